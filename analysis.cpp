@@ -0,0 +1,238 @@
+/**********************************************************
+ *  Orator - analysis.cpp
+ *
+ *  Band-level analysis thread (see analysis.h).
+ **********************************************************/
+#include "analysis.h"
+#include "ringbuffer.h"
+#include "triplebuffer.h"
+#include "arena.h"
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Level mapping: ANALYSIS_FLOOR_DB .. 0 dBFS -> 0 .. 1
+#define ANALYSIS_FLOOR_DB 48.0f
+// Envelope: fraction of the way to the new level per block
+#define ANALYSIS_ATTACK   0.6f
+#define ANALYSIS_RELEASE  0.15f
+
+struct AnalysisState {
+    std::atomic<bool> active;       // analysisPush() may write
+    std::atomic<bool> stopRequested;
+    int sampleRate;
+    int channels;
+    AudioRing tap;                  // Callback -> analysis thread
+    std::thread worker;
+    TripleBuffer<AudioLevels> levels;   // Analysis thread -> simulation thread
+
+    std::atomic<unsigned long> blocks;
+    std::atomic<unsigned long> droppedSamples;
+    std::atomic<unsigned long long> blockNs;   // Sum over all blocks
+};
+
+static AnalysisState analysis;
+
+/**********************************************************
+ * toLevel(...) - Linear amplitude -> [0, 1] on a dB scale
+ **********************************************************/
+static float toLevel(float amplitude)
+{
+    if (amplitude <= 1.0e-9f) return 0.0f;
+    float level = (20.0f * log10f(amplitude) + ANALYSIS_FLOOR_DB) / ANALYSIS_FLOOR_DB;
+    return level < 0.0f ? 0.0f : (level > 1.0f ? 1.0f : level);
+}
+
+/**********************************************************
+ * bandAmplitude(...) - Sine amplitude with this band's energy
+ *
+ * A Hann-windowed sine of amplitude A has |X| = A*N/4 at its
+ * bin and A*N/8 at both neighbours: energy (A*N/4)^2 * 1.5.
+ **********************************************************/
+static float bandAmplitude(const float* re, const float* im, int firstBin, int lastBin)
+{
+    float energy = 0.0f;
+    for (int k = firstBin; k <= lastBin; ++k)
+        energy += re[k] * re[k] + im[k] * im[k];
+    return 4.0f / ANALYSIS_FFT_SIZE * sqrtf(energy / 1.5f);
+}
+
+/**********************************************************
+ * follow(...) - Fast attack, slow release envelope
+ **********************************************************/
+static float follow(float current, float target)
+{
+    float rate = target > current ? ANALYSIS_ATTACK : ANALYSIS_RELEASE;
+    return current + (target - current) * rate;
+}
+
+/**********************************************************
+ * analysisMain() - Downmix, window, FFT, bands, publish
+ **********************************************************/
+static void analysisMain()
+{
+    typedef std::chrono::steady_clock Clock;
+    const int N = ANALYSIS_FFT_SIZE;
+    const int channels = analysis.channels;
+
+    FftPlan plan;
+    fftInit(plan, N);
+    std::vector<float> window(N), history(N, 0.0f);
+    for (int i = 0; i < N; ++i)
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / N);
+    std::vector<float> block(ANALYSIS_HOP * channels);
+
+    // Band edges in bins
+    float binHz = (float)analysis.sampleRate / N;
+    int bassLo = (int)(30.0f / binHz + 0.5f),  bassHi = (int)(150.0f / binHz + 0.5f);
+    int midLo  = bassHi + 1,                   midHi  = (int)(500.0f / binHz + 0.5f);
+    if (bassLo < 1) bassLo = 1;
+    if (midHi > N / 2) midHi = N / 2;
+
+    // Poll a few times per hop while waiting for samples
+    std::chrono::microseconds idle((long long)ANALYSIS_HOP * 250000 / analysis.sampleRate);
+
+    int filled = 0;   // Valid samples in history (until it is full)
+    AudioLevels current;
+    memset(&current, 0, sizeof(current));
+
+    while (!analysis.stopRequested.load(std::memory_order_relaxed)) {
+        if (ringFill(analysis.tap) < block.size()) {
+            std::this_thread::sleep_for(idle);
+            continue;
+        }
+        ringRead(analysis.tap, block.data(), block.size());
+
+        // Slide the history and append the mono downmix
+        memmove(history.data(), history.data() + ANALYSIS_HOP, (N - ANALYSIS_HOP) * sizeof(float));
+        float* tail = history.data() + N - ANALYSIS_HOP;
+        float sumSquares = 0.0f;
+        for (int i = 0; i < ANALYSIS_HOP; ++i) {
+            float mono = 0.0f;
+            for (int c = 0; c < channels; ++c)
+                mono += block[i * channels + c];
+            mono /= channels;
+            tail[i] = mono;
+            sumSquares += mono * mono;
+        }
+        if (filled < N) {
+            filled += ANALYSIS_HOP;
+            if (filled < N) continue;
+        }
+
+        Clock::time_point start = Clock::now();
+        // Spectrum of this block, in the thread's arena
+        float* re = arenaArray<float>(N);
+        float* im = arenaArray<float>(N);
+        for (int i = 0; i < N; ++i) {
+            re[i] = history[i] * window[i];
+            im[i] = 0.0f;
+        }
+        fftForward(plan, re, im);
+
+        // RMS of a sine is A/sqrt(2); report it on the same scale
+        float rmsAmplitude = sqrtf(2.0f * sumSquares / ANALYSIS_HOP);
+        current.bass   = follow(current.bass,   toLevel(bandAmplitude(re, im, bassLo, bassHi)));
+        current.lowMid = follow(current.lowMid, toLevel(bandAmplitude(re, im, midLo, midHi)));
+        current.rms    = follow(current.rms,    toLevel(rmsAmplitude));
+        current.sequence++;
+        arenaReset();
+
+        tripleWriteSlot(analysis.levels) = current;
+        triplePublish(analysis.levels);
+
+        analysis.blockNs.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(),
+            std::memory_order_relaxed);
+        analysis.blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+    arenaRelease();
+}
+
+/**********************************************************
+ * analysisStart(...) - Tap ring + worker thread
+ **********************************************************/
+bool analysisStart(int sampleRate, int channels)
+{
+    if (analysis.active.load() || sampleRate <= 0 || channels < 1)
+        return false;
+    // Room for a few hops, so a late wake-up does not drop samples
+    if (!ringInit(analysis.tap, (size_t)ANALYSIS_FFT_SIZE * 2 * channels))
+        return false;
+
+    analysis.sampleRate = sampleRate;
+    analysis.channels   = channels;
+    analysis.blocks.store(0);
+    analysis.droppedSamples.store(0);
+    analysis.blockNs.store(0);
+    analysis.stopRequested.store(false);
+    analysis.worker = std::thread(analysisMain);
+    analysis.active.store(true, std::memory_order_release);
+    return true;
+}
+
+/**********************************************************
+ * analysisStop() - Call once the audio callback is stopped
+ **********************************************************/
+void analysisStop()
+{
+    if (!analysis.active.load())
+        return;
+    analysis.active.store(false);
+    analysis.stopRequested.store(true);
+    analysis.worker.join();
+    ringFree(analysis.tap);
+}
+
+/**********************************************************
+ * analysisRunning() - True between start and stop
+ **********************************************************/
+bool analysisRunning()
+{
+    return analysis.active.load(std::memory_order_relaxed);
+}
+
+/**********************************************************
+ * analysisPush(...) - Audio callback: copy into the tap
+ **********************************************************/
+void analysisPush(const float* samples, size_t count)
+{
+    if (!analysis.active.load(std::memory_order_acquire) || count == 0)
+        return;
+    size_t written = ringWrite(analysis.tap, samples, count);
+    if (written < count)
+        analysis.droppedSamples.fetch_add(count - written, std::memory_order_relaxed);
+}
+
+/**********************************************************
+ * analysisLatest(...) - Simulation thread: newest levels
+ **********************************************************/
+bool analysisLatest(AudioLevels& levels)
+{
+    if (!analysis.active.load(std::memory_order_relaxed))
+        return false;
+    const AudioLevels* latest;
+    tripleRead(analysis.levels, &latest);
+    levels = *latest;
+    return levels.sequence > 0;
+}
+
+/**********************************************************
+ * analysisGetStats(...) - Counters for bench output
+ **********************************************************/
+void analysisGetStats(AnalysisStats& stats)
+{
+    stats.blocks         = analysis.blocks.load(std::memory_order_relaxed);
+    stats.droppedSamples = analysis.droppedSamples.load(std::memory_order_relaxed);
+    stats.meanBlockUs    = stats.blocks
+        ? analysis.blockNs.load(std::memory_order_relaxed) / 1000.0 / stats.blocks : 0.0;
+    stats.backend        = fftCurrentBackend();
+}
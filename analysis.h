@@ -0,0 +1,54 @@
+/**********************************************************
+ *  Orator - analysis.h
+ *
+ *  Audio analysis for the audio-reactive speaker. The SDL
+ *  callback copies what it plays into a tap ring (one
+ *  memcpy, no locks). A separate thread downmixes it,
+ *  applies a Hann window every ANALYSIS_HOP samples and runs
+ *  a SIMD FFT (fft.h). It turns the spectrum into a few
+ *  smoothed band levels and publishes them through a
+ *  wait-free triple buffer. The simulation thread only
+ *  reads the latest levels into its scene snapshot; neither
+ *  it nor the render thread does any DSP.
+ **********************************************************/
+#ifndef ORATOR_ANALYSIS_H
+#define ORATOR_ANALYSIS_H
+
+#include "fft.h"
+
+#include <stddef.h>
+
+#define ANALYSIS_FFT_SIZE 2048   // ~46 ms at 44.1 kHz, ~21 Hz per bin
+#define ANALYSIS_HOP      512    // New block every ~11.6 ms
+
+// Smoothed levels in [0, 1] (0 = -48 dBFS or less, 1 = 0 dBFS)
+struct AudioLevels {
+    float bass;       // 30-150 Hz
+    float lowMid;     // 150-500 Hz
+    float rms;        // Whole block, time domain
+    unsigned long sequence;   // Blocks analysed so far (0 = none yet)
+};
+
+struct AnalysisStats {
+    unsigned long blocks;
+    unsigned long droppedSamples;   // Tap ring was full
+    double meanBlockUs;             // Window + FFT + bands
+    FftBackend backend;
+};
+
+// Called by the audio engine before playback starts / after it stops
+bool analysisStart(int sampleRate, int channels);
+void analysisStop();
+bool analysisRunning();
+
+// Audio callback side: copies interleaved samples into the tap
+// ring. Wait-free; samples that do not fit are dropped.
+void analysisPush(const float* samples, size_t count);
+
+// Simulation thread side (simulation.h): latest levels. Returns
+// false while analysis is off or nothing has been analysed yet.
+bool analysisLatest(AudioLevels& levels);
+
+void analysisGetStats(AnalysisStats& stats);
+
+#endif // ORATOR_ANALYSIS_H
@@ -0,0 +1,252 @@
+/**********************************************************
+ *  Orator - arena.cpp
+ *
+ *  Per-thread frame arenas and the heap allocation counters
+ *  (see arena.h). The arena state is thread_local plain
+ *  data, so a thread's arena needs no setup and no lock.
+ **********************************************************/
+#include "arena.h"
+
+#include <stdint.h>   // uintptr_t
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>        // std::bad_alloc, std::nothrow_t, std::get_new_handler
+
+// Chunk header; the data follows it
+struct ArenaChunk {
+    ArenaChunk* next;      // Older chunk
+    size_t capacity;       // Data bytes
+    size_t used;
+};
+
+struct FrameArena {
+    ArenaChunk* head;      // Newest chunk, allocations come from it
+    size_t frameBytes;
+    size_t peakBytes;
+    size_t capacity;
+    unsigned long growths;
+};
+
+static thread_local FrameArena arena;
+
+static thread_local unsigned long threadHeapAllocations;
+static std::atomic<unsigned long> totalHeapAllocations(0);
+
+/**********************************************************
+ * countedMalloc(...) - malloc that shows up in the counters
+ **********************************************************/
+static void* countedMalloc(size_t bytes)
+{
+    threadHeapAllocations++;
+    totalHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(bytes ? bytes : 1);
+}
+
+/**********************************************************
+ * addChunk(...) - Chain a chunk of at least 'bytes'
+ **********************************************************/
+static void addChunk(size_t bytes)
+{
+    ArenaChunk* chunk = (ArenaChunk*)countedMalloc(sizeof(ArenaChunk) + bytes);
+    if (!chunk) {
+        fprintf(stderr, "Frame arena: out of memory (%zu bytes)\n", bytes);
+        abort();
+    }
+    if (arena.head)
+        arena.growths++;
+    chunk->next     = arena.head;
+    chunk->capacity = bytes;
+    chunk->used     = 0;
+    arena.head      = chunk;
+    arena.capacity += bytes;
+}
+
+/**********************************************************
+ * freeChunks() - Back to the heap, all of them
+ **********************************************************/
+static void freeChunks()
+{
+    while (arena.head) {
+        ArenaChunk* next = arena.head->next;
+        free(arena.head);
+        arena.head = next;
+    }
+    arena.capacity = 0;
+}
+
+/**********************************************************
+ * arenaAlloc(...) - Bump allocation from the newest chunk
+ **********************************************************/
+void* arenaAlloc(size_t bytes, size_t align)
+{
+    for (;;) {
+        if (arena.head) {
+            ArenaChunk* chunk = arena.head;
+            uintptr_t data  = (uintptr_t)(chunk + 1);
+            uintptr_t start = (data + chunk->used + align - 1) & ~(uintptr_t)(align - 1);
+            if (start + bytes <= data + chunk->capacity) {
+                chunk->used = start + bytes - data;
+                arena.frameBytes += bytes;
+                if (arena.frameBytes > arena.peakBytes)
+                    arena.peakBytes = arena.frameBytes;
+                return (void*)start;
+            }
+        }
+        // Does not fit: a chunk twice the last, or just big enough
+        size_t size = arena.head ? 2 * arena.head->capacity : ARENA_CHUNK_BYTES;
+        if (size < bytes + align)
+            size = bytes + align;
+        addChunk(size);
+    }
+}
+
+/**********************************************************
+ * arenaReset() - Start over; merge the chunks if it grew
+ **********************************************************/
+void arenaReset()
+{
+    if (arena.head && arena.head->next) {
+        // Room for the busiest frame plus alignment slack
+        size_t size = arena.capacity;
+        freeChunks();
+        addChunk(size);
+    } else if (arena.head) {
+        arena.head->used = 0;
+    }
+    arena.frameBytes = 0;
+}
+
+/**********************************************************
+ * arenaMark() / arenaRewind(...) - Scoped scratch
+ *
+ * If the arena grew in between, the newer chunk stays in use
+ * until the next reset merges it.
+ **********************************************************/
+ArenaMark arenaMark()
+{
+    ArenaMark mark = { arena.head, arena.head ? arena.head->used : 0, arena.frameBytes };
+    return mark;
+}
+
+void arenaRewind(const ArenaMark& mark)
+{
+    if (arena.head != mark.chunk)
+        return;
+    if (arena.head)
+        arena.head->used = mark.used;
+    arena.frameBytes = mark.frameBytes;
+}
+
+/**********************************************************
+ * arenaRelease() - Before the thread exits
+ **********************************************************/
+void arenaRelease()
+{
+    freeChunks();
+    arena.frameBytes = 0;
+}
+
+/**********************************************************
+ * arenaGetStats(...) - The calling thread's arena
+ **********************************************************/
+void arenaGetStats(ArenaStats& stats)
+{
+    stats.frameBytes = arena.frameBytes;
+    stats.peakBytes  = arena.peakBytes;
+    stats.capacity   = arena.capacity;
+    stats.growths    = arena.growths;
+}
+
+unsigned long heapAllocations()
+{
+    return threadHeapAllocations;
+}
+
+unsigned long heapAllocationsTotal()
+{
+    return totalHeapAllocations.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// COUNTED OPERATOR NEW
+// --------------------------------------------------------
+// Replaces the global allocation functions, so every
+// container, string and new expression is counted. Plain
+// malloc calls (C code, the GL driver) are not.
+//
+// Every delete that can receive a block from these must be
+// replaced too, including the sized ones that C++14 code
+// (the driver's LLVM, for one) calls. Otherwise the
+// runtime's delete frees our malloc blocks, which
+// AddressSanitizer reports as an alloc-dealloc mismatch.
+// The std::align_val_t forms (C++17, not declared with
+// -std=c++11) are left to the runtime: they only ever get
+// blocks from the runtime's own aligned new, never ours.
+// Those allocations are not counted.
+
+// Out of memory, the installed new_handler gets a chance to
+// free some and the allocation is retried, as the standard
+// operator new does; without a handler it throws.
+
+void* operator new(size_t bytes)
+{
+    for (;;) {
+        void* p = countedMalloc(bytes);
+        if (p)
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](size_t bytes)
+{
+    return operator new(bytes);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+    try {
+        return operator new(bytes);
+    } catch (const std::bad_alloc&) {
+        return NULL;   // Thrown by us or by the new_handler
+    }
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+    return operator new(bytes, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
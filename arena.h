@@ -0,0 +1,73 @@
+/**********************************************************
+ *  Orator - arena.h
+ *
+ *  Frame arena: a bump allocator for data that only lives
+ *  until the end of a frame (visibility masks, instance
+ *  matrices, shadow outlines) or of an analysis block.
+ *  Every thread has its own arena, so there is no locking;
+ *  the render thread resets its arena at the swap, and the
+ *  analysis thread after every block.
+ *
+ *  An allocation that does not fit chains another chunk from
+ *  the heap. At the next reset the chunks are merged into
+ *  one as big as the busiest frame so far, so after the
+ *  first few frames the arena never touches the heap.
+ *
+ *  Also counts heap allocations (operator new and the
+ *  arena's own chunks) per thread, so the bench can show
+ *  that a steady frame allocates nothing.
+ **********************************************************/
+#ifndef ORATOR_ARENA_H
+#define ORATOR_ARENA_H
+
+#include <stddef.h>
+
+// Size of a thread's first chunk
+#define ARENA_CHUNK_BYTES (256 * 1024)
+
+// Alignment of every allocation unless asked for more
+// (enough for SSE loads and mat4)
+#define ARENA_ALIGN 16
+
+struct ArenaStats {
+    size_t frameBytes;       // Handed out since the last reset
+    size_t peakBytes;        // Most handed out in one frame
+    size_t capacity;         // Of all chunks
+    unsigned long growths;   // Chunks added after the first
+};
+
+// Uninitialised memory, valid until this thread's next
+// arenaReset(); never NULL (aborts if the heap is out)
+void* arenaAlloc(size_t bytes, size_t align = ARENA_ALIGN);
+
+template <typename T>
+T* arenaArray(size_t count)
+{
+    return (T*)arenaAlloc(count * sizeof(T), alignof(T) > ARENA_ALIGN ? alignof(T) : ARENA_ALIGN);
+}
+
+// Frees everything this thread allocated from its arena
+void arenaReset();
+
+// Scratch inside a frame, or where no frame ends (the
+// startup and kernel benchmarks): everything allocated after
+// arenaMark() is handed back by arenaRewind()
+struct ArenaMark {
+    void*  chunk;
+    size_t used;
+    size_t frameBytes;
+};
+ArenaMark arenaMark();
+void arenaRewind(const ArenaMark& mark);
+
+// Gives the chunks back to the heap (before a thread exits)
+void arenaRelease();
+
+// The calling thread's arena
+void arenaGetStats(ArenaStats& stats);
+
+// Heap allocations by the calling thread / all threads
+unsigned long heapAllocations();
+unsigned long heapAllocationsTotal();
+
+#endif // ORATOR_ARENA_H
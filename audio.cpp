@@ -0,0 +1,748 @@
+/**********************************************************
+ *  Orator - audio.cpp
+ *
+ *  SDL2 streaming playback of one or more mixed sources
+ *  (see audio.h).
+ *
+ *  Threads:
+ *    decoder  - mapped PCM -> floats (-> resampler, if the
+ *               file's rate is not the device's), into
+ *               every source's ring; sleeps while all
+ *               rings are full
+ *    SDL      - audioCallback(): rings -> mixer (mixer.h) ->
+ *               16-bit device buffer, and a copy of the
+ *               float mix into the analysis tap
+ *    analysis - FFT band levels (analysis.cpp)
+ *    main     - start/stop, source gains, reading counters
+ **********************************************************/
+#include "audio.h"
+#include "analysis.h"
+#include "audiotiming.h"
+#include "mixer.h"
+#include "resampler.h"
+#include "ringbuffer.h"
+#include "wav.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>    // sysconf
+
+// Most frames the decoder converts into one ring before
+// moving on to the next source
+#define DECODE_CHUNK_FRAMES 1024
+
+// Most channels a source may have (only the first two are mixed)
+#define AUDIO_MAX_CHANNELS 8
+
+// Most different file rates in one mix (one filter each)
+#define AUDIO_MAX_RATES 8
+
+// One file being played
+struct AudioSource {
+    WavSource         wav;
+    AudioRing         ring;
+    std::atomic<bool> done;   // Decoder wrote its last sample
+
+    // Decoder thread only, for files not at the device rate
+    bool               resampling;
+    bool               inputEnded;   // Resampler has the last frame
+    Resampler          resampler;
+    std::vector<float> decoded;      // One chunk of converted PCM
+};
+
+// Everything the three threads share
+struct AudioEngine {
+    bool              running;
+    SDL_AudioDeviceID device;
+    SDL_AudioSpec     spec;          // As obtained
+    AudioSource       sources[MIXER_MAX_SOURCES];   // Static: the rings are cache-line aligned
+    int               sourceCount;
+    ResampleFilter    filters[AUDIO_MAX_RATES];     // Shared by sources of one rate
+    int               filterCount;
+    int               resampledCount;
+    ResampleQuality   resampleQuality;
+    float*            mix;           // Callback: stereo float block
+    float*            scratch;       // Callback: frames of a >2 channel source
+    bool              loop;
+    std::thread       decoder;
+
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> decoderDone;   // Every source is done
+
+    // Written by the callback only; relaxed is enough for counters
+    std::atomic<unsigned long> callbacks;
+    std::atomic<unsigned long> framesPlayed;
+    std::atomic<unsigned long> underruns;
+    std::atomic<unsigned long> underrunFrames;
+    std::atomic<unsigned long long> mixNs;      // Sum over all callbacks
+    std::atomic<unsigned long long> mixNsMax;
+
+    // One point per callback (audiotiming.h); the callback
+    // fills the table, the count publishes the points
+    const char*       timingCsv;       // Written by audioStop()
+    bool              timingHistograms;
+    std::vector<AudioTimingPoint> timing;
+    std::atomic<size_t> timingCount;
+    std::chrono::steady_clock::time_point firstCallback;
+    std::chrono::steady_clock::time_point lastCallback;
+};
+
+static AudioEngine engine;
+
+// --------------------------------------------------------
+// SDL CALLBACK (real-time: no locks, no allocation, no I/O)
+// --------------------------------------------------------
+
+/**********************************************************
+ * mixSource(...) - One source's frames into the mix
+ *
+ * Mono and stereo are mixed straight from the ring storage
+ * (at most two pieces, at the wrap-around). Wider files are
+ * copied out first, since their frames may straddle the
+ * wrap. Returns the frames the ring had.
+ **********************************************************/
+static size_t mixSource(int k, size_t frames)
+{
+    AudioSource& src = engine.sources[k];
+    int channels = src.wav.channels;
+    size_t got = 0;
+
+    if (channels <= 2) {
+        while (got < frames) {
+            const float* region;
+            size_t n = ringReadRegion(src.ring, &region) / channels;
+            if (n == 0) break;
+            if (n > frames - got) n = frames - got;
+            mixerAddSource(k, engine.mix + 2 * got, region, n, channels);
+            ringCommitRead(src.ring, n * channels);
+            got += n;
+        }
+    } else {
+        size_t available = ringFill(src.ring) / channels;
+        got = available < frames ? available : frames;
+        ringRead(src.ring, engine.scratch, got * channels);
+        mixerAddSource(k, engine.mix, engine.scratch, got, channels);
+    }
+    if (got == 0)
+        mixerSkipSource(k);
+    return got;
+}
+
+/**********************************************************
+ * audioCallback(...) - Mixes one device buffer
+ **********************************************************/
+static void SDLCALL audioCallback(void* userdata, Uint8* stream, int len)
+{
+    typedef std::chrono::steady_clock Clock;
+    (void)userdata;
+    Clock::time_point start = Clock::now();
+
+    size_t frames = (size_t)len / (2 * sizeof(int16_t));
+    memset(engine.mix, 0, frames * 2 * sizeof(float));
+    mixerBeginBlock();
+
+    size_t played = 0, shortest = frames, fill = 0;
+    bool anyPlaying = false;
+    for (int k = 0; k < engine.sourceCount; ++k) {
+        // Check for the end *before* reading: if the decoder is
+        // done now, whatever is in the ring is all that will come
+        AudioSource& src = engine.sources[k];
+        bool done = src.done.load(std::memory_order_acquire);
+        if (!done) {
+            size_t f = ringFill(src.ring) / src.wav.channels;
+            if (!anyPlaying || f < fill) fill = f;
+            anyPlaying = true;
+        }
+        size_t got = mixSource(k, frames);
+        if (got > played) played = got;
+        if (!done && got < shortest) shortest = got;
+    }
+
+    mixerFinishBlock(engine.mix, (int16_t*)stream, frames);
+    analysisPush(engine.mix, played * 2);
+
+    if (shortest < frames) {
+        engine.underruns.fetch_add(1, std::memory_order_relaxed);
+        engine.underrunFrames.fetch_add(frames - shortest, std::memory_order_relaxed);
+    }
+    engine.callbacks.fetch_add(1, std::memory_order_relaxed);
+    engine.framesPlayed.fetch_add(played, std::memory_order_relaxed);
+
+    unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+    engine.mixNs.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > engine.mixNsMax.load(std::memory_order_relaxed))
+        engine.mixNsMax.store(ns, std::memory_order_relaxed);
+
+    // Record the callback while the table has room
+    size_t n = engine.timingCount.load(std::memory_order_relaxed);
+    if (n == 0)
+        engine.firstCallback = engine.lastCallback = start;
+    if (n < engine.timing.size()) {
+        AudioTimingPoint& p = engine.timing[n];
+        p.timeUs      = std::chrono::duration<double, std::micro>(start - engine.firstCallback).count();
+        p.intervalUs  = std::chrono::duration<float, std::micro>(start - engine.lastCallback).count();
+        p.callbackUs  = ns / 1000.0f;
+        p.ringFill    = (int)fill;
+        p.shortFrames = (int)(frames - shortest);
+        engine.timingCount.store(n + 1, std::memory_order_release);
+    }
+    engine.lastCallback = start;
+}
+
+// --------------------------------------------------------
+// DECODER THREAD
+// --------------------------------------------------------
+
+/**********************************************************
+ * nextSamples(...) - Next slice of the file, looping if asked
+ **********************************************************/
+static size_t nextSamples(AudioSource& src, size_t maxSamples, const unsigned char** pcm)
+{
+    size_t count = wavNextSamples(src.wav, maxSamples, pcm);
+    if (count == 0 && engine.loop && wavRewind(src.wav))
+        count = wavNextSamples(src.wav, maxSamples, pcm);
+    return count;
+}
+
+/**********************************************************
+ * topUpResampled(...) - topUp() through the resampler
+ *
+ * Converted output goes straight into the ring. When the
+ * resampler has no full filter's worth of input left, one
+ * chunk of the file is converted to floats and fed to it.
+ *
+ * The resampler writes whole frames, but with 3, 5, 6 or 7
+ * channels a frame can straddle the ring's wrap-around. Less
+ * than a frame before the end, one frame goes through a
+ * small buffer and ringWrite() splits it.
+ **********************************************************/
+static bool topUpResampled(AudioSource& src, float* region, size_t space)
+{
+    int channels = src.wav.channels;
+    size_t frames;
+    if (space >= (size_t)channels) {
+        frames = resampleRead(src.resampler, region, space / channels);
+        if (frames > 0)
+            ringCommitWrite(src.ring, frames * channels);
+    } else {
+        if (ringSpace(src.ring) < (size_t)channels)
+            return false;   // Wait for the callback to free a frame
+        float frame[AUDIO_MAX_CHANNELS];
+        frames = resampleRead(src.resampler, frame, 1);
+        if (frames > 0)
+            ringWrite(src.ring, frame, channels);
+    }
+    if (frames > 0)
+        return true;
+    if (src.inputEnded) {
+        src.done.store(true, std::memory_order_release);   // Flushed
+        return false;
+    }
+
+    size_t want = resampleSpace(src.resampler);
+    if (want == 0)
+        return false;   // Full of input: not the end of the file
+    if (want > DECODE_CHUNK_FRAMES) want = DECODE_CHUNK_FRAMES;
+    const unsigned char* pcm;
+    size_t count = nextSamples(src, want * channels, &pcm);
+    if (count == 0) {
+        resampleFinish(src.resampler);
+        src.inputEnded = true;
+        return true;
+    }
+    wavConvert(src.wav, pcm, count, &src.decoded[0]);
+    resampleWrite(src.resampler, &src.decoded[0], count / channels);
+    return true;
+}
+
+/**********************************************************
+ * topUp(...) - One chunk into one source's ring
+ *
+ * Samples go from the mapped file straight into the ring's
+ * own storage: wavConvert() (or the resampler) is the only
+ * pass over them. Returns false if nothing could be written.
+ **********************************************************/
+static bool topUp(AudioSource& src)
+{
+    if (src.done.load(std::memory_order_relaxed))
+        return false;
+    float* region;
+    size_t space = ringWriteRegion(src.ring, &region);
+    if (space == 0)
+        return false;
+    // Publish in small steps so the callback sees new data early
+    size_t chunkSamples = DECODE_CHUNK_FRAMES * (size_t)src.wav.channels;
+    if (space > chunkSamples) space = chunkSamples;
+    if (src.resampling)
+        return topUpResampled(src, region, space);
+
+    const unsigned char* pcm;
+    size_t count = nextSamples(src, space, &pcm);
+    if (count == 0) {
+        src.done.store(true, std::memory_order_release);   // End of file
+        return false;
+    }
+    wavConvert(src.wav, pcm, count, region);
+    ringCommitWrite(src.ring, count);
+    return true;
+}
+
+/**********************************************************
+ * decoderMain() - Keeps every ring topped up
+ **********************************************************/
+static void decoderMain()
+{
+    // While every ring is full, wait about half a device buffer
+    std::chrono::microseconds idle(
+        (long long)engine.spec.samples * 500000 / engine.spec.freq);
+
+    while (!engine.stopRequested.load(std::memory_order_relaxed)) {
+        bool wrote = false, allDone = true;
+        for (int k = 0; k < engine.sourceCount; ++k) {
+            wrote |= topUp(engine.sources[k]);
+            allDone &= engine.sources[k].done.load(std::memory_order_relaxed);
+        }
+        if (allDone)
+            break;
+        if (!wrote)
+            std::this_thread::sleep_for(idle);
+    }
+    engine.decoderDone.store(true, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// CONTROL (main thread)
+// --------------------------------------------------------
+
+/**********************************************************
+ * residentBytes() - Resident set size of the whole process
+ **********************************************************/
+static size_t residentBytes()
+{
+    unsigned long size = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(f);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/**********************************************************
+ * closeSources(...) - Unmaps files and frees rings
+ **********************************************************/
+static void closeSources()
+{
+    for (int k = 0; k < engine.sourceCount; ++k) {
+        AudioSource& src = engine.sources[k];
+        ringFree(src.ring);
+        wavClose(src.wav);
+        std::vector<float>().swap(src.decoded);
+        std::vector<float>().swap(src.resampler.history);
+    }
+    for (int i = 0; i < engine.filterCount; ++i)
+        std::vector<float>().swap(engine.filters[i].coeffs);
+    engine.sourceCount = 0;
+    engine.filterCount = 0;
+    engine.resampledCount = 0;
+}
+
+/**********************************************************
+ * startResamplers(...) - A converter per off-rate source
+ *
+ * Sources with the same file rate share one filter.
+ **********************************************************/
+static bool startResamplers(int deviceRate, ResampleQuality quality)
+{
+    engine.resampleQuality = quality;
+    for (int k = 0; k < engine.sourceCount; ++k) {
+        AudioSource& src = engine.sources[k];
+        src.resampling = src.wav.sampleRate != deviceRate;
+        src.inputEnded = false;
+        if (!src.resampling)
+            continue;
+
+        ResampleFilter* filter = NULL;
+        for (int i = 0; i < engine.filterCount && !filter; ++i)
+            if (engine.filters[i].inRate == src.wav.sampleRate)
+                filter = &engine.filters[i];
+        if (!filter) {
+            if (engine.filterCount == AUDIO_MAX_RATES) {
+                fprintf(stderr, "At most %d different sample rates can be mixed\n", AUDIO_MAX_RATES);
+                return false;
+            }
+            filter = &engine.filters[engine.filterCount];
+            if (!resampleFilterInit(*filter, src.wav.sampleRate, deviceRate, quality))
+                return false;
+            engine.filterCount++;
+        }
+        resamplerInit(src.resampler, *filter, src.wav.channels);
+        src.decoded.assign(DECODE_CHUNK_FRAMES * (size_t)src.wav.channels, 0.0f);
+        engine.resampledCount++;
+    }
+    return true;
+}
+
+/**********************************************************
+ * openSources(...) - One mapping + ring per source
+ *
+ * Source k plays file k % files. The rates may differ: the
+ * resamplers are set up once the device rate is known.
+ **********************************************************/
+static bool openSources(const AudioOptions& options)
+{
+    int files = (int)options.wavPaths.size();
+    int count = options.sources > 0 ? options.sources : files;
+    if (count > MIXER_MAX_SOURCES) {
+        fprintf(stderr, "At most %d audio sources can be mixed\n", MIXER_MAX_SOURCES);
+        return false;
+    }
+
+    engine.sourceCount = 0;
+    engine.filterCount = 0;
+    engine.resampledCount = 0;
+    for (int k = 0; k < count; ++k) {
+        AudioSource& src = engine.sources[k];
+        const char* path = options.wavPaths[k % files];
+        if (!wavOpen(src.wav, path)) {
+            closeSources();
+            return false;
+        }
+        engine.sourceCount = k + 1;
+        src.ring.data = NULL;
+        src.done.store(false);
+
+        if (src.wav.channels > AUDIO_MAX_CHANNELS) {
+            fprintf(stderr, "%s: %d channels; at most %d can be played\n",
+                    path, src.wav.channels, AUDIO_MAX_CHANNELS);
+            closeSources();
+            return false;
+        }
+        // Copies of one file start at different places
+        if (k >= files)
+            wavSeekFrame(src.wav, (size_t)(k / files) * AUDIO_SOURCE_STAGGER_FRAMES);
+        if (!ringInit(src.ring, (size_t)options.ringFrames * src.wav.channels)) {
+            fprintf(stderr, "Cannot allocate the audio ring\n");
+            closeSources();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**********************************************************
+ * audioStart(...) - Files + device + decoder, then play
+ **********************************************************/
+bool audioStart(const AudioOptions& options)
+{
+    if (engine.running || options.wavPaths.empty())
+        return false;
+
+    if (!openSources(options))
+        return false;
+
+    // SDL reads the driver name when the audio subsystem starts
+    if (options.driver)
+        SDL_setenv("SDL_AUDIODRIVER", options.driver, 1);
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        fprintf(stderr, "SDL audio init failed: %s\n", SDL_GetError());
+        closeSources();
+        return false;
+    }
+
+    // Dithered 16-bit stereo, at --audio-rate or the first
+    // file's rate. The device may pick another rate (its own):
+    // the files are then resampled here, by the decoder, and
+    // SDL never converts. Format and channels are fixed, so the
+    // callback always sees exactly this layout.
+    SDL_AudioSpec want;
+    SDL_zero(want);
+    want.freq     = options.sampleRate > 0 ? options.sampleRate
+                                           : engine.sources[0].wav.sampleRate;
+    want.format   = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples  = (Uint16)options.deviceFrames;
+    want.callback = audioCallback;
+
+    engine.device = SDL_OpenAudioDevice(NULL, 0, &want, &engine.spec,
+                                        SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (engine.device == 0) {
+        fprintf(stderr, "Cannot open audio device: %s\n", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        closeSources();
+        return false;
+    }
+    if (!startResamplers(engine.spec.freq, options.resampleQuality)) {
+        SDL_CloseAudioDevice(engine.device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        closeSources();
+        return false;
+    }
+
+    // Callback buffers, sized for the largest block SDL may ask for
+    engine.mix     = new float[2 * (size_t)engine.spec.samples];
+    engine.scratch = new float[AUDIO_MAX_CHANNELS * (size_t)engine.spec.samples];
+
+    // Every source starts centered; the render thread pans them
+    mixerInit(engine.sourceCount);
+    for (int k = 0; k < engine.sourceCount; ++k)
+        mixerSetGains(k, 1.0f, 1.0f);
+
+    engine.loop = options.loop;
+    engine.stopRequested.store(false);
+    engine.decoderDone.store(false);
+    engine.callbacks.store(0);
+    engine.framesPlayed.store(0);
+    engine.underruns.store(0);
+    engine.underrunFrames.store(0);
+    engine.mixNs.store(0);
+    engine.mixNsMax.store(0);
+    engine.timing.assign(AUDIO_TIMING_CALLBACKS, AudioTimingPoint());
+    engine.timingCount.store(0);
+    engine.timingCsv        = options.timingCsv;
+    engine.timingHistograms = options.timingHistograms;
+    engine.decoder = std::thread(decoderMain);
+    engine.running = true;
+    if (options.analysis && !analysisStart(engine.spec.freq, engine.spec.channels))
+        fprintf(stderr, "Audio analysis could not start\n");
+
+    // Prime: let the decoder fill half of every ring (or finish a
+    // short file) before the device starts pulling, so start-up
+    // does not count as an underrun. Give up after a second.
+    for (int i = 0; i < 1000; ++i) {
+        bool primed = true;
+        for (int k = 0; k < engine.sourceCount; ++k) {
+            const AudioSource& src = engine.sources[k];
+            primed &= ringFill(src.ring) >= src.ring.capacity / 2 ||
+                      src.done.load(std::memory_order_acquire);
+        }
+        if (primed)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    SDL_PauseAudioDevice(engine.device, 0);
+    return true;
+}
+
+/**********************************************************
+ * audioStop() - Silence, join and release everything
+ **********************************************************/
+void audioStop()
+{
+    if (!engine.running)
+        return;
+
+    // Closing the device waits for a running callback to return
+    SDL_CloseAudioDevice(engine.device);
+    analysisStop();
+    engine.stopRequested.store(true);
+    engine.decoder.join();
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+
+    // The callback has stopped, so the table is complete
+    if (engine.timingCsv) {
+        size_t count = engine.timingCount.load(std::memory_order_acquire);
+        if (audioTimingWriteCsv(engine.timingCsv, &engine.timing[0], count,
+                                1.0e6 * engine.spec.samples / engine.spec.freq,
+                                (int)(engine.sources[0].ring.capacity / engine.sources[0].wav.channels)))
+            printf("Audio timing  : %lu callbacks written to %s-callbacks.csv and %s-histograms.csv\n",
+                   (unsigned long)count, engine.timingCsv, engine.timingCsv);
+    }
+    std::vector<AudioTimingPoint>().swap(engine.timing);
+
+    delete[] engine.mix;
+    delete[] engine.scratch;
+    engine.mix = engine.scratch = NULL;
+    closeSources();
+    engine.running = false;
+}
+
+/**********************************************************
+ * audioRunning() - True between audioStart and audioStop
+ **********************************************************/
+bool audioRunning()
+{
+    return engine.running;
+}
+
+/**********************************************************
+ * audioSourceCount() - Sources the render thread may pan
+ **********************************************************/
+int audioSourceCount()
+{
+    return engine.running ? engine.sourceCount : 0;
+}
+
+/**********************************************************
+ * ringCapacityFrames() - Frames one ring holds
+ **********************************************************/
+static int ringCapacityFrames()
+{
+    const AudioSource& first = engine.sources[0];
+    return (int)(first.ring.capacity / first.wav.channels);
+}
+
+/**********************************************************
+ * audioGetTiming(...) - Summary of the callbacks so far
+ **********************************************************/
+void audioGetTiming(AudioTiming& timing)
+{
+    if (!engine.running) {
+        audioTimingSummarize(NULL, 0, 0.0, 0, timing);
+        return;
+    }
+    size_t count = engine.timingCount.load(std::memory_order_acquire);
+    audioTimingSummarize(&engine.timing[0], count,
+                         1.0e6 * engine.spec.samples / engine.spec.freq,
+                         ringCapacityFrames(), timing);
+}
+
+/**********************************************************
+ * audioGetStats(...) - Copies the counters
+ **********************************************************/
+void audioGetStats(AudioStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    if (!engine.running)
+        return;
+
+    // Rings: the capacity of the first, the emptiest fill
+    const AudioSource& first = engine.sources[0];
+    stats.ringFrames = ringCapacityFrames();
+    stats.ringFill   = stats.ringFrames;
+    for (int k = 0; k < engine.sourceCount; ++k) {
+        const AudioSource& src = engine.sources[k];
+        int fill = (int)(ringFill(src.ring) / src.wav.channels);
+        if (fill < stats.ringFill) stats.ringFill = fill;
+        stats.fileBytes += src.wav.mapSize;
+        stats.openMs    += src.wav.openMs;
+    }
+
+    stats.sampleRate     = engine.spec.freq;
+    stats.channels       = engine.spec.channels;
+    stats.sources        = engine.sourceCount;
+    stats.resampledSources = engine.resampledCount;
+    stats.resampleQuality  = engine.resampleQuality;
+    stats.deviceFrames   = engine.spec.samples;
+    stats.callbacks      = engine.callbacks.load(std::memory_order_relaxed);
+    stats.framesPlayed   = engine.framesPlayed.load(std::memory_order_relaxed);
+    stats.underruns      = engine.underruns.load(std::memory_order_relaxed);
+    stats.underrunFrames = engine.underrunFrames.load(std::memory_order_relaxed);
+    stats.mixUsMean      = stats.callbacks
+        ? engine.mixNs.load(std::memory_order_relaxed) / 1000.0 / stats.callbacks : 0.0;
+    stats.mixUsMax       = engine.mixNsMax.load(std::memory_order_relaxed) / 1000.0;
+    stats.droppedCommands = mixerDroppedCommands();
+    stats.finished       = engine.decoderDone.load(std::memory_order_acquire);
+    stats.driver         = SDL_GetCurrentAudioDriver();
+    stats.fileFrames     = wavFrameCount(first.wav);
+    stats.fileRate       = first.wav.sampleRate;
+    stats.residentBytes  = residentBytes();
+}
+
+/**********************************************************
+ * audioPrintStats() - Human-readable counters
+ **********************************************************/
+void audioPrintStats()
+{
+    AudioStats s;
+    audioGetStats(s);
+    if (!engine.running)
+        return;
+
+    printf("Audio         : %s driver, %d Hz, %d ch, device %d frames (%.1f ms), "
+           "ring %d frames (%.1f ms)\n",
+           s.driver ? s.driver : "?", s.sampleRate, s.channels,
+           s.deviceFrames, 1000.0 * s.deviceFrames / s.sampleRate,
+           s.ringFrames, 1000.0 * s.ringFrames / s.sampleRate);
+    printf("Audio stream  : %lu callbacks, %lu frames played, %lu underruns "
+           "(%lu frames of silence)%s\n",
+           s.callbacks, s.framesPlayed, s.underruns, s.underrunFrames,
+           s.finished ? ", end of file" : "");
+    printf("Audio file    : %.1f MB mapped (%.1f min), opened in %.3f ms, "
+           "process RSS %.1f MB\n",
+           s.fileBytes / 1048576.0, s.fileFrames / (60.0 * s.fileRate),
+           s.openMs, s.residentBytes / 1048576.0);
+    if (s.resampledSources > 0)
+        printf("Audio resample: %d of %d source%s converted to %d Hz (%s, %s)\n",
+               s.resampledSources, s.sources, s.sources == 1 ? "" : "s", s.sampleRate,
+               resampleQualityName(s.resampleQuality),
+               resampleBackendName(resampleCurrentBackend()));
+    double periodUs = 1.0e6 * s.deviceFrames / s.sampleRate;
+    printf("Audio mix     : %d source%s (%s), %.1f us mean / %.1f us max per callback "
+           "(%.1f%% / %.1f%% of %.0f us), %lu gain updates dropped\n",
+           s.sources, s.sources == 1 ? "" : "s", mixBackendName(mixCurrentBackend()),
+           s.mixUsMean, s.mixUsMax, 100.0 * s.mixUsMean / periodUs,
+           100.0 * s.mixUsMax / periodUs, periodUs, s.droppedCommands);
+
+    AudioTiming timing;
+    audioGetTiming(timing);
+    audioTimingPrint(timing);
+    if (engine.timingHistograms) {
+        size_t count = engine.timingCount.load(std::memory_order_acquire);
+        audioTimingPrintHistograms(&engine.timing[0], count, periodUs, s.ringFrames);
+    }
+
+    if (analysisRunning()) {
+        AnalysisStats a;
+        analysisGetStats(a);
+        printf("Audio analysis: %lu blocks of %d (%s FFT), %.1f us per block, "
+               "%lu samples dropped\n",
+               a.blocks, ANALYSIS_FFT_SIZE, fftBackendName(a.backend),
+               a.meanBlockUs, a.droppedSamples);
+    }
+}
+
+// --------------------------------------------------------
+// OFFLINE DECODE (no device, no threads)
+// --------------------------------------------------------
+
+/**********************************************************
+ * audioDecodeOffline(...) - The decoder path on this thread
+ *
+ * Plays 'path' once through topUp() into a ring of
+ * ringFrames, converted to deviceRate, and drains the ring
+ * in reads of readFrames like the callback would. Returns
+ * the frames that came out, or -1 if the file cannot be
+ * played.
+ **********************************************************/
+long audioDecodeOffline(const char* path, int deviceRate, ResampleQuality quality,
+                        int ringFrames, int readFrames)
+{
+    if (engine.running)
+        return -1;
+    AudioOptions options = {};
+    options.wavPaths.push_back(path);
+    options.ringFrames = ringFrames;
+    if (!openSources(options))
+        return -1;
+    if (!startResamplers(deviceRate, quality)) {
+        closeSources();
+        return -1;
+    }
+    engine.loop = false;
+
+    AudioSource& src = engine.sources[0];
+    int channels = src.wav.channels;
+    std::vector<float> block((size_t)readFrames * channels);
+    long frames = 0;
+    for (;;) {
+        bool wrote = false;
+        while (topUp(src))
+            wrote = true;
+        bool done = src.done.load(std::memory_order_acquire);
+        size_t got = ringRead(src.ring, &block[0], block.size());
+        frames += (long)(got / channels);
+        if (done && ringFill(src.ring) == 0)
+            break;
+        if (!wrote && got == 0)
+            break;   // Stuck short of the end: the caller sees too few frames
+    }
+    closeSources();
+    return frames;
+}
@@ -0,0 +1,102 @@
+/**********************************************************
+ *  Orator - audio.h
+ *
+ *  Streaming WAV playback through SDL2. Every source (one
+ *  per --wav file, or more with --sources) has its own
+ *  memory-mapped file (wav.h) and lock-free SPSC ring
+ *  (ringbuffer.h). One decoder thread converts the files
+ *  straight into the rings; the SDL audio callback mixes
+ *  them out of the rings into one stereo stream (mixer.h),
+ *  so it never locks, allocates or touches the disk. A
+ *  source whose ring runs dry plays silence and the
+ *  callback counts an underrun.
+ *
+ *  Files may have different sample rates: the device runs
+ *  at one rate, and the decoder converts every other file
+ *  to it (resampler.h) on its way into the ring.
+ *
+ *  SDL's "dummy" (discards) and "disk" (writes the raw
+ *  stream to $SDL_DISKAUDIOFILE) drivers run the same
+ *  callback in real time without any sound hardware.
+ **********************************************************/
+#ifndef ORATOR_AUDIO_H
+#define ORATOR_AUDIO_H
+
+// Defaults for AudioOptions
+#define AUDIO_DEFAULT_DEVICE_FRAMES 512    // ~11.6 ms at 44.1 kHz
+#define AUDIO_DEFAULT_RING_FRAMES   8192   // ~186 ms decoded ahead
+
+// Sources sharing one file start this many frames apart,
+// so they do not play in phase
+#define AUDIO_SOURCE_STAGGER_FRAMES 7919
+
+#include "audiotiming.h"
+#include "resampler.h"
+
+#include <vector>
+
+struct AudioOptions {
+    std::vector<const char*> wavPaths;   // Empty = no audio at all
+    int  sources;          // Sources to mix; source k plays file
+                           // k % files (0 = one per file)
+    const char* driver;    // SDL audio driver name, NULL = SDL's choice
+    int  sampleRate;       // Device rate asked for (0 = the first file's)
+    ResampleQuality resampleQuality;   // For files at other rates
+    int  deviceFrames;     // Frames per callback (power of two)
+    int  ringFrames;       // Frames the decoder may run ahead
+    bool loop;             // Restart the file at its end
+    bool analysis;         // Run the FFT analysis thread (analysis.h)
+    const char* timingCsv; // Callback timing CSV files (BASE-*.csv), or NULL
+    bool timingHistograms; // Print the timing histograms with the stats
+};
+
+// Snapshot of the engine counters
+struct AudioStats {
+    int    sampleRate;
+    int    channels;         // Device: always stereo
+    int    sources;
+    int    resampledSources; // Files not at the device rate
+    ResampleQuality resampleQuality;
+    int    deviceFrames;     // As obtained from SDL
+    int    ringFrames;       // Ring capacity in frames
+    int    ringFill;         // Frames buffered right now
+    unsigned long callbacks;
+    unsigned long framesPlayed;
+    unsigned long underruns;       // Callbacks that ran short
+    unsigned long underrunFrames;  // Frames of silence inserted
+    double mixUsMean;        // Whole callback: mix + dither
+    double mixUsMax;
+    unsigned long droppedCommands; // Gain updates lost (queue full)
+    bool   finished;         // Decoder reached the end of every file
+    const char* driver;
+    unsigned long fileFrames;      // Length of the first source's data
+    int    fileRate;               // ... and its sample rate
+    unsigned long fileBytes;       // Size of all mappings
+    double openMs;                 // wavOpen() of every source
+    unsigned long residentBytes;   // Process RSS right now
+};
+
+// Opens the file and the device, starts the decoder thread,
+// waits until the ring is primed and starts playback.
+bool audioStart(const AudioOptions& options);
+// Stops playback, joins the decoder thread and writes the
+// timing CSV files if asked to
+void audioStop();
+
+bool audioRunning();
+// Sources being mixed (0 when not running)
+int  audioSourceCount();
+void audioGetStats(AudioStats& stats);
+// Callback interval, time and ring fill so far (audiotiming.h)
+void audioGetTiming(AudioTiming& timing);
+// One-paragraph text summary on stdout
+void audioPrintStats();
+
+// Without a device or threads: plays the file once through
+// the decoder and a ring of ringFrames, converted to
+// deviceRate, reading readFrames at a time. Returns the
+// frames that came out, or -1 (--resample-bench checks it).
+long audioDecodeOffline(const char* path, int deviceRate, ResampleQuality quality,
+                        int ringFrames, int readFrames);
+
+#endif // ORATOR_AUDIO_H
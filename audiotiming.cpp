@@ -0,0 +1,255 @@
+/**********************************************************
+ *  Orator - audiotiming.cpp
+ *
+ *  Summary, histograms and CSV export of the recorded
+ *  audio callbacks (see audiotiming.h). Runs on the main
+ *  thread after (or between) callbacks; nothing here is
+ *  called from the callback itself.
+ **********************************************************/
+#include "audiotiming.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Most bins of one histogram
+#define TIMING_MAX_BINS 16
+
+// Width of the longest histogram bar, in characters
+#define TIMING_BAR_WIDTH 40
+
+// One histogram over a value in percent. Bin i holds
+// [edges[i], edges[i + 1]); with 'overflow' the last bin
+// holds everything from edges[bins - 1] up.
+struct TimingHistogram {
+    const char* name;      // CSV name
+    const char* title;     // Text heading
+    int    bins;
+    double edges[TIMING_MAX_BINS + 1];
+    bool   overflow;
+    unsigned long counts[TIMING_MAX_BINS];
+};
+
+/**********************************************************
+ * nearestRank(...) - Percentile of sorted data
+ **********************************************************/
+static double nearestRank(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+/**********************************************************
+ * audioTimingSummarize(...) - Means, percentiles, extremes
+ **********************************************************/
+void audioTimingSummarize(const AudioTimingPoint* points, size_t count,
+                          double periodUs, int ringFrames, AudioTiming& timing)
+{
+    memset(&timing, 0, sizeof(timing));
+    timing.callbacks  = count;
+    timing.periodUs   = periodUs;
+    timing.ringFrames = ringFrames;
+    if (count == 0)
+        return;
+
+    // The first callback has no interval
+    std::vector<double> intervals, times;
+    intervals.reserve(count);
+    times.reserve(count);
+    double fillSum = 0.0;
+    timing.ringFillMin = points[0].ringFill;
+    for (size_t i = 0; i < count; ++i) {
+        const AudioTimingPoint& p = points[i];
+        if (i > 0)
+            intervals.push_back(p.intervalUs);
+        times.push_back(p.callbackUs);
+        fillSum += p.ringFill;
+        if (p.ringFill < timing.ringFillMin) timing.ringFillMin = p.ringFill;
+        if (p.shortFrames > 0) timing.underruns++;
+    }
+    timing.ringFillMean = fillSum / count;
+
+    if (!intervals.empty()) {
+        double sum = 0.0, squares = 0.0;
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            sum     += intervals[i];
+            squares += intervals[i] * intervals[i];
+        }
+        timing.intervalMeanUs = sum / intervals.size();
+        double variance = squares / intervals.size() - timing.intervalMeanUs * timing.intervalMeanUs;
+        timing.jitterUs = variance > 0.0 ? sqrt(variance) : 0.0;
+        std::sort(intervals.begin(), intervals.end());
+        timing.intervalP50Us = nearestRank(intervals, 50.0);
+        timing.intervalP99Us = nearestRank(intervals, 99.0);
+        timing.intervalMaxUs = intervals.back();
+    }
+
+    double sum = 0.0;
+    for (size_t i = 0; i < times.size(); ++i) sum += times[i];
+    timing.callbackMeanUs = sum / times.size();
+    std::sort(times.begin(), times.end());
+    timing.callbackP99Us = nearestRank(times, 99.0);
+    timing.callbackMaxUs = times.back();
+}
+
+/**********************************************************
+ * audioTimingPrint(...) - One-line summary
+ **********************************************************/
+void audioTimingPrint(const AudioTiming& t)
+{
+    if (t.callbacks == 0)
+        return;
+    printf("Audio timing  : interval p50 %.0f / p99 %.0f / max %.0f us (period %.0f us, "
+           "jitter %.0f us), callback p99 %.0f / max %.0f us, ring fill min %d of %d frames, "
+           "%lu short callbacks\n",
+           t.intervalP50Us, t.intervalP99Us, t.intervalMaxUs, t.periodUs, t.jitterUs,
+           t.callbackP99Us, t.callbackMaxUs, t.ringFillMin, t.ringFrames, t.underruns);
+}
+
+// --------------------------------------------------------
+// HISTOGRAMS
+// --------------------------------------------------------
+
+/**********************************************************
+ * buildHistograms(...) - Interval, callback time, ring fill
+ *
+ * All three in percent: of the period (how late or early a
+ * callback came, how much of its budget it used) and of
+ * the ring capacity (how close playback came to running
+ * dry).
+ **********************************************************/
+static void buildHistograms(const AudioTimingPoint* points, size_t count,
+                            double periodUs, int ringFrames, TimingHistogram h[3])
+{
+    // On time is the 95-105% bin; the last bin of the first two is open-ended
+    static const double intervalEdges[] = { 0, 50, 80, 90, 95, 105, 110, 120, 150, 200, 300 };
+    static const double callbackEdges[] = { 0, 1, 2, 5, 10, 25, 50, 100 };
+    static const double fillEdges[]     = { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+
+    memset(h, 0, 3 * sizeof(TimingHistogram));
+    h[0].name  = "interval";
+    h[0].title = "Callback interval, % of the period";
+    h[0].bins  = sizeof(intervalEdges) / sizeof(intervalEdges[0]);
+    h[0].overflow = true;
+    memcpy(h[0].edges, intervalEdges, sizeof(intervalEdges));
+
+    h[1].name  = "callback";
+    h[1].title = "Time in the callback, % of the period";
+    h[1].bins  = sizeof(callbackEdges) / sizeof(callbackEdges[0]);
+    h[1].overflow = true;
+    memcpy(h[1].edges, callbackEdges, sizeof(callbackEdges));
+
+    h[2].name  = "ring_fill";
+    h[2].title = "Emptiest ring at the callback, % full";
+    h[2].bins  = sizeof(fillEdges) / sizeof(fillEdges[0]) - 1;   // 100% is in the last bin
+    h[2].overflow = false;
+    memcpy(h[2].edges, fillEdges, sizeof(fillEdges));
+
+    for (size_t i = 0; i < count; ++i) {
+        double values[3] = {
+            100.0 * points[i].intervalUs / periodUs,
+            100.0 * points[i].callbackUs / periodUs,
+            ringFrames > 0 ? 100.0 * points[i].ringFill / ringFrames : 0.0
+        };
+        for (int k = 0; k < 3; ++k) {
+            if (k == 0 && i == 0)
+                continue;   // No interval before the first callback
+            TimingHistogram& hist = h[k];
+            int bin = hist.bins - 1;
+            for (int b = 0; b < hist.bins - 1; ++b)
+                if (values[k] < hist.edges[b + 1]) { bin = b; break; }
+            hist.counts[bin]++;
+        }
+    }
+}
+
+/**********************************************************
+ * binLabel(...) - "100-125%", or ">= 300%" for overflow
+ **********************************************************/
+static std::string binLabel(const TimingHistogram& h, int b)
+{
+    char label[32];
+    if (h.overflow && b == h.bins - 1)
+        snprintf(label, sizeof(label), ">= %g%%", h.edges[b]);
+    else
+        snprintf(label, sizeof(label), "%g-%g%%", h.edges[b], h.edges[b + 1]);
+    return label;
+}
+
+/**********************************************************
+ * audioTimingPrintHistograms(...) - Text bars, empty bins
+ *                                   at either end left out
+ **********************************************************/
+void audioTimingPrintHistograms(const AudioTimingPoint* points, size_t count,
+                                double periodUs, int ringFrames)
+{
+    TimingHistogram h[3];
+    buildHistograms(points, count, periodUs, ringFrames, h);
+
+    for (int k = 0; k < 3; ++k) {
+        int first = 0, last = h[k].bins - 1;
+        unsigned long most = 0;
+        while (first < last && h[k].counts[first] == 0) first++;
+        while (last > first && h[k].counts[last] == 0) last--;
+        for (int b = first; b <= last; ++b)
+            most = std::max(most, h[k].counts[b]);
+
+        printf("%s (%lu callbacks)\n", h[k].title, (unsigned long)count);
+        for (int b = first; b <= last; ++b) {
+            int width = most ? (int)((h[k].counts[b] * TIMING_BAR_WIDTH + most - 1) / most) : 0;
+            printf("  %10s |%-*s| %lu\n", binLabel(h[k], b).c_str(), TIMING_BAR_WIDTH,
+                   std::string(width, '#').c_str(), h[k].counts[b]);
+        }
+    }
+}
+
+// --------------------------------------------------------
+// CSV EXPORT
+// --------------------------------------------------------
+
+/**********************************************************
+ * audioTimingWriteCsv(...) - Raw points and histogram bins
+ **********************************************************/
+bool audioTimingWriteCsv(const char* base, const AudioTimingPoint* points, size_t count,
+                         double periodUs, int ringFrames)
+{
+    std::string path = std::string(base) + "-callbacks.csv";
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+    fprintf(f, "callback,time_us,interval_us,callback_us,ring_fill_frames,ring_fill_pct,short_frames\n");
+    for (size_t i = 0; i < count; ++i) {
+        const AudioTimingPoint& p = points[i];
+        fprintf(f, "%lu,%.1f,%.1f,%.2f,%d,%.1f,%d\n", (unsigned long)i, p.timeUs,
+                p.intervalUs, p.callbackUs, p.ringFill,
+                ringFrames > 0 ? 100.0 * p.ringFill / ringFrames : 0.0, p.shortFrames);
+    }
+    bool ok = fclose(f) == 0;
+
+    TimingHistogram h[3];
+    buildHistograms(points, count, periodUs, ringFrames, h);
+    path = std::string(base) + "-histograms.csv";
+    f = fopen(path.c_str(), "w");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+    fprintf(f, "histogram,low_pct,high_pct,count\n");
+    for (int k = 0; k < 3; ++k)
+        for (int b = 0; b < h[k].bins; ++b) {
+            if (h[k].overflow && b == h[k].bins - 1)
+                fprintf(f, "%s,%g,,%lu\n", h[k].name, h[k].edges[b], h[k].counts[b]);
+            else
+                fprintf(f, "%s,%g,%g,%lu\n", h[k].name, h[k].edges[b], h[k].edges[b + 1],
+                        h[k].counts[b]);
+        }
+    return fclose(f) == 0 && ok;
+}
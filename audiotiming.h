@@ -0,0 +1,68 @@
+/**********************************************************
+ *  Orator - audiotiming.h
+ *
+ *  What the audio callback did, measured instead of
+ *  listened to. The callback records one point per call
+ *  (start time, time since the previous call, time spent
+ *  inside, how full the rings were, frames of silence)
+ *  into a table allocated before playback starts. Once
+ *  the run is over this file turns the table into a
+ *  summary, text histograms and CSV files.
+ *
+ *  Works the same with SDL's "dummy" and "disk" drivers,
+ *  so the whole audio path can be checked headless, with
+ *  or without a synthetic render load (synthload.h).
+ **********************************************************/
+#ifndef ORATOR_AUDIOTIMING_H
+#define ORATOR_AUDIOTIMING_H
+
+#include <stddef.h>
+
+// Callbacks recorded per run (over 12 minutes at 512 frames
+// and 44.1 kHz); later callbacks are still counted in the
+// engine totals, just not recorded
+#define AUDIO_TIMING_CALLBACKS 65536
+
+// One callback
+struct AudioTimingPoint {
+    double timeUs;        // Start, since playback started
+    float  intervalUs;    // Since the previous start (0 for the first)
+    float  callbackUs;    // Spent inside the callback
+    int    ringFill;      // Emptiest playing ring at the start, frames
+    int    shortFrames;   // Frames of silence inserted (underrun)
+};
+
+// Summary of the recorded callbacks
+struct AudioTiming {
+    unsigned long callbacks;   // Recorded
+    double periodUs;           // Device frames / rate
+    double intervalMeanUs;
+    double intervalP50Us;
+    double intervalP99Us;
+    double intervalMaxUs;
+    double jitterUs;           // Standard deviation of the interval
+    double callbackMeanUs;
+    double callbackP99Us;
+    double callbackMaxUs;
+    int    ringFrames;         // Capacity of a ring
+    int    ringFillMin;
+    double ringFillMean;
+    unsigned long underruns;   // Recorded callbacks that ran short
+};
+
+void audioTimingSummarize(const AudioTimingPoint* points, size_t count,
+                          double periodUs, int ringFrames, AudioTiming& timing);
+
+// One line on stdout
+void audioTimingPrint(const AudioTiming& timing);
+
+// Interval, callback time and ring fill histograms on stdout
+void audioTimingPrintHistograms(const AudioTimingPoint* points, size_t count,
+                                double periodUs, int ringFrames);
+
+// BASE-callbacks.csv (one row per callback) and
+// BASE-histograms.csv (one row per histogram bin)
+bool audioTimingWriteCsv(const char* base, const AudioTimingPoint* points, size_t count,
+                         double periodUs, int ringFrames);
+
+#endif // ORATOR_AUDIOTIMING_H
@@ -0,0 +1,1137 @@
+/**********************************************************
+ *  Orator - bench.cpp
+ *
+ *  Offscreen benchmark mode (--bench N). Creates an EGL
+ *  context without any window surface, renders into a
+ *  framebuffer object and times N frames of renderScene().
+ *  Also the CPU-only vertex kernel comparison (--tess-bench)
+ *  the mesh cache startup comparison (--startup-bench), the
+ *  audio mixer kernels (--mix-bench), the sample-rate
+ *  converter (--resample-bench) and the matrix kernels
+ *  (--matrix-bench).
+ **********************************************************/
+#include "bench.h"
+#include "mesh.h"      // frameStats
+#include "glstate.h"   // stateStats
+#include "drawlist.h"  // drawListSize
+#include "orator.h"    // initGL, reshape, renderScene, advanceAnimation
+#include "profiler.h"  // Optional per-stage timings (--profile/--trace)
+#include "speakers.h"  // speakerCount (array mode)
+#include "shadow.h"    // shadowMode
+#include "audio.h"     // Audio counters, when --wav is playing
+#include "analysis.h"  // FFT analysis counters
+#include "tessellate.h" // Vertex kernels for --tess-bench
+#include "meshcache.h"  // Mesh cache file for --startup-bench
+#include "recorder.h"   // --record readback and encoder counters
+#include "scheduler.h"  // schedulerFps: frame slot while recording
+#include "mixer.h"      // Mix kernels for --mix-bench
+#include "resampler.h"  // Converter for --resample-bench
+#include "culling.h"    // Culling counters
+#include "mat4.h"       // Matrix kernels for --matrix-bench
+#include "arena.h"      // Frame arena and heap counters
+#include "programcache.h" // Program binaries loaded or compiled
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <math.h>      // fabsf, sin
+#include <stdint.h>    // uintptr_t
+#include <stdio.h>
+#include <stdlib.h>    // labs
+#include <string.h>
+#include <sys/stat.h>  // stat (cache file size)
+#include <unistd.h>    // unlink
+#include <algorithm>   // std::sort
+#include <chrono>
+#include <thread>      // sleep_until (recording pace)
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// --------------------------------------------------------
+// OFFSCREEN CONTEXT
+// --------------------------------------------------------
+
+// EGL + FBO handles for the lifetime of the benchmark
+struct OffscreenTarget {
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;     // Only used if surfaceless is unsupported
+    GLuint     fbo;
+    GLuint     colorRb;
+    GLuint     depthRb;
+};
+
+/**********************************************************
+ * hasExtension(...) - Checks an EGL extension string
+ **********************************************************/
+static bool hasExtension(const char* list, const char* name)
+{
+    if (!list) return false;
+    size_t len = strlen(name);
+    for (const char* p = strstr(list, name); p; p = strstr(p + len, name)) {
+        // Make sure we matched a whole word
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+/**********************************************************
+ * openDisplay() - Surfaceless Mesa display if possible
+ *
+ * EGL_PLATFORM_SURFACELESS_MESA needs no X11/Wayland and no
+ * GPU; Mesa falls back to llvmpipe. Otherwise try the default
+ * display (which may be a real GPU or a headless driver).
+ **********************************************************/
+static EGLDisplay openDisplay()
+{
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExts, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            EGLDisplay dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                                EGL_DEFAULT_DISPLAY, NULL);
+            if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, NULL, NULL))
+                return dpy;
+        }
+    }
+    EGLDisplay dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, NULL, NULL))
+        return dpy;
+    return EGL_NO_DISPLAY;
+}
+
+/**********************************************************
+ * createOffscreenTarget(...) - EGL context + w x h FBO
+ **********************************************************/
+static bool createOffscreenTarget(OffscreenTarget& t, int width, int height)
+{
+    memset(&t, 0, sizeof(t));
+    t.display = openDisplay();
+    if (t.display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "bench: no EGL display available\n");
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "bench: EGL has no desktop OpenGL support\n");
+        return false;
+    }
+
+    // The scene uses fixed-function GL, so ask for a compatibility profile
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = 0;
+    EGLint numConfigs = 0;
+    eglChooseConfig(t.display, configAttribs, &config, 1, &numConfigs);
+
+    EGLint contextAttribs[] = {
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    const char* displayExts = eglQueryString(t.display, EGL_EXTENSIONS);
+    bool noConfig = hasExtension(displayExts, "EGL_KHR_no_config_context") ||
+                    hasExtension(displayExts, "EGL_MESA_configless_context");
+    t.context = eglCreateContext(t.display,
+                                 numConfigs > 0 ? config : (noConfig ? EGL_NO_CONFIG_KHR : 0),
+                                 EGL_NO_CONTEXT, contextAttribs);
+    if (t.context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "bench: eglCreateContext failed (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    // Prefer no surface at all; fall back to a tiny pbuffer
+    t.surface = EGL_NO_SURFACE;
+    if (!hasExtension(displayExts, "EGL_KHR_surfaceless_context") && numConfigs > 0) {
+        EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        t.surface = eglCreatePbufferSurface(t.display, config, pbufferAttribs);
+    }
+    if (!eglMakeCurrent(t.display, t.surface, t.surface, t.context)) {
+        fprintf(stderr, "bench: eglMakeCurrent failed (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    // Color + depth/stencil renderbuffers attached to one FBO
+    glGenRenderbuffers(1, &t.colorRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, t.colorRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &t.depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, t.depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &t.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, t.colorRb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, t.depthRb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "bench: offscreen framebuffer is incomplete\n");
+        return false;
+    }
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    return true;
+}
+
+/**********************************************************
+ * destroyOffscreenTarget(...) - Releases GL and EGL objects
+ **********************************************************/
+static void destroyOffscreenTarget(OffscreenTarget& t)
+{
+    if (t.context != EGL_NO_CONTEXT) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (t.fbo)     glDeleteFramebuffers(1, &t.fbo);
+        if (t.colorRb) glDeleteRenderbuffers(1, &t.colorRb);
+        if (t.depthRb) glDeleteRenderbuffers(1, &t.depthRb);
+        eglMakeCurrent(t.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(t.display, t.context);
+    }
+    if (t.surface != EGL_NO_SURFACE)
+        eglDestroySurface(t.display, t.surface);
+    if (t.display != EGL_NO_DISPLAY)
+        eglTerminate(t.display);
+}
+
+// --------------------------------------------------------
+// STATISTICS
+// --------------------------------------------------------
+
+/**********************************************************
+ * percentile(...) - Nearest-rank percentile of sorted data
+ **********************************************************/
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+// --------------------------------------------------------
+// BENCHMARK
+// --------------------------------------------------------
+
+/**********************************************************
+ * morphShape(...) - --morph: new cap angle for frame 'frame'
+ **********************************************************/
+static void morphShape(const MeshParams& start, int frame)
+{
+    double phase = 2.0 * M_PI * frame / BENCH_MORPH_FRAMES;
+    float  phi   = start.phiMax + (float)(BENCH_MORPH_DEGREES * M_PI / 180.0 * sin(phase));
+    setSpeakerShape(phi, start.innerRadiusFactor, start.concaveDepth);
+}
+
+/**********************************************************
+ * flyCamera(...) - --fly: camera for frame 'frame'
+ *
+ * Low over the array along x, weaving a little in y and
+ * looking ahead and down, so most of the array is behind,
+ * beside or beyond the frustum at any time.
+ **********************************************************/
+static void flyCamera(int frame)
+{
+    float half = 10.0f;
+    for (size_t k = 0; k < speakerInstances.size(); ++k)
+        half = fmaxf(half, fabsf(speakerInstances[k].offset[0]));
+
+    double phase = (double)(frame % BENCH_FLY_FRAMES) / BENCH_FLY_FRAMES;
+    cameraPose.active = true;
+    cameraPose.eye[0] = (float)(-half + 2.0 * half * phase);
+    cameraPose.eye[1] = (float)(0.25 * half * sin(2.0 * M_PI * phase));
+    cameraPose.eye[2] = BENCH_FLY_HEIGHT;
+    cameraPose.target[0] = cameraPose.eye[0] + 2.0f * BENCH_FLY_HEIGHT;
+    cameraPose.target[1] = cameraPose.eye[1];
+    cameraPose.target[2] = 0.0f;
+}
+
+/**********************************************************
+ * runBenchmark(...) - Render and time N offscreen frames
+ *
+ * Each frame is timed from the start of renderScene() until
+ * glFinish() returns, so GPU (or llvmpipe) work is included.
+ **********************************************************/
+int runBenchmark(const BenchOptions& options)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    OffscreenTarget target;
+    if (!createOffscreenTarget(target, options.width, options.height)) {
+        destroyOffscreenTarget(target);
+        return 1;
+    }
+
+    initGL();
+    reshape(options.width, options.height);
+    MeshParams startShape = speakerShapeParams(0, 0);
+
+    // Warm up caches, shader compilers and the driver
+    // (without profiling, so the stage averages stay clean)
+    bool profiling = profilerEnabled;
+    profilerEnabled = false;
+    // initGL() to the first finished frame: the start a user
+    // waits for (cold or warm, see programcache.h)
+    double startupMs = -1.0;
+    for (int i = 0; i < options.warmupFrames; ++i) {
+        if (options.morph) morphShape(startShape, i);
+        if (options.fly) flyCamera(i);
+        renderScene();
+        if (i == 0) {
+            glFinish();
+            startupMs = msSinceInitGL();
+        }
+        arenaReset();
+        advanceAnimation(BENCH_FRAME_SECONDS);
+    }
+    glFinish();
+    profilerEnabled = profiling;
+
+    std::vector<double> frameMs;
+    frameMs.reserve(options.frames);
+    double totalTriangles = 0.0, totalVertices = 0.0, totalDrawCalls = 0.0;
+    double totalStateRequests = 0.0, totalStateChanges = 0.0;
+    double totalVisible = 0.0, totalFrustumCulled = 0.0, totalOcclusionCulled = 0.0;
+    double totalQueries = 0.0;
+    // Heap allocations of the render thread within the frames
+    unsigned long heapCalls = 0;
+    int heapFrames = 0;
+
+    // While recording, frames are paced at --fps like the window,
+    // so the encoders see real-time load; a frame that takes
+    // longer than its slot is late
+    bool recording = recorderActive();
+    Clock::duration slot = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / schedulerFps));
+    int lateFrames = 0;
+
+    for (int i = 0; i < options.frames; ++i) {
+        unsigned long heapBefore = heapAllocations();
+        Clock::time_point start = Clock::now();
+        // A shape edit is part of the frame it shows up in
+        if (options.morph) morphShape(startShape, options.warmupFrames + i);
+        if (options.fly) flyCamera(options.warmupFrames + i);
+        profilerBeginFrame();
+        renderScene();
+        if (recording) {
+            ProfileScope scope(STAGE_CAPTURE);
+            recorderCapture(options.width, options.height);
+        }
+        {
+            // There is nothing to present; glFinish stands in for the swap
+            ProfileScope scope(STAGE_SWAP);
+            glFinish();
+        }
+        profilerEndFrame();
+        arenaReset();
+        Clock::time_point end = Clock::now();
+        if (startupMs < 0.0)
+            startupMs = msSinceInitGL();   // No warm-up frames
+        unsigned long heapFrame = heapAllocations() - heapBefore;
+        heapCalls  += heapFrame;
+        heapFrames += heapFrame > 0;
+        if (recording) {
+            if (end - start > slot)
+                lateFrames++;
+            else
+                std::this_thread::sleep_until(start + slot);
+        }
+
+        frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        totalTriangles += frameStats.triangles;
+        totalVertices  += frameStats.vertices;
+        totalDrawCalls += frameStats.drawCalls;
+        totalStateRequests += stateStats.requested;
+        totalStateChanges  += stateStats.issued;
+        totalVisible         += cullStats.visible;
+        totalFrustumCulled   += cullStats.frustumCulled;
+        totalOcclusionCulled += cullStats.occlusionCulled;
+        totalQueries         += cullStats.queries;
+        advanceAnimation(BENCH_FRAME_SECONDS);
+    }
+
+    // GPU timings of the last frames, while the context exists
+    profilerDrain();
+    // Flush the ring and let the encoders finish (not timed)
+    recorderStop();
+    RecordStats record;
+    recorderGetStats(record);
+
+    // Summarize
+    double sum = 0.0;
+    for (size_t i = 0; i < frameMs.size(); ++i) sum += frameMs[i];
+    int n = options.frames > 0 ? options.frames : 1;
+    double mean = sum / n;
+    std::vector<double> sorted(frameMs);
+    std::sort(sorted.begin(), sorted.end());
+    double p50 = percentile(sorted, 50.0);
+    double p95 = percentile(sorted, 95.0);
+    double p99 = percentile(sorted, 99.0);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    ArenaStats arena;
+    arenaGetStats(arena);
+
+    if (options.json) {
+        printf("{\"renderer\": \"%s\", \"width\": %d, \"height\": %d, "
+               "\"speakers\": %d, \"path\": \"%s\", \"morph\": %s, \"shadow\": \"%s\", "
+               "\"frames\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, "
+               "\"p95_ms\": %.4f, \"p99_ms\": %.4f, "
+               "\"triangles_per_frame\": %.0f, \"vertices_per_frame\": %.0f, "
+               "\"draw_calls_per_frame\": %.1f, \"draw_list_items\": %d, "
+               "\"state_changes_per_frame\": %.1f, \"state_changes_avoided_per_frame\": %.1f",
+               renderer ? renderer : "unknown", options.width, options.height,
+               speakerCount > 0 ? speakerCount : 1, speakerPathName(speakerPath),
+               options.morph ? "true" : "false", shadowMode == SHADOW_MESH ? "mesh" : "silhouette",
+               options.frames, mean, p50, p95, p99,
+               totalTriangles / n, totalVertices / n, totalDrawCalls / n, drawListSize(),
+               totalStateChanges / n, (totalStateRequests - totalStateChanges) / n);
+        printf(", \"fly\": %s, \"cull\": %s, \"occlusion\": %s, \"culler\": \"%s\", "
+               "\"visible_per_frame\": %.1f, \"frustum_culled_per_frame\": %.1f, "
+               "\"occlusion_culled_per_frame\": %.1f, \"occlusion_queries_per_frame\": %.1f",
+               options.fly ? "true" : "false", cullEnabled ? "true" : "false",
+               cullOcclusion ? "true" : "false", cullBackendName(cullCurrentBackend()),
+               totalVisible / n, totalFrustumCulled / n, totalOcclusionCulled / n, totalQueries / n);
+        printf(", \"matrix_backend\": \"%s\"", mat4BackendName(mat4CurrentBackend()));
+        printf(", \"heap_allocs_per_frame\": %.2f, \"heap_alloc_frames\": %d, "
+               "\"arena_peak_bytes\": %zu, \"arena_capacity_bytes\": %zu, \"arena_growths\": %lu",
+               (double)heapCalls / n, heapFrames, arena.peakBytes, arena.capacity, arena.growths);
+        printf(", \"startup_ms\": %.2f, \"programs_loaded\": %d, \"programs_compiled\": %d, "
+               "\"programs_rejected\": %d, \"program_build_ms\": %.2f",
+               startupMs, programCacheStats.loaded, programCacheStats.compiled,
+               programCacheStats.rejected, programCacheStats.buildMs);
+        if (recording) {
+            printf(", \"record_fps\": %d, \"record_written\": %lu, \"record_dropped\": %lu, "
+                   "\"record_stalls\": %lu, \"record_late_frames\": %d, "
+                   "\"record_readback_ms\": %.4f, \"record_encode_ms\": %.4f, \"record_workers\": %d",
+                   schedulerFps, record.written, record.dropped, record.stalls, lateFrames,
+                   record.meanReadbackMs, record.meanEncodeMs, record.workers);
+        }
+        if (audioRunning()) {
+            AudioStats audio;
+            audioGetStats(audio);
+            printf(", \"audio_callbacks\": %lu, \"audio_frames\": %lu, "
+                   "\"audio_underruns\": %lu, \"audio_underrun_frames\": %lu, "
+                   "\"audio_open_ms\": %.3f, \"rss_bytes\": %lu, \"audio_resampled\": %d",
+                   audio.callbacks, audio.framesPlayed, audio.underruns, audio.underrunFrames,
+                   audio.openMs, audio.residentBytes, audio.resampledSources);
+            AudioTiming timing;
+            audioGetTiming(timing);
+            printf(", \"audio_interval_p99_us\": %.1f, \"audio_interval_max_us\": %.1f, "
+                   "\"audio_jitter_us\": %.1f, \"audio_callback_p99_us\": %.1f, "
+                   "\"audio_callback_max_us\": %.1f, \"audio_ring_fill_min\": %d",
+                   timing.intervalP99Us, timing.intervalMaxUs, timing.jitterUs,
+                   timing.callbackP99Us, timing.callbackMaxUs, timing.ringFillMin);
+        }
+        if (analysisRunning()) {
+            AnalysisStats analysis;
+            analysisGetStats(analysis);
+            printf(", \"fft_backend\": \"%s\", \"analysis_blocks\": %lu, "
+                   "\"analysis_block_us\": %.2f",
+                   fftBackendName(analysis.backend), analysis.blocks, analysis.meanBlockUs);
+        }
+        printf("}\n");
+    } else {
+        printf("Renderer      : %s\n", renderer ? renderer : "unknown");
+        printf("Target        : %dx%d offscreen, %d frames (+%d warm-up)\n",
+               options.width, options.height, options.frames, options.warmupFrames);
+        printf("Speakers      : %d%s\n", speakerCount > 0 ? speakerCount : 1,
+               speakerCount > 0 ? " (instanced array)" : "");
+        printf("Speaker path  : %s%s\n", speakerPathName(speakerPath),
+               options.morph ? ", shape changing every frame" : "");
+        printf("Shadow        : %s\n", shadowMode == SHADOW_MESH ? "full mesh" : "silhouette");
+        printf("Frame time    : mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n",
+               mean, p50, p95, p99);
+        printf("Per frame     : %.0f triangles, %.0f vertices, %.1f draw calls\n",
+               totalTriangles / n, totalVertices / n, totalDrawCalls / n);
+        printf("State changes : %.1f issued, %.1f avoided per frame (%d draw list items)\n",
+               totalStateChanges / n, (totalStateRequests - totalStateChanges) / n, drawListSize());
+        printf("Startup       : first frame %.1f ms after initGL; programs: %d from cache, "
+               "%d compiled (%d refused by the driver), %.1f ms\n", startupMs,
+               programCacheStats.loaded, programCacheStats.compiled, programCacheStats.rejected,
+               programCacheStats.buildMs);
+        printf("Heap          : %.2f allocations per frame (%d of %d frames allocated), "
+               "arena peak %.1f KB of %.1f KB\n", (double)heapCalls / n, heapFrames, options.frames,
+               arena.peakBytes / 1024.0, arena.capacity / 1024.0);
+        if (!cullEnabled) {
+            printf("Culling       : off%s\n", options.fly ? ", flying over the array" : "");
+        } else {
+            printf("Culling       : %s spheres%s%s, %.1f speakers drawn, %.1f outside the frustum, "
+                   "%.1f occluded per frame\n", cullBackendName(cullCurrentBackend()),
+                   cullOcclusion ? " + occlusion queries" : "",
+                   options.fly ? ", flying over the array" : "",
+                   totalVisible / n, totalFrustumCulled / n, totalOcclusionCulled / n);
+            if (cullOcclusion)
+                printf("Occlusion     : %.1f queries per frame\n", totalQueries / n);
+        }
+        if (recording) {
+            recorderPrintStats();
+            printf("Record pace   : %d fps, %d of %d frames late\n",
+                   schedulerFps, lateFrames, options.frames);
+        }
+        audioPrintStats();
+        profilerPrintSummary();
+    }
+
+    destroyOffscreenTarget(target);
+    return 0;
+}
+
+// --------------------------------------------------------
+// TESSELLATION MICROBENCHMARK
+// --------------------------------------------------------
+
+/**********************************************************
+ * vertexError(...) - Largest attribute difference
+ **********************************************************/
+static float vertexError(const MeshVertex& a, const MeshVertex& b)
+{
+    float e = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        e = fmaxf(e, fabsf(a.position[i] - b.position[i]));
+        e = fmaxf(e, fabsf(a.normal[i]   - b.normal[i]));
+    }
+    for (int i = 0; i < 2; ++i)
+        e = fmaxf(e, fabsf(a.texCoord[i] - b.texCoord[i]));
+    return e;
+}
+
+/**********************************************************
+ * runTessBenchmark(...) - Every vertex kernel on one speaker
+ *
+ * Each kernel rebuilds the cap, ring and concavity vertices
+ * TESS_BENCH_RUNS times into the same, already touched
+ * buffer (32-byte aligned, like a mapped VBO). The scalar
+ * per-vertex loop is the reference for speed and accuracy.
+ **********************************************************/
+int runTessBenchmark(int uSteps, int vSteps, bool json)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    MeshParams params[MESH_COMPONENT_COUNT] = {
+        speakerShapeParams(uSteps, vSteps),   // MESH_CAP
+        speakerShapeParams(uSteps, 0),        // MESH_RING
+        speakerShapeParams(uSteps, vSteps)    // MESH_CONCAVE
+    };
+    size_t first[MESH_COMPONENT_COUNT + 1] = { 0 };
+    for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+        first[c + 1] = first[c] + tessVertexCount((MeshComponent)c, params[c]);
+    const size_t total = first[MESH_COMPONENT_COUNT];
+
+    std::vector<MeshVertex> reference(total), storage(total + 1);
+    MeshVertex* aligned = (MeshVertex*)(((uintptr_t)storage.data() + 31) & ~(uintptr_t)31);
+
+    if (!json)
+        printf("Tessellation  : %dx%d cap and concavity, %d ring, %zu vertices (%.1f MB)\n",
+               uSteps, vSteps, uSteps, total, total * sizeof(MeshVertex) / (1024.0 * 1024.0));
+
+    TessBackend previous = tessCurrentBackend();
+    TessBackend best     = tessBestBackend();
+    double scalarMs = 0.0;
+    for (int b = TESS_SCALAR; b <= best; ++b) {
+        tessSetBackend((TessBackend)b);
+        MeshVertex* out = b == TESS_SCALAR ? reference.data() : aligned;
+
+        double minMs = 0.0, sumMs = 0.0;
+        for (int run = -1; run < TESS_BENCH_RUNS; ++run) {
+            Clock::time_point start = Clock::now();
+            for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+                tessellateVertices((MeshComponent)c, params[c], out + first[c]);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            if (run < 0)
+                continue;   // Untimed: faults the pages in
+            sumMs += ms;
+            if (run == 0 || ms < minMs) minMs = ms;
+        }
+        double meanMs = sumMs / TESS_BENCH_RUNS;
+        if (b == TESS_SCALAR)
+            scalarMs = meanMs;
+
+        float maxError = 0.0f;
+        if (b != TESS_SCALAR)
+            for (size_t i = 0; i < total; ++i)
+                maxError = fmaxf(maxError, vertexError(reference[i], out[i]));
+
+        const char* name = tessBackendName((TessBackend)b);
+        double mvps = total / (meanMs * 1000.0);
+        if (json) {
+            printf("{\"tess_backend\": \"%s\", \"u_steps\": %d, \"v_steps\": %d, "
+                   "\"vertices\": %zu, \"mean_ms\": %.4f, \"min_ms\": %.4f, "
+                   "\"mvertices_per_s\": %.2f, \"speedup\": %.2f, \"max_error\": %.3g}\n",
+                   name, uSteps, vSteps, total, meanMs, minMs, mvps, scalarMs / meanMs, maxError);
+        } else {
+            printf("%-14s: mean %.3f ms, min %.3f ms, %.1f Mvertices/s, x%.1f, max error %.2g\n",
+                   name, meanMs, minMs, mvps, scalarMs / meanMs, maxError);
+        }
+    }
+    tessSetBackend(previous);
+    return 0;
+}
+
+// --------------------------------------------------------
+// MESH STARTUP BENCHMARK
+// --------------------------------------------------------
+
+// The three ways the retained meshes can come up at startup
+enum StartupMode {
+    STARTUP_TESSELLATE = 0,  // No cache at all (--no-mesh-cache)
+    STARTUP_COLD,            // No file yet: tessellate and write it
+    STARTUP_CACHED,          // File present: map and upload it
+    STARTUP_MODE_COUNT
+};
+
+static const char* startupModeName(StartupMode mode)
+{
+    switch (mode) {
+        case STARTUP_TESSELLATE: return "tessellate";
+        case STARTUP_COLD:       return "cold";
+        case STARTUP_CACHED:     return "cached";
+        default:                 return "unknown";
+    }
+}
+
+/**********************************************************
+ * runStartupBenchmark(...) - Mesh startup with and without
+ *                            the cache file
+ *
+ * Each run frees the meshes and builds the whole LOD chain
+ * again in one of the three modes, up to glFinish(), so the
+ * upload is included. The file stays in the OS page cache
+ * between runs: "cached" is a warm start, a cold disk only
+ * adds its read time on top.
+ **********************************************************/
+int runStartupBenchmark(int runs, bool json)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::string path = speakerMeshCachePath();
+    if (path.empty()) {
+        fprintf(stderr, "--startup-bench needs a mesh cache directory (--mesh-cache DIR)\n");
+        return 1;
+    }
+
+    OffscreenTarget target;
+    if (!createOffscreenTarget(target, 64, 64)) {
+        destroyOffscreenTarget(target);
+        return 1;
+    }
+
+    double sumMs[STARTUP_MODE_COUNT] = { 0.0 }, minMs[STARTUP_MODE_COUNT] = { 0.0 };
+    long vertices = 0, indices = 0;
+    bool ok = true;
+    for (int run = -1; run < runs && ok; ++run) {
+        for (int m = 0; m < STARTUP_MODE_COUNT && ok; ++m) {
+            destroySpeakerMeshes();
+            if (m == STARTUP_COLD)
+                unlink(path.c_str());
+
+            Clock::time_point start = Clock::now();
+            MeshCacheResult result = MESH_CACHE_UNAVAILABLE;
+            if (m == STARTUP_TESSELLATE)
+                updateSpeakerMeshes();
+            else
+                result = loadSpeakerMeshes();
+            glFinish();
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            // Cold must write the file and cached must read it back,
+            // or the numbers compare the wrong things
+            if ((m == STARTUP_COLD   && result != MESH_CACHE_WRITTEN) ||
+                (m == STARTUP_CACHED && result != MESH_CACHE_HIT)) {
+                fprintf(stderr, "Startup bench: %s start gave '%s'\n",
+                        startupModeName((StartupMode)m), meshCacheResultName(result));
+                ok = false;
+            }
+            if (run < 0)
+                continue;   // Untimed: driver and page cache warm-up
+            sumMs[m] += ms;
+            if (run == 0 || ms < minMs[m]) minMs[m] = ms;
+        }
+    }
+    for (int l = 0; l < LOD_LEVELS; ++l)
+        for (int c = 0; c < MESH_COMPONENT_COUNT; ++c) {
+            vertices += speakerMeshes[l][c].vertexCount;
+            indices  += speakerMeshes[l][c].indexCount;
+        }
+    destroySpeakerMeshes();
+    destroyOffscreenTarget(target);
+    if (!ok)
+        return 1;
+
+    struct stat st;
+    long fileBytes = stat(path.c_str(), &st) == 0 ? (long)st.st_size : 0;
+    double mean[STARTUP_MODE_COUNT];
+    for (int m = 0; m < STARTUP_MODE_COUNT; ++m)
+        mean[m] = sumMs[m] / runs;
+
+    if (json) {
+        printf("{\"mesh_vertices\": %ld, \"mesh_indices\": %ld, \"cache_file_bytes\": %ld, \"runs\": %d",
+               vertices, indices, fileBytes, runs);
+        for (int m = 0; m < STARTUP_MODE_COUNT; ++m)
+            printf(", \"%s_mean_ms\": %.4f, \"%s_min_ms\": %.4f",
+                   startupModeName((StartupMode)m), mean[m],
+                   startupModeName((StartupMode)m), minMs[m]);
+        printf(", \"cached_speedup\": %.2f}\n", mean[STARTUP_TESSELLATE] / mean[STARTUP_CACHED]);
+    } else {
+        printf("Meshes        : %ld vertices, %ld indices over %d levels\n",
+               vertices, indices, LOD_LEVELS);
+        printf("Cache file    : %s (%.1f MB)\n", path.c_str(), fileBytes / (1024.0 * 1024.0));
+        for (int m = 0; m < STARTUP_MODE_COUNT; ++m)
+            printf("%-14s: mean %.3f ms, min %.3f ms\n",
+                   startupModeName((StartupMode)m), mean[m], minMs[m]);
+        printf("Cached start  : x%.1f faster than tessellating\n",
+               mean[STARTUP_TESSELLATE] / mean[STARTUP_CACHED]);
+    }
+    return 0;
+}
+
+// --------------------------------------------------------
+// AUDIO MIX BENCHMARK
+// --------------------------------------------------------
+
+// Blocks of synthetic audio per source; the bench cycles
+// through them like a ring, so the data is not all in L1
+#define MIX_BENCH_RING_BLOCKS 8
+
+/**********************************************************
+ * runMixBenchmark(...) - Every mix kernel, one callback at
+ *                        a time
+ *
+ * Sources alternate mono and stereo sines and sit on a
+ * 16-wide grid; the listener circles it, so every block
+ * brings new gains for every source through the command
+ * queue (queued outside the timing, as the render thread
+ * would). Timed per block: clear, commands, accumulate all
+ * sources, master + dither + int16, which is the whole
+ * callback minus the ring bookkeeping.
+ **********************************************************/
+int runMixBenchmark(int sources, int frames, bool json)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<std::vector<float> > data(sources);
+    std::vector<int> channels(sources);
+    std::vector<float> positions(3 * sources);
+    for (int k = 0; k < sources; ++k) {
+        channels[k] = 1 + (k & 1);
+        size_t n = (size_t)frames * MIX_BENCH_RING_BLOCKS;
+        data[k].resize(n * channels[k]);
+        double w = 2.0 * M_PI * 110.0 * (1.0 + 0.37 * k) / MIX_BENCH_RATE;
+        for (size_t i = 0; i < n; ++i)
+            for (int c = 0; c < channels[k]; ++c)
+                data[k][i * channels[k] + c] = (float)(0.5 * sin(w * i + c));
+        positions[3 * k]     = 3.0f * (k % 16 - 7.5f);
+        positions[3 * k + 1] = 3.0f * (k / 16);
+        positions[3 * k + 2] = 0.0f;
+    }
+
+    std::vector<float> mix(2 * (size_t)frames);
+    std::vector<int16_t> out(2 * (size_t)frames * MIX_BENCH_BLOCKS), reference;
+    double periodUs = 1.0e6 * frames / MIX_BENCH_RATE;
+
+    if (!json)
+        printf("Mix           : %d sources (mono/stereo), %d frames per callback "
+               "(%.0f us at %d Hz), %d callbacks\n",
+               sources, frames, periodUs, MIX_BENCH_RATE, MIX_BENCH_BLOCKS);
+
+    MixBackend previous = mixCurrentBackend();
+    MixBackend best     = mixBestBackend();
+    double scalarUs = 0.0;
+    for (int b = MIX_SCALAR; b <= best; ++b) {
+        mixSetBackend((MixBackend)b);
+        mixerInit(sources);
+
+        std::vector<double> blockUs;
+        blockUs.reserve(MIX_BENCH_BLOCKS);
+        unsigned long dropped = 0;
+        for (int block = 0; block < MIX_BENCH_BLOCKS; ++block) {
+            // Render thread side: listener on a circle around the grid
+            float angle = 0.01f * block;
+            MixListener listener = { { 30.0f * cosf(angle), 30.0f * sinf(angle), 5.0f },
+                                     { -sinf(angle), cosf(angle), 0.0f } };
+            for (int k = 0; k < sources; ++k)
+                if (!mixerPlaceSource(k, &positions[3 * k], listener))
+                    dropped++;
+
+            // Callback side
+            Clock::time_point start = Clock::now();
+            memset(mix.data(), 0, mix.size() * sizeof(float));
+            mixerBeginBlock();
+            size_t offset = (size_t)(block % MIX_BENCH_RING_BLOCKS) * frames;
+            for (int k = 0; k < sources; ++k)
+                mixerAddSource(k, mix.data(), &data[k][offset * channels[k]], frames, channels[k]);
+            mixerFinishBlock(mix.data(), &out[2 * (size_t)frames * block], frames);
+            blockUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+
+        std::vector<double> sorted(blockUs);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < blockUs.size(); ++i) sum += blockUs[i];
+        double meanUs = sum / MIX_BENCH_BLOCKS;
+        double p99Us  = percentile(sorted, 99.0);
+        double maxUs  = sorted.back();
+        if (b == MIX_SCALAR) {
+            scalarUs  = meanUs;
+            reference = out;
+        }
+        int maxDiff = 0;
+        for (size_t i = 0; i < out.size(); ++i) {
+            int d = abs(out[i] - reference[i]);
+            if (d > maxDiff) maxDiff = d;
+        }
+
+        const char* name = mixBackendName((MixBackend)b);
+        if (json) {
+            printf("{\"mix_backend\": \"%s\", \"sources\": %d, \"frames\": %d, "
+                   "\"period_us\": %.1f, \"mean_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+                   "\"budget_used\": %.4f, \"speedup\": %.2f, \"max_diff_lsb\": %d, "
+                   "\"dropped_commands\": %lu}\n",
+                   name, sources, frames, periodUs, meanUs, p99Us, maxUs,
+                   maxUs / periodUs, scalarUs / meanUs, maxDiff, dropped);
+        } else {
+            printf("%-14s: mean %.1f us, p99 %.1f us, max %.1f us = %.1f%% of the period, "
+                   "x%.1f, max diff %d LSB%s\n",
+                   name, meanUs, p99Us, maxUs, 100.0 * maxUs / periodUs,
+                   scalarUs / meanUs, maxDiff, dropped ? ", gain updates dropped" : "");
+        }
+    }
+    mixSetBackend(previous);
+    return 0;
+}
+
+// --------------------------------------------------------
+// SAMPLE-RATE CONVERTER BENCHMARK
+// --------------------------------------------------------
+
+// Input frames per resampleWrite(), like one decoder chunk
+#define RESAMPLE_BENCH_CHUNK 1024
+// Runs per kernel; the fastest counts
+#define RESAMPLE_BENCH_RUNS  5
+
+// Rate pairs: the usual file rates to the usual device
+// rates, and one pair with no small ratio (interpolated)
+static const int resampleBenchRates[][2] = {
+    { 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 }, { 96000, 44100 }, { 44056, 48000 }
+};
+
+// Worst THD+N each tier may have at either tone (dB), by
+// ResampleQuality: a few dB above the worst rate pair
+static const double resampleThdnLimitDb[] = { -58.0, -88.0, -100.0 };
+
+/**********************************************************
+ * resampleStream(...) - A whole signal through the
+ *                       streaming API, chunk by chunk
+ **********************************************************/
+static size_t resampleStream(Resampler& r, const std::vector<float>& in,
+                             std::vector<float>& out)
+{
+    int channels = r.channels;
+    size_t frames = in.size() / channels, done = 0, made = 0;
+    size_t maxOut = out.size() / channels;
+    for (;;) {
+        size_t n = frames - done;
+        if (n > RESAMPLE_BENCH_CHUNK) n = RESAMPLE_BENCH_CHUNK;
+        if (n > 0)
+            done += resampleWrite(r, &in[done * channels], n);
+        else
+            resampleFinish(r);
+        size_t got = resampleRead(r, &out[made * channels], maxOut - made);
+        made += got;
+        if ((got == 0 && r.finished) || made == maxOut)
+            return made;
+    }
+}
+
+/**********************************************************
+ * thdPlusNoiseDb(...) - Everything that is not the test
+ *                       tone, relative to the tone
+ *
+ * Fits a sin + b cos + c at the tone's frequency (least
+ * squares) to the output, away from the start and end
+ * transients, and compares the residual with the fit. The
+ * fitted sine is the reference, so a passband gain error
+ * does not count, but noise, aliases, images and
+ * distortion all do.
+ **********************************************************/
+static double thdPlusNoiseDb(const ResampleFilter& filter, double frequency)
+{
+    int inFrames = filter.inRate;    // One second
+    std::vector<float> in(inFrames);
+    double amplitude = pow(10.0, -1.0 / 20.0);   // -1 dBFS
+    for (int i = 0; i < inFrames; ++i)
+        in[i] = (float)(amplitude * sin(2.0 * M_PI * frequency * i / filter.inRate));
+
+    Resampler r;
+    resamplerInit(r, filter, 1);
+    std::vector<float> out((size_t)filter.outRate + filter.taps + 2);
+    size_t n = resampleStream(r, in, out);
+
+    double w = 2.0 * M_PI * frequency / filter.outRate;
+    size_t from = 2 * (size_t)filter.taps, to = n - 2 * (size_t)filter.taps;
+
+    // Normal equations of the 3-parameter fit
+    double m[3][4] = { { 0 } };
+    for (size_t i = from; i < to; ++i) {
+        double b[3] = { sin(w * i), cos(w * i), 1.0 };
+        for (int row = 0; row < 3; ++row) {
+            for (int col = 0; col < 3; ++col)
+                m[row][col] += b[row] * b[col];
+            m[row][3] += b[row] * out[i];
+        }
+    }
+    for (int p = 0; p < 3; ++p)             // Gauss-Jordan; the
+        for (int row = 0; row < 3; ++row) { // matrix is well conditioned
+            if (row == p) continue;
+            double f = m[row][p] / m[p][p];
+            for (int col = p; col < 4; ++col)
+                m[row][col] -= f * m[p][col];
+        }
+    double a = m[0][3] / m[0][0], b = m[1][3] / m[1][1], c = m[2][3] / m[2][2];
+
+    double signal = 0.0, residual = 0.0;
+    for (size_t i = from; i < to; ++i) {
+        double fit = a * sin(w * i) + b * cos(w * i) + c;
+        signal   += fit * fit;
+        residual += (out[i] - fit) * (out[i] - fit);
+    }
+    return 10.0 * log10(residual / signal);
+}
+
+/**********************************************************
+ * writeTestWav(...) - 16-bit PCM, a different tone per
+ *                     channel
+ **********************************************************/
+static bool writeTestWav(const char* path, int channels, int rate, int frames)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return false;
+    uint32_t dataBytes = (uint32_t)frames * channels * 2;
+    uint32_t riffBytes = 36 + dataBytes, fmtBytes = 16, byteRate = (uint32_t)rate * channels * 2;
+    uint16_t format = 1, chans = (uint16_t)channels, align = (uint16_t)(channels * 2), bits = 16;
+    uint32_t sampleRate = (uint32_t)rate;
+    fwrite("RIFF", 1, 4, f); fwrite(&riffBytes, 4, 1, f); fwrite("WAVE", 1, 4, f);
+    fwrite("fmt ", 1, 4, f); fwrite(&fmtBytes, 4, 1, f);
+    fwrite(&format, 2, 1, f); fwrite(&chans, 2, 1, f); fwrite(&sampleRate, 4, 1, f);
+    fwrite(&byteRate, 4, 1, f); fwrite(&align, 2, 1, f); fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f); fwrite(&dataBytes, 4, 1, f);
+    for (int i = 0; i < frames; ++i)
+        for (int c = 0; c < channels; ++c) {
+            int16_t v = (int16_t)(16000.0 * sin(2.0 * M_PI * 220.0 * (c + 1) * i / rate));
+            fwrite(&v, 2, 1, f);
+        }
+    return fclose(f) == 0;
+}
+
+/**********************************************************
+ * checkMultichannelDecode() - Off-rate files of every
+ *                             channel count play to the end
+ *
+ * Goes through the real decoder path (audioDecodeOffline)
+ * with a ring that is not a whole number of frames for 3,
+ * 5, 6 and 7 channels, so frames straddle its wrap-around.
+ * Every channel count must give as many frames as mono.
+ **********************************************************/
+static bool checkMultichannelDecode(bool json)
+{
+    const char* path = "/tmp/orator-resample-check.wav";
+    const int inRate = 44100, outRate = 48000, frames = 100000;
+    long expected = -1;
+    bool ok = true;
+    for (int channels = 1; channels <= RESAMPLE_MAX_CHANNELS; ++channels) {
+        long got = -1;
+        if (writeTestWav(path, channels, inRate, frames))
+            got = audioDecodeOffline(path, outRate, RESAMPLE_MEDIUM, 4096, 512);
+        unlink(path);
+        if (channels == 1)
+            expected = got;
+        bool pass = got > 0 && got == expected &&
+                    labs(got - (long)frames * outRate / inRate) < 64;
+        ok = ok && pass;
+        if (json)
+            printf("{\"decode_channels\": %d, \"in_frames\": %d, \"out_frames\": %ld, "
+                   "\"pass\": %s}\n", channels, frames, got, pass ? "true" : "false");
+        else if (!pass)
+            printf("Decode        : %d channels, %d frames at %d Hz gave %ld at %d Hz "
+                   "(expected %ld)\n", channels, frames, inRate, got, outRate, expected);
+    }
+    if (!json && ok)
+        printf("Decode        : %d->%d Hz, 1 to %d channels through the ring, all %ld frames\n",
+               inRate, outRate, RESAMPLE_MAX_CHANNELS, expected);
+    return ok;
+}
+
+/**********************************************************
+ * runResampleBenchmark(...) - Throughput per kernel and
+ *                             THD+N per quality tier
+ *
+ * Throughput: 'seconds' of stereo noise-like input per
+ * case, in decoder-sized chunks, counted as output samples
+ * (all channels) per second, best of RESAMPLE_BENCH_RUNS. Quality: one second of a mono
+ * -1 dBFS sine at 1 kHz and at 60% of the lower Nyquist
+ * frequency, inside every tier's passband. Returns 1 if a
+ * tier is above its resampleThdnLimitDb[] at either tone.
+ **********************************************************/
+int runResampleBenchmark(int seconds, bool json)
+{
+    typedef std::chrono::steady_clock Clock;
+    const int channels = 2;
+
+    ResampleBackend previous = resampleCurrentBackend();
+    ResampleBackend best     = resampleBestBackend();
+    int pairs = (int)(sizeof(resampleBenchRates) / sizeof(resampleBenchRates[0]));
+    bool failed = false;
+
+    if (!json)
+        printf("Resample      : %d s of stereo per case, output samples per second; "
+               "THD+N at 1 kHz and at 0.6 x Nyquist\n", seconds);
+
+    for (int p = 0; p < pairs; ++p) {
+        int inRate = resampleBenchRates[p][0], outRate = resampleBenchRates[p][1];
+
+        std::vector<float> in((size_t)inRate * seconds * channels);
+        uint32_t seed = 12345;
+        for (size_t i = 0; i < in.size(); ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            in[i] = (float)((int32_t)seed >> 8) / 8388608.0f * 0.5f;
+        }
+
+        for (int q = RESAMPLE_FAST; q <= RESAMPLE_BEST; ++q) {
+            ResampleFilter filter;
+            if (!resampleFilterInit(filter, inRate, outRate, (ResampleQuality)q))
+                return 1;
+            double highTone = 0.6 * 0.5 * (inRate < outRate ? inRate : outRate);
+            double thd1k   = thdPlusNoiseDb(filter, 1000.0);
+            double thdHigh = thdPlusNoiseDb(filter, highTone);
+            double limit   = resampleThdnLimitDb[q];
+            bool   pass    = thd1k <= limit && thdHigh <= limit;
+            failed = failed || !pass;
+
+            double msps[3] = { 0.0, 0.0, 0.0 };
+            double maxDiff = 0.0;
+            std::vector<float> out(((size_t)outRate * seconds + filter.taps + 2) * channels);
+            std::vector<float> reference;
+            for (int b = RESAMPLE_SCALAR; b <= best; ++b) {
+                resampleSetBackend((ResampleBackend)b);
+                Resampler r;
+                resamplerInit(r, filter, channels);
+                size_t n = 0;
+                for (int run = 0; run < RESAMPLE_BENCH_RUNS; ++run) {
+                    resamplerReset(r);
+                    Clock::time_point start = Clock::now();
+                    n = resampleStream(r, in, out);
+                    double s = std::chrono::duration<double>(Clock::now() - start).count();
+                    msps[b] = std::max(msps[b], n * channels / s / 1.0e6);
+                }
+                if (b == RESAMPLE_SCALAR)
+                    reference.assign(out.begin(), out.begin() + n * channels);
+                for (size_t i = 0; i < reference.size(); ++i)
+                    maxDiff = std::max(maxDiff, (double)fabsf(out[i] - reference[i]));
+            }
+            resampleSetBackend(previous);
+
+            const char* quality = resampleQualityName((ResampleQuality)q);
+            if (json) {
+                printf("{\"in_rate\": %d, \"out_rate\": %d, \"quality\": \"%s\", \"taps\": %d, "
+                       "\"phases\": %d, \"interpolated\": %s, \"scalar_msps\": %.2f, "
+                       "\"sse2_msps\": %.2f, \"avx_msps\": %.2f, \"thdn_1k_db\": %.1f, "
+                       "\"thdn_high_db\": %.1f, \"high_hz\": %.0f, \"thdn_limit_db\": %.1f, "
+                       "\"thdn_pass\": %s, \"max_diff\": %.2e}\n",
+                       inRate, outRate, quality, filter.taps, filter.phases,
+                       filter.interpolate ? "true" : "false", msps[0], msps[1], msps[2],
+                       thd1k, thdHigh, highTone, limit, pass ? "true" : "false", maxDiff);
+            } else {
+                printf("%5d->%-5d %-6s: %3d taps x %4d%s, %6.1f M/s (%s; scalar %.1f, x%.1f), "
+                       "THD+N %6.1f dB / %6.1f dB%s, max diff %.1e\n",
+                       inRate, outRate, quality, filter.taps, filter.phases,
+                       filter.interpolate ? "i" : " ", msps[best],
+                       resampleBackendName(best), msps[0], msps[best] / msps[0],
+                       thd1k, thdHigh, pass ? "" : " (FAIL)", maxDiff);
+            }
+        }
+    }
+    if (failed && !json)
+        printf("Resample      : THD+N above the tier's limit (fast %.0f, medium %.0f, "
+               "best %.0f dB)\n", resampleThdnLimitDb[0], resampleThdnLimitDb[1],
+               resampleThdnLimitDb[2]);
+    if (!checkMultichannelDecode(json))
+        failed = true;
+    return failed ? 1 : 0;
+}
+
+// --------------------------------------------------------
+// MATRIX BENCHMARK
+// --------------------------------------------------------
+
+/**********************************************************
+ * runMatrixBenchmark(...) - Every matrix kernel on one
+ *                           batch of instance transforms
+ *
+ * Composes view * local for 'count' speakers, the work of
+ * the immediate array path every frame, MAT4_BENCH_RUNS
+ * times per kernel; the fastest run counts.
+ **********************************************************/
+int runMatrixBenchmark(int count, bool json)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    float eye[3] = { 20.0f, 15.0f, 10.0f }, center[3] = { 0.0f, 0.0f, 0.0f };
+    float up[3]  = { 0.0f, 0.0f, 1.0f };
+    mat4 view;
+    mat4LookAt(view, eye, center, up);
+    mat4Rotate(view, 30.0f, 1, 0, 0);
+
+    std::vector<mat4> locals(count), out(count), reference;
+    for (int k = 0; k < count; ++k) {
+        mat4Identity(locals[k]);
+        mat4Translate(locals[k], 3.0f * (k % 100), 3.0f * (k / 100), 0.0f);
+        mat4Rotate(locals[k], 7.0f * k, 0, 0, 1);
+        mat4Scale(locals[k], 0.5f + 0.01f * (k % 50), 0.5f + 0.01f * (k % 50), 0.5f + 0.01f * (k % 50));
+    }
+
+    if (!json)
+        printf("Matrices      : view * local for %d instances, best of %d runs\n",
+               count, MAT4_BENCH_RUNS);
+
+    Mat4Backend previous = mat4CurrentBackend();
+    Mat4Backend best     = mat4BestBackend();
+    double scalarUs = 0.0;
+    for (int b = MAT4_SCALAR; b <= best; ++b) {
+        mat4SetBackend((Mat4Backend)b);
+        double minUs = 1.0e30;
+        for (int run = 0; run < MAT4_BENCH_RUNS; ++run) {
+            Clock::time_point start = Clock::now();
+            mat4MultiplyBatch(view, locals.data(), out.data(), count);
+            minUs = std::min(minUs, std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        if (b == MAT4_SCALAR) {
+            scalarUs  = minUs;
+            reference = out;
+        }
+        float maxDiff = 0.0f;
+        for (int k = 0; k < count; ++k)
+            for (int i = 0; i < 16; ++i)
+                maxDiff = std::max(maxDiff, fabsf(out[k].m[i] - reference[k].m[i]));
+
+        const char* name = mat4BackendName((Mat4Backend)b);
+        if (json) {
+            printf("{\"matrix_backend\": \"%s\", \"instances\": %d, \"batch_us\": %.2f, "
+                   "\"ns_per_matrix\": %.2f, \"speedup\": %.2f, \"max_diff\": %.2e}\n",
+                   name, count, minUs, 1000.0 * minUs / count, scalarUs / minUs, maxDiff);
+        } else {
+            printf("%-14s: %.1f us per batch, %.2f ns per matrix, x%.1f, max diff %.1e\n",
+                   name, minUs, 1000.0 * minUs / count, scalarUs / minUs, maxDiff);
+        }
+    }
+    mat4SetBackend(previous);
+    return 0;
+}
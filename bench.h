@@ -0,0 +1,74 @@
+/**********************************************************
+ *  Orator - bench.h
+ *
+ *  Headless benchmark: renders the normal scene into an
+ *  offscreen framebuffer (EGL surfaceless, e.g. Mesa
+ *  llvmpipe) and reports frame-time statistics. No window
+ *  or display server is needed.
+ **********************************************************/
+#ifndef ORATOR_BENCH_H
+#define ORATOR_BENCH_H
+
+// Animation time per benchmark frame. Fixed, so every run
+// renders the same sequence of images.
+#define BENCH_FRAME_SECONDS (1.0 / 60.0)
+
+// --morph: cap angle swings by this much (degrees) around
+// its start value, one period per BENCH_MORPH_FRAMES frames
+#define BENCH_MORPH_DEGREES 20.0
+#define BENCH_MORPH_FRAMES  60
+
+// --fly: frames for one pass over the speaker array, and the
+// camera height above the speakers
+#define BENCH_FLY_FRAMES 600
+#define BENCH_FLY_HEIGHT 4.0f
+
+// Timed runs per kernel in runTessBenchmark()
+#define TESS_BENCH_RUNS 5
+
+struct BenchOptions {
+    int  frames;        // Number of measured frames
+    int  warmupFrames;  // Frames rendered before measuring
+    int  width;         // Offscreen target size in pixels
+    int  height;
+    bool json;          // Print one JSON object instead of text
+    bool morph;         // Sweep the cap angle every frame (--morph)
+    bool fly;           // Low camera flight over the array (--fly)
+};
+
+// Runs the benchmark; returns a process exit code
+int runBenchmark(const BenchOptions& options);
+
+// Times every vertex kernel (tessellate.h) on a whole speaker
+// with cap and concavity at uSteps x vSteps; no GL needed
+int runTessBenchmark(int uSteps, int vSteps, bool json);
+
+// Times N startups of the retained meshes: tessellated without
+// a cache, cold (tessellate + write the cache file) and cached
+// (map + upload the file); needs a mesh cache directory
+int runStartupBenchmark(int runs, bool json);
+
+// Blocks mixed per kernel in runMixBenchmark()
+#define MIX_BENCH_BLOCKS 2000
+// Sample rate the callback budget is computed for
+#define MIX_BENCH_RATE   44100
+
+// Times every mix kernel (mixer.h) on 'sources' synthetic
+// sources, one device block of 'frames' frames at a time,
+// against the callback period; no audio device needed
+int runMixBenchmark(int sources, int frames, bool json);
+
+// Converts 'seconds' of stereo at common rate pairs with
+// every resampler kernel and quality tier; prints
+// throughput and THD+N of a sine (resampler.h)
+int runResampleBenchmark(int seconds, bool json);
+
+// Batches timed per kernel in runMatrixBenchmark(); the
+// fastest counts
+#define MAT4_BENCH_RUNS 50
+
+// Times every matrix kernel (mat4.h) composing the view with
+// 'count' instance transforms in one batch
+int runMatrixBenchmark(int count, bool json);
+
+#endif // ORATOR_BENCH_H
@@ -0,0 +1,627 @@
+/**********************************************************
+ *  Orator - culling.cpp
+ *
+ *  Frustum planes, bounding spheres of speakers and shadows,
+ *  the cell grid, scalar/SSE2/AVX sphere tests and the
+ *  occlusion queries (see culling.h).
+ **********************************************************/
+#include "culling.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#endif
+
+// One cell of the grid
+struct CullCell {
+    int   first, count;      // Range of the cell-ordered arrays
+    float boxMin[3];         // Bounds of the speaker centres
+    float boxMax[3];
+    float maxScale;
+    GLuint query;            // 0 until the first query
+    bool  queryPending;      // Issued, result not read yet
+    bool  occluded;          // This frame's result: no samples passed
+    bool  inFrustum;         // Speaker or shadow in view this frame
+    bool  nearCamera;        // Too close for a query
+};
+
+CullStats cullStats;
+bool cullEnabled   = true;
+bool cullOcclusion = false;
+
+static CullBackend currentBackend = cullBestBackend();
+
+// Grid, speakers in cell order (SoA), and per-frame scratch
+static std::vector<CullCell> cells;
+static std::vector<int>   cellOrder;     // Cell order -> layout index
+static std::vector<float> cellX, cellY, cellZ, cellScale;
+static std::vector<float> radii;
+static std::vector<unsigned char> bodyVisible;
+static std::vector<int>   shadowIndex;   // Speakers whose shadow is tested
+static std::vector<float> shadowX, shadowY, shadowZ, shadowR;
+static std::vector<unsigned char> shadowVisible;
+static float boundRadius = 1.0f;         // As last passed to cullSpeakers()
+
+// --------------------------------------------------------
+// FRUSTUM AND SHADOW GEOMETRY
+// --------------------------------------------------------
+
+/**********************************************************
+ * cullBuildFrustum(...) - Gribb/Hartmann plane extraction
+ *
+ * Row i of clip = projection * modelview gives the planes
+ * row3 +/- row i, normalised so a*x + b*y + c*z + d is a
+ * distance in modelview units.
+ **********************************************************/
+void cullBuildFrustum(const float projection[16], const float modelview[16], CullFrustum& f)
+{
+    float clip[16];
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k)
+                sum += projection[k * 4 + r] * modelview[c * 4 + k];
+            clip[c * 4 + r] = sum;
+        }
+
+    for (int p = 0; p < 6; ++p) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        float* plane = f.planes[p];
+        for (int c = 0; c < 4; ++c)
+            plane[c] = clip[c * 4 + 3] + sign * clip[c * 4 + row];
+        float len = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (len > 0.0f)
+            for (int c = 0; c < 4; ++c)
+                plane[c] /= len;
+    }
+}
+
+/**********************************************************
+ * cullBuildShadow(...) - Light and plane in the model frame
+ *
+ * For x_world = R x + t: x = R^T (x_world - t), and a plane
+ * p (row vector) becomes p * M.
+ **********************************************************/
+void cullBuildShadow(const float model[16], const float light[4], const float plane[4],
+                     CullShadow& s)
+{
+    float w = light[3] != 0.0f ? light[3] : 1.0f;
+    float d[3];
+    for (int i = 0; i < 3; ++i)
+        d[i] = light[i] / w - model[12 + i];
+    for (int c = 0; c < 3; ++c)
+        s.light[c] = model[c * 4 + 0] * d[0] + model[c * 4 + 1] * d[1] + model[c * 4 + 2] * d[2];
+
+    for (int c = 0; c < 4; ++c)
+        s.plane[c] = plane[0] * model[c * 4 + 0] + plane[1] * model[c * 4 + 1] +
+                     plane[2] * model[c * 4 + 2] + plane[3] * model[c * 4 + 3];
+    float len = sqrtf(s.plane[0] * s.plane[0] + s.plane[1] * s.plane[1] + s.plane[2] * s.plane[2]);
+    if (len > 0.0f)
+        for (int c = 0; c < 4; ++c)
+            s.plane[c] /= len;
+}
+
+/**********************************************************
+ * cullClassifySphere(...) - Inside, straddling or outside
+ **********************************************************/
+int cullClassifySphere(const CullFrustum& f, const float center[3], float radius)
+{
+    int result = 1;
+    for (int p = 0; p < 6; ++p) {
+        const float* pl = f.planes[p];
+        float d = pl[0] * center[0] + pl[1] * center[1] + pl[2] * center[2] + pl[3];
+        if (d < -radius)
+            return -1;
+        if (d < radius)
+            result = 0;
+    }
+    return result;
+}
+
+/**********************************************************
+ * cullShadowSphere(...) - Sphere around a sphere's shadow
+ *
+ * A point at height h above the plane projects from the
+ * light (height H) to L + (P - L) * k with k = H / (H - h).
+ * For P = C + v, |v| <= r, the shadow point lies within
+ * |C - L| * |k - kC| + r * k of the centre's shadow, and k
+ * stays between its values at h(C) - r and h(C) + r.
+ **********************************************************/
+bool cullShadowSphere(const CullShadow& s, const float center[3], float radius,
+                      float shadowCenter[3], float* shadowRadius)
+{
+    const float* pl = s.plane;
+    float lightHeight = pl[0] * s.light[0] + pl[1] * s.light[1] + pl[2] * s.light[2] + pl[3];
+    float height = pl[0] * center[0] + pl[1] * center[1] + pl[2] * center[2] + pl[3];
+    // Reaching up to (or above) the light: unbounded shadow
+    if (lightHeight <= 0.0f || height + radius >= lightHeight * 0.999f)
+        return false;
+
+    float k    = lightHeight / (lightHeight - height);
+    float kMin = lightHeight / (lightHeight - (height - radius));
+    float kMax = lightHeight / (lightHeight - (height + radius));
+    float toLight2 = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        float d = center[i] - s.light[i];
+        shadowCenter[i] = s.light[i] + d * k;
+        toLight2 += d * d;
+    }
+    *shadowRadius = sqrtf(toLight2) * fmaxf(kMax - k, k - kMin) + radius * kMax;
+    return true;
+}
+
+// --------------------------------------------------------
+// SPHERE KERNELS: visible[i] = no plane has sphere i outside
+// --------------------------------------------------------
+
+/**********************************************************
+ * spheresScalar(...) - Spheres [from, count)
+ **********************************************************/
+static void spheresScalar(const CullFrustum& f, const float* x, const float* y, const float* z,
+                          const float* r, int from, int count, unsigned char* visible)
+{
+    for (int i = from; i < count; ++i) {
+        unsigned char inside = 1;
+        for (int p = 0; p < 6; ++p) {
+            const float* pl = f.planes[p];
+            if (pl[0] * x[i] + pl[1] * y[i] + pl[2] * z[i] + pl[3] < -r[i]) {
+                inside = 0;
+                break;
+            }
+        }
+        visible[i] = inside;
+    }
+}
+
+#ifdef CULL_X86
+/**********************************************************
+ * spheresSse2(...) - 4 spheres per step
+ *
+ * Returns the number done; the caller finishes the tail.
+ **********************************************************/
+__attribute__((target("sse2")))
+static int spheresSse2(const CullFrustum& f, const float* x, const float* y, const float* z,
+                       const float* r, int count, unsigned char* visible)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 nr = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            const float* pl = f.planes[p];
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[0]), px),
+                                             _mm_mul_ps(_mm_set1_ps(pl[1]), py)),
+                                  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[2]), pz),
+                                             _mm_set1_ps(pl[3])));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, nr));
+            if (_mm_movemask_ps(outside) == 0xF)
+                break;   // All four out already
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int j = 0; j < 4; ++j)
+            visible[i + j] = (unsigned char)(((mask >> j) & 1) ^ 1);
+    }
+    return i;
+}
+
+/**********************************************************
+ * spheresAvx(...) - 8 spheres per step
+ **********************************************************/
+__attribute__((target("avx")))
+static int spheresAvx(const CullFrustum& f, const float* x, const float* y, const float* z,
+                      const float* r, int count, unsigned char* visible)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            const float* pl = f.planes[p];
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl[0]), px),
+                                                   _mm256_mul_ps(_mm256_set1_ps(pl[1]), py)),
+                                     _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(pl[2]), pz),
+                                                   _mm256_set1_ps(pl[3])));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, nr, _CMP_LT_OQ));
+            if (_mm256_movemask_ps(outside) == 0xFF)
+                break;
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (int j = 0; j < 8; ++j)
+            visible[i + j] = (unsigned char)(((mask >> j) & 1) ^ 1);
+    }
+    return i;
+}
+#endif
+
+/**********************************************************
+ * cullSpheres(...) - Current kernel, scalar tail
+ **********************************************************/
+void cullSpheres(const CullFrustum& f, const float* x, const float* y, const float* z,
+                 const float* r, int count, unsigned char* visible)
+{
+    int done = 0;
+#ifdef CULL_X86
+    if (currentBackend == CULL_AVX)
+        done = spheresAvx(f, x, y, z, r, count, visible);
+    else if (currentBackend == CULL_SSE2)
+        done = spheresSse2(f, x, y, z, r, count, visible);
+#endif
+    spheresScalar(f, x, y, z, r, done, count, visible);
+}
+
+// --------------------------------------------------------
+// SINGLE SPEAKER
+// --------------------------------------------------------
+
+/**********************************************************
+ * cullSingleSpeaker(...) - Speaker and shadow separately
+ **********************************************************/
+void cullSingleSpeaker(const CullFrustum& body, const CullFrustum& shadowFrustum,
+                       const CullShadow& shadow, float radius,
+                       bool* bodyIn, bool* shadowIn)
+{
+    const float origin[3] = { 0.0f, 0.0f, 0.0f };
+    float center[3], shadowRadius;
+    *bodyIn   = cullClassifySphere(body, origin, radius) >= 0;
+    *shadowIn = !cullShadowSphere(shadow, origin, radius, center, &shadowRadius) ||
+                cullClassifySphere(shadowFrustum, center, shadowRadius) >= 0;
+
+    memset(&cullStats, 0, sizeof(cullStats));
+    cullStats.instances     = 1;
+    cullStats.visible       = (*bodyIn || *shadowIn) ? 1 : 0;
+    cullStats.frustumCulled = 1 - cullStats.visible;
+}
+
+// --------------------------------------------------------
+// GRID
+// --------------------------------------------------------
+
+/**********************************************************
+ * cullBuildGrid(...) - Uniform grid over the layout plane
+ *
+ * About CULL_CELL_SIDE^2 speakers per cell for the square
+ * layouts of speakers.cpp; the speakers are counting-sorted
+ * by cell so every cell is one range of the SoA arrays.
+ **********************************************************/
+void cullBuildGrid(const std::vector<SpeakerInstance>& instances)
+{
+    for (size_t c = 0; c < cells.size(); ++c)
+        if (cells[c].query)
+            glDeleteQueries(1, &cells[c].query);
+    cells.clear();
+
+    int count = (int)instances.size();
+    if (count == 0)
+        return;
+
+    float lo[2] = { instances[0].offset[0], instances[0].offset[1] };
+    float hi[2] = { lo[0], lo[1] };
+    for (int k = 1; k < count; ++k)
+        for (int a = 0; a < 2; ++a) {
+            lo[a] = fminf(lo[a], instances[k].offset[a]);
+            hi[a] = fmaxf(hi[a], instances[k].offset[a]);
+        }
+    int side = (int)ceil(sqrt((double)count) / CULL_CELL_SIDE);
+    if (side < 1) side = 1;
+    float size[2] = { (hi[0] - lo[0]) / side + 1.0e-3f, (hi[1] - lo[1]) / side + 1.0e-3f };
+
+    std::vector<int> cellOf(count);
+    std::vector<int> counts(side * side, 0);
+    for (int k = 0; k < count; ++k) {
+        int cx = (int)((instances[k].offset[0] - lo[0]) / size[0]);
+        int cy = (int)((instances[k].offset[1] - lo[1]) / size[1]);
+        if (cx >= side) cx = side - 1;
+        if (cy >= side) cy = side - 1;
+        cellOf[k] = cy * side + cx;
+        counts[cellOf[k]]++;
+    }
+
+    cells.resize(side * side);
+    int first = 0;
+    for (int c = 0; c < side * side; ++c) {
+        memset(&cells[c], 0, sizeof(CullCell));
+        cells[c].first = first;
+        first += counts[c];
+    }
+
+    cellOrder.resize(count);
+    cellX.resize(count);
+    cellY.resize(count);
+    cellZ.resize(count);
+    cellScale.resize(count);
+    for (int k = 0; k < count; ++k) {
+        CullCell& cell = cells[cellOf[k]];
+        const SpeakerInstance& inst = instances[k];
+        int i = cell.first + cell.count;
+        cellOrder[i] = k;
+        cellX[i] = inst.offset[0];
+        cellY[i] = inst.offset[1];
+        cellZ[i] = inst.offset[2];
+        cellScale[i] = inst.scale;
+        for (int a = 0; a < 3; ++a) {
+            cell.boxMin[a] = cell.count ? fminf(cell.boxMin[a], inst.offset[a]) : inst.offset[a];
+            cell.boxMax[a] = cell.count ? fmaxf(cell.boxMax[a], inst.offset[a]) : inst.offset[a];
+        }
+        cell.maxScale = fmaxf(cell.maxScale, inst.scale);
+        cell.count++;
+    }
+
+    // Empty cells (possible on the last row) are dropped
+    size_t kept = 0;
+    for (size_t c = 0; c < cells.size(); ++c)
+        if (cells[c].count > 0)
+            cells[kept++] = cells[c];
+    cells.resize(kept);
+
+    radii.resize(count);
+    bodyVisible.resize(count);
+    shadowIndex.resize(count);
+    shadowX.resize(count);
+    shadowY.resize(count);
+    shadowZ.resize(count);
+    shadowR.resize(count);
+    shadowVisible.resize(count);
+}
+
+/**********************************************************
+ * readQueries() - Last frame's results, without waiting
+ *
+ * A result that is not in yet counts as visible; its cell
+ * is not queried again until it is.
+ **********************************************************/
+static void readQueries()
+{
+    for (size_t c = 0; c < cells.size(); ++c) {
+        CullCell& cell = cells[c];
+        cell.occluded = false;
+        if (!cell.queryPending)
+            continue;
+        GLuint available = 0;
+        glGetQueryObjectuiv(cell.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+        GLuint samples = 0;
+        glGetQueryObjectuiv(cell.query, GL_QUERY_RESULT, &samples);
+        cell.occluded = samples == 0;
+        cell.queryPending = false;
+    }
+}
+
+/**********************************************************
+ * cullCell(...) - Speakers of one straddling cell
+ *
+ * Spheres first; only the speakers found outside get their
+ * shadow sphere computed and tested.
+ **********************************************************/
+static void cullCell(const CullCell& cell, const CullFrustum& body,
+                     const CullFrustum& shadowFrustum, const CullShadow& shadow,
+                     float radius, unsigned char* visible)
+{
+    int first = cell.first, n = cell.count;
+    for (int i = 0; i < n; ++i)
+        radii[first + i] = cellScale[first + i] * radius;
+    cullSpheres(body, &cellX[first], &cellY[first], &cellZ[first], &radii[first], n,
+                &bodyVisible[first]);
+
+    int shadows = 0;
+    for (int i = first; i < first + n; ++i) {
+        if (bodyVisible[i]) {
+            visible[cellOrder[i]] = 1;
+            continue;
+        }
+        float center[3] = { cellX[i], cellY[i], cellZ[i] }, s[3], sr;
+        if (!cullShadowSphere(shadow, center, radii[i], s, &sr)) {
+            visible[cellOrder[i]] = 1;
+            continue;
+        }
+        shadowIndex[shadows] = i;
+        shadowX[shadows] = s[0];
+        shadowY[shadows] = s[1];
+        shadowZ[shadows] = s[2];
+        shadowR[shadows] = sr;
+        shadows++;
+    }
+    cullSpheres(shadowFrustum, shadowX.data(), shadowY.data(), shadowZ.data(), shadowR.data(),
+                shadows, shadowVisible.data());
+    for (int j = 0; j < shadows; ++j)
+        visible[cellOrder[shadowIndex[j]]] = shadowVisible[j];
+}
+
+/**********************************************************
+ * cullSpeakers(...) - Cell tests, then speaker tests
+ **********************************************************/
+void cullSpeakers(const CullFrustum& body, const CullFrustum& shadowFrustum,
+                  const CullShadow& shadow, float radius, const float cameraLocal[3],
+                  unsigned char* visible)
+{
+    readQueries();
+    boundRadius = radius;
+    memset(&cullStats, 0, sizeof(cullStats));
+    cullStats.instances = (int)cellOrder.size();
+    cullStats.cells     = (int)cells.size();
+
+    for (size_t c = 0; c < cells.size(); ++c) {
+        CullCell& cell = cells[c];
+        float margin = cell.maxScale * radius;
+        float center[3], half2 = 0.0f;
+        bool near = true;
+        for (int a = 0; a < 3; ++a) {
+            center[a] = 0.5f * (cell.boxMin[a] + cell.boxMax[a]);
+            float half = 0.5f * (cell.boxMax[a] - cell.boxMin[a]);
+            half2 += half * half;
+            if (fabsf(cameraLocal[a] - center[a]) > half + margin + CULL_NEAR_MARGIN)
+                near = false;
+        }
+        float cellRadius = sqrtf(half2) + margin;
+        cell.nearCamera = near;
+
+        // Whole cell first: speakers, then their shadows
+        int inBody = cullClassifySphere(body, center, cellRadius);
+        int inShadow = 1;
+        if (inBody < 1) {
+            float s[3], sr;
+            inShadow = cullShadowSphere(shadow, center, cellRadius, s, &sr)
+                     ? cullClassifySphere(shadowFrustum, s, sr) : 0;
+        }
+        cell.inFrustum = inBody >= 0 || inShadow >= 0;
+
+        if (!cell.inFrustum) {
+            cullStats.cellsRejected++;
+            for (int i = cell.first; i < cell.first + cell.count; ++i)
+                visible[cellOrder[i]] = 0;
+            cullStats.frustumCulled += cell.count;
+            continue;
+        }
+        if (cullOcclusion && cell.occluded && !near) {
+            for (int i = cell.first; i < cell.first + cell.count; ++i)
+                visible[cellOrder[i]] = 0;
+            cullStats.occlusionCulled += cell.count;
+            continue;
+        }
+        if (inBody == 1 || inShadow == 1) {
+            cullStats.cellsAccepted++;
+            for (int i = cell.first; i < cell.first + cell.count; ++i)
+                visible[cellOrder[i]] = 1;
+            cullStats.visible += cell.count;
+            continue;
+        }
+
+        cullCell(cell, body, shadowFrustum, shadow, radius, visible);
+        for (int i = cell.first; i < cell.first + cell.count; ++i) {
+            if (visible[cellOrder[i]])
+                cullStats.visible++;
+            else
+                cullStats.frustumCulled++;
+        }
+    }
+}
+
+// --------------------------------------------------------
+// OCCLUSION QUERIES
+// --------------------------------------------------------
+
+/**********************************************************
+ * drawBox(...) - The six faces of an axis-aligned box
+ **********************************************************/
+static void drawBox(const float lo[3], const float hi[3])
+{
+    static const int faces[6][4] = {
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 },   // z low, z high
+        { 0, 1, 5, 4 }, { 2, 6, 7, 3 },   // y low, y high
+        { 0, 4, 6, 2 }, { 1, 3, 7, 5 }    // x low, x high
+    };
+    glBegin(GL_QUADS);
+    for (int f = 0; f < 6; ++f)
+        for (int v = 0; v < 4; ++v) {
+            int corner = faces[f][v];
+            glVertex3f((corner & 1) ? hi[0] : lo[0],
+                       (corner & 2) ? hi[1] : lo[1],
+                       (corner & 4) ? hi[2] : lo[2]);
+        }
+    glEnd();
+}
+
+/**********************************************************
+ * cullIssueQueries(...) - One query per cell in the frustum
+ *
+ * Colour and depth writes are off; the caller has the depth
+ * test on and no program, texture, lighting or stencil.
+ **********************************************************/
+void cullIssueQueries(const float bodyModelview[16], const float shadowModelview[16])
+{
+    if (!cullOcclusion || cells.empty())
+        return;
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+
+    // The cell bounds as last used by cullSpeakers()
+    for (size_t c = 0; c < cells.size(); ++c) {
+        CullCell& cell = cells[c];
+        if (!cell.inFrustum || cell.nearCamera || cell.queryPending)
+            continue;
+        if (!cell.query)
+            glGenQueries(1, &cell.query);
+
+        float margin = cell.maxScale * boundRadius;
+        float lo[3], hi[3];
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = cell.boxMin[a] - margin;
+            hi[a] = cell.boxMax[a] + margin;
+        }
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, cell.query);
+        glLoadMatrixf(bodyModelview);
+        drawBox(lo, hi);
+        glLoadMatrixf(shadowModelview);
+        drawBox(lo, hi);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        cell.queryPending = true;
+        cullStats.queries++;
+    }
+
+    glPopMatrix();
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// --------------------------------------------------------
+// BACKEND SELECTION
+// --------------------------------------------------------
+
+/**********************************************************
+ * cullBestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+CullBackend cullBestBackend()
+{
+#ifdef CULL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return CULL_AVX;
+    if (__builtin_cpu_supports("sse2")) return CULL_SSE2;
+#endif
+    return CULL_SCALAR;
+}
+
+/**********************************************************
+ * cullCurrentBackend() - Kernel the sphere tests use
+ **********************************************************/
+CullBackend cullCurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * cullSetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+CullBackend cullSetBackend(CullBackend backend)
+{
+    CullBackend best = cullBestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * cullBackendName(...) - For logs and bench output
+ **********************************************************/
+const char* cullBackendName(CullBackend backend)
+{
+    switch (backend) {
+        case CULL_AVX:  return "avx";
+        case CULL_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
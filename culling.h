@@ -0,0 +1,125 @@
+/**********************************************************
+ *  Orator - culling.h
+ *
+ *  Visibility culling of the speakers and their planar
+ *  shadows. Every speaker has a bounding sphere, and so has
+ *  its shadow: the sphere projected from the point light
+ *  onto the floor plane. A speaker is drawn if either one
+ *  touches the view frustum, since the instanced shadow
+ *  pass draws the same instances as the lit pass.
+ *
+ *  Arrays are split into a uniform grid of cells over the
+ *  layout plane. A cell whose bounds are entirely outside
+ *  (or inside) the frustum is rejected (or accepted) as a
+ *  whole. Only the speakers of straddling cells are tested
+ *  one by one, 4 or 8 spheres per SIMD plane test.
+ *
+ *  With --occlusion every cell in the frustum also gets a
+ *  hardware occlusion query: its box is drawn, invisibly,
+ *  against the finished depth buffer, once as it stands and
+ *  once flattened through the shadow matrix. A cell whose
+ *  query passed no samples is skipped in the next frame.
+ *  Results are read one frame late and never waited for.
+ *
+ *  All tests run in the array's own frame (the frustum is
+ *  built from the modelview with the array rotation), so
+ *  the speaker positions are never transformed.
+ **********************************************************/
+#ifndef ORATOR_CULLING_H
+#define ORATOR_CULLING_H
+
+#include "speakers.h"  // SpeakerInstance
+
+#include <vector>
+
+// Speakers per grid cell side
+#define CULL_CELL_SIDE 16
+
+// A cell this close to the camera is never occlusion tested:
+// the near plane would clip its box
+#define CULL_NEAR_MARGIN 2.0f
+
+enum CullBackend {
+    CULL_SCALAR = 0,
+    CULL_SSE2,
+    CULL_AVX
+};
+
+// Planes in the order left, right, bottom, top, near, far.
+// a*x + b*y + c*z + d is the distance, positive inside.
+struct CullFrustum {
+    float planes[6][4];
+};
+
+// Point light and receiving plane of the planar shadow, both
+// in the frame of the speakers casting it
+struct CullShadow {
+    float light[3];
+    float plane[4];   // Normalised
+};
+
+// Counts of the last frame
+struct CullStats {
+    int instances;         // Speakers tested
+    int visible;           // Drawn: speaker or shadow in view
+    int frustumCulled;     // Speaker and shadow outside the frustum
+    int occlusionCulled;   // In a cell touching the frustum, hidden last frame
+    int cells;             // Grid cells (0 for a single speaker)
+    int cellsRejected;     // Outside as a whole
+    int cellsAccepted;     // Inside as a whole
+    int queries;           // Occlusion queries issued
+};
+extern CullStats cullStats;
+
+extern bool cullEnabled;     // --no-cull turns it off
+extern bool cullOcclusion;   // --occlusion
+
+// Planes of projection * modelview (both column-major)
+void cullBuildFrustum(const float projection[16], const float modelview[16], CullFrustum& f);
+
+// Light and plane (world) in the frame of 'model', a rigid
+// transform (column-major) from that frame to world
+void cullBuildShadow(const float model[16], const float light[4], const float plane[4],
+                     CullShadow& s);
+
+// 1 inside, 0 straddling, -1 outside
+int cullClassifySphere(const CullFrustum& f, const float center[3], float radius);
+
+// Bounding sphere of the shadow of a sphere. False if the
+// sphere reaches the light's height (no bounded shadow).
+bool cullShadowSphere(const CullShadow& s, const float center[3], float radius,
+                      float shadowCenter[3], float* shadowRadius);
+
+// visible[i] = 1 if sphere i (SoA) is at least partly inside
+void cullSpheres(const CullFrustum& f, const float* x, const float* y, const float* z,
+                 const float* r, int count, unsigned char* visible);
+
+// The single speaker at the origin: are it and its shadow
+// in view? Fills in cullStats.
+void cullSingleSpeaker(const CullFrustum& body, const CullFrustum& shadowFrustum,
+                       const CullShadow& shadow, float radius,
+                       bool* bodyVisible, bool* shadowVisible);
+
+// Grid over the layout (speakers.h); call after every new
+// layout, with the GL context current (drops old queries)
+void cullBuildGrid(const std::vector<SpeakerInstance>& instances);
+
+// Per frame: visible[k] for every speaker of the grid, for
+// speakers of bounding radius 'radius' x their scale.
+// Picks up the previous frame's occlusion results first.
+void cullSpeakers(const CullFrustum& body, const CullFrustum& shadowFrustum,
+                  const CullShadow& shadow, float radius, const float cameraLocal[3],
+                  unsigned char* visible);
+
+// After the frame is drawn: one occlusion query per cell in
+// the frustum. bodyModelview and shadowModelview are the
+// matrices the lit and the shadow pass draw the array with.
+void cullIssueQueries(const float bodyModelview[16], const float shadowModelview[16]);
+
+CullBackend cullBestBackend();
+CullBackend cullCurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+CullBackend cullSetBackend(CullBackend backend);
+const char* cullBackendName(CullBackend backend);
+
+#endif // ORATOR_CULLING_H
@@ -0,0 +1,119 @@
+/**********************************************************
+ *  Orator - drawlist.cpp
+ *
+ *  Sorted per-frame draw submissions (see drawlist.h).
+ **********************************************************/
+#include "drawlist.h"
+#include "glstate.h"
+#include "shader.h"    // shaderSetModelview
+#include "profiler.h"
+
+#include <algorithm>   // std::sort
+#include <vector>
+
+// Sort key, most significant first:
+//   layer (8 bits) | program (16) | texture (16) |
+//   stencil (1) | lighting (1) | submission order (22)
+// GL names are small integers in practice; larger ones only
+// sort less well, they are never drawn wrong.
+#define DRAW_KEY_ORDER_BITS 22
+
+static std::vector<DrawItem> items;   // Capacity kept across frames
+static int lastFlushSize = 0;
+
+/**********************************************************
+ * drawKey(...) - Sort key of one submission
+ **********************************************************/
+static uint64_t drawKey(DrawLayer layer, const DrawState& state, size_t order)
+{
+    uint64_t key = (uint64_t)layer << 56;
+    key |= (uint64_t)(state.program & 0xFFFF) << 40;
+    key |= (uint64_t)(state.texture & 0xFFFF) << 24;
+    key |= (uint64_t)(state.stencil  ? 1 : 0) << 23;
+    key |= (uint64_t)(state.lighting ? 1 : 0) << DRAW_KEY_ORDER_BITS;
+    key |= (uint64_t)order & ((1u << DRAW_KEY_ORDER_BITS) - 1);
+    return key;
+}
+
+static bool keyLess(const DrawItem& a, const DrawItem& b)
+{
+    return a.key < b.key;
+}
+
+/**********************************************************
+ * applyState(...) - Everything an item asked for
+ *
+ * Goes through the state cache, so only real changes
+ * between neighbouring items reach GL.
+ **********************************************************/
+static void applyState(const DrawState& state)
+{
+    stateUseProgram(state.program);
+    stateEnable(GL_TEXTURE_2D, state.texture != 0);
+    if (state.texture)
+        stateBindTexture(state.texture);
+    stateEnable(GL_LIGHTING, state.lighting);
+    stateEnable(GL_STENCIL_TEST, state.stencil);
+    stateColor(state.color[0], state.color[1], state.color[2], state.color[3]);
+}
+
+/**********************************************************
+ * drawListBegin() - Empty list, same storage
+ **********************************************************/
+void drawListBegin()
+{
+    items.clear();
+}
+
+/**********************************************************
+ * drawListSubmit(...) - Record one draw for the flush
+ **********************************************************/
+void drawListSubmit(DrawLayer layer, const DrawState& state, const mat4& modelview,
+                    DrawFunction draw, int arg, int stage)
+{
+    DrawItem item;
+    item.key   = drawKey(layer, state, items.size());
+    item.state = state;
+    item.modelview = modelview;
+    item.draw  = draw;
+    item.arg   = arg;
+    item.stage = stage;
+    items.push_back(item);
+}
+
+/**********************************************************
+ * drawListFlush() - Sort by state, then draw in that order
+ *
+ * Each item's modelview is made current for its draw; the
+ * caller's is current again afterwards.
+ **********************************************************/
+void drawListFlush()
+{
+    std::sort(items.begin(), items.end(), keyLess);
+
+    mat4 caller = shaderModelview();
+    for (size_t i = 0; i < items.size(); ++i) {
+        const DrawItem& item = items[i];
+        applyState(item.state);
+        shaderSetModelview(item.modelview);
+        if (item.stage >= 0) {
+            ProfileScope scope((ProfileStage)item.stage);
+            item.draw(item);
+        } else {
+            item.draw(item);
+        }
+    }
+    shaderSetModelview(caller);
+
+    // Code outside the list expects the fixed-function pipeline
+    stateUseProgram(0);
+    lastFlushSize = (int)items.size();
+}
+
+/**********************************************************
+ * drawListSize() - Items in the last flush
+ **********************************************************/
+int drawListSize()
+{
+    return lastFlushSize;
+}
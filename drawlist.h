@@ -0,0 +1,66 @@
+/**********************************************************
+ *  Orator - drawlist.h
+ *
+ *  Per-frame list of draw submissions. Each item names the
+ *  state it needs (program, texture, lighting, stencil,
+ *  color), the modelview matrix it is drawn under (mat4.h)
+ *  and a function that draws it. drawListFlush() sorts the
+ *  items by a key built from that state, so items sharing a
+ *  program or texture run back to back, then applies each
+ *  item's state through the cache in glstate.h and draws.
+ *
+ *  Layers keep the order that matters: the planar shadow is
+ *  blended into the floor with the stencil buffer, so it is
+ *  drawn after everything opaque. Within a layer, items with
+ *  equal state keep their submission order.
+ **********************************************************/
+#ifndef ORATOR_DRAWLIST_H
+#define ORATOR_DRAWLIST_H
+
+#include "mat4.h"
+
+#include <GL/gl.h>
+#include <stdint.h>    // uint64_t
+
+enum DrawLayer {
+    DRAW_LAYER_OPAQUE = 0,
+    DRAW_LAYER_SHADOW,     // Needs the floor's depth and stencil
+    DRAW_LAYER_COUNT
+};
+
+// Everything an item needs set before its draw function runs
+struct DrawState {
+    GLuint  program;    // 0 = fixed function
+    GLuint  texture;    // 0 = GL_TEXTURE_2D disabled
+    bool    lighting;
+    bool    stencil;    // Shadow pass: each pixel written once
+    GLfloat color[4];   // Current color (color material)
+};
+
+struct DrawItem;
+typedef void (*DrawFunction)(const DrawItem& item);
+
+struct DrawItem {
+    uint64_t     key;            // Layer, state and submission order
+    DrawState    state;
+    mat4         modelview;      // Made current before draw() runs
+    DrawFunction draw;
+    int          arg;            // Passed through, e.g. a MeshComponent
+    int          stage;          // ProfileStage to time it under, or -1
+};
+
+// Starts an empty list for a new frame
+void drawListBegin();
+
+// Records one item, drawn under 'modelview'
+void drawListSubmit(DrawLayer layer, const DrawState& state, const mat4& modelview,
+                    DrawFunction draw, int arg, int stage);
+
+// Sorts and draws everything submitted since drawListBegin(),
+// then leaves the fixed-function pipeline (program 0) bound
+void drawListFlush();
+
+// Items drawn by the last flush
+int drawListSize();
+
+#endif // ORATOR_DRAWLIST_H
@@ -0,0 +1,236 @@
+/**********************************************************
+ *  Orator - fft.cpp
+ *
+ *  Radix-2/4 SoA FFT with scalar, SSE2 and AVX kernels
+ *  (see fft.h). The SIMD kernels are compiled with per-
+ *  function target attributes, so the program itself needs
+ *  no -mavx and still runs on CPUs without AVX.
+ **********************************************************/
+#include "fft.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FFT_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static FftBackend currentBackend = fftBestBackend();
+
+// --------------------------------------------------------
+// PLAN
+// --------------------------------------------------------
+
+/**********************************************************
+ * fftInit(...) - Permutation and twiddle tables
+ **********************************************************/
+bool fftInit(FftPlan& plan, int n)
+{
+    if (n < 4 || (n & (n - 1)) != 0)
+        return false;
+    plan.n = n;
+
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+    plan.bitReverse.resize(n);
+    for (int i = 0; i < n; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b)
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        plan.bitReverse[i] = r;
+    }
+
+    // Stage with half-size h uses exp(-2*pi*i*k / 2h), k < h,
+    // stored contiguously at [h, 2h) so SIMD can load them
+    plan.twiddleRe.assign(n, 0.0f);
+    plan.twiddleIm.assign(n, 0.0f);
+    for (int h = 1; h < n; h *= 2) {
+        for (int k = 0; k < h; ++k) {
+            double a = -M_PI * k / h;
+            plan.twiddleRe[h + k] = (float)cos(a);
+            plan.twiddleIm[h + k] = (float)sin(a);
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------
+// KERNELS
+// --------------------------------------------------------
+
+/**********************************************************
+ * radix4First(...) - Stages h=1 and h=2 in one pass
+ *
+ * Twiddles are 1 and -i there: no multiplications at all.
+ **********************************************************/
+static void radix4First(float* re, float* im, int n)
+{
+    for (int s = 0; s < n; s += 4) {
+        // h = 1
+        float r0 = re[s]     + re[s + 1], i0 = im[s]     + im[s + 1];
+        float r1 = re[s]     - re[s + 1], i1 = im[s]     - im[s + 1];
+        float r2 = re[s + 2] + re[s + 3], i2 = im[s + 2] + im[s + 3];
+        float r3 = re[s + 2] - re[s + 3], i3 = im[s + 2] - im[s + 3];
+        // h = 2: (r3 + i*i3) * -i = i3 - i*r3
+        re[s]     = r0 + r2;  im[s]     = i0 + i2;
+        re[s + 2] = r0 - r2;  im[s + 2] = i0 - i2;
+        re[s + 1] = r1 + i3;  im[s + 1] = i1 - r3;
+        re[s + 3] = r1 - i3;  im[s + 3] = i1 + r3;
+    }
+}
+
+/**********************************************************
+ * radix2Scalar(...) - One radix-2 stage, any h
+ **********************************************************/
+static void radix2Scalar(float* re, float* im, int n, int h,
+                         const float* wr, const float* wi)
+{
+    for (int s = 0; s < n; s += 2 * h) {
+        float* ar = re + s;  float* ai = im + s;
+        float* br = ar + h;  float* bi = ai + h;
+        for (int k = 0; k < h; ++k) {
+            float tr = br[k] * wr[k] - bi[k] * wi[k];
+            float ti = br[k] * wi[k] + bi[k] * wr[k];
+            br[k] = ar[k] - tr;  bi[k] = ai[k] - ti;
+            ar[k] = ar[k] + tr;  ai[k] = ai[k] + ti;
+        }
+    }
+}
+
+#ifdef FFT_X86
+/**********************************************************
+ * radix2Sse2(...) - One radix-2 stage, h a multiple of 4
+ **********************************************************/
+__attribute__((target("sse2")))
+static void radix2Sse2(float* re, float* im, int n, int h,
+                       const float* wr, const float* wi)
+{
+    for (int s = 0; s < n; s += 2 * h) {
+        float* ar = re + s;  float* ai = im + s;
+        float* br = ar + h;  float* bi = ai + h;
+        for (int k = 0; k < h; k += 4) {
+            __m128 vwr = _mm_loadu_ps(wr + k), vwi = _mm_loadu_ps(wi + k);
+            __m128 vbr = _mm_loadu_ps(br + k), vbi = _mm_loadu_ps(bi + k);
+            __m128 var = _mm_loadu_ps(ar + k), vai = _mm_loadu_ps(ai + k);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(vbr, vwr), _mm_mul_ps(vbi, vwi));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(vbr, vwi), _mm_mul_ps(vbi, vwr));
+            _mm_storeu_ps(br + k, _mm_sub_ps(var, tr));
+            _mm_storeu_ps(bi + k, _mm_sub_ps(vai, ti));
+            _mm_storeu_ps(ar + k, _mm_add_ps(var, tr));
+            _mm_storeu_ps(ai + k, _mm_add_ps(vai, ti));
+        }
+    }
+}
+
+/**********************************************************
+ * radix2Avx(...) - One radix-2 stage, h a multiple of 8
+ **********************************************************/
+__attribute__((target("avx")))
+static void radix2Avx(float* re, float* im, int n, int h,
+                      const float* wr, const float* wi)
+{
+    for (int s = 0; s < n; s += 2 * h) {
+        float* ar = re + s;  float* ai = im + s;
+        float* br = ar + h;  float* bi = ai + h;
+        for (int k = 0; k < h; k += 8) {
+            __m256 vwr = _mm256_loadu_ps(wr + k), vwi = _mm256_loadu_ps(wi + k);
+            __m256 vbr = _mm256_loadu_ps(br + k), vbi = _mm256_loadu_ps(bi + k);
+            __m256 var = _mm256_loadu_ps(ar + k), vai = _mm256_loadu_ps(ai + k);
+            __m256 tr = _mm256_sub_ps(_mm256_mul_ps(vbr, vwr), _mm256_mul_ps(vbi, vwi));
+            __m256 ti = _mm256_add_ps(_mm256_mul_ps(vbr, vwi), _mm256_mul_ps(vbi, vwr));
+            _mm256_storeu_ps(br + k, _mm256_sub_ps(var, tr));
+            _mm256_storeu_ps(bi + k, _mm256_sub_ps(vai, ti));
+            _mm256_storeu_ps(ar + k, _mm256_add_ps(var, tr));
+            _mm256_storeu_ps(ai + k, _mm256_add_ps(vai, ti));
+        }
+    }
+}
+#endif
+
+// --------------------------------------------------------
+// TRANSFORM
+// --------------------------------------------------------
+
+/**********************************************************
+ * fftForward(...) - Permute, radix-4 pass, radix-2 passes
+ **********************************************************/
+void fftForward(const FftPlan& plan, float* re, float* im)
+{
+    int n = plan.n;
+    for (int i = 0; i < n; ++i) {
+        int j = plan.bitReverse[i];
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    radix4First(re, im, n);
+
+    for (int h = 4; h < n; h *= 2) {
+        const float* wr = &plan.twiddleRe[h];
+        const float* wi = &plan.twiddleIm[h];
+#ifdef FFT_X86
+        if (currentBackend == FFT_AVX && h >= 8) {
+            radix2Avx(re, im, n, h, wr, wi);
+            continue;
+        }
+        if (currentBackend >= FFT_SSE2) {
+            radix2Sse2(re, im, n, h, wr, wi);
+            continue;
+        }
+#endif
+        radix2Scalar(re, im, n, h, wr, wi);
+    }
+}
+
+// --------------------------------------------------------
+// BACKEND SELECTION
+// --------------------------------------------------------
+
+/**********************************************************
+ * fftBestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+FftBackend fftBestBackend()
+{
+#ifdef FFT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return FFT_AVX;
+    if (__builtin_cpu_supports("sse2")) return FFT_SSE2;
+#endif
+    return FFT_SCALAR;
+}
+
+/**********************************************************
+ * fftCurrentBackend() - Kernel fftForward() uses
+ **********************************************************/
+FftBackend fftCurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * fftSetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+FftBackend fftSetBackend(FftBackend backend)
+{
+    FftBackend best = fftBestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * fftBackendName(...) - For logs and bench output
+ **********************************************************/
+const char* fftBackendName(FftBackend backend)
+{
+    switch (backend) {
+        case FFT_AVX:  return "avx";
+        case FFT_SSE2: return "sse2";
+        default:       return "scalar";
+    }
+}
@@ -0,0 +1,45 @@
+/**********************************************************
+ *  Orator - fft.h
+ *
+ *  In-place complex FFT for the audio analysis thread.
+ *  Data is split into separate real and imaginary arrays
+ *  (SoA), so one SIMD register holds 4 (SSE2) or 8 (AVX)
+ *  butterflies of the same stage. The first two stages run
+ *  as one radix-4 pass (their twiddles are just 1 and -i),
+ *  the rest as radix-2 passes with per-stage twiddle tables.
+ *
+ *  The widest kernel the CPU supports is picked at run
+ *  time; the scalar one works everywhere.
+ **********************************************************/
+#ifndef ORATOR_FFT_H
+#define ORATOR_FFT_H
+
+#include <vector>
+
+enum FftBackend {
+    FFT_SCALAR = 0,
+    FFT_SSE2,
+    FFT_AVX
+};
+
+struct FftPlan {
+    int n;                           // Power of two, >= 4
+    std::vector<int>   bitReverse;   // Input permutation
+    std::vector<float> twiddleRe;    // Stage h: entries [h, 2h)
+    std::vector<float> twiddleIm;
+};
+
+// Builds the tables for an n-point transform
+bool fftInit(FftPlan& plan, int n);
+
+// Forward transform, X[k] = sum x[j] * exp(-2*pi*i*j*k/n)
+void fftForward(const FftPlan& plan, float* re, float* im);
+
+// Best backend this CPU supports, and the one in use
+FftBackend fftBestBackend();
+FftBackend fftCurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+FftBackend fftSetBackend(FftBackend backend);
+const char* fftBackendName(FftBackend backend);
+
+#endif // ORATOR_FFT_H
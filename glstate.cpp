@@ -0,0 +1,147 @@
+/**********************************************************
+ *  Orator - glstate.cpp
+ *
+ *  Redundant-change filter for GL state (see glstate.h).
+ **********************************************************/
+#include "glstate.h"
+
+#include <string.h>    // memcmp, memcpy
+
+StateStats stateStats = { 0, 0 };
+
+// Cached enable bits, in this order
+static const GLenum cachedCaps[] = {
+    GL_TEXTURE_2D, GL_LIGHTING, GL_DEPTH_TEST, GL_STENCIL_TEST
+};
+#define STATE_CAP_COUNT (int)(sizeof(cachedCaps) / sizeof(cachedCaps[0]))
+
+// Last values sent to GL; 'known' is false until the first
+// one after stateInvalidate()
+struct CachedState {
+    bool    capKnown[STATE_CAP_COUNT];
+    bool    capOn[STATE_CAP_COUNT];
+    bool    textureKnown, programKnown, shadeKnown, colorKnown;
+    bool    specularKnown, shininessKnown;
+    GLuint  texture;
+    GLuint  program;
+    GLenum  shadeModel;
+    GLfloat color[4];
+    GLfloat specular[4];
+    GLfloat shininess;
+};
+static CachedState cache;   // Zeroed: nothing known yet
+
+/**********************************************************
+ * resetStateStats() - Start counting a new frame
+ **********************************************************/
+void resetStateStats()
+{
+    stateStats.requested = 0;
+    stateStats.issued    = 0;
+}
+
+/**********************************************************
+ * stateInvalidate() - Assume nothing about the GL state
+ **********************************************************/
+void stateInvalidate()
+{
+    memset(&cache, 0, sizeof(cache));
+}
+
+/**********************************************************
+ * stateEnable(...) - glEnable/glDisable if it changes
+ **********************************************************/
+void stateEnable(GLenum cap, bool on)
+{
+    ++stateStats.requested;
+    for (int i = 0; i < STATE_CAP_COUNT; ++i) {
+        if (cachedCaps[i] != cap)
+            continue;
+        if (cache.capKnown[i] && cache.capOn[i] == on)
+            return;
+        cache.capKnown[i] = true;
+        cache.capOn[i]    = on;
+        break;
+    }
+    ++stateStats.issued;
+    if (on) glEnable(cap);
+    else    glDisable(cap);
+}
+
+/**********************************************************
+ * stateBindTexture(...) - 2D texture of the active unit
+ **********************************************************/
+void stateBindTexture(GLuint texture)
+{
+    ++stateStats.requested;
+    if (cache.textureKnown && cache.texture == texture)
+        return;
+    cache.textureKnown = true;
+    cache.texture      = texture;
+    ++stateStats.issued;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/**********************************************************
+ * stateUseProgram(...) - Shader program or fixed function
+ **********************************************************/
+void stateUseProgram(GLuint program)
+{
+    ++stateStats.requested;
+    if (cache.programKnown && cache.program == program)
+        return;
+    cache.programKnown = true;
+    cache.program      = program;
+    ++stateStats.issued;
+    glUseProgram(program);
+}
+
+/**********************************************************
+ * stateShadeModel(...) - GL_SMOOTH or GL_FLAT
+ **********************************************************/
+void stateShadeModel(GLenum mode)
+{
+    ++stateStats.requested;
+    if (cache.shadeKnown && cache.shadeModel == mode)
+        return;
+    cache.shadeKnown = true;
+    cache.shadeModel = mode;
+    ++stateStats.issued;
+    glShadeModel(mode);
+}
+
+/**********************************************************
+ * stateColor(...) - Current color (and color material)
+ **********************************************************/
+void stateColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    GLfloat color[4] = { r, g, b, a };
+    ++stateStats.requested;
+    if (cache.colorKnown && memcmp(cache.color, color, sizeof(color)) == 0)
+        return;
+    cache.colorKnown = true;
+    memcpy(cache.color, color, sizeof(color));
+    ++stateStats.issued;
+    glColor4fv(color);
+}
+
+/**********************************************************
+ * stateMaterial(...) - Front-face specular / shininess
+ **********************************************************/
+void stateMaterial(GLenum pname, const GLfloat* params)
+{
+    ++stateStats.requested;
+    if (pname == GL_SPECULAR) {
+        if (cache.specularKnown && memcmp(cache.specular, params, sizeof(cache.specular)) == 0)
+            return;
+        cache.specularKnown = true;
+        memcpy(cache.specular, params, sizeof(cache.specular));
+    } else if (pname == GL_SHININESS) {
+        if (cache.shininessKnown && cache.shininess == params[0])
+            return;
+        cache.shininessKnown = true;
+        cache.shininess      = params[0];
+    }
+    ++stateStats.issued;
+    glMaterialfv(GL_FRONT, pname, params);
+}
@@ -0,0 +1,58 @@
+/**********************************************************
+ *  Orator - glstate.h
+ *
+ *  Thin cache over the GL state the renderer changes every
+ *  frame: enable bits, the bound texture and program, the
+ *  shade model, the current color and the front material.
+ *  Each call compares against the last value it set and
+ *  only reaches GL when something actually changes. The
+ *  counters say how many changes were asked for and how
+ *  many were issued, so the difference is what the cache
+ *  saved.
+ *
+ *  The cache only knows what went through it. Code that
+ *  changes the same state directly (setup code, or the HUD's
+ *  glPushAttrib/glPopAttrib, which restores it) must either
+ *  leave it as it found it or call stateInvalidate().
+ **********************************************************/
+#ifndef ORATOR_GLSTATE_H
+#define ORATOR_GLSTATE_H
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+// State changes since the last resetStateStats()
+struct StateStats {
+    long requested;   // Calls into this module
+    long issued;      // Calls that reached GL
+};
+extern StateStats stateStats;
+
+void resetStateStats();
+
+// Forget the cached values (e.g. after a new context or raw
+// GL setup calls); the next request of each is always issued
+void stateInvalidate();
+
+// glEnable/glDisable. GL_TEXTURE_2D, GL_LIGHTING,
+// GL_DEPTH_TEST and GL_STENCIL_TEST are cached; any other
+// capability goes straight through.
+void stateEnable(GLenum cap, bool on);
+
+// glBindTexture(GL_TEXTURE_2D, ...) on the active unit
+void stateBindTexture(GLuint texture);
+
+// glUseProgram (0 = fixed function)
+void stateUseProgram(GLuint program);
+
+void stateShadeModel(GLenum mode);
+
+// glColor4f; with GL_COLOR_MATERIAL this is the ambient and
+// diffuse material as well
+void stateColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+// glMaterialfv(GL_FRONT, ...) for GL_SPECULAR (4 values) or
+// GL_SHININESS (1 value); other names go straight through
+void stateMaterial(GLenum pname, const GLfloat* params);
+
+#endif // ORATOR_GLSTATE_H
@@ -0,0 +1,109 @@
+/**********************************************************
+ *  Orator - lod.cpp
+ *
+ *  LOD chain and screen-space level selection (see lod.h).
+ **********************************************************/
+#include "lod.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Level 0 is the original 100x50 / 100 / 100x20 tessellation.
+// Triangles per speaker: 14200, 5760, 1472, 384, 112, 60.
+// The thresholds keep the silhouette error r*(1-cos(pi/uSteps))
+// at or below about half a pixel. Their sin/cos tables are
+// compiled in (tesstable.cpp); keep the two lists in sync.
+const LodLevel lodLevels[LOD_LEVELS] = {
+    { 100, 50, 20, 300.0f },
+    {  64, 32, 12, 100.0f },
+    {  32, 16,  6,  30.0f },
+    {  16,  8,  3,   8.0f },
+    {   8,  4,  2,   4.0f },
+    {   6,  3,  1,   0.0f },
+};
+
+/**********************************************************
+ * lodPixelScale(...) - Viewport pixels per unit at depth 1
+ **********************************************************/
+float lodPixelScale(float fovYDegrees, int viewportHeight)
+{
+    float halfFov = 0.5f * fovYDegrees * (float)M_PI / 180.0f;
+    return 0.5f * viewportHeight / tanf(halfFov);
+}
+
+/**********************************************************
+ * lodProjectedRadius(...) - Sphere radius on screen in pixels
+ **********************************************************/
+float lodProjectedRadius(float worldRadius, float distance, float pixelScale)
+{
+    if (distance <= worldRadius)
+        return 1.0e9f;   // Camera inside the bounds: finest level
+    return worldRadius / distance * pixelScale;
+}
+
+/**********************************************************
+ * selectLod(...) - Threshold test with hysteresis
+ *
+ * Refining to level L-1 needs radius > min(L-1) * (1 + H);
+ * coarsening past level L needs radius < min(L) * (1 - H).
+ **********************************************************/
+int selectLod(int currentLevel, float radiusPixels)
+{
+    int level = currentLevel;
+    if (level < 0) level = 0;
+    if (level >= LOD_LEVELS) level = LOD_LEVELS - 1;
+
+    while (level > 0 &&
+           radiusPixels > lodLevels[level - 1].minPixels * (1.0f + LOD_HYSTERESIS))
+        level--;
+    while (level < LOD_LEVELS - 1 &&
+           radiusPixels < lodLevels[level].minPixels * (1.0f - LOD_HYSTERESIS))
+        level++;
+    return level;
+}
+
+/**********************************************************
+ * lodDistances(...) - selectLod()'s thresholds as squared
+ *                     distances, once per frame
+ *
+ * r * pixelScale / d > m * (1 + H) is the same test as
+ * d^2 < r^2 * (pixelScale / (m * (1 + H)))^2. The coarsest
+ * level never coarsens further.
+ **********************************************************/
+void lodDistances(float pixelScale, LodDistances& out)
+{
+    for (int l = 0; l < LOD_LEVELS; ++l) {
+        out.refineSq[l]  = 0.0f;
+        out.coarsenSq[l] = HUGE_VALF;
+        if (l > 0) {
+            float d = pixelScale / (lodLevels[l - 1].minPixels * (1.0f + LOD_HYSTERESIS));
+            out.refineSq[l] = d * d;
+        }
+        if (lodLevels[l].minPixels > 0.0f) {
+            float d = pixelScale / (lodLevels[l].minPixels * (1.0f - LOD_HYSTERESIS));
+            out.coarsenSq[l] = d * d;
+        }
+    }
+}
+
+/**********************************************************
+ * selectLodSquared(...) - selectLod() without the sqrt
+ **********************************************************/
+int selectLodSquared(int currentLevel, float distanceSq, float worldRadiusSq,
+                     const LodDistances& d)
+{
+    if (distanceSq <= worldRadiusSq)
+        return 0;   // Camera inside the bounds: finest level
+    int level = currentLevel;
+    if (level < 0) level = 0;
+    if (level >= LOD_LEVELS) level = LOD_LEVELS - 1;
+
+    while (level > 0 && distanceSq < d.refineSq[level] * worldRadiusSq)
+        level--;
+    while (level < LOD_LEVELS - 1 && distanceSq > d.coarsenSq[level] * worldRadiusSq)
+        level++;
+    return level;
+}
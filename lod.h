@@ -0,0 +1,54 @@
+/**********************************************************
+ *  Orator - lod.h
+ *
+ *  Screen-space level of detail for the speaker meshes.
+ *  Every level of the chain is tessellated up front; each
+ *  frame a level is picked from the speaker's projected
+ *  radius in pixels. A hysteresis band around every
+ *  threshold keeps a speaker from flickering between two
+ *  levels when its size hovers near a boundary.
+ **********************************************************/
+#ifndef ORATOR_LOD_H
+#define ORATOR_LOD_H
+
+// Number of levels in the chain (0 = finest)
+#define LOD_LEVELS 6
+
+// Relative width of the hysteresis band around each threshold
+#define LOD_HYSTERESIS 0.15f
+
+// Tessellation of one level plus the screen size it needs
+struct LodLevel {
+    int   uSteps;        // Around the axis (all three parts)
+    int   capVSteps;     // Along phi for the cap
+    int   concaveVSteps; // Radial rings for the concavity
+    float minPixels;     // Smallest projected radius using this level
+};
+
+extern const LodLevel lodLevels[LOD_LEVELS];
+
+// Pixels covered by one world unit at distance 1, for a
+// perspective projection with vertical FOV fovYDegrees
+float lodPixelScale(float fovYDegrees, int viewportHeight);
+
+// Projected radius in pixels of a sphere at 'distance'
+float lodProjectedRadius(float worldRadius, float distance, float pixelScale);
+
+// Level for a projected radius, starting from the current one.
+// Only moves when the radius is clearly past a threshold.
+int selectLod(int currentLevel, float radiusPixels);
+
+// The hysteresis thresholds as squared camera distances for a
+// speaker of radius 1, for one pixelScale: per-speaker tests
+// need no sqrt (multiply by the squared world radius)
+struct LodDistances {
+    float refineSq[LOD_LEVELS];    // Refine from level L below this
+    float coarsenSq[LOD_LEVELS];   // Coarsen from level L above this
+};
+void lodDistances(float pixelScale, LodDistances& out);
+
+// selectLod() from the squared distance to the camera
+int selectLodSquared(int currentLevel, float distanceSq, float worldRadiusSq,
+                     const LodDistances& d);
+
+#endif // ORATOR_LOD_H
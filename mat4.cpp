@@ -0,0 +1,340 @@
+/**********************************************************
+ *  Orator - mat4.cpp
+ *
+ *  Scalar, SSE2 and AVX matrix products and the matrix
+ *  builders that replace the GL/GLU calls (see mat4.h).
+ *
+ *  Element (row, col) of a * b is
+ *    ((a0 * b0 + a1 * b1) + a2 * b2) + a3 * b3
+ *  in every kernel: a column of the result is the columns of
+ *  a scaled by the column of b and summed in that order.
+ **********************************************************/
+#include "mat4.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MAT4_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static Mat4Backend currentBackend = mat4BestBackend();
+
+// --------------------------------------------------------
+// PRODUCT KERNELS: out[i] = a * b[i]
+// --------------------------------------------------------
+
+/**********************************************************
+ * multiplyScalar(...) - One element at a time
+ **********************************************************/
+static void multiplyScalar(const mat4& a, const mat4* b, mat4* out, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        float r[16];
+        const float* bm = b[i].m;
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+                r[col * 4 + row] = a.m[0 * 4 + row] * bm[col * 4 + 0] +
+                                   a.m[1 * 4 + row] * bm[col * 4 + 1] +
+                                   a.m[2 * 4 + row] * bm[col * 4 + 2] +
+                                   a.m[3 * 4 + row] * bm[col * 4 + 3];
+        memcpy(out[i].m, r, sizeof(r));
+    }
+}
+
+#ifdef MAT4_X86
+/**********************************************************
+ * multiplySse2(...) - One result column per register
+ **********************************************************/
+__attribute__((target("sse2")))
+static void multiplySse2(const mat4& a, const mat4* b, mat4* out, int count)
+{
+    __m128 a0 = _mm_loadu_ps(a.m + 0);
+    __m128 a1 = _mm_loadu_ps(a.m + 4);
+    __m128 a2 = _mm_loadu_ps(a.m + 8);
+    __m128 a3 = _mm_loadu_ps(a.m + 12);
+    for (int i = 0; i < count; ++i) {
+        const float* bm = b[i].m;
+        __m128 r[4];
+        for (int col = 0; col < 4; ++col) {
+            __m128 bc = _mm_loadu_ps(bm + col * 4);
+            __m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2))));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(3, 3, 3, 3))));
+            r[col] = sum;
+        }
+        // All four columns are read before any is written (out may be b)
+        for (int col = 0; col < 4; ++col)
+            _mm_storeu_ps(out[i].m + col * 4, r[col]);
+    }
+}
+
+/**********************************************************
+ * multiplyAvx(...) - Two result columns per register
+ *
+ * a's columns sit in both halves; within each half,
+ * permute broadcasts element k of that half's b column.
+ **********************************************************/
+__attribute__((target("avx")))
+static void multiplyAvx(const mat4& a, const mat4* b, mat4* out, int count)
+{
+    __m256 a0 = _mm256_broadcast_ps((const __m128*)(a.m + 0));
+    __m256 a1 = _mm256_broadcast_ps((const __m128*)(a.m + 4));
+    __m256 a2 = _mm256_broadcast_ps((const __m128*)(a.m + 8));
+    __m256 a3 = _mm256_broadcast_ps((const __m128*)(a.m + 12));
+    for (int i = 0; i < count; ++i) {
+        const float* bm = b[i].m;
+        __m256 b01 = _mm256_loadu_ps(bm);
+        __m256 b23 = _mm256_loadu_ps(bm + 8);
+
+        __m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1))));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2))));
+        r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        __m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1))));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2))));
+        r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        _mm256_storeu_ps(out[i].m, r01);
+        _mm256_storeu_ps(out[i].m + 8, r23);
+    }
+}
+#endif
+
+/**********************************************************
+ * mat4MultiplyBatch(...) - Current kernel
+ **********************************************************/
+void mat4MultiplyBatch(const mat4& a, const mat4* b, mat4* out, int count)
+{
+    // a is copied first: it may be one of the outputs
+    mat4 left = a;
+#ifdef MAT4_X86
+    if (currentBackend == MAT4_AVX) {
+        multiplyAvx(left, b, out, count);
+        return;
+    }
+    if (currentBackend == MAT4_SSE2) {
+        multiplySse2(left, b, out, count);
+        return;
+    }
+#endif
+    multiplyScalar(left, b, out, count);
+}
+
+/**********************************************************
+ * mat4Multiply(...) - out = a * b
+ **********************************************************/
+void mat4Multiply(mat4& out, const mat4& a, const mat4& b)
+{
+    mat4MultiplyBatch(a, &b, &out, 1);
+}
+
+/**********************************************************
+ * mat4Transform(...) - out = m * v
+ **********************************************************/
+vec4 mat4Transform(const mat4& m, const vec4& v)
+{
+    vec4 out;
+    for (int row = 0; row < 4; ++row)
+        out.v[row] = m.m[0 * 4 + row] * v.v[0] + m.m[1 * 4 + row] * v.v[1] +
+                     m.m[2 * 4 + row] * v.v[2] + m.m[3 * 4 + row] * v.v[3];
+    return out;
+}
+
+// --------------------------------------------------------
+// BUILDERS
+// --------------------------------------------------------
+
+/**********************************************************
+ * mat4Identity(...)
+ **********************************************************/
+void mat4Identity(mat4& out)
+{
+    for (int i = 0; i < 16; ++i)
+        out.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+/**********************************************************
+ * mat4Translate(...) - m = m * T
+ *
+ * Only the last column changes, so no full product.
+ **********************************************************/
+void mat4Translate(mat4& m, float x, float y, float z)
+{
+    for (int row = 0; row < 4; ++row)
+        m.m[12 + row] = m.m[row] * x + m.m[4 + row] * y + m.m[8 + row] * z + m.m[12 + row];
+}
+
+/**********************************************************
+ * mat4Rotate(...) - m = m * R, R as glRotatef builds it
+ **********************************************************/
+void mat4Rotate(mat4& m, float degrees, float x, float y, float z)
+{
+    float len = sqrtf(x * x + y * y + z * z);
+    if (len == 0.0f)
+        return;
+    x /= len; y /= len; z /= len;
+    float a = degrees * (float)M_PI / 180.0f;
+    float c = cosf(a), s = sinf(a), t = 1.0f - c;
+
+    mat4 r;
+    r.m[0] = x * x * t + c;      r.m[4] = x * y * t - z * s;  r.m[8]  = x * z * t + y * s;  r.m[12] = 0.0f;
+    r.m[1] = y * x * t + z * s;  r.m[5] = y * y * t + c;      r.m[9]  = y * z * t - x * s;  r.m[13] = 0.0f;
+    r.m[2] = x * z * t - y * s;  r.m[6] = y * z * t + x * s;  r.m[10] = z * z * t + c;      r.m[14] = 0.0f;
+    r.m[3] = 0.0f;               r.m[7] = 0.0f;               r.m[11] = 0.0f;               r.m[15] = 1.0f;
+    mat4Multiply(m, m, r);
+}
+
+/**********************************************************
+ * mat4Scale(...) - m = m * S: scales the first 3 columns
+ **********************************************************/
+void mat4Scale(mat4& m, float x, float y, float z)
+{
+    for (int row = 0; row < 4; ++row) {
+        m.m[row]     *= x;
+        m.m[4 + row] *= y;
+        m.m[8 + row] *= z;
+    }
+}
+
+/**********************************************************
+ * mat4Perspective(...) - gluPerspective's matrix
+ **********************************************************/
+void mat4Perspective(mat4& out, float fovyDegrees, float aspect, float zNear, float zFar)
+{
+    double half = fovyDegrees * M_PI / 360.0;
+    double f = cos(half) / sin(half);
+    memset(out.m, 0, sizeof(out.m));
+    out.m[0]  = (float)(f / aspect);
+    out.m[5]  = (float)f;
+    out.m[10] = (float)((zFar + zNear) / (double)(zNear - zFar));
+    out.m[11] = -1.0f;
+    out.m[14] = (float)(2.0 * zFar * zNear / (double)(zNear - zFar));
+}
+
+/**********************************************************
+ * mat4LookAt(...) - gluLookAt's matrix
+ *
+ * Rows side, up and -forward, then the eye moved to the
+ * origin.
+ **********************************************************/
+void mat4LookAt(mat4& out, const float eye[3], const float center[3], const float up[3])
+{
+    float f[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+    float len = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    if (len > 0.0f) { f[0] /= len; f[1] /= len; f[2] /= len; }
+
+    float s[3] = { f[1] * up[2] - f[2] * up[1],
+                   f[2] * up[0] - f[0] * up[2],
+                   f[0] * up[1] - f[1] * up[0] };
+    len = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    if (len > 0.0f) { s[0] /= len; s[1] /= len; s[2] /= len; }
+
+    float u[3] = { s[1] * f[2] - s[2] * f[1],
+                   s[2] * f[0] - s[0] * f[2],
+                   s[0] * f[1] - s[1] * f[0] };
+
+    for (int c = 0; c < 3; ++c) {
+        out.m[c * 4 + 0] =  s[c];
+        out.m[c * 4 + 1] =  u[c];
+        out.m[c * 4 + 2] = -f[c];
+        out.m[c * 4 + 3] =  0.0f;
+    }
+    out.m[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    out.m[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    out.m[14] =  (f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2]);
+    out.m[15] = 1.0f;
+}
+
+/**********************************************************
+ * mat4PlanarShadow(...) - dot(plane, light) * I - light * plane
+ **********************************************************/
+void mat4PlanarShadow(mat4& out, const float light[4], const float plane[4])
+{
+    float dot = plane[0] * light[0] + plane[1] * light[1] +
+                plane[2] * light[2] + plane[3] * light[3];
+    for (int col = 0; col < 4; ++col)
+        for (int row = 0; row < 4; ++row)
+            out.m[col * 4 + row] = (row == col ? dot : 0.0f) - light[row] * plane[col];
+}
+
+/**********************************************************
+ * mat4NormalMatrix(...) - Inverse transpose of the 3x3
+ *
+ * The transposed inverse is the cofactor matrix over the
+ * determinant.
+ **********************************************************/
+void mat4NormalMatrix(const mat4& m, float out[9])
+{
+    const float* a = m.m;   // a[col * 4 + row]
+    float c[9] = {
+        a[5] * a[10] - a[9] * a[6],  a[8] * a[6] - a[4] * a[10], a[4] * a[9] - a[8] * a[5],
+        a[9] * a[2]  - a[1] * a[10], a[0] * a[10] - a[8] * a[2], a[8] * a[1] - a[0] * a[9],
+        a[1] * a[6]  - a[5] * a[2],  a[4] * a[2] - a[0] * a[6],  a[0] * a[5] - a[4] * a[1]
+    };
+    // c[col * 3 + row] is the cofactor of element (row, col)
+    float det = a[0] * c[0] + a[4] * c[3] + a[8] * c[6];
+    if (fabsf(det) < 1.0e-12f) {
+        for (int col = 0; col < 3; ++col)
+            for (int row = 0; row < 3; ++row)
+                out[col * 3 + row] = a[col * 4 + row];
+        return;
+    }
+    for (int i = 0; i < 9; ++i)
+        out[i] = c[i] / det;
+}
+
+// --------------------------------------------------------
+// BACKEND SELECTION
+// --------------------------------------------------------
+
+/**********************************************************
+ * mat4BestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+Mat4Backend mat4BestBackend()
+{
+#ifdef MAT4_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return MAT4_AVX;
+    if (__builtin_cpu_supports("sse2")) return MAT4_SSE2;
+#endif
+    return MAT4_SCALAR;
+}
+
+/**********************************************************
+ * mat4CurrentBackend() - Kernel the products use
+ **********************************************************/
+Mat4Backend mat4CurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * mat4SetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+Mat4Backend mat4SetBackend(Mat4Backend backend)
+{
+    Mat4Backend best = mat4BestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * mat4BackendName(...) - For logs and bench output
+ **********************************************************/
+const char* mat4BackendName(Mat4Backend backend)
+{
+    switch (backend) {
+        case MAT4_AVX:  return "avx";
+        case MAT4_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
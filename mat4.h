@@ -0,0 +1,74 @@
+/**********************************************************
+ *  Orator - mat4.h
+ *
+ *  4x4 matrices and 4-vectors for the transforms that used
+ *  to go through the fixed-function matrix stack (glRotatef,
+ *  glMultMatrixf, gluLookAt, gluPerspective). Matrices are
+ *  column-major like OpenGL's, so m.m can go straight to
+ *  glLoadMatrixf or glUniformMatrix4fv.
+ *
+ *  The product exists as scalar, SSE2 and AVX kernels,
+ *  picked at run time like the mixer's. All of them add the
+ *  four terms of every element in the same order, so they
+ *  give the same result bit for bit. mat4MultiplyBatch()
+ *  keeps the left matrix in registers across a whole array
+ *  of right-hand sides (one matrix per instance).
+ *
+ *  The mat4Translate/Rotate/Scale helpers multiply on the
+ *  right, as the GL calls of the same name did, so
+ *  transform code reads in the same order as before.
+ **********************************************************/
+#ifndef ORATOR_MAT4_H
+#define ORATOR_MAT4_H
+
+enum Mat4Backend {
+    MAT4_SCALAR = 0,
+    MAT4_SSE2,
+    MAT4_AVX
+};
+
+struct alignas(16) vec4 {
+    float v[4];
+};
+
+// m[column * 4 + row]
+struct alignas(16) mat4 {
+    float m[16];
+};
+
+void mat4Identity(mat4& out);
+
+// out = a * b (out may be a or b)
+void mat4Multiply(mat4& out, const mat4& a, const mat4& b);
+
+// out[i] = a * b[i] for 'count' matrices (out may be b)
+void mat4MultiplyBatch(const mat4& a, const mat4* b, mat4* out, int count);
+
+// out = m * v
+vec4 mat4Transform(const mat4& m, const vec4& v);
+
+// m = m * T, m * R (angle in degrees about the axis, which
+// need not be normalised), m * S; as glTranslatef etc.
+void mat4Translate(mat4& m, float x, float y, float z);
+void mat4Rotate(mat4& m, float degrees, float x, float y, float z);
+void mat4Scale(mat4& m, float x, float y, float z);
+
+// As gluPerspective and gluLookAt (without multiplying)
+void mat4Perspective(mat4& out, float fovyDegrees, float aspect, float zNear, float zFar);
+void mat4LookAt(mat4& out, const float eye[3], const float center[3], const float up[3]);
+
+// Projects onto 'plane' (a*x + b*y + c*z + d = 0) from
+// 'light' (w = 1 a point, w = 0 a direction)
+void mat4PlanarShadow(mat4& out, const float light[4], const float plane[4]);
+
+// Inverse transpose of the upper 3x3, column-major, for
+// normals; the plain 3x3 if that is singular (a projection)
+void mat4NormalMatrix(const mat4& m, float out[9]);
+
+Mat4Backend mat4BestBackend();
+Mat4Backend mat4CurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+Mat4Backend mat4SetBackend(Mat4Backend backend);
+const char* mat4BackendName(Mat4Backend backend);
+
+#endif // ORATOR_MAT4_H
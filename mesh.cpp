@@ -0,0 +1,306 @@
+/**********************************************************
+ *  Orator - mesh.cpp
+ *
+ *  Tessellation of the speaker parts into vertex/index
+ *  arrays and their upload into VBO/IBO/VAO objects.
+ *  The vertices come from tessellate.cpp; the math mirrors
+ *  the immediate-mode draw functions in orator.cpp, so both
+ *  paths produce the same surface.
+ **********************************************************/
+#include "mesh.h"
+#include "tessellate.h"
+
+#include <stddef.h>    // offsetof
+
+// Per-frame submission counters (see mesh.h)
+FrameStats frameStats = { 0, 0, 0 };
+
+/**********************************************************
+ * resetFrameStats() - Start counting a new frame
+ **********************************************************/
+void resetFrameStats()
+{
+    frameStats.drawCalls = 0;
+    frameStats.triangles = 0;
+    frameStats.vertices  = 0;
+}
+
+// --------------------------------------------------------
+// HELPERS
+// --------------------------------------------------------
+
+/**********************************************************
+ * addGridIndices(...) - Two triangles per grid cell
+ *
+ * The grid has (columns+1) x (rows+1) vertices stored row by
+ * row. For each cell a=(c,r), b=(c+1,r), c=(c,r+1), d=(c+1,r+1)
+ * the triangles are ordered so both end on 'd', which keeps
+ * GL_FLAT shading identical to the old GL_QUAD_STRIP output
+ * (the last vertex of a quad provokes its color).
+ **********************************************************/
+static void addGridIndices(std::vector<GLuint>& indices,
+                           int columns, int rows, bool swapAxes)
+{
+    const int stride = columns + 1;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            GLuint a = r * stride + c;
+            GLuint b = a + 1;          // next column
+            GLuint cc = a + stride;    // next row
+            GLuint d = cc + 1;
+            if (!swapAxes) {
+                // Strip runs along columns: quad a, b, d, c
+                indices.push_back(a);  indices.push_back(b); indices.push_back(d);
+                indices.push_back(cc); indices.push_back(a); indices.push_back(d);
+            } else {
+                // Strip runs along rows: quad a, c, d, b
+                indices.push_back(a);  indices.push_back(cc); indices.push_back(d);
+                indices.push_back(b);  indices.push_back(a);  indices.push_back(d);
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------
+// TESSELLATION
+// --------------------------------------------------------
+
+/**********************************************************
+ * buildMeshIndices(...) - Triangle list of one component
+ *
+ * Only depends on the step counts, not on the shape.
+ **********************************************************/
+void buildMeshIndices(MeshComponent component, const MeshParams& p,
+                      std::vector<GLuint>& indices)
+{
+    indices.clear();
+    if (component == MESH_RING) {
+        // Row 0 is the outer edge, row 1 the inner edge
+        indices.reserve(p.uSteps * 6);
+        addGridIndices(indices, p.uSteps, 1, true);
+    } else {
+        indices.reserve(p.uSteps * p.vSteps * 6);
+        addGridIndices(indices, p.uSteps, p.vSteps, component == MESH_CONCAVE);
+    }
+}
+
+/**********************************************************
+ * tessellateComponent(...) - Vertices and indices into arrays
+ **********************************************************/
+static void tessellateComponent(MeshComponent component, const MeshParams& p,
+                                std::vector<MeshVertex>& vertices,
+                                std::vector<GLuint>& indices)
+{
+    vertices.resize(tessVertexCount(component, p));
+    tessellateVertices(component, p, vertices.data());
+    buildMeshIndices(component, p, indices);
+}
+
+/**********************************************************
+ * tessellateSphericalCap(...) - partial sphere, phi = 0..phiMax
+ **********************************************************/
+void tessellateSphericalCap(const MeshParams& p,
+                            std::vector<MeshVertex>& vertices,
+                            std::vector<GLuint>& indices)
+{
+    tessellateComponent(MESH_CAP, p, vertices, indices);
+}
+
+/**********************************************************
+ * tessellateFlatOuterRing(...) - ring around the spherical cap
+ **********************************************************/
+void tessellateFlatOuterRing(const MeshParams& p,
+                             std::vector<MeshVertex>& vertices,
+                             std::vector<GLuint>& indices)
+{
+    tessellateComponent(MESH_RING, p, vertices, indices);
+}
+
+/**********************************************************
+ * tessellateConcaveInnerCircle(...) - concavity in the center
+ **********************************************************/
+void tessellateConcaveInnerCircle(const MeshParams& p,
+                                  std::vector<MeshVertex>& vertices,
+                                  std::vector<GLuint>& indices)
+{
+    tessellateComponent(MESH_CONCAVE, p, vertices, indices);
+}
+
+// --------------------------------------------------------
+// GPU BUFFERS
+// --------------------------------------------------------
+
+/**********************************************************
+ * relevantParams(...) - Zeroes the fields a component ignores
+ *
+ * That way e.g. a concaveDepth change does not rebuild the cap.
+ **********************************************************/
+static MeshParams relevantParams(MeshComponent component, const MeshParams& p)
+{
+    MeshParams r = p;
+    if (component == MESH_CAP) {
+        r.innerRadiusFactor = 0.0f;
+        r.concaveDepth      = 0.0f;
+    } else if (component == MESH_RING) {
+        r.vSteps       = 0;
+        r.concaveDepth = 0.0f;
+    }
+    return r;
+}
+
+/**********************************************************
+ * sameParams(...) - Field-wise comparison of two MeshParams
+ **********************************************************/
+static bool sameParams(const MeshParams& a, const MeshParams& b)
+{
+    return a.uSteps == b.uSteps && a.vSteps == b.vSteps &&
+           a.phiMax == b.phiMax &&
+           a.innerRadiusFactor == b.innerRadiusFactor &&
+           a.concaveDepth == b.concaveDepth;
+}
+
+/**********************************************************
+ * createMeshObjects(...) - VAO/VBO/IBO with the vertex layout
+ *
+ * The client-state pointers and the element buffer binding
+ * are recorded in the VAO, so drawing only needs one bind.
+ **********************************************************/
+static void createMeshObjects(MeshBuffer& mesh)
+{
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &mesh.ibo);
+
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+
+    const GLsizei stride = sizeof(MeshVertex);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, (const GLvoid*)offsetof(MeshVertex, position));
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, stride, (const GLvoid*)offsetof(MeshVertex, normal));
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, stride, (const GLvoid*)offsetof(MeshVertex, texCoord));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/**********************************************************
+ * updateMeshBuffer(...) - Rebuild only on parameter change
+ *
+ * The vertices are tessellated straight into the mapped VBO
+ * (no staging copy). A shape-only edit keeps the step counts
+ * and with them the index buffer, so only the vertices are
+ * regenerated while a parameter is being dragged.
+ **********************************************************/
+bool updateMeshBuffer(MeshBuffer& mesh, MeshComponent component,
+                      const MeshParams& p)
+{
+    if (component < 0 || component >= MESH_COMPONENT_COUNT)
+        return false;
+    MeshParams key = relevantParams(component, p);
+    if (mesh.built && sameParams(mesh.params, key))
+        return false;   // Buffer is already up to date
+
+    bool sameTopology = mesh.built &&
+                        mesh.params.uSteps == key.uSteps &&
+                        mesh.params.vSteps == key.vSteps;
+
+    if (mesh.vao == 0)
+        createMeshObjects(mesh);
+
+    // Fresh storage (the GPU may still be reading the old one),
+    // then write the vertices into it
+    GLsizei    vertexCount = tessVertexCount(component, p);
+    GLsizeiptr bytes       = (GLsizeiptr)vertexCount * sizeof(MeshVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        tessellateVertices(component, p, (MeshVertex*)mapped);
+        if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+            mapped = NULL;   // Contents lost (e.g. mode switch): upload below
+    }
+    if (!mapped) {
+        std::vector<MeshVertex> vertices(vertexCount);
+        tessellateVertices(component, p, vertices.data());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!sameTopology) {
+        std::vector<GLuint> indices;
+        buildMeshIndices(component, p, indices);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                     indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        mesh.indexCount = (GLsizei)indices.size();
+    }
+
+    mesh.vertexCount = vertexCount;
+    mesh.params      = key;
+    mesh.built       = true;
+    return true;
+}
+
+/**********************************************************
+ * uploadMeshData(...) - Ready-made vertices and indices
+ *
+ * For data that was tessellated earlier (the mesh cache):
+ * straight into the buffers, nothing is generated.
+ **********************************************************/
+void uploadMeshData(MeshBuffer& mesh, MeshComponent component, const MeshParams& p,
+                    const MeshVertex* vertices, GLsizei vertexCount,
+                    const GLuint* indices, GLsizei indexCount)
+{
+    if (mesh.vao == 0)
+        createMeshObjects(mesh);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * sizeof(MeshVertex),
+                 vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCount * sizeof(GLuint),
+                 indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    mesh.vertexCount = vertexCount;
+    mesh.indexCount  = indexCount;
+    mesh.params      = relevantParams(component, p);
+    mesh.built       = true;
+}
+
+/**********************************************************
+ * drawMeshBuffer(...) - One indexed draw from the VAO
+ **********************************************************/
+void drawMeshBuffer(const MeshBuffer& mesh)
+{
+    if (!mesh.built)
+        return;
+    glBindVertexArray(mesh.vao);
+    glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    frameStats.drawCalls += 1;
+    frameStats.triangles += mesh.indexCount / 3;
+    frameStats.vertices  += mesh.indexCount;
+}
+
+/**********************************************************
+ * destroyMeshBuffer(...) - Frees the GL objects
+ **********************************************************/
+void destroyMeshBuffer(MeshBuffer& mesh)
+{
+    if (mesh.vao) glDeleteVertexArrays(1, &mesh.vao);
+    if (mesh.vbo) glDeleteBuffers(1, &mesh.vbo);
+    if (mesh.ibo) glDeleteBuffers(1, &mesh.ibo);
+    mesh.vao = mesh.vbo = mesh.ibo = 0;
+    mesh.vertexCount = mesh.indexCount = 0;
+    mesh.built = false;
+}
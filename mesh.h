@@ -0,0 +1,98 @@
+/**********************************************************
+ *  Orator - mesh.h
+ *
+ *  Retained GPU meshes for the speaker geometry. Each part
+ *  of the speaker (spherical cap, flat ring, concave center)
+ *  is tessellated once into an interleaved vertex buffer and
+ *  an index buffer, wrapped in a vertex array object, and
+ *  drawn from there every frame.
+ **********************************************************/
+#ifndef ORATOR_MESH_H
+#define ORATOR_MESH_H
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <vector>
+
+// The three parts that make up one speaker
+enum MeshComponent {
+    MESH_CAP = 0,      // Spherical cap (phi = 0..phi_max)
+    MESH_RING,         // Flat ring around the cap
+    MESH_CONCAVE,      // Concave circle in the middle of the ring
+    MESH_COMPONENT_COUNT
+};
+
+// Everything that influences the tessellated output.
+// Two meshes built from equal params are identical.
+struct MeshParams {
+    int   uSteps;             // Subdivisions around the Z axis (theta)
+    int   vSteps;             // Subdivisions along phi / radius (unused by the ring)
+    float phiMax;             // Angle of the spherical cap
+    float innerRadiusFactor;  // Inner ring radius / outer ring radius
+    float concaveDepth;       // Depth of the concavity
+};
+
+// One interleaved vertex: position, normal, texture coordinate
+struct MeshVertex {
+    GLfloat position[3];
+    GLfloat normal[3];
+    GLfloat texCoord[2];
+};
+
+// GPU-side mesh plus the parameters it was last built with
+struct MeshBuffer {
+    GLuint     vao;          // Vertex array object (0 = not created yet)
+    GLuint     vbo;          // Interleaved MeshVertex data
+    GLuint     ibo;          // GLuint triangle indices
+    GLsizei    vertexCount;  // Number of vertices in the VBO
+    GLsizei    indexCount;   // Number of indices in the IBO
+    bool       built;        // False until the first upload
+    MeshParams params;       // Parameters of the current contents
+};
+
+// Geometry submitted to GL since the last resetFrameStats()
+struct FrameStats {
+    long drawCalls;   // glBegin/glEnd blocks and glDraw* calls
+    long triangles;   // Triangles rasterized (quads count as two)
+    long vertices;    // Vertices (or indices) sent down the pipeline
+};
+extern FrameStats frameStats;
+
+// Zeroes frameStats; called at the start of every frame
+void resetFrameStats();
+
+// CPU tessellation into plain arrays (indices form GL_TRIANGLES);
+// the vertices come from tessellateVertices() (tessellate.h)
+void tessellateSphericalCap(const MeshParams& p,
+                            std::vector<MeshVertex>& vertices,
+                            std::vector<GLuint>& indices);
+void tessellateFlatOuterRing(const MeshParams& p,
+                             std::vector<MeshVertex>& vertices,
+                             std::vector<GLuint>& indices);
+void tessellateConcaveInnerCircle(const MeshParams& p,
+                                  std::vector<MeshVertex>& vertices,
+                                  std::vector<GLuint>& indices);
+
+// Just the indices (they only depend on the step counts).
+// Grid vertex (i, j) is index j*(uSteps+1) + i for every part.
+void buildMeshIndices(MeshComponent component, const MeshParams& p,
+                      std::vector<GLuint>& indices);
+
+// Re-tessellates and re-uploads only if the params relevant to
+// this component changed. Returns true if the buffer was rebuilt.
+bool updateMeshBuffer(MeshBuffer& mesh, MeshComponent component,
+                      const MeshParams& p);
+
+// Uploads vertices/indices tessellated earlier for p (e.g. from
+// the mesh cache) without generating anything
+void uploadMeshData(MeshBuffer& mesh, MeshComponent component, const MeshParams& p,
+                    const MeshVertex* vertices, GLsizei vertexCount,
+                    const GLuint* indices, GLsizei indexCount);
+
+// Draws the whole mesh with one glDrawElements call
+void drawMeshBuffer(const MeshBuffer& mesh);
+
+// Releases the GL objects owned by the mesh
+void destroyMeshBuffer(MeshBuffer& mesh);
+
+#endif // ORATOR_MESH_H
@@ -0,0 +1,330 @@
+/**********************************************************
+ *  Orator - meshcache.cpp
+ *
+ *  Memory-mapped binary cache of the speaker meshes (see
+ *  meshcache.h).
+ **********************************************************/
+#include "meshcache.h"
+#include "tessellate.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>    // getenv
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Identifies the file type and the writer's byte order
+static const char     meshCacheMagic[8] = { 'O', 'R', 'M', 'E', 'S', 'H', '\0', '\0' };
+static const uint32_t meshCacheByteOrder = 0x01020304;
+
+struct MeshCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t vertexBytes;    // sizeof(MeshVertex) of the writer
+    uint32_t partCount;
+    uint64_t key;            // meshCacheKey() of the parts
+    uint64_t fileBytes;      // Whole file, to catch truncation
+};
+
+struct MeshCacheEntry {
+    int32_t  component;
+    int32_t  uSteps, vSteps;
+    float    phiMax, innerRadiusFactor, concaveDepth;
+    uint32_t vertexCount, indexCount;
+    uint64_t vertexOffset, indexOffset;   // From the start of the file
+};
+
+// --------------------------------------------------------
+// KEYS AND PATHS
+// --------------------------------------------------------
+
+/**********************************************************
+ * cacheHash(...) - 64-bit FNV-1a over a byte range
+ **********************************************************/
+uint64_t cacheHash(uint64_t hash, const void* data, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**********************************************************
+ * entryFor(...) - Header entry of one part (no offsets yet)
+ *
+ * Also what the key is hashed from, field by field, so
+ * struct padding never ends up in it.
+ **********************************************************/
+static MeshCacheEntry entryFor(const MeshCachePart& part)
+{
+    MeshCacheEntry e;
+    memset(&e, 0, sizeof(e));
+    e.component         = part.component;
+    e.uSteps            = part.params.uSteps;
+    e.vSteps            = part.params.vSteps;
+    e.phiMax            = part.params.phiMax;
+    e.innerRadiusFactor = part.params.innerRadiusFactor;
+    e.concaveDepth      = part.params.concaveDepth;
+    return e;
+}
+
+/**********************************************************
+ * meshCacheKey(...) - Hash of the version and all parts
+ **********************************************************/
+static uint64_t meshCacheKey(const MeshCachePart* parts, int count)
+{
+    uint64_t hash = CACHE_HASH_SEED;
+    uint32_t header[3] = { MESH_CACHE_VERSION, (uint32_t)sizeof(MeshVertex), (uint32_t)count };
+    hash = cacheHash(hash, header, sizeof(header));
+    for (int i = 0; i < count; ++i) {
+        MeshCacheEntry e = entryFor(parts[i]);
+        hash = cacheHash(hash, &e.component, sizeof(e.component));
+        hash = cacheHash(hash, &e.uSteps, sizeof(e.uSteps));
+        hash = cacheHash(hash, &e.vSteps, sizeof(e.vSteps));
+        hash = cacheHash(hash, &e.phiMax, sizeof(e.phiMax));
+        hash = cacheHash(hash, &e.innerRadiusFactor, sizeof(e.innerRadiusFactor));
+        hash = cacheHash(hash, &e.concaveDepth, sizeof(e.concaveDepth));
+    }
+    return hash;
+}
+
+/**********************************************************
+ * meshCacheDefaultDir() - Per-user cache directory
+ **********************************************************/
+std::string meshCacheDefaultDir()
+{
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0])
+        return std::string(xdg) + "/orator";
+    const char* home = getenv("HOME");
+    if (home && home[0])
+        return std::string(home) + "/.cache/orator";
+    return std::string();
+}
+
+/**********************************************************
+ * meshCachePath(...) - <dir>/speaker-<key>.mesh
+ **********************************************************/
+std::string meshCachePath(const std::string& dir,
+                          const MeshCachePart* parts, int count)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "speaker-%016llx.mesh",
+             (unsigned long long)meshCacheKey(parts, count));
+    return dir + "/" + name;
+}
+
+/**********************************************************
+ * cacheMakeDirectories(...) - mkdir -p
+ **********************************************************/
+bool cacheMakeDirectories(const std::string& dir)
+{
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+        std::string prefix = dir.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (slash == std::string::npos)
+            return true;
+    }
+}
+
+// --------------------------------------------------------
+// LOADING
+// --------------------------------------------------------
+
+/**********************************************************
+ * entryMatches(...) - Same part, in bounds, sane counts
+ **********************************************************/
+static bool entryMatches(const MeshCacheEntry& e, const MeshCachePart& part,
+                         size_t fileBytes)
+{
+    MeshCacheEntry want = entryFor(part);
+    if (e.component != want.component || e.uSteps != want.uSteps ||
+        e.vSteps != want.vSteps || e.phiMax != want.phiMax ||
+        e.innerRadiusFactor != want.innerRadiusFactor ||
+        e.concaveDepth != want.concaveDepth)
+        return false;
+    // Two triangles per grid cell; the ring has one row of cells
+    int rows = part.component == MESH_RING ? 1 : part.params.vSteps;
+    if (e.vertexCount != (uint32_t)tessVertexCount(part.component, part.params) ||
+        e.indexCount  != (uint32_t)(part.params.uSteps * rows * 6))
+        return false;
+    uint64_t vertexEnd = e.vertexOffset + (uint64_t)e.vertexCount * sizeof(MeshVertex);
+    uint64_t indexEnd  = e.indexOffset  + (uint64_t)e.indexCount * sizeof(GLuint);
+    return e.vertexOffset % MESH_CACHE_ALIGN == 0 && e.indexOffset % MESH_CACHE_ALIGN == 0 &&
+           vertexEnd <= fileBytes && indexEnd <= fileBytes;
+}
+
+/**********************************************************
+ * loadCacheFile(...) - Map, check, upload; false on mismatch
+ **********************************************************/
+static bool loadCacheFile(const std::string& path, const MeshCachePart* parts,
+                          int count, MeshBuffer* meshes)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MeshCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t mapSize = (size_t)info.st_size;
+    void* map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // The mapping keeps the file alive
+    if (map == MAP_FAILED)
+        return false;
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+
+    const unsigned char*   base    = (const unsigned char*)map;
+    const MeshCacheHeader* header  = (const MeshCacheHeader*)base;
+    const MeshCacheEntry*  entries = (const MeshCacheEntry*)(base + sizeof(MeshCacheHeader));
+    bool valid = memcmp(header->magic, meshCacheMagic, sizeof(meshCacheMagic)) == 0 &&
+                 header->version == MESH_CACHE_VERSION &&
+                 header->byteOrder == meshCacheByteOrder &&
+                 header->vertexBytes == sizeof(MeshVertex) &&
+                 header->partCount == (uint32_t)count &&
+                 header->key == meshCacheKey(parts, count) &&
+                 header->fileBytes == mapSize &&
+                 sizeof(MeshCacheHeader) + count * sizeof(MeshCacheEntry) <= mapSize;
+    for (int i = 0; valid && i < count; ++i)
+        valid = entryMatches(entries[i], parts[i], mapSize);
+
+    // Straight from the page cache into the GPU buffers
+    for (int i = 0; valid && i < count; ++i)
+        uploadMeshData(meshes[i], parts[i].component, parts[i].params,
+                       (const MeshVertex*)(base + entries[i].vertexOffset), entries[i].vertexCount,
+                       (const GLuint*)(base + entries[i].indexOffset), entries[i].indexCount);
+
+    munmap(map, mapSize);
+    return valid;
+}
+
+// --------------------------------------------------------
+// BUILDING AND WRITING
+// --------------------------------------------------------
+
+/**********************************************************
+ * writePadded(...) - Data block at the next aligned offset
+ **********************************************************/
+static bool writePadded(FILE* file, const void* data, size_t bytes, uint64_t& offset)
+{
+    static const unsigned char zeros[MESH_CACHE_ALIGN] = { 0 };
+    uint64_t aligned = (offset + MESH_CACHE_ALIGN - 1) / MESH_CACHE_ALIGN * MESH_CACHE_ALIGN;
+    size_t   padding = (size_t)(aligned - offset);
+    if (padding && fwrite(zeros, 1, padding, file) != padding)
+        return false;
+    if (bytes && fwrite(data, 1, bytes, file) != bytes)
+        return false;
+    offset = aligned + bytes;
+    return true;
+}
+
+/**********************************************************
+ * buildAndWrite(...) - Tessellate each part, upload it and
+ *    append it to the cache file
+ *
+ * Parts are written one at a time, so only one part's data
+ * is held in memory. The entry table and the header are
+ * written last, into the space left for them, and the file
+ * only gets its real name once it is complete.
+ **********************************************************/
+static bool buildAndWrite(const std::string& dir, const std::string& path,
+                          const MeshCachePart* parts, int count, MeshBuffer* meshes)
+{
+    std::string temp = path + ".tmp" + std::to_string((long)getpid());
+    FILE* file = NULL;
+    if (cacheMakeDirectories(dir))
+        file = fopen(temp.c_str(), "wb");
+
+    std::vector<MeshCacheEntry> entries(count);
+    uint64_t offset = sizeof(MeshCacheHeader) + count * sizeof(MeshCacheEntry);
+    bool ok = file && fseek(file, (long)offset, SEEK_SET) == 0;
+
+    std::vector<MeshVertex> vertices;
+    std::vector<GLuint>     indices;
+    for (int i = 0; i < count; ++i) {
+        const MeshCachePart& part = parts[i];
+        vertices.resize(tessVertexCount(part.component, part.params));
+        tessellateVertices(part.component, part.params, vertices.data());
+        buildMeshIndices(part.component, part.params, indices);
+        uploadMeshData(meshes[i], part.component, part.params,
+                       vertices.data(), (GLsizei)vertices.size(),
+                       indices.data(), (GLsizei)indices.size());
+
+        entries[i] = entryFor(part);
+        entries[i].vertexCount = (uint32_t)vertices.size();
+        entries[i].indexCount  = (uint32_t)indices.size();
+        if (!ok)
+            continue;   // Still build every mesh
+        ok = writePadded(file, vertices.data(), vertices.size() * sizeof(MeshVertex), offset);
+        entries[i].vertexOffset = offset - vertices.size() * sizeof(MeshVertex);
+        ok = ok && writePadded(file, indices.data(), indices.size() * sizeof(GLuint), offset);
+        entries[i].indexOffset = offset - indices.size() * sizeof(GLuint);
+    }
+    if (!file) {
+        fprintf(stderr, "Mesh cache: cannot create '%s'\n", temp.c_str());
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version     = MESH_CACHE_VERSION;
+    header.byteOrder   = meshCacheByteOrder;
+    header.vertexBytes = sizeof(MeshVertex);
+    header.partCount   = (uint32_t)count;
+    header.key         = meshCacheKey(parts, count);
+    header.fileBytes   = offset;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(entries.data(), sizeof(MeshCacheEntry), count, file) == (size_t)count;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "Mesh cache: cannot write '%s'\n", path.c_str());
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**********************************************************
+ * loadMeshesCached(...) - From the file, or build and save
+ **********************************************************/
+MeshCacheResult loadMeshesCached(const std::string& dir,
+                                 const MeshCachePart* parts, int count,
+                                 MeshBuffer* meshes)
+{
+    std::string path = meshCachePath(dir, parts, count);
+    if (!dir.empty() && loadCacheFile(path, parts, count, meshes))
+        return MESH_CACHE_HIT;
+    if (!dir.empty() && buildAndWrite(dir, path, parts, count, meshes))
+        return MESH_CACHE_WRITTEN;
+
+    // No usable directory: plain tessellation (a no-op for
+    // meshes buildAndWrite() already uploaded)
+    for (int i = 0; i < count; ++i)
+        updateMeshBuffer(meshes[i], parts[i].component, parts[i].params);
+    return MESH_CACHE_UNAVAILABLE;
+}
+
+/**********************************************************
+ * meshCacheResultName(...) - For logs and bench output
+ **********************************************************/
+const char* meshCacheResultName(MeshCacheResult result)
+{
+    switch (result) {
+        case MESH_CACHE_HIT:     return "hit";
+        case MESH_CACHE_WRITTEN: return "written";
+        default:                 return "unavailable";
+    }
+}
@@ -0,0 +1,77 @@
+/**********************************************************
+ *  Orator - meshcache.h
+ *
+ *  On-disk cache of the tessellated speaker meshes, so a
+ *  start with the same geometry skips the tessellation. The
+ *  file holds every part's vertices and indices exactly as
+ *  the GPU buffers want them. Its name is a hash of the
+ *  parts' parameters, so a different shape or tessellation
+ *  uses (and writes) a different file.
+ *
+ *  Loading maps the file and hands the mapped ranges
+ *  straight to glBufferData: nothing is parsed or converted
+ *  beyond checking the header. A file that does not match
+ *  (other version, byte order, parameters, or truncated) is
+ *  ignored and rewritten.
+ *
+ *  Layout (native byte order):
+ *    MeshCacheHeader
+ *    MeshCacheEntry x partCount
+ *    per part: vertices, then indices, each starting on a
+ *              MESH_CACHE_ALIGN boundary
+ **********************************************************/
+#ifndef ORATOR_MESHCACHE_H
+#define ORATOR_MESHCACHE_H
+
+#include "mesh.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Bump when the file layout or MeshVertex changes
+#define MESH_CACHE_VERSION 1
+
+// Alignment of each data block in the file
+#define MESH_CACHE_ALIGN 64
+
+// One mesh to load: which part, at which parameters
+struct MeshCachePart {
+    MeshComponent component;
+    MeshParams    params;
+};
+
+enum MeshCacheResult {
+    MESH_CACHE_HIT = 0,      // Uploaded from the file
+    MESH_CACHE_WRITTEN,      // Tessellated, file written for next time
+    MESH_CACHE_UNAVAILABLE   // Tessellated, but no file could be written
+};
+
+// $XDG_CACHE_HOME/orator or ~/.cache/orator ("" if neither
+// variable is set)
+std::string meshCacheDefaultDir();
+
+// File that holds exactly these parts
+std::string meshCachePath(const std::string& dir,
+                          const MeshCachePart* parts, int count);
+
+// Fills meshes[i] for parts[i]: from the cache file in 'dir'
+// if there is a matching one, otherwise by tessellating them
+// (and then writing the file). Needs a current GL context.
+MeshCacheResult loadMeshesCached(const std::string& dir,
+                                 const MeshCachePart* parts, int count,
+                                 MeshBuffer* meshes);
+
+const char* meshCacheResultName(MeshCacheResult result);
+
+// Shared with the program cache (programcache.cpp), so both
+// caches name and create their files the same way:
+// 64-bit FNV-1a over a byte range, starting from
+// CACHE_HASH_SEED or an earlier result
+#define CACHE_HASH_SEED 14695981039346656037ull
+uint64_t cacheHash(uint64_t hash, const void* data, size_t bytes);
+
+// mkdir -p
+bool cacheMakeDirectories(const std::string& dir);
+
+#endif // ORATOR_MESHCACHE_H
@@ -0,0 +1,434 @@
+/**********************************************************
+ *  Orator - mixer.cpp
+ *
+ *  N-source stereo mix with per-source gain ramps, scalar,
+ *  SSE2 and AVX kernels and dithered 16-bit output (see
+ *  mixer.h).
+ *
+ *  Every kernel computes the gain of frame i as
+ *  start + i * step (never by adding up steps), so all
+ *  backends produce the same gains bit for bit.
+ **********************************************************/
+#include "mixer.h"
+#include "spscqueue.h"
+
+#include <math.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIX_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// One queued gain change
+struct MixCommand {
+    int   source;
+    float gains[2];
+};
+
+// Callback-side state of one source
+struct MixVoice {
+    float gains[2];    // Reached at the end of the last block
+    float target[2];   // Latest command
+};
+
+struct MixerState {
+    int        sources;
+    float      sent[MIXER_MAX_SOURCES][2];   // Render thread: last queued gains
+    float      masterGain;
+    MixVoice   voices[MIXER_MAX_SOURCES];
+    uint32_t   dither[4];   // xorshift32 per SIMD lane
+    SpscQueue<MixCommand, MIXER_COMMAND_QUEUE> commands;
+    std::atomic<unsigned long> droppedCommands;
+};
+
+static MixerState mixer;
+static MixBackend currentBackend = mixBestBackend();
+
+// --------------------------------------------------------
+// ACCUMULATE KERNELS: out (stereo) += in * ramped gains
+// --------------------------------------------------------
+
+/**********************************************************
+ * accumulateScalar(...) - Any channel count, frames [from, n)
+ **********************************************************/
+static void accumulateScalar(float* out, const float* in, size_t from, size_t frames,
+                             int channels, const float g0[2], const float step[2])
+{
+    for (size_t i = from; i < frames; ++i) {
+        float gl = g0[0] + (float)i * step[0];
+        float gr = g0[1] + (float)i * step[1];
+        const float* frame = in + i * channels;
+        float l = frame[0];
+        float r = channels == 1 ? l : frame[1];
+        out[2 * i]     += gl * l;
+        out[2 * i + 1] += gr * r;
+    }
+}
+
+#ifdef MIX_X86
+/**********************************************************
+ * accumulateSse2(...) - Mono or stereo, 4 frames per step
+ *
+ * Two frames per register: [l0 r0 l1 r1]. A mono block of
+ * four samples is spread to two such registers by
+ * interleaving it with itself.
+ **********************************************************/
+__attribute__((target("sse2")))
+static size_t accumulateSse2(float* out, const float* in, size_t frames,
+                             int channels, const float g0[2], const float step[2])
+{
+    const __m128 start = _mm_setr_ps(g0[0], g0[1], g0[0], g0[1]);
+    const __m128 delta = _mm_setr_ps(step[0], step[1], step[0], step[1]);
+    const __m128 two   = _mm_set1_ps(2.0f);
+    const __m128 four  = _mm_set1_ps(4.0f);
+    __m128 index = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);   // Frame of each lane
+
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a, b;
+        if (channels == 1) {
+            __m128 m = _mm_loadu_ps(in + i);
+            a = _mm_unpacklo_ps(m, m);
+            b = _mm_unpackhi_ps(m, m);
+        } else {
+            a = _mm_loadu_ps(in + 2 * i);
+            b = _mm_loadu_ps(in + 2 * i + 4);
+        }
+        __m128 ga = _mm_add_ps(start, _mm_mul_ps(index, delta));
+        __m128 gb = _mm_add_ps(start, _mm_mul_ps(_mm_add_ps(index, two), delta));
+        _mm_storeu_ps(out + 2 * i,     _mm_add_ps(_mm_loadu_ps(out + 2 * i),     _mm_mul_ps(a, ga)));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(out + 2 * i + 4), _mm_mul_ps(b, gb)));
+        index = _mm_add_ps(index, four);
+    }
+    return i;
+}
+
+/**********************************************************
+ * accumulateAvx(...) - Mono or stereo, 8 frames per step
+ **********************************************************/
+__attribute__((target("avx")))
+static size_t accumulateAvx(float* out, const float* in, size_t frames,
+                            int channels, const float g0[2], const float step[2])
+{
+    const __m256 start = _mm256_setr_ps(g0[0], g0[1], g0[0], g0[1], g0[0], g0[1], g0[0], g0[1]);
+    const __m256 delta = _mm256_setr_ps(step[0], step[1], step[0], step[1],
+                                        step[0], step[1], step[0], step[1]);
+    const __m256 four  = _mm256_set1_ps(4.0f);
+    const __m256 eight = _mm256_set1_ps(8.0f);
+    __m256 index = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a, b;
+        if (channels == 1) {
+            __m128 m0 = _mm_loadu_ps(in + i), m1 = _mm_loadu_ps(in + i + 4);
+            a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_unpacklo_ps(m0, m0)),
+                                     _mm_unpackhi_ps(m0, m0), 1);
+            b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_unpacklo_ps(m1, m1)),
+                                     _mm_unpackhi_ps(m1, m1), 1);
+        } else {
+            a = _mm256_loadu_ps(in + 2 * i);
+            b = _mm256_loadu_ps(in + 2 * i + 8);
+        }
+        __m256 ga = _mm256_add_ps(start, _mm256_mul_ps(index, delta));
+        __m256 gb = _mm256_add_ps(start, _mm256_mul_ps(_mm256_add_ps(index, four), delta));
+        _mm256_storeu_ps(out + 2 * i,
+                         _mm256_add_ps(_mm256_loadu_ps(out + 2 * i), _mm256_mul_ps(a, ga)));
+        _mm256_storeu_ps(out + 2 * i + 8,
+                         _mm256_add_ps(_mm256_loadu_ps(out + 2 * i + 8), _mm256_mul_ps(b, gb)));
+        index = _mm256_add_ps(index, eight);
+    }
+    return i;
+}
+#endif
+
+// --------------------------------------------------------
+// OUTPUT KERNELS: master gain, TPDF dither, int16
+// --------------------------------------------------------
+
+// Dither noise of one lane: the difference of two uniform
+// values in [0, 1) LSB is triangular in (-1, 1) LSB
+static inline uint32_t xorshift32(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/**********************************************************
+ * finishScalar(...) - Samples [from, count)
+ *
+ * Sample j uses dither lane j % 4, like the SSE2 kernel.
+ **********************************************************/
+static void finishScalar(float* mix, int16_t* out, size_t from, size_t count)
+{
+    const float unit = 1.0f / 16777216.0f;
+    for (size_t j = from; j < count; ++j) {
+        uint32_t& lane = mixer.dither[j & 3];
+        lane = xorshift32(lane);
+        float u1 = (float)(lane >> 8) * unit;
+        lane = xorshift32(lane);
+        float u2 = (float)(lane >> 8) * unit;
+
+        float v = mix[j] * mixer.masterGain;
+        mix[j] = v;
+        long s = lrintf(v * 32767.0f + (u1 - u2));
+        out[j] = (int16_t)(s > 32767 ? 32767 : (s < -32768 ? -32768 : s));
+    }
+}
+
+#ifdef MIX_X86
+/**********************************************************
+ * finishSse2(...) - 8 samples per step, saturating pack
+ **********************************************************/
+__attribute__((target("sse2")))
+static size_t finishSse2(float* mix, int16_t* out, size_t count)
+{
+    const __m128 unit   = _mm_set1_ps(1.0f / 16777216.0f);
+    const __m128 master = _mm_set1_ps(mixer.masterGain);
+    const __m128 scale  = _mm_set1_ps(32767.0f);
+    __m128i state = _mm_loadu_si128((const __m128i*)mixer.dither);
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m128i packed[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128 noise[2];
+            for (int d = 0; d < 2; ++d) {
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+                state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+                state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+                noise[d] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), unit);
+            }
+            __m128 v = _mm_mul_ps(_mm_loadu_ps(mix + j + 4 * h), master);
+            _mm_storeu_ps(mix + j + 4 * h, v);
+            v = _mm_add_ps(_mm_mul_ps(v, scale), _mm_sub_ps(noise[0], noise[1]));
+            packed[h] = _mm_cvtps_epi32(v);
+        }
+        _mm_storeu_si128((__m128i*)(out + j), _mm_packs_epi32(packed[0], packed[1]));
+    }
+    _mm_storeu_si128((__m128i*)mixer.dither, state);
+    return j;
+}
+#endif
+
+// --------------------------------------------------------
+// MIX
+// --------------------------------------------------------
+
+/**********************************************************
+ * mixerInit(...) - Silent sources, empty queue
+ **********************************************************/
+bool mixerInit(int sources)
+{
+    if (sources < 1 || sources > MIXER_MAX_SOURCES)
+        return false;
+    mixer.sources    = sources;
+    mixer.masterGain = 1.0f / sqrtf((float)sources);
+    for (int s = 0; s < sources; ++s) {
+        MixVoice& v = mixer.voices[s];
+        v.gains[0] = v.gains[1] = v.target[0] = v.target[1] = 0.0f;
+        mixer.sent[s][0] = mixer.sent[s][1] = 0.0f;
+    }
+    static const uint32_t seeds[4] = { 0x9E3779B9u, 0x85EBCA6Bu, 0xC2B2AE35u, 0x27D4EB2Fu };
+    for (int l = 0; l < 4; ++l)
+        mixer.dither[l] = seeds[l];
+    MixCommand c;
+    while (spscPop(mixer.commands, c)) {}
+    mixer.droppedCommands.store(0);
+    return true;
+}
+
+/**********************************************************
+ * mixerSourceCount() - Sources in the current mix
+ **********************************************************/
+int mixerSourceCount()
+{
+    return mixer.sources;
+}
+
+/**********************************************************
+ * mixerSpatialGains(...) - Pan and distance of one source
+ *
+ * The pan is the cosine between the direction to the
+ * source and the listener's right vector; the equal-power
+ * law is scaled so a centered source plays at 1 on both
+ * sides. Distance follows 1/r from MIXER_REF_DISTANCE, at
+ * most 2x for close sources.
+ **********************************************************/
+void mixerSpatialGains(const float position[3], const MixListener& listener,
+                       float gains[2])
+{
+    float d[3] = { position[0] - listener.position[0],
+                   position[1] - listener.position[1],
+                   position[2] - listener.position[2] };
+    float dist = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    float pan = 0.0f;
+    if (dist > 1.0e-6f)
+        pan = (d[0] * listener.right[0] + d[1] * listener.right[1] +
+               d[2] * listener.right[2]) / dist;
+    pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+
+    float angle = (pan + 1.0f) * (float)(M_PI / 4.0);
+    float near  = 0.5f * MIXER_REF_DISTANCE;
+    float att   = MIXER_REF_DISTANCE / (dist > near ? dist : near);
+    gains[0] = att * (float)M_SQRT2 * cosf(angle);
+    gains[1] = att * (float)M_SQRT2 * sinf(angle);
+}
+
+/**********************************************************
+ * mixerSetGains(...) - Render thread: queue new gains
+ **********************************************************/
+bool mixerSetGains(int source, float left, float right)
+{
+    if (source < 0 || source >= mixer.sources)
+        return false;
+    float* sent = mixer.sent[source];
+    if (fabsf(left - sent[0]) < MIXER_GAIN_EPSILON && fabsf(right - sent[1]) < MIXER_GAIN_EPSILON)
+        return true;
+
+    MixCommand c = { source, { left, right } };
+    if (spscPush(mixer.commands, c)) {
+        sent[0] = left;
+        sent[1] = right;
+        return true;
+    }
+    mixer.droppedCommands.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/**********************************************************
+ * mixerPlaceSource(...) - Render thread: gains from position
+ **********************************************************/
+bool mixerPlaceSource(int source, const float position[3], const MixListener& listener)
+{
+    float gains[2];
+    mixerSpatialGains(position, listener, gains);
+    return mixerSetGains(source, gains[0], gains[1]);
+}
+
+/**********************************************************
+ * mixerBeginBlock() - Callback: take every queued command
+ **********************************************************/
+void mixerBeginBlock()
+{
+    MixCommand c;
+    while (spscPop(mixer.commands, c)) {
+        if (c.source < 0 || c.source >= mixer.sources)
+            continue;
+        mixer.voices[c.source].target[0] = c.gains[0];
+        mixer.voices[c.source].target[1] = c.gains[1];
+    }
+}
+
+/**********************************************************
+ * mixerAddSource(...) - Callback: one source into the mix
+ **********************************************************/
+void mixerAddSource(int source, float* out, const float* in, size_t frames, int channels)
+{
+    if (source < 0 || source >= mixer.sources || frames == 0)
+        return;
+    MixVoice& v = mixer.voices[source];
+    float step[2] = { (v.target[0] - v.gains[0]) / (float)frames,
+                      (v.target[1] - v.gains[1]) / (float)frames };
+
+    size_t done = 0;
+#ifdef MIX_X86
+    if (channels <= 2) {
+        if (currentBackend == MIX_AVX)
+            done = accumulateAvx(out, in, frames, channels, v.gains, step);
+        else if (currentBackend == MIX_SSE2)
+            done = accumulateSse2(out, in, frames, channels, v.gains, step);
+    }
+#endif
+    accumulateScalar(out, in, done, frames, channels, v.gains, step);
+
+    v.gains[0] = v.target[0];
+    v.gains[1] = v.target[1];
+}
+
+/**********************************************************
+ * mixerSkipSource(...) - Callback: silent this block
+ **********************************************************/
+void mixerSkipSource(int source)
+{
+    if (source < 0 || source >= mixer.sources)
+        return;
+    MixVoice& v = mixer.voices[source];
+    v.gains[0] = v.target[0];
+    v.gains[1] = v.target[1];
+}
+
+/**********************************************************
+ * mixerFinishBlock(...) - Callback: master, dither, int16
+ **********************************************************/
+void mixerFinishBlock(float* mix, int16_t* out, size_t frames)
+{
+    size_t count = 2 * frames, done = 0;
+#ifdef MIX_X86
+    if (currentBackend >= MIX_SSE2)
+        done = finishSse2(mix, out, count);
+#endif
+    finishScalar(mix, out, done, count);
+}
+
+/**********************************************************
+ * mixerDroppedCommands() - Queue overflows so far
+ **********************************************************/
+unsigned long mixerDroppedCommands()
+{
+    return mixer.droppedCommands.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// BACKEND SELECTION
+// --------------------------------------------------------
+
+/**********************************************************
+ * mixBestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+MixBackend mixBestBackend()
+{
+#ifdef MIX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return MIX_AVX;
+    if (__builtin_cpu_supports("sse2")) return MIX_SSE2;
+#endif
+    return MIX_SCALAR;
+}
+
+/**********************************************************
+ * mixCurrentBackend() - Kernel the mix uses
+ **********************************************************/
+MixBackend mixCurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * mixSetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+MixBackend mixSetBackend(MixBackend backend)
+{
+    MixBackend best = mixBestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * mixBackendName(...) - For logs and bench output
+ **********************************************************/
+const char* mixBackendName(MixBackend backend)
+{
+    switch (backend) {
+        case MIX_AVX:  return "avx";
+        case MIX_SSE2: return "sse2";
+        default:       return "scalar";
+    }
+}
@@ -0,0 +1,100 @@
+/**********************************************************
+ *  Orator - mixer.h
+ *
+ *  Sums many audio sources into one stereo stream for the
+ *  SDL callback. Each source has a left/right gain set from
+ *  its speaker's position relative to the camera (equal-
+ *  power pan plus distance attenuation). The render thread
+ *  sends new gains through a lock-free command queue
+ *  (spscqueue.h); the callback drains it at the start of
+ *  every block and ramps each source from its old gains to
+ *  the new ones over the block, so moving the camera does
+ *  not click.
+ *
+ *  The accumulate and output kernels exist as scalar, SSE2
+ *  and AVX versions, picked at run time like the FFT (the
+ *  program itself needs no -mavx). The output is converted
+ *  to 16-bit with TPDF dither.
+ *
+ *  Nothing here knows about SDL or WAV files, so the
+ *  benchmark drives exactly the code the callback runs.
+ **********************************************************/
+#ifndef ORATOR_MIXER_H
+#define ORATOR_MIXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most sources one mix can hold
+#define MIXER_MAX_SOURCES 256
+
+// Pending gain changes; a frame sends one per source
+#define MIXER_COMMAND_QUEUE 1024
+
+// Distance at which a source plays at its own level (the
+// default camera distance); closer sources get up to 2x
+#define MIXER_REF_DISTANCE 12.0f
+
+// Gains closer than this to the last ones sent are not sent
+#define MIXER_GAIN_EPSILON 1.0e-4f
+
+enum MixBackend {
+    MIX_SCALAR = 0,
+    MIX_SSE2,
+    MIX_AVX
+};
+
+// Where the sound is heard from: camera position and the
+// unit vector pointing to the right of the view
+struct MixListener {
+    float position[3];
+    float right[3];
+};
+
+// Starts a mix of 'sources' sources (all gains 0 until the
+// first update). Not thread-safe: call before the callback runs.
+bool mixerInit(int sources);
+int  mixerSourceCount();
+
+// Render thread: new target gains for one source, from its
+// world position. Unchanged gains are not queued. Returns
+// false if the queue was full; the change is then sent
+// again by the next call.
+bool mixerPlaceSource(int source, const float position[3], const MixListener& listener);
+// Render thread: gains set directly (e.g. no camera)
+bool mixerSetGains(int source, float left, float right);
+
+// Equal-power pan + distance gain of a source (pure math)
+void mixerSpatialGains(const float position[3], const MixListener& listener,
+                       float gains[2]);
+
+// Callback side, once per block: applies queued commands
+void mixerBeginBlock();
+
+// Callback side: adds 'frames' frames of one source
+// (interleaved, 'channels' per frame) into the stereo buffer
+// 'out', ramping that source's gains over the block. Mono is
+// panned, stereo balanced; further channels are ignored.
+void mixerAddSource(int source, float* out, const float* in, size_t frames, int channels);
+
+// Callback side: the source did not play this block; its
+// gains still jump to their targets
+void mixerSkipSource(int source);
+
+// Callback side: master gain (1/sqrt(sources), so the level
+// stays about the same for any number of uncorrelated
+// sources), then TPDF-dithered conversion to int16 with
+// saturation. 'mix' is stereo and is scaled in place, so it
+// can be shown to the analysis tap afterwards.
+void mixerFinishBlock(float* mix, int16_t* out, size_t frames);
+
+// Commands refused because the queue was full
+unsigned long mixerDroppedCommands();
+
+MixBackend mixBestBackend();
+MixBackend mixCurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+MixBackend mixSetBackend(MixBackend backend);
+const char* mixBackendName(MixBackend backend);
+
+#endif // ORATOR_MIXER_H
@@ -12,6 +12,37 @@
 #include <stdlib.h>    // For exit(), etc.
 #include <stdio.h>     // For printf
 
+#include <string.h>    // For strcmp
+#include <chrono>      // Startup time (initGL to first frame)
+#include <vector>      // For std::vector
+
+#include "orator.h"    // Functions shared with the other modules
+#include "mesh.h"      // Retained VBO/IBO meshes for the speaker
+#include "bench.h"     // Headless --bench mode
+#include "profiler.h"  // Per-stage CPU/GPU timers, HUD, trace export
+#include "speakers.h"  // Instanced speaker arrays (--speakers N)
+#include "lod.h"       // Screen-space level of detail
+#include "shadow.h"    // Silhouette-based planar shadow
+#include "audio.h"     // SDL2 streaming WAV playback
+#include "analysis.h"  // FFT band levels of the playing audio
+#include "scheduler.h" // Delta-time, event-driven frame pacing
+#include "tessellate.h" // SIMD vertex generation (--tessellator)
+#include "procedural.h" // Buffer-less speaker from gl_VertexID
+#include "tesstable.h"  // Compile-time sin/cos of the LOD levels
+#include "glstate.h"    // Redundant GL state change filter
+#include "drawlist.h"   // Per-frame draw submissions sorted by state
+#include "meshcache.h"  // Tessellated meshes stored on disk
+#include "recorder.h"   // --record: PBO readback to an image sequence
+#include "mixer.h"      // Spatial gains of the audio sources
+#include "synthload.h"  // --render-load / --cpu-load test load
+#include "simulation.h" // Scene state ticked on its own thread
+#include "culling.h"    // Frustum and occlusion culling
+#include "mat4.h"       // CPU-side transforms
+#include "shader.h"     // Current transform for the shader paths
+#include "arena.h"      // Per-frame scratch memory
+#include "programcache.h" // Linked shader programs stored on disk
+#include "scenefile.h"  // --scene: light, floor and shape, reloaded live
+
 /* If M_PI isn't defined by math.h in some environments,
  * define it manually here. */
 #ifndef M_PI
@@ -21,39 +52,63 @@
 // --------------------------------------------------------
 // SPHERICAL CAP + SHADOW PARAMETERS
 // --------------------------------------------------------
-// Toggles and IDs
-bool  textureEnabled      = true;  // Switch for checkerboard texture
-int   smoothShading       = 1;     // 1 = GL_SMOOTH, 0 = GL_FLAT
-int   depthTestEnabled    = 1;     // 1 = enable depth testing, 0 = disable
 GLuint textureID          = 0;     // OpenGL texture handle for checkerboard
 
-// Camera variables
-float cameraAngleX        = 0.0f;  // Horizontal camera angle
-float cameraAngleY        = 30.0f; // Vertical camera angle
-float distance            = 12.0f; // Distance from origin (zoom)
-
-// Automatic shape rotation
-float shapeRotationAngle  = 0.0f;  // Updated over time to spin the shape
+// Camera, rotations, pump and toggles as this frame draws them:
+// filled in from the simulation thread by updateSceneView()
+SceneSnapshot scene = {
+    0.0, 0, 0,                      // Time, tick, inputs
+    0.0f, 30.0f, 12.0f,             // Camera angles X/Y, distance
+    0.0f, 0.0f, 0.0f,               // Mouse rotation X/Y, automatic spin
+    1.0f, 1.0f,                     // Pump of cap and concavity
+    (3.0f * M_PI) / 4.0f, 0.4f, 0.1f, 0,   // Shape (set in main()), version
+    true, true, true,               // Texture, smooth shading, depth test
+    true, true                      // Spin, audio-reactive pump
+};
+
+// Current window size (kept by reshape, used by the HUD)
+int   windowWidth         = 800;
+int   windowHeight        = 600;
 
 // Mouse Interaction
 int   isDragging          = 0;     // Are we currently dragging with mouse?
 int   lastMouseX          = 0;     // Last mouse X position
 int   lastMouseY          = 0;     // Last mouse Y position
-// Extra user-driven rotation 
-float rotationX           = 0.0f;  // Rotation around X set by mouse drag
-float rotationY           = 0.0f;  // Rotation around Y set by mouse drag
 
-// Spherical Cap + Ring geometry parameters
-const float phi_max          = (3.0f * M_PI) / 4.0f; // How big the spherical cap is (angle)
-const float innerRadiusFactor= 0.4f;  // Ratio: inner ring radius / outer ring radius
-const float concaveDepth     = 0.1f;  // Depth for the concavity in center
+// Spherical Cap + Ring geometry parameters the meshes are built
+// from (edits arrive through the snapshot, see setSpeakerShape)
+float phi_max                = (3.0f * M_PI) / 4.0f; // How big the spherical cap is (angle)
+float innerRadiusFactor      = 0.4f;  // Ratio: inner ring radius / outer ring radius
+float concaveDepth           = 0.1f;  // Depth for the concavity in center
 
 // Shadow plane & light
-// The "floor" is at z=-9.5 => plane eqn: z+9.5=0 => {0,0,1,9.5}
+// The floor is drawn at z=-10 and the shadow a little above it,
+// at z=-9.5 => plane eqn: z+9.5=0 => {0,0,1,9.5} (see setFloorHeight)
+float   floorHeight    = -10.0f;
+const float shadowLift = 0.5f;
 GLfloat planeFloor[4] = { 0.0f, 0.0f, 1.0f, 9.5f };
 // A point light in 3D space at (5,5,5), w=1 means it's positional (not directional).
 GLfloat lightPosition[4] = { 5.0f, 5.0f, 5.0f, 1.0f };
 
+// Retained meshes for cap, ring and concavity (see mesh.h),
+// one set per level of detail (see lod.h)
+MeshBuffer speakerMeshes[LOD_LEVELS][MESH_COMPONENT_COUNT] = {};
+SpeakerPath speakerPath   = PATH_RETAINED;  // 'm' cycles, --path
+bool  proceduralAvailable = false; // GLSL 3.30 program compiled
+bool  lodEnabled          = true;  // false = always the finest level
+int   speakerLodLevel     = 0;     // Current level of the single speaker
+int   meshDetail          = 1;     // --detail: steps x this at every level
+// Where the tessellated meshes are cached ("" = no cache, see meshcache.h)
+std::string meshCacheDir  = meshCacheDefaultDir();
+
+// Vertical field of view of the perspective projection (degrees)
+const float fieldOfViewY  = 45.0f;
+int   requestedSpeakers   = 0;     // --speakers N (0 = single speaker)
+// --record DIR: every drawn frame to an image file
+RecordOptions recordOptions = { NULL, RECORD_PPM, 0 };
+// Set by --bench --fly: replaces the orbit around the origin
+CameraPose cameraPose = { false, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+
 // --------------------------------------------------------
 // TEXTURE GENERATION (Checkerboard)
 // --------------------------------------------------------
@@ -80,7 +135,7 @@ void generateTexture()
     // Generate one texture ID and store it in textureID
     glGenTextures(1, &textureID);
     // Bind it to the 2D texture target
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    stateBindTexture(textureID);
 
     // Set various texture parameters:
     // Wrap S/T means if texture coords go beyond [0,1], they will repeat.
@@ -101,103 +156,69 @@ void generateTexture()
 // --------------------------------------------------------
 
 /**********************************************************
- * drawFoundation() - Draws a big floor at z = -9.5
+ * drawFoundation() - Draws a big floor at z = floorHeight
  **********************************************************/
 void drawFoundation() 
 {
     glPushMatrix();          // Save current transform state
-    glColor3f(1.0f, 1.0f, 1.0f);   // Color it white
+    // White and untextured: the draw list item sets that
     glNormal3f(0.0f, 0.0f, 1.0f);  // Upward-facing normal for light calculations
 
-    float z = -10.0f;         // The floor plane's Z coordinate
+    float z = floorHeight;    // The floor plane's Z coordinate
 
-    // We draw a large quad from (-20,-20) to (+20,+20) at z = -9.5
+    // We draw a large quad from (-20,-20) to (+20,+20) at that z
     glBegin(GL_QUADS);
         glVertex3f(-20.0f, -20.0f, z);
         glVertex3f( 20.0f, -20.0f, z);
         glVertex3f( 20.0f,  20.0f, z);
         glVertex3f(-20.0f,  20.0f, z);
     glEnd();
+    frameStats.drawCalls += 1;
+    frameStats.triangles += 2;
+    frameStats.vertices  += 4;
 
     glPopMatrix();           // Restore transform
 }
 
-/**********************************************************
- * computeShadowMatrix(...) - Creates a 4x4 shadow projection
- *    based on plane eqn and light position
- **********************************************************/
-void computeShadowMatrix(GLfloat shadowMat[16],
-                         const GLfloat lightPos[4],
-                         const GLfloat plane[4]) 
-{
-    // plane[] = {A, B, C, D} => A*x + B*y + C*z + D = 0
-    // lightPos[] = {Lx, Ly, Lz, Lw}
-    // dot = A*Lx + B*Ly + C*Lz + D*Lw
-    GLfloat dot = plane[0]*lightPos[0] +
-                  plane[1]*lightPos[1] +
-                  plane[2]*lightPos[2] +
-                  plane[3]*lightPos[3];
-
-    // Fill out the 16 entries of shadowMat
-    // The formula is: shadowMat = dot*I - lightPos * plane (outer product)
-    // We'll fill each column of the 4x4 matrix:
-    shadowMat[0]  = dot - lightPos[0]*plane[0];
-    shadowMat[4]  =     - lightPos[0]*plane[1];
-    shadowMat[8]  =     - lightPos[0]*plane[2];
-    shadowMat[12] =     - lightPos[0]*plane[3];
-
-    shadowMat[1]  =     - lightPos[1]*plane[0];
-    shadowMat[5]  = dot - lightPos[1]*plane[1];
-    shadowMat[9]  =     - lightPos[1]*plane[2];
-    shadowMat[13] =     - lightPos[1]*plane[3];
-
-    shadowMat[2]  =     - lightPos[2]*plane[0];
-    shadowMat[6]  =     - lightPos[2]*plane[1];
-    shadowMat[10] = dot - lightPos[2]*plane[2];
-    shadowMat[14] =     - lightPos[2]*plane[3];
-
-    shadowMat[3]  =     - lightPos[3]*plane[0];
-    shadowMat[7]  =     - lightPos[3]*plane[1];
-    shadowMat[11] =     - lightPos[3]*plane[2];
-    shadowMat[15] = dot - lightPos[3]*plane[3];
-}
-
 /**********************************************************
  * drawSphericalCap(...) - draws partial sphere from phi=0 to phi=phi_max
  **********************************************************/
 void drawSphericalCap(int uSteps, int vSteps) 
 {
-    // If textures are enabled, bind and enable the texture
-    if (textureEnabled) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-    } else {
-        // Otherwise disable texturing
-        glDisable(GL_TEXTURE_2D);
-    }
+    // Texturing is already set up by the caller's draw list item
 
     // We subdivide the sphere in the 'u' (theta) direction
-    // and the 'v' (phi) direction.
-    float dTheta = (2.0f * M_PI) / uSteps; // Full 360 deg / uSteps
+    // and the 'v' (phi) direction. The theta columns come from
+    // the angle table of this level (no sin/cos per vertex).
+    TessTableView table = tessTable(uSteps, vSteps);
     float dPhi   = phi_max / vSteps;      // From 0..phi_max
     float radius = 1.0f;                  // Radius of sphere
 
+    // phi depends on the shape, so it is done once per row here
+    // (arena scratch, handed back below: an array draws this
+    // once per speaker)
+    ArenaMark mark = arenaMark();
+    float* sinPhi = arenaArray<float>(vSteps + 1);
+    float* cosPhi = arenaArray<float>(vSteps + 1);
+    for (int j = 0; j <= vSteps; ++j) {
+        sinPhi[j] = sin(j * dPhi);
+        cosPhi[j] = cos(j * dPhi);
+    }
+
     // Loop over longitude slices
     for (int i = 0; i < uSteps; ++i) {
-        float theta = i * dTheta;
         // We'll build a quad strip for each slice
         glBegin(GL_QUAD_STRIP);
         // Loop over latitude subdivisions
         for (int j = 0; j <= vSteps; ++j) {
-            float phi = j * dPhi;
             // We do 2 vertices at a time in a strip
             for (int k = 0; k <= 1; ++k) {
-                float theta_curr = theta + k * dTheta;
+                int column = i + k;
 
                 // Cartesian coords from spherical:
-                float x = radius * sin(phi) * cos(theta_curr);
-                float y = radius * sin(phi) * sin(theta_curr);
-                float z = radius * cos(phi);
+                float x = radius * sinPhi[j] * table.cosTheta[column];
+                float y = radius * sinPhi[j] * table.sinTheta[column];
+                float z = radius * cosPhi[j];
 
                 // Normal is just (x,y,z)/radius for a sphere
                 float nx = x / radius;
@@ -205,10 +226,10 @@ void drawSphericalCap(int uSteps, int vSteps)
                 float nz = z / radius;
 
                 // Texture coords: 
-                // - U mapped to theta_curr / 2π,
+                // - U mapped to theta / 2π,
                 // - V mapped to phi / phi_max
-                float texU = theta_curr / (2.0f * M_PI);
-                float texV = phi / phi_max;
+                float texU = table.texU[column];
+                float texV = table.rowT[j];
 
                 glNormal3f(nx, ny, nz);
                 glTexCoord2f(texU, texV);
@@ -217,6 +238,10 @@ void drawSphericalCap(int uSteps, int vSteps)
         }
         glEnd(); // End quad strip
     }
+    arenaRewind(mark);
+    frameStats.drawCalls += uSteps;
+    frameStats.triangles += uSteps * vSteps * 2;
+    frameStats.vertices  += uSteps * (vSteps + 1) * 2;
 }
 
 /**********************************************************
@@ -224,14 +249,6 @@ void drawSphericalCap(int uSteps, int vSteps)
  **********************************************************/
 void drawFlatOuterRing(int uSteps) 
 {
-    // Similarly handle texture enabling
-    if (textureEnabled) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-    } else {
-        glDisable(GL_TEXTURE_2D);
-    }
-
     // Outer ring radius (circle in x-y plane) is sin(phi_max)
     float outerRadius = sin(phi_max);
     // Inner radius is some fraction (innerRadiusFactor) of outer
@@ -240,12 +257,12 @@ void drawFlatOuterRing(int uSteps)
     float z = cos(phi_max);
 
     // We'll build a triangle strip from outer radius to inner radius.
+    TessTableView table = tessTable(uSteps, 1);
     glBegin(GL_TRIANGLE_STRIP);
     for (int i = 0; i <= uSteps; ++i) {
-        // Angle from 0..2π
-        float theta = i * (2.0f * M_PI) / uSteps;
-        float cosTheta = cos(theta);
-        float sinTheta = sin(theta);
+        // Angle from 0..2π, looked up in the table
+        float cosTheta = table.cosTheta[i];
+        float sinTheta = table.sinTheta[i];
 
         // Outer edge coords
         float xOuter = outerRadius * cosTheta;
@@ -269,6 +286,9 @@ void drawFlatOuterRing(int uSteps)
         glVertex3f(xInner, yInner, z);
     }
     glEnd();
+    frameStats.drawCalls += 1;
+    frameStats.triangles += uSteps * 2;
+    frameStats.vertices  += (uSteps + 1) * 2;
 }
 
 /**********************************************************
@@ -276,13 +296,6 @@ void drawFlatOuterRing(int uSteps)
  **********************************************************/
 void drawConcaveInnerCircle(int uSteps, int vSteps) 
 {
-    if (textureEnabled) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-    } else {
-        glDisable(GL_TEXTURE_2D);
-    }
-
     // This circle's outer radius is the ring's inner radius
     float innerR = sin(phi_max) * innerRadiusFactor;
     // The base Z is cos(phi_max)
@@ -291,19 +304,19 @@ void drawConcaveInnerCircle(int uSteps, int vSteps)
     float maxD   = concaveDepth;
 
     // We'll draw it in vSteps radial layers
+    TessTableView table = tessTable(uSteps, vSteps);
     for (int j = 0; j < vSteps; ++j) {
         // r1/r2 = radii of the current ring and the next ring
-        float r1 = innerR * (1 - (float)j / vSteps);
-        float r2 = innerR * (1 - (float)(j+1) / vSteps);
+        float r1 = innerR * (1 - table.rowT[j]);
+        float r2 = innerR * (1 - table.rowT[j + 1]);
         // z1/z2 = corresponding heights
-        float z1 = zBase + maxD * ((float)j / vSteps);
-        float z2 = zBase + maxD * ((float)(j+1) / vSteps);
+        float z1 = zBase + maxD * table.rowT[j];
+        float z2 = zBase + maxD * table.rowT[j + 1];
 
         glBegin(GL_QUAD_STRIP);
         for (int i = 0; i <= uSteps; ++i) {
-            float theta = i * (2.0f * M_PI) / uSteps;
-            float cosT  = cos(theta);
-            float sinT  = sin(theta);
+            float cosT  = table.cosTheta[i];
+            float sinT  = table.sinTheta[i];
 
             // Coordinates for first ring (r1)
             float x1 = r1 * cosT;
@@ -350,43 +363,549 @@ void drawConcaveInnerCircle(int uSteps, int vSteps)
         }
         glEnd();
     }
+    frameStats.drawCalls += vSteps;
+    frameStats.triangles += vSteps * uSteps * 2;
+    frameStats.vertices  += vSteps * (uSteps + 1) * 2;
+}
+
+/**********************************************************
+ * speakerPathName(...) - For --path, logs and bench output
+ **********************************************************/
+const char* speakerPathName(SpeakerPath path)
+{
+    switch (path) {
+        case PATH_IMMEDIATE:  return "immediate";
+        case PATH_PROCEDURAL: return "procedural";
+        default:              return "retained";
+    }
+}
+
+/**********************************************************
+ * clampSpeakerShape(...) - Into the range of the shape edits
+ **********************************************************/
+void clampSpeakerShape(float& phiMax, float& innerFactor, float& depth)
+{
+    phiMax      = fminf(fmaxf(phiMax, phiMaxMin), phiMaxMax);
+    innerFactor = fminf(fmaxf(innerFactor, innerFactorMin), innerFactorMax);
+    depth       = fminf(fmaxf(depth, 0.0f), concaveDepthMax);
+}
+
+/**********************************************************
+ * setSpeakerShape(...) - New cap angle, ring ratio, depth
+ *
+ * Values are clamped so the ring and concavity stay valid;
+ * the meshes follow on the next frame.
+ **********************************************************/
+void setSpeakerShape(float phiMax, float innerFactor, float depth)
+{
+    clampSpeakerShape(phiMax, innerFactor, depth);
+    phi_max           = phiMax;
+    innerRadiusFactor = innerFactor;
+    concaveDepth      = depth;
+}
+
+/**********************************************************
+ * setFloorHeight(...) - Floor at z, the shadow plane above it
+ **********************************************************/
+void setFloorHeight(float z)
+{
+    floorHeight   = z;
+    planeFloor[3] = -(z + shadowLift);
+}
+
+/**********************************************************
+ * speakerShapeParams(...) - Current shape at a tessellation
+ **********************************************************/
+MeshParams speakerShapeParams(int uSteps, int vSteps)
+{
+    MeshParams p = { uSteps, vSteps, phi_max, innerRadiusFactor, concaveDepth };
+    return p;
+}
+
+/**********************************************************
+ * partParams(...) - Shape and steps of one part at one level
+ **********************************************************/
+MeshParams partParams(MeshComponent component, int lodLevel)
+{
+    const LodLevel& lod = lodLevels[lodLevel];
+    int vSteps = component == MESH_CAP     ? lod.capVSteps
+               : component == MESH_CONCAVE ? lod.concaveVSteps : 0;
+    return speakerShapeParams(lod.uSteps * meshDetail, vSteps * meshDetail);
+}
+
+/**********************************************************
+ * updateSpeakerMeshes() - (Re)build the retained meshes
+ *
+ * Builds the whole LOD chain. Each buffer is only
+ * re-tessellated when its own parameters changed, so calling
+ * this every frame is cheap.
+ **********************************************************/
+void updateSpeakerMeshes(int* rebuilt)
+{
+    for (int l = 0; l < LOD_LEVELS; ++l)
+        for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+            if (updateMeshBuffer(speakerMeshes[l][c], (MeshComponent)c,
+                                 partParams((MeshComponent)c, l)) && rebuilt)
+                rebuilt[c]++;
+}
+
+/**********************************************************
+ * speakerMeshParts(...) - The LOD chain as cache parts
+ *
+ * In the order of speakerMeshes, so parts[i] belongs to
+ * (&speakerMeshes[0][0])[i]. Returns the number of parts.
+ **********************************************************/
+static int speakerMeshParts(MeshCachePart* parts)
+{
+    int n = 0;
+    for (int l = 0; l < LOD_LEVELS; ++l)
+        for (int c = 0; c < MESH_COMPONENT_COUNT; ++c, ++n) {
+            parts[n].component = (MeshComponent)c;
+            parts[n].params    = partParams((MeshComponent)c, l);
+        }
+    return n;
+}
+
+/**********************************************************
+ * loadSpeakerMeshes() - Startup build of the retained meshes
+ *
+ * Same result as updateSpeakerMeshes(), but goes through the
+ * mesh cache file: a start with a known shape and detail
+ * uploads the stored meshes instead of tessellating them.
+ * Later shape edits use updateSpeakerMeshes() as before.
+ **********************************************************/
+MeshCacheResult loadSpeakerMeshes()
+{
+    if (meshCacheDir.empty()) {
+        updateSpeakerMeshes();
+        return MESH_CACHE_UNAVAILABLE;
+    }
+    MeshCachePart parts[LOD_LEVELS * MESH_COMPONENT_COUNT];
+    int n = speakerMeshParts(parts);
+    return loadMeshesCached(meshCacheDir, parts, n, &speakerMeshes[0][0]);
+}
+
+/**********************************************************
+ * speakerMeshCachePath() - Cache file for the current shape
+ **********************************************************/
+std::string speakerMeshCachePath()
+{
+    if (meshCacheDir.empty())
+        return "";
+    MeshCachePart parts[LOD_LEVELS * MESH_COMPONENT_COUNT];
+    int n = speakerMeshParts(parts);
+    return meshCachePath(meshCacheDir, parts, n);
+}
+
+/**********************************************************
+ * destroySpeakerMeshes() - Frees every retained mesh
+ **********************************************************/
+void destroySpeakerMeshes()
+{
+    for (int l = 0; l < LOD_LEVELS; ++l)
+        for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+            destroyMeshBuffer(speakerMeshes[l][c]);
+}
+
+/**********************************************************
+ * meshesNeeded() - Does the current path draw from buffers?
+ *
+ * Immediate mode and the procedural single speaker do not,
+ * so shape edits then cost no tessellation at all.
+ **********************************************************/
+bool meshesNeeded()
+{
+    if (speakerCount > 0)
+        return speakerPath != PATH_IMMEDIATE;   // Arrays instance the meshes
+    return speakerPath == PATH_RETAINED;
+}
+
+/**********************************************************
+ * cameraInArrayFrame(...) - Camera in the speakers' frame
+ *
+ * The array is rotated by rotationX/rotationY; bring the
+ * camera into the array's frame instead of moving every
+ * speaker.
+ **********************************************************/
+void cameraInArrayFrame(float cameraX, float cameraY, float cameraZ, float local[3])
+{
+    float ax = -scene.rotationX * M_PI / 180.f;
+    float ay = -scene.rotationY * M_PI / 180.f;
+    float x1 = cameraX;
+    float y1 = cameraY * cosf(ax) - cameraZ * sinf(ax);
+    float z1 = cameraY * sinf(ax) + cameraZ * cosf(ax);
+    local[0] =  x1 * cosf(ay) + z1 * sinf(ay);
+    local[1] =  y1;
+    local[2] = -x1 * sinf(ay) + z1 * cosf(ay);
+}
+
+// Visibility of this frame (see updateVisibility), in the
+// frame arena
+static unsigned char* speakerCullMask;
+static bool singleBodyVisible   = true;
+static bool singleShadowVisible = true;
+
+// Transforms of the current frame, composed in renderScene()
+struct FrameTransforms {
+    mat4 view;             // Camera
+    mat4 shadowMatrix;     // Projects onto planeFloor from the light
+    mat4 casterModel;      // T(-0.5, 2, 0) * Rx * Ry: where the shadow is cast from
+    mat4 body;             // view * Rx * Ry: the lit speakers
+    mat4 caster;           // view * casterModel
+    mat4 shadow;           // view * shadowMatrix * casterModel: the shadow pass
+};
+static FrameTransforms frame;
+
+/**********************************************************
+ * composeFrameTransforms(...) - Everything from one view
+ *
+ * The three products with the view are one batch.
+ **********************************************************/
+void composeFrameTransforms(const mat4& view)
+{
+    frame.view = view;
+    {
+        ProfileScope scope(STAGE_SHADOW_MATRIX);
+        mat4PlanarShadow(frame.shadowMatrix, lightPosition, planeFloor);
+    }
+
+    mat4 models[3];
+    mat4Identity(models[0]);
+    mat4Rotate(models[0], scene.rotationX, 1, 0, 0);
+    mat4Rotate(models[0], scene.rotationY, 0, 1, 0);
+    mat4Identity(frame.casterModel);
+    mat4Translate(frame.casterModel, -0.5f, 2.0f, 0.0f);
+    mat4Multiply(frame.casterModel, frame.casterModel, models[0]);
+    models[1] = frame.casterModel;
+    mat4Multiply(models[2], frame.shadowMatrix, frame.casterModel);
+
+    mat4MultiplyBatch(view, models, models, 3);
+    frame.body   = models[0];
+    frame.caster = models[1];
+    frame.shadow = models[2];
+}
+
+/**********************************************************
+ * speakerBoundRadius() - Bounding sphere of a unit speaker
+ *
+ * The unit cap, ring and concavity fit in the unit sphere
+ * plus the concavity depth. The pump stretches the cap by
+ * at most 2 (its height) per unit of pump.
+ **********************************************************/
+float speakerBoundRadius()
+{
+    return 1.0f + 2.0f * fmaxf(scene.capPump - 1.0f, 0.0f) +
+           concaveDepth * fmaxf(scene.concavePump, 1.0f);
+}
+
+/**********************************************************
+ * updateVisibility(...) - Which speakers and shadows to draw
+ *
+ * Both frustums are built in the frame the speakers are
+ * given in: the lit pass draws them rotated, the shadow pass
+ * also offset (see drawFlattenedSpeaker). Needs this frame's
+ * composeFrameTransforms().
+ **********************************************************/
+void updateVisibility(const float cameraLocal[3])
+{
+    singleBodyVisible = singleShadowVisible = true;
+    if (!cullEnabled)
+        return;
+    ProfileScope scope(STAGE_CULL);
+
+    CullFrustum body, shadowFrustum;
+    CullShadow shadow;
+    cullBuildFrustum(shaderProjection().m, frame.body.m, body);
+    cullBuildFrustum(shaderProjection().m, frame.caster.m, shadowFrustum);
+    cullBuildShadow(frame.casterModel.m, lightPosition, planeFloor, shadow);
+
+    if (speakerCount == 0) {
+        cullSingleSpeaker(body, shadowFrustum, shadow, speakerBoundRadius(),
+                          &singleBodyVisible, &singleShadowVisible);
+        return;
+    }
+    speakerCullMask = arenaArray<unsigned char>(speakerCount);
+    cullSpeakers(body, shadowFrustum, shadow, speakerBoundRadius(), cameraLocal,
+                 speakerCullMask);
+}
+
+/**********************************************************
+ * updateLevelsOfDetail(...) - Pick LOD levels for this frame
+ *
+ * Uses the projected radius of the unit-sized speaker, from
+ * fieldOfViewY, the window height and the camera distance.
+ * Culled speakers (updateVisibility) are not drawn at any
+ * level, but their levels follow the camera all the same.
+ **********************************************************/
+void updateLevelsOfDetail(const float cameraLocal[3])
+{
+    float pixelScale = lodPixelScale(fieldOfViewY, windowHeight);
+
+    if (speakerCount == 0) {
+        // The single speaker sits at the origin
+        float distance = cameraPose.active
+            ? sqrtf(cameraLocal[0] * cameraLocal[0] + cameraLocal[1] * cameraLocal[1] +
+                    cameraLocal[2] * cameraLocal[2])
+            : scene.distance;
+        speakerLodLevel = lodEnabled
+            ? selectLod(speakerLodLevel, lodProjectedRadius(1.0f, distance, pixelScale))
+            : 0;
+        return;
+    }
+    updateSpeakerLods(cameraLocal, pixelScale, lodEnabled,
+                      cullEnabled ? speakerCullMask : NULL);
+}
+
+/**********************************************************
+ * updateAudioPanning(...) - Source gains from the camera
+ *
+ * Source k sits at speaker k of the array (all at the
+ * single speaker in the origin otherwise). The mixer only
+ * queues gains that changed, so a still camera costs no
+ * messages to the audio thread.
+ **********************************************************/
+void updateAudioPanning(float cameraX, float cameraY, float cameraZ)
+{
+    int sources = audioSourceCount();
+    if (sources == 0)
+        return;
+
+    // Right of the view: forward (towards the origin) x up (z)
+    MixListener listener = { { cameraX, cameraY, cameraZ }, { -cameraY, cameraX, 0.0f } };
+    float len = sqrtf(cameraX * cameraX + cameraY * cameraY);
+    if (len < 1.0e-6f) {
+        listener.right[0] = 1.0f;   // Looking straight down
+        listener.right[1] = 0.0f;
+    } else {
+        listener.right[0] /= len;
+        listener.right[1] /= len;
+    }
+
+    // The array is drawn rotated by rotationX, then rotationY
+    float ax = scene.rotationX * M_PI / 180.f, ay = scene.rotationY * M_PI / 180.f;
+    for (int k = 0; k < sources; ++k) {
+        float p[3] = { 0.0f, 0.0f, 0.0f };
+        if (k < speakerCount) {
+            const float* o = speakerInstances[k].offset;
+            float x1 =  o[0] * cosf(ay) + o[2] * sinf(ay);
+            float z1 = -o[0] * sinf(ay) + o[2] * cosf(ay);
+            p[0] = x1;
+            p[1] = o[1] * cosf(ax) - z1 * sinf(ax);
+            p[2] = o[1] * sinf(ax) + z1 * cosf(ax);
+        }
+        mixerPlaceSource(k, p, listener);
+    }
+}
+
+/**********************************************************
+ * partPump(...) - z-scale of one part this frame
+ **********************************************************/
+float partPump(MeshComponent component)
+{
+    if (component == MESH_CAP)     return scene.capPump;
+    if (component == MESH_CONCAVE) return scene.concavePump;
+    return 1.0f;   // The ring stays put
+}
+
+// Modelview before beginPartPump() (parts are never nested)
+static mat4 unpumpedModelview;
+
+/**********************************************************
+ * beginPartPump(...) - Stretch a part along z about the
+ *    rim plane z = cos(phi_max), so it stays attached to
+ *    the ring. Returns true if endPartPump() must restore.
+ **********************************************************/
+bool beginPartPump(MeshComponent component)
+{
+    float pump = partPump(component);
+    if (pump == 1.0f)
+        return false;
+    float rimZ = cos(phi_max);
+    unpumpedModelview = shaderModelview();
+    mat4 m = unpumpedModelview;
+    mat4Translate(m, 0.0f, 0.0f, rimZ);
+    mat4Scale(m, 1.0f, 1.0f, pump);
+    mat4Translate(m, 0.0f, 0.0f, -rimZ);
+    shaderSetModelview(m);
+    return true;
+}
+
+void endPartPump(bool pumped)
+{
+    if (pumped)
+        shaderSetModelview(unpumpedModelview);
+}
+
+/**********************************************************
+ * drawImmediatePart(...) - Immediate-mode draw of one part
+ **********************************************************/
+void drawImmediatePart(MeshComponent component, int lodLevel)
+{
+    MeshParams p = partParams(component, lodLevel);
+    switch (component) {
+        case MESH_CAP:     drawSphericalCap(p.uSteps, p.vSteps);       break;
+        case MESH_RING:    drawFlatOuterRing(p.uSteps);                break;
+        case MESH_CONCAVE: drawConcaveInnerCircle(p.uSteps, p.vSteps); break;
+        default:           break;
+    }
+}
+
+/**********************************************************
+ * instanceMatrix(...) - T(offset) * Rz(spin + phase) * S(scale)
+ *
+ * What the instancing shader does per vertex, as a matrix.
+ **********************************************************/
+void instanceMatrix(const SpeakerInstance& inst, float spinDegrees, mat4& out)
+{
+    float a = spinDegrees * (float)M_PI / 180.0f + inst.phase;
+    float c = cosf(a) * inst.scale, s = sinf(a) * inst.scale;
+    mat4 m = { {
+        c,    s,    0.0f,       0.0f,
+        -s,   c,    0.0f,       0.0f,
+        0.0f, 0.0f, inst.scale, 0.0f,
+        inst.offset[0], inst.offset[1], inst.offset[2], 1.0f
+    } };
+    out = m;
+}
+
+/**********************************************************
+ * drawSpeakerArrayPart(...) - One part for every speaker
+ *
+ * Instanced from the retained mesh, or (with 'm') one
+ * immediate-mode copy per speaker for comparison. The
+ * procedural path has no instanced variant; arrays keep
+ * using the retained meshes there.
+ **********************************************************/
+void drawSpeakerArrayPart(MeshComponent component, bool shadowPass)
+{
+    if (speakerPath != PATH_IMMEDIATE) {
+        for (int l = 0; l < LOD_LEVELS; ++l)
+            drawSpeakerInstances(speakerMeshes[l][component], l, component,
+                                 scene.shapeRotationAngle, shadowPass,
+                                 scene.textureEnabled && !shadowPass,
+                                 cos(phi_max), partPump(component));
+        return;
+    }
+
+    // Every speaker's modelview, composed in one batch
+    mat4* modelviews = arenaArray<mat4>(speakerCount);
+    int*  drawn      = arenaArray<int>(speakerCount);
+    int drawnCount = 0;
+    for (int k = 0; k < speakerCount; ++k) {
+        if (!speakerVisible[k])
+            continue;   // Culled (updateVisibility)
+        instanceMatrix(speakerInstances[k], scene.shapeRotationAngle, modelviews[drawnCount]);
+        drawn[drawnCount++] = k;
+    }
+    mat4 base = shaderModelview();
+    mat4MultiplyBatch(base, modelviews, modelviews, drawnCount);
+
+    for (int i = 0; i < drawnCount; ++i) {
+        const SpeakerInstance& inst = speakerInstances[drawn[i]];
+        shaderSetModelview(modelviews[i]);
+        if (!shadowPass)
+            stateColor(inst.color[0] / 255.0f, inst.color[1] / 255.0f,
+                       inst.color[2] / 255.0f, inst.color[3] / 255.0f);
+        bool pumped = beginPartPump(component);
+        drawImmediatePart(component, speakerLod[drawn[i]]);
+        endPartPump(pumped);
+    }
+    shaderSetModelview(base);
+}
+
+/**********************************************************
+ * drawSpeakerPart(...) - One of cap, ring or concavity
+ *
+ * Uses the path selected with 'm' / --path: retained
+ * buffers, immediate mode, or the procedural vertex shader.
+ * In array mode (--speakers) the part is drawn for every
+ * speaker, each with its own spin, so the caller skips the
+ * shapeRotationAngle rotation.
+ **********************************************************/
+void drawSpeakerPart(MeshComponent component, bool shadowPass)
+{
+    if (speakerCount > 0) {
+        drawSpeakerArrayPart(component, shadowPass);
+        return;
+    }
+    if (speakerPath == PATH_PROCEDURAL) {
+        // The shader does the pump itself, like the instanced path
+        drawProceduralPart(component, partParams(component, speakerLodLevel),
+                           shadowPass, scene.textureEnabled && !shadowPass,
+                           cos(phi_max), partPump(component));
+        return;
+    }
+    bool pumped = beginPartPump(component);
+    if (speakerPath == PATH_IMMEDIATE) {
+        drawImmediatePart(component, speakerLodLevel);
+    } else {
+        drawMeshBuffer(speakerMeshes[speakerLodLevel][component]);
+    }
+    endPartPump(pumped);
+}
+
+/**********************************************************
+ * drawSpeaker(...) - Cap, ring and concavity in one go
+ **********************************************************/
+void drawSpeaker(bool shadowPass)
+{
+    for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+        drawSpeakerPart((MeshComponent)c, shadowPass);
 }
 
 // --------------------------------------------------------
 // LIGHTING SETUP
 // --------------------------------------------------------
 
+/**********************************************************
+ * sceneLight() - The light at lightPosition with its diffuse,
+ *    specular and ambient intensities, for GL_LIGHT0 and the
+ *    shaders alike
+ **********************************************************/
+ShaderLight sceneLight()
+{
+    ShaderLight light = {
+        { lightPosition[0], lightPosition[1], lightPosition[2], lightPosition[3] },
+        { 0.0f, 0.0f, 0.0f, 1.0f },     // Light ambient (GL's default)
+        { 1.0f, 1.0f, 1.0f, 1.0f },     // Diffuse
+        { 1.0f, 1.0f, 1.0f, 1.0f },     // Specular
+        { 0.2f, 0.2f, 0.2f, 1.0f },     // Global ambient
+        { 1.0f, 1.0f, 1.0f, 1.0f },     // Material specular
+        50.0f                           // Shininess
+    };
+    return light;
+}
+
 /**********************************************************
  * initLighting() - Basic lighting setup
  **********************************************************/
 void initLighting() 
 {
     // Enable depth testing so nearer objects block farther ones
-    glEnable(GL_DEPTH_TEST);
+    stateEnable(GL_DEPTH_TEST, scene.depthTestEnabled);
     // Turn on lighting in general, and a single light (LIGHT0)
-    glEnable(GL_LIGHTING);
+    stateEnable(GL_LIGHTING, true);
     glEnable(GL_LIGHT0);
 
-    // Position the light at (5,5,5)
-    glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
-
-    // Set the diffuse, specular, and ambient intensities for this light
-    GLfloat light_diffuse[]   = {1.0, 1.0, 1.0, 1.0};
-    GLfloat light_specular[]  = {1.0, 1.0, 1.0, 1.0};
-    GLfloat ambient_light[]   = {0.2, 0.2, 0.2, 1.0};
-    glLightfv(GL_LIGHT0, GL_DIFFUSE,  light_diffuse);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambient_light);
+    ShaderLight light = sceneLight();
+    shaderSetLight(light);
 
     // Enable color material so we can use glColor3f() for diffuse color
     glEnable(GL_COLOR_MATERIAL);
     glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
 
     // A bit of specular highlight
-    GLfloat mat_specular[]  = {1.0, 1.0, 1.0, 1.0};
-    GLfloat mat_shininess[] = {50.0};
-    glMaterialfv(GL_FRONT, GL_SPECULAR,  mat_specular);
-    glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+    stateMaterial(GL_SPECULAR,  light.materialSpecular);
+    stateMaterial(GL_SHININESS, &light.shininess);
+}
+
+// When initGL() last started
+static std::chrono::steady_clock::time_point initGLStart;
+
+double msSinceInitGL()
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - initGLStart).count();
 }
 
 /**********************************************************
@@ -394,6 +913,11 @@ void initLighting()
  **********************************************************/
 void initGL() 
 {
+    initGLStart = std::chrono::steady_clock::now();
+
+    // A new context: the state cache knows nothing about it yet
+    stateInvalidate();
+
     // Generate the checkerboard texture
     generateTexture();
     // Setup lighting
@@ -402,108 +926,468 @@ void initGL()
     glClearColor(0.f, 0.f, 0.f, 1.f);
 
     // Start with a shading model (smooth or flat) depending on toggle
-    glShadeModel(smoothShading ? GL_SMOOTH : GL_FLAT);
+    stateShadeModel(scene.smoothShading ? GL_SMOOTH : GL_FLAT);
+
+    // Instance buffer + shader for array mode
+    if (requestedSpeakers > 0 && !initSpeakerArray(requestedSpeakers)) {
+        fprintf(stderr, "Instancing unavailable, drawing a single speaker\n");
+        speakerCount = 0;
+    }
+    // Culling grid over the array (queries need the context)
+    if (speakerCount > 0)
+        cullBuildGrid(speakerInstances);
+
+    // Shader for the buffer-less path
+    proceduralAvailable = initProceduralSpeaker();
+    if (speakerPath == PATH_PROCEDURAL && !proceduralAvailable) {
+        fprintf(stderr, "Procedural path unavailable, using retained meshes\n");
+        speakerPath = PATH_RETAINED;
+    }
+
+    // Tessellate the speaker once (or load it from the mesh
+    // cache) and upload it to the GPU, only if the chosen path
+    // draws from buffers
+    if (meshesNeeded()) {
+        MeshCacheResult r = loadSpeakerMeshes();
+        if (r == MESH_CACHE_WRITTEN)
+            fprintf(stderr, "Mesh cache: wrote %s\n", speakerMeshCachePath().c_str());
+    }
+
+    // GPU timer queries for the profiler
+    profilerInit();
+
+    // Readback ring and encoder threads for --record
+    if (recordOptions.dir && !recorderActive() && !recorderStart(recordOptions))
+        fprintf(stderr, "Recording disabled\n");
 }
 
 // --------------------------------------------------------
-// ANIMATION
+// SCENE FILE
 // --------------------------------------------------------
 
+const char* sceneFilePath = NULL;   // --scene FILE
+
+/**********************************************************
+ * liveSceneConfig(...) - What is in use, with this shape
+ **********************************************************/
+static SceneConfig liveSceneConfig(float phiMax, float innerRing, float concavity)
+{
+    SceneConfig c;
+    memcpy(c.light, lightPosition, sizeof(c.light));
+    c.floorHeight = floorHeight;
+    c.phiMax      = phiMax;
+    c.innerRing   = innerRing;
+    c.concavity   = concavity;
+    c.detail      = meshDetail;
+    return c;
+}
+
+/**********************************************************
+ * loadSceneFile() - Startup: read it, set the globals, watch
+ *
+ * Runs before any GL, so initGL() builds everything from the
+ * file's values as usual. Settings the file leaves out keep
+ * their defaults and command-line values.
+ **********************************************************/
+bool loadSceneFile()
+{
+    // No simulation yet: the globals are the shape
+    SceneConfig f = liveSceneConfig(phi_max, innerRadiusFactor, concaveDepth);
+    if (!sceneFileRead(sceneFilePath, f))
+        return false;
+
+    memcpy(lightPosition, f.light, sizeof(lightPosition));
+    setFloorHeight(f.floorHeight);
+    setSpeakerShape(f.phiMax, f.innerRing, f.concavity);
+    meshDetail = f.detail;
+    if (!sceneWatchStart(sceneFilePath))
+        fprintf(stderr, "Scene: cannot watch '%s', changes need a restart\n", sceneFilePath);
+    return true;
+}
+
+/**********************************************************
+ * appendItem(...) - ", "-separated list in a fixed buffer
+ **********************************************************/
+static void appendItem(char* list, size_t size, const char* item)
+{
+    size_t used = strlen(list);
+    snprintf(list + used, size - used, "%s%s", used ? ", " : "", item);
+}
+
 /**********************************************************
- * timer(...) - Called periodically by GLUT to animate
+ * reloadSceneFile() - Apply what changed, rebuild only that
+ *
+ * The light and the floor only enter the shadow matrix,
+ * which is composed every frame anyway, and the light
+ * uniforms. A shape or detail change re-tessellates just
+ * the buffers whose own parameters changed (see
+ * updateMeshBuffer): the cap follows the cap angle, the ring
+ * the cap angle and inner ring, the concavity all three.
+ *
+ * The file is compared with what is in use, the shape as the
+ * simulation published it, not with its previous contents:
+ * saving it again undoes key edits of the settings it names.
+ * Settings it leaves out stay as they are. The shape also
+ * goes to the simulation, which owns it, so later key edits
+ * start from the file's values.
  **********************************************************/
-void timer(int value) 
+void reloadSceneFile()
 {
-    // Increase shape rotation angle
-    shapeRotationAngle += 0.5f;
-    // Wrap around if angle exceeds 360
-    if (shapeRotationAngle >= 360.f)
-        shapeRotationAngle -= 360.f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const SceneConfig live = liveSceneConfig(scene.phiMax, scene.innerRadiusFactor,
+                                             scene.concaveDepth);
+    SceneConfig next = live;
+    if (!sceneFileRead(sceneFilePath, next)) {
+        fprintf(stderr, "Scene: keeping the previous settings\n");
+        return;
+    }
+    // Out-of-range values count as changed only if the clamped one is
+    clampSpeakerShape(next.phiMax, next.innerRing, next.concavity);
+    bool light  = memcmp(next.light, live.light, sizeof(next.light)) != 0;
+    bool floor  = next.floorHeight != live.floorHeight;
+    bool capAngle  = next.phiMax != live.phiMax;
+    bool innerRing = next.innerRing != live.innerRing;
+    bool concavity = next.concavity != live.concavity;
+    bool shape  = capAngle || innerRing || concavity;
+    bool detail = next.detail != live.detail;
+
+    if (light) {
+        memcpy(lightPosition, next.light, sizeof(lightPosition));
+        shaderSetLight(sceneLight());
+    }
+    if (floor)
+        setFloorHeight(next.floorHeight);
+    if (shape) {
+        setSpeakerShape(next.phiMax, next.innerRing, next.concavity);
+        InputEvent event = { INPUT_SHAPE, 0, 0, 0, { next.phiMax, next.innerRing, next.concavity } };
+        simulationPost(event);
+    }
+    if (detail)
+        meshDetail = next.detail;
+    int rebuilt[MESH_COMPONENT_COUNT] = { 0 };
+    if ((shape || detail) && meshesNeeded())
+        updateSpeakerMeshes(rebuilt);
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // "inner-ring changed: ring x6, concave x6 (1.20 ms)"
+    static const char* const partNames[MESH_COMPONENT_COUNT] = { "cap", "ring", "concave" };
+    char changed[96] = "", work[160] = "", item[32];
+    if (light)     appendItem(changed, sizeof(changed), "light");
+    if (floor)     appendItem(changed, sizeof(changed), "floor");
+    if (capAngle)  appendItem(changed, sizeof(changed), "cap-angle");
+    if (innerRing) appendItem(changed, sizeof(changed), "inner-ring");
+    if (concavity) appendItem(changed, sizeof(changed), "concavity");
+    if (detail)    appendItem(changed, sizeof(changed), "detail");
+    if (light || floor)
+        appendItem(work, sizeof(work), "shadow matrix");
+    for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+        if (rebuilt[c] > 0) {
+            snprintf(item, sizeof(item), "%s x%d", partNames[c], rebuilt[c]);
+            appendItem(work, sizeof(work), item);
+        }
+    if ((shape || detail) && !meshesNeeded())
+        appendItem(work, sizeof(work), "no meshes on this path");
+    printf("Scene: %s: %s (%.2f ms)\n", changed[0] ? changed : "nothing changed",
+           work[0] ? work : "nothing rebuilt", ms);
+}
 
-    // Request a redisplay
-    glutPostRedisplay();
-    // Schedule the next timer call ~16ms later (~60FPS)
-    glutTimerFunc(16, timer, 0);
+/**********************************************************
+ * watchSceneFile(...) - Wakes an idle window for a reload
+ *
+ * Frames look at the file themselves, but with nothing
+ * animating no frame comes; this asks for one when the
+ * file was saved.
+ **********************************************************/
+void watchSceneFile(int)
+{
+    if (sceneWatchPending())
+        requestRedraw();
+    glutTimerFunc(SCENE_WATCH_POLL_MS, watchSceneFile, 0);
 }
 
 // --------------------------------------------------------
-// RENDERING
+// ANIMATION
 // --------------------------------------------------------
 
 /**********************************************************
- * display() - Main rendering function
+ * advanceAnimation(...) - One simulation tick of 'seconds'
+ *
+ * For --bench, which runs no simulation thread: the tick
+ * happens here, between two frames, so every run draws the
+ * same images.
  **********************************************************/
-void display() 
+void advanceAnimation(double seconds)
 {
-    // Clear the color and depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    simulationStep(seconds);
+}
 
-    // Work with the modelview matrix
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+/**********************************************************
+ * sceneAnimating() - Does the picture change on its own?
+ *
+ * If not, no further frames are scheduled until input. An
+ * input still on its way to the simulation thread, or a
+ * view between two ticks, needs a few frames more.
+ **********************************************************/
+bool sceneAnimating()
+{
+    return scene.autoSpin || (scene.audioReactive && analysisRunning()) ||
+           simulationSettling();
+}
 
-    // Compute camera position from our polar angles and distance
-    float cameraX = distance * cosf(cameraAngleX * M_PI / 180.f) * cosf(cameraAngleY * M_PI / 180.f);
-    float cameraY = distance * sinf(cameraAngleX * M_PI / 180.f) * cosf(cameraAngleY * M_PI / 180.f);
-    float cameraZ = distance * sinf(cameraAngleY * M_PI / 180.f);
+/**********************************************************
+ * updateSceneView() - This frame's state from the simulation
+ *
+ * GL state behind a toggle and the meshes behind the shape
+ * are only touched when they changed. Also picks up a saved
+ * scene file.
+ **********************************************************/
+void updateSceneView()
+{
+    bool smooth = scene.smoothShading, depthTest = scene.depthTestEnabled;
+    unsigned long shapeVersion = scene.shapeVersion;
+    simulationView(scene);
+
+    if (scene.smoothShading != smooth)
+        stateShadeModel(scene.smoothShading ? GL_SMOOTH : GL_FLAT);
+    if (scene.depthTestEnabled != depthTest)
+        stateEnable(GL_DEPTH_TEST, scene.depthTestEnabled);
+    if (scene.shapeVersion != shapeVersion)
+        setSpeakerShape(scene.phiMax, scene.innerRadiusFactor, scene.concaveDepth);
+
+    // --scene: saved since the last frame
+    if (sceneWatchChanged())
+        reloadSceneFile();
+}
 
-    // Place camera at (cameraX,cameraY,cameraZ), looking at origin (0,0,0), with up = (0,0,1)
-    gluLookAt(cameraX, cameraY, cameraZ,
-              0.0, 0.0, 0.0,
-              0.0, 0.0, 1.0);
+/**********************************************************
+ * drawFlattenedSpeaker() - Shadow by re-drawing the whole
+ *    speaker through the shadow matrix
+ **********************************************************/
+void drawFlattenedSpeaker()
+{
+    mat4 caller = shaderModelview();
+    // view * shadow projection * offset * user rotations
+    mat4 m = frame.shadow;
+    // Automatic spin (array speakers spin individually)
+    if (speakerCount == 0)
+        mat4Rotate(m, scene.shapeRotationAngle, 0, 0, 1);
+    shaderSetModelview(m);
+
+    // Redraw the same geometry -> it now appears flattened on the plane
+    drawSpeaker(true);
+
+    shaderSetModelview(caller);
+}
+
+/**********************************************************
+ * drawSilhouette() - Shadow from the projected outline
+ *
+ * Same placement as drawFlattenedSpeaker() (offset, user and
+ * automatic rotations), but only the outline is projected.
+ * Returns false if no outline could be built.
+ **********************************************************/
+bool drawSilhouette()
+{
+    ShadowPoint* outline;   // In the frame arena
+    int outlineCount;
+
+    mat4 objectMatrix;
+    buildObjectMatrix(objectMatrix, -0.5f, 2.0f, 0.0f,
+                      scene.rotationX, scene.rotationY, scene.shapeRotationAngle);
+    int outlineSteps = 2 * lodLevels[speakerLodLevel].uSteps * meshDetail;
+    if (!buildSilhouetteShadow(objectMatrix, frame.shadowMatrix, lightPosition, planeFloor,
+                               phi_max, scene.capPump, outlineSteps, &outline, &outlineCount))
+        return false;
+
+    // The outline is already in world space: only the view applies
+    drawShadowOutline(outline, outlineCount);
+    return true;
+}
 
-    // 1) Draw the floor
+/**********************************************************
+ * speakerPartProgram() - Program the speaker parts use
+ *
+ * Part of the draw list state, so items are sorted by it.
+ **********************************************************/
+GLuint speakerPartProgram()
+{
+    if (speakerPath == PATH_IMMEDIATE)
+        return 0;
+    if (speakerCount > 0)
+        return speakerArrayProgram();
+    return speakerPath == PATH_PROCEDURAL ? proceduralSpeakerProgram() : 0;
+}
+
+/**********************************************************
+ * draw*Item(...) - Draw list callbacks of renderScene()
+ **********************************************************/
+void drawFloorItem(const DrawItem&)
+{
     drawFoundation();
+}
+
+void drawPartItem(const DrawItem& item)
+{
+    drawSpeakerPart((MeshComponent)item.arg, false);
+}
+
+void drawShadowItem(const DrawItem&)
+{
+    // Every shadow pixel is written once: the first write bumps
+    // the stencil value, so overlapping triangles (or a later
+    // blended shadow) never darken a pixel twice
+    glStencilFunc(GL_EQUAL, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    // The outline is only used for the single speaker; arrays
+    // keep flattening their (LOD-reduced) instanced meshes
+    if (speakerCount > 0 || shadowMode != SHADOW_SILHOUETTE ||
+        !drawSilhouette())
+        drawFlattenedSpeaker();
+}
+
+/**********************************************************
+ * renderScene() - Draws the whole frame into the current
+ *    framebuffer (window or offscreen FBO)
+ **********************************************************/
+void renderScene()
+{
+    resetFrameStats();
+    resetStateStats();
+
+    // --render-load: stand-in for a much heavier scene
+    if (renderLoadMs > 0.0f) {
+        ProfileScope scope(STAGE_LOAD);
+        applyRenderLoad();
+    }
+
+    // Camera, rotations, pump and toggles for this frame
+    updateSceneView();
+
+    // Clear the color, depth and stencil buffers
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // Compute camera position from our polar angles and distance
+    float cameraX = scene.distance * cosf(scene.cameraAngleX * M_PI / 180.f) * cosf(scene.cameraAngleY * M_PI / 180.f);
+    float cameraY = scene.distance * sinf(scene.cameraAngleX * M_PI / 180.f) * cosf(scene.cameraAngleY * M_PI / 180.f);
+    float cameraZ = scene.distance * sinf(scene.cameraAngleY * M_PI / 180.f);
+
+    // Place camera at (cameraX,cameraY,cameraZ), looking at origin (0,0,0), with up = (0,0,1)
+    float target[3] = { 0.0f, 0.0f, 0.0f };
+    if (cameraPose.active) {
+        // --fly: the bench moves the camera itself
+        cameraX = cameraPose.eye[0];
+        cameraY = cameraPose.eye[1];
+        cameraZ = cameraPose.eye[2];
+        target[0] = cameraPose.target[0];
+        target[1] = cameraPose.target[1];
+        target[2] = cameraPose.target[2];
+    }
+    float eye[3] = { cameraX, cameraY, cameraZ };
+    float up[3]  = { 0.0f, 0.0f, 1.0f };
+    mat4 view;
+    mat4LookAt(view, eye, target, up);
+    shaderSetModelview(view);
+
+    // Shadow projection and the rotated frames, composed once
+    composeFrameTransforms(view);
+
+    // Leave out what neither shows nor casts a visible shadow
+    float cameraLocal[3];
+    cameraInArrayFrame(cameraX, cameraY, cameraZ, cameraLocal);
+    updateVisibility(cameraLocal);
+    // Choose how finely to tessellate, based on screen size
+    updateLevelsOfDetail(cameraLocal);
+    // Pick up shape edits (nothing to do unless one changed)
+    if (meshesNeeded())
+        updateSpeakerMeshes();
+    // Pan every audio source to where its speaker is seen
+    updateAudioPanning(cameraX, cameraY, cameraZ);
+
+    // Everything below is recorded, then drawn sorted by state
+    drawListBegin();
+
+    // 1) Draw the floor: lit, white, untextured
+    DrawState floorState = { 0, 0, true, false, { 1.0f, 1.0f, 1.0f, 1.0f } };
+    drawListSubmit(DRAW_LAYER_OPAQUE, floorState, view, drawFloorItem, 0, STAGE_FLOOR);
 
     // 2) Draw main 3D geometry
-    glPushMatrix(); 
-      // Apply user-driven rotation from mouse
-      glRotatef(rotationX, 1, 0, 0);
-      glRotatef(rotationY, 0, 1, 0);
-      // Apply automatic spinning
-      glRotatef(shapeRotationAngle, 0, 0, 1);
-
-      // Draw spherical cap, ring, and concave center
-      drawSphericalCap(100, 50);      // subdiv = 100x50
-      drawFlatOuterRing(100);
-      drawConcaveInnerCircle(100, 20);
-    glPopMatrix();
-
-    // 3) Draw the shadow
-    GLfloat shadowMatrix[16];
-    // Compute matrix that projects onto planeFloor from lightPosition
-    computeShadowMatrix(shadowMatrix, lightPosition, planeFloor);
-
-    // Disable lighting & texture for a solid black silhouette
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glColor3f(0.0f, 0.0f, 0.0f);
-
-    glPushMatrix();
-      // Multiply current matrix by the shadow projection matrix
-      glMultMatrixf(shadowMatrix);
-
-      // Optional: offset the shadow slightly
-      glTranslatef(-0.5f, 2.0f, 0.0f);
-
-      // Apply same user & automatic rotations
-      glRotatef(rotationX, 1, 0, 0);
-      glRotatef(rotationY, 0, 1, 0);
-      glRotatef(shapeRotationAngle, 0, 0, 1);
-
-      // Redraw the same geometry -> it now appears flattened on the plane
-      drawSphericalCap(100, 50);
-      drawFlatOuterRing(100);
-      drawConcaveInnerCircle(100, 20);
-
-    glPopMatrix();
-
-    // Re-enable lighting, and if texture was on, re-enable it
-    glEnable(GL_LIGHTING);
-    if(textureEnabled) glEnable(GL_TEXTURE_2D);
+    DrawState partState = { speakerPartProgram(), scene.textureEnabled ? textureID : 0,
+                            true, false, { 1.0f, 1.0f, 1.0f, 1.0f } };
+    // User-driven rotation from mouse (frame.body), then
+    // automatic spinning (array speakers spin individually)
+    mat4 body = frame.body;
+    if (speakerCount == 0)
+        mat4Rotate(body, scene.shapeRotationAngle, 0, 0, 1);
+
+    // Spherical cap, ring, and concave center, each timed
+    // as its own stage
+    static const ProfileStage litStages[MESH_COMPONENT_COUNT] = {
+        STAGE_CAP, STAGE_RING, STAGE_CONCAVE
+    };
+    if (singleBodyVisible)
+        for (int c = 0; c < MESH_COMPONENT_COUNT; ++c)
+            drawListSubmit(DRAW_LAYER_OPAQUE, partState, body, drawPartItem, c, litStages[c]);
+
+    // 3) Draw the shadow (its matrix was computed for the culling)
+    // No lighting and no texture for a solid black silhouette
+    DrawState shadowState = { 0, 0, false, true, { 0.0f, 0.0f, 0.0f, 1.0f } };
+    if (singleShadowVisible)
+        drawListSubmit(DRAW_LAYER_SHADOW, shadowState, view, drawShadowItem, 0, STAGE_SHADOW_DRAW);
+
+    drawListFlush();
+
+    // 4) --occlusion: query the grid cells against this frame's
+    // depth buffer, for the next frame's culling
+    if (cullEnabled && cullOcclusion && speakerCount > 0 && scene.depthTestEnabled) {
+        ProfileScope scope(STAGE_OCCLUSION);
+        stateUseProgram(0);
+        stateEnable(GL_LIGHTING, false);
+        stateEnable(GL_TEXTURE_2D, false);
+        stateEnable(GL_STENCIL_TEST, false);
+        cullIssueQueries(frame.body.m, frame.shadow.m);
+    }
+}
+
+/**********************************************************
+ * display() - Main rendering function
+ **********************************************************/
+void display() 
+{
+    // The animation runs on the simulation thread; renderScene()
+    // picks up where it is
+    schedulerBeginFrame();
+
+    profilerBeginFrame();
+    renderScene();
+    profilerDrawHud(windowWidth, windowHeight);
+
+    // --record: queue the readback of what is about to be shown
+    if (recorderActive()) {
+        ProfileScope scope(STAGE_CAPTURE);
+        recorderCapture(windowWidth, windowHeight);
+    }
 
     // Swap front/back buffers (double buffering)
-    glutSwapBuffers();
+    {
+        ProfileScope scope(STAGE_SWAP);
+        glutSwapBuffers();
+    }
+    profilerEndFrame();
+    // Everything transient of this frame goes at once
+    arenaReset();
+
+    // How long the start took, with or without cached programs
+    static bool firstFrameShown = false;
+    if (!firstFrameShown) {
+        firstFrameShown = true;
+        fprintf(stderr, "Startup: first frame %.1f ms after initGL (programs: %d from cache, "
+                "%d compiled in %.1f ms)\n", msSinceInitGL(), programCacheStats.loaded,
+                programCacheStats.compiled, programCacheStats.buildMs);
+    }
+
+    // Arm the next frame, or go idle until input
+    schedulerEndFrame(sceneAnimating());
 }
 
 /**********************************************************
@@ -513,53 +1397,80 @@ void reshape(int w, int h)
 {
     // Avoid divide-by-zero if height is 0
     if (h == 0) h = 1;
+    windowWidth  = w;
+    windowHeight = h;
     // Reset the viewport to match new window size
     glViewport(0, 0, w, h);
 
-    // Switch to projection matrix to set up perspective
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
     // Set perspective with 45° FOV, aspect ratio = w/h, near=1, far=100
-    gluPerspective(45.0, (float)w/(float)h, 1.0, 100.0);
-
-    // Return to modelview for subsequent transforms
-    glMatrixMode(GL_MODELVIEW);
+    mat4 projection;
+    mat4Perspective(projection, fieldOfViewY, (float)w/(float)h, 1.0f, 100.0f);
+    shaderSetProjection(projection);
 }
 
 // --------------------------------------------------------
 // INPUT HANDLING
 // --------------------------------------------------------
 
+/**********************************************************
+ * postKey(...) - Scene key for the simulation thread
+ **********************************************************/
+void postKey(unsigned char key)
+{
+    InputEvent event = { INPUT_KEY, key, 0, 0, { 0, 0, 0 } };
+    simulationPost(event);
+}
+
 /**********************************************************
  * keyboard(...) - Handle normal key presses
+ *
+ * Keys that pick how the scene is drawn are handled here;
+ * keys that change the scene itself are queued for the
+ * simulation thread (see simulation.h).
  **********************************************************/
 void keyboard(unsigned char key, int x, int y) 
 {
     switch(key) {
         // ESC: exit
         case 27:
+            simulationStop();
+            profilerDrain();   // The trace file is finished at exit
+            schedulerPrintStats();
+            simulationPrintStats();
+            audioPrintStats();
+            audioStop();
+            cpuLoadStop();
+            recorderStop();
+            recorderPrintStats();
             exit(0);
             break;
-        // 't': toggle texture
-        case 't':
-            textureEnabled = !textureEnabled;
+        // 'h': toggle the profiler HUD (turns timing on)
+        case 'h':
+            profilerHud = !profilerHud;
+            if (profilerHud) profilerEnabled = true;
+            break;
+        // 'o': toggle silhouette vs. full-mesh shadow
+        case 'o':
+            shadowMode = (shadowMode == SHADOW_SILHOUETTE) ? SHADOW_MESH : SHADOW_SILHOUETTE;
             break;
-        // 's': toggle shading mode
-        case 's':
-            smoothShading = !smoothShading;
-            glShadeModel(smoothShading ? GL_SMOOTH : GL_FLAT);
+        // 'l': toggle level of detail (off = always finest)
+        case 'l':
+            lodEnabled = !lodEnabled;
             break;
-        // 'd': toggle depth test
-        case 'd':
-            depthTestEnabled = !depthTestEnabled;
-            if(depthTestEnabled) glEnable(GL_DEPTH_TEST);
-            else                 glDisable(GL_DEPTH_TEST);
+        // 'm': retained meshes -> immediate mode -> procedural
+        case 'm':
+            speakerPath = (SpeakerPath)((speakerPath + 1) % PATH_COUNT);
+            if (speakerPath == PATH_PROCEDURAL && !proceduralAvailable)
+                speakerPath = PATH_RETAINED;
+            printf("Speaker path: %s\n", speakerPathName(speakerPath));
             break;
+        // 't', 's', 'd', shape keys, Space, 'a': scene state
         default:
+            postKey(key);
             break;
     }
     // Request a redraw after changing settings
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 /**********************************************************
@@ -567,19 +1478,21 @@ void keyboard(unsigned char key, int x, int y)
  **********************************************************/
 void specialKeys(int key, int x, int y) 
 {
-    const float angleStep = 5.0f; // Degrees per key press
+    // One camera step per press; the simulation applies it
+    InputEvent event = { INPUT_ORBIT, 0, 0, 0, { 0, 0, 0 } };
     if(key == GLUT_KEY_LEFT) {
-        cameraAngleX -= angleStep;
+        event.dx = -1;
     } else if(key == GLUT_KEY_RIGHT) {
-        cameraAngleX += angleStep;
+        event.dx = 1;
     } else if(key == GLUT_KEY_UP) {
-        cameraAngleY += angleStep;
-        if(cameraAngleY > 89.f) cameraAngleY = 89.f; // Avoid flipping
+        event.dy = 1;
     } else if(key == GLUT_KEY_DOWN) {
-        cameraAngleY -= angleStep;
-        if(cameraAngleY < -89.f) cameraAngleY = -89.f;
+        event.dy = -1;
+    } else {
+        return;
     }
-    glutPostRedisplay();
+    simulationPost(event);
+    requestRedraw();
 }
 
 /**********************************************************
@@ -611,16 +1524,17 @@ void mouseMotion(int x, int y)
         int dx = x - lastMouseX;
         int dy = y - lastMouseY;
 
-        // Update rotation angles based on mouse movement
-        rotationX += dy * 0.5f;
-        rotationY += dx * 0.5f;
+        // The simulation turns this into rotation angles
+        InputEvent event = { INPUT_DRAG, 0, dx, dy, { 0, 0, 0 } };
+        simulationPost(event);
 
         // Remember new mouse position
         lastMouseX = x;
         lastMouseY = y;
 
-        // Request redraw
-        glutPostRedisplay();
+        // Request a redraw; a burst of motion events
+        // before the next frame slot gives one frame
+        requestRedraw();
     }
 }
 
@@ -628,15 +1542,377 @@ void mouseMotion(int x, int y)
 // MAIN FUNCTION
 // --------------------------------------------------------
 
+/**********************************************************
+ * printUsage(...) - Command-line help
+ **********************************************************/
+void printUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --bench N      Render N frames offscreen (no window) and print timings\n");
+    printf("  --json         With --bench: print the results as one JSON object\n");
+    printf("  --size WxH     With --bench: offscreen target size (default 800x600)\n");
+    printf("  --morph        With --bench: change the cap angle every frame\n");
+    printf("  --fly          With --bench: fly low across the speaker array\n");
+    printf("  --immediate    Use the old immediate-mode drawing instead of meshes\n");
+    printf("  --path NAME    Speaker drawing: retained (default), immediate or procedural\n");
+    printf("  --no-lod       Always draw the finest tessellation\n");
+    printf("  --shadow MODE  'silhouette' (default) or 'mesh' planar shadow\n");
+    printf("  --speakers N   Draw an instanced array of N speakers (1..%d)\n", MAX_SPEAKERS);
+    printf("  --no-cull      Draw every speaker and shadow, in view or not\n");
+    printf("  --occlusion    Also skip array cells hidden in the previous frame\n");
+    printf("  --culler KIND  Sphere test kernel: avx, sse2 or scalar\n");
+    printf("  --matrix KIND  Matrix product kernel: avx, sse2 or scalar\n");
+    printf("  --matrix-bench N  Time composing N instance matrices per kernel and exit\n");
+    printf("  --profile      Time every render stage (CPU + GPU queries)\n");
+    printf("  --trace FILE   Write a Chrome trace_event JSON file (implies --profile)\n");
+    printf("  --wav FILE     Stream a WAV file through SDL2 audio; repeat to mix several\n");
+    printf("  --sources N    Mix N sources (file k %% files), source k on speaker k (max %d)\n",
+           MIXER_MAX_SOURCES);
+    printf("  --mixer KIND   Mix kernel: avx, sse2 or scalar\n");
+    printf("  --mix-bench N  Time the mix of N synthetic sources per callback and exit\n");
+    printf("  --loop         With --wav: restart the file at its end\n");
+    printf("  --no-react     With --wav: no FFT analysis, the speaker does not pump\n");
+    printf("  --fft KIND     FFT kernel for the analysis: avx, sse2 or scalar\n");
+    printf("  --audio-driver NAME   SDL audio driver, e.g. 'dummy' or 'disk' for offline runs\n");
+    printf("  --audio-buffer N      Frames per audio callback, a power of two (default %d)\n",
+           AUDIO_DEFAULT_DEVICE_FRAMES);
+    printf("  --audio-ring N        Frames decoded ahead of playback (default %d)\n",
+           AUDIO_DEFAULT_RING_FRAMES);
+    printf("  --audio-rate HZ       Device sample rate (default: the first file's)\n");
+    printf("  --resample Q          Conversion of other rates: fast, medium (default) or best\n");
+    printf("  --resample-bench N    Time the resampler on N s of audio per case, print THD+N, exit\n");
+    printf("  --audio-csv BASE      Write every callback's timing to BASE-callbacks.csv and\n"
+           "                        BASE-histograms.csv when audio stops\n");
+    printf("  --audio-histograms    Print callback interval, time and ring fill histograms\n");
+    printf("  --render-load MS      Keep the render thread busy for MS ms in every frame\n");
+    printf("  --cpu-load N          N background threads that keep the CPU busy\n");
+    printf("  --cap-angle DEG       Angle of the spherical cap (default 135)\n");
+    printf("  --inner-ring F        Inner ring radius / outer radius (default 0.4)\n");
+    printf("  --concavity D         Depth of the concave center (default 0.1)\n");
+    printf("  --tessellator KIND    Vertex kernel: avx2, sse2, table or scalar\n");
+    printf("  --tess-bench UxV      Time the vertex kernels for a UxV speaker and exit\n");
+    printf("  --detail N            Tessellation x N at every level of detail (1..%d)\n", MAX_MESH_DETAIL);
+    printf("  --scene FILE          Light, floor and shape from FILE, reloaded when it is saved\n");
+    printf("  --mesh-cache DIR      Mesh cache directory (default $XDG_CACHE_HOME/orator)\n");
+    printf("  --no-mesh-cache       Always tessellate at startup\n");
+    printf("  --program-cache DIR   Shader binary cache directory (default: as the mesh cache)\n");
+    printf("  --no-program-cache    Always compile the shaders at startup\n");
+    printf("  --startup-bench N     Time N mesh startups: no cache, cold and cached\n");
+    printf("  --record DIR          Write every frame to DIR/frame-NNNNNN.ppm\n");
+    printf("  --record-format FMT   'ppm' (default) or 'png'\n");
+    printf("  --record-threads N    Encoder threads (default: cores - 1, max %d)\n", RECORD_MAX_WORKERS);
+    printf("  --fps N        Frame rate while animating (default %d)\n", SCHEDULER_DEFAULT_FPS);
+    printf("  --vsync        Pace animation by the display refresh instead\n");
+    printf("  --tick-rate HZ Simulation ticks per second (default %d)\n", SIM_DEFAULT_TICK_RATE);
+    printf("  --help         Show this text\n");
+}
+
 /**********************************************************
  * main(...) - Program entry point
  **********************************************************/
 int main(int argc, char** argv)
 {
+    // 0) Parse our own options; anything else is left for GLUT
+    BenchOptions bench = { 0, 30, 800, 600, false, false, false };
+    AudioOptions audio = { std::vector<const char*>(), 0, NULL, 0, RESAMPLE_MEDIUM,
+                           AUDIO_DEFAULT_DEVICE_FRAMES, AUDIO_DEFAULT_RING_FRAMES, false, true,
+                           NULL, false };
+    int tessBenchU = 0, tessBenchV = 0;
+    int startupRuns = 0;
+    int mixBenchSources = 0;
+    int matrixBenchCount = 0;
+    int resampleBenchSeconds = 0;
+    int cpuLoad = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench.frames = atoi(argv[++i]);
+            if (bench.frames <= 0) {
+                fprintf(stderr, "--bench needs a positive frame count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--json") == 0) {
+            bench.json = true;
+        } else if (strcmp(argv[i], "--morph") == 0) {
+            bench.morph = true;
+        } else if (strcmp(argv[i], "--fly") == 0) {
+            bench.fly = true;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &bench.width, &bench.height) != 2 ||
+                bench.width <= 0 || bench.height <= 0) {
+                fprintf(stderr, "--size expects WxH, e.g. 1920x1080\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--immediate") == 0) {
+            speakerPath = PATH_IMMEDIATE;
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            int path = 0;
+            while (path < PATH_COUNT && strcmp(name, speakerPathName((SpeakerPath)path)) != 0)
+                path++;
+            if (path == PATH_COUNT) {
+                fprintf(stderr, "--path expects 'retained', 'immediate' or 'procedural'\n");
+                return 1;
+            }
+            speakerPath = (SpeakerPath)path;
+        } else if (strcmp(argv[i], "--no-lod") == 0) {
+            lodEnabled = false;
+        } else if (strcmp(argv[i], "--shadow") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "mesh") == 0) {
+                shadowMode = SHADOW_MESH;
+            } else if (strcmp(mode, "silhouette") == 0) {
+                shadowMode = SHADOW_SILHOUETTE;
+            } else {
+                fprintf(stderr, "--shadow expects 'mesh' or 'silhouette'\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--speakers") == 0 && i + 1 < argc) {
+            requestedSpeakers = atoi(argv[++i]);
+            if (requestedSpeakers < 1 || requestedSpeakers > MAX_SPEAKERS) {
+                fprintf(stderr, "--speakers must be between 1 and %d\n", MAX_SPEAKERS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-cull") == 0) {
+            cullEnabled = false;
+        } else if (strcmp(argv[i], "--occlusion") == 0) {
+            cullOcclusion = true;
+        } else if (strcmp(argv[i], "--culler") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            CullBackend want = strcmp(name, "scalar") == 0 ? CULL_SCALAR
+                             : strcmp(name, "sse2") == 0   ? CULL_SSE2 : CULL_AVX;
+            CullBackend got = cullSetBackend(want);
+            if (got != want)
+                fprintf(stderr, "--culler %s not supported here, using %s\n", name, cullBackendName(got));
+        } else if (strcmp(argv[i], "--matrix") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            Mat4Backend want = strcmp(name, "scalar") == 0 ? MAT4_SCALAR
+                             : strcmp(name, "sse2") == 0   ? MAT4_SSE2 : MAT4_AVX;
+            Mat4Backend got = mat4SetBackend(want);
+            if (got != want)
+                fprintf(stderr, "--matrix %s not supported here, using %s\n", name, mat4BackendName(got));
+        } else if (strcmp(argv[i], "--matrix-bench") == 0 && i + 1 < argc) {
+            matrixBenchCount = atoi(argv[++i]);
+            if (matrixBenchCount < 1 || matrixBenchCount > MAX_SPEAKERS) {
+                fprintf(stderr, "--matrix-bench must be between 1 and %d instances\n", MAX_SPEAKERS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profilerEnabled = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            if (!profilerOpenTrace(argv[++i]))
+                return 1;
+        } else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            audio.wavPaths.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--sources") == 0 && i + 1 < argc) {
+            audio.sources = atoi(argv[++i]);
+            if (audio.sources < 1 || audio.sources > MIXER_MAX_SOURCES) {
+                fprintf(stderr, "--sources must be between 1 and %d\n", MIXER_MAX_SOURCES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--mixer") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            MixBackend want = strcmp(name, "scalar") == 0 ? MIX_SCALAR
+                            : strcmp(name, "sse2") == 0   ? MIX_SSE2 : MIX_AVX;
+            MixBackend got = mixSetBackend(want);
+            if (got != want)
+                fprintf(stderr, "--mixer %s not supported here, using %s\n", name, mixBackendName(got));
+        } else if (strcmp(argv[i], "--mix-bench") == 0 && i + 1 < argc) {
+            mixBenchSources = atoi(argv[++i]);
+            if (mixBenchSources < 1 || mixBenchSources > MIXER_MAX_SOURCES) {
+                fprintf(stderr, "--mix-bench must be between 1 and %d sources\n", MIXER_MAX_SOURCES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--no-react") == 0) {
+            audio.analysis = false;
+            scene.audioReactive = false;
+        } else if (strcmp(argv[i], "--fft") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            FftBackend want = strcmp(name, "scalar") == 0 ? FFT_SCALAR
+                            : strcmp(name, "sse2") == 0   ? FFT_SSE2 : FFT_AVX;
+            FftBackend got = fftSetBackend(want);
+            if (got != want)
+                fprintf(stderr, "--fft %s not supported here, using %s\n", name, fftBackendName(got));
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            audio.loop = true;
+        } else if (strcmp(argv[i], "--audio-driver") == 0 && i + 1 < argc) {
+            audio.driver = argv[++i];
+        } else if (strcmp(argv[i], "--audio-buffer") == 0 && i + 1 < argc) {
+            audio.deviceFrames = atoi(argv[++i]);
+            if (audio.deviceFrames < 16 || audio.deviceFrames > 32768 ||
+                (audio.deviceFrames & (audio.deviceFrames - 1)) != 0) {
+                fprintf(stderr, "--audio-buffer must be a power of two between 16 and 32768\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--audio-ring") == 0 && i + 1 < argc) {
+            audio.ringFrames = atoi(argv[++i]);
+            if (audio.ringFrames < audio.deviceFrames) {
+                fprintf(stderr, "--audio-ring must hold at least one audio buffer\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--audio-rate") == 0 && i + 1 < argc) {
+            audio.sampleRate = atoi(argv[++i]);
+            if (audio.sampleRate < 8000 || audio.sampleRate > 384000) {
+                fprintf(stderr, "--audio-rate must be between 8000 and 384000 Hz\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resample") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (strcmp(name, "fast") == 0) {
+                audio.resampleQuality = RESAMPLE_FAST;
+            } else if (strcmp(name, "medium") == 0) {
+                audio.resampleQuality = RESAMPLE_MEDIUM;
+            } else if (strcmp(name, "best") == 0) {
+                audio.resampleQuality = RESAMPLE_BEST;
+            } else {
+                fprintf(stderr, "--resample expects 'fast', 'medium' or 'best'\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resample-bench") == 0 && i + 1 < argc) {
+            resampleBenchSeconds = atoi(argv[++i]);
+            if (resampleBenchSeconds < 1) {
+                fprintf(stderr, "--resample-bench needs a positive number of seconds\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--audio-csv") == 0 && i + 1 < argc) {
+            audio.timingCsv = argv[++i];
+        } else if (strcmp(argv[i], "--audio-histograms") == 0) {
+            audio.timingHistograms = true;
+        } else if (strcmp(argv[i], "--render-load") == 0 && i + 1 < argc) {
+            renderLoadMs = (float)atof(argv[++i]);
+            if (renderLoadMs < 0.0f || renderLoadMs > 1000.0f) {
+                fprintf(stderr, "--render-load must be between 0 and 1000 ms\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cpu-load") == 0 && i + 1 < argc) {
+            cpuLoad = atoi(argv[++i]);
+            if (cpuLoad < 0 || cpuLoad > SYNTH_LOAD_MAX_THREADS) {
+                fprintf(stderr, "--cpu-load must be between 0 and %d threads\n", SYNTH_LOAD_MAX_THREADS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            schedulerFps = atoi(argv[++i]);
+            if (schedulerFps < 1 || schedulerFps > 1000) {
+                fprintf(stderr, "--fps must be between 1 and 1000\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--vsync") == 0) {
+            schedulerVsync = true;
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            simulationTickRate = atoi(argv[++i]);
+            if (simulationTickRate < 10 || simulationTickRate > 1000) {
+                fprintf(stderr, "--tick-rate must be between 10 and 1000\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cap-angle") == 0 && i + 1 < argc) {
+            setSpeakerShape(atof(argv[++i]) * M_PI / 180.0, innerRadiusFactor, concaveDepth);
+        } else if (strcmp(argv[i], "--inner-ring") == 0 && i + 1 < argc) {
+            setSpeakerShape(phi_max, atof(argv[++i]), concaveDepth);
+        } else if (strcmp(argv[i], "--concavity") == 0 && i + 1 < argc) {
+            setSpeakerShape(phi_max, innerRadiusFactor, atof(argv[++i]));
+        } else if (strcmp(argv[i], "--tessellator") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            TessBackend want = strcmp(name, "scalar") == 0 ? TESS_SCALAR
+                             : strcmp(name, "table") == 0  ? TESS_TABLE
+                             : strcmp(name, "sse2") == 0   ? TESS_SSE2 : TESS_AVX2;
+            TessBackend got = tessSetBackend(want);
+            if (got != want)
+                fprintf(stderr, "--tessellator %s not supported here, using %s\n", name, tessBackendName(got));
+        } else if (strcmp(argv[i], "--tess-bench") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &tessBenchU, &tessBenchV) != 2 ||
+                tessBenchU < 3 || tessBenchV < 1) {
+                fprintf(stderr, "--tess-bench expects UxV, e.g. 4096x2048\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--detail") == 0 && i + 1 < argc) {
+            meshDetail = atoi(argv[++i]);
+            if (meshDetail < 1 || meshDetail > MAX_MESH_DETAIL) {
+                fprintf(stderr, "--detail must be between 1 and %d\n", MAX_MESH_DETAIL);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            sceneFilePath = argv[++i];
+        } else if (strcmp(argv[i], "--mesh-cache") == 0 && i + 1 < argc) {
+            meshCacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-mesh-cache") == 0) {
+            meshCacheDir = "";
+        } else if (strcmp(argv[i], "--program-cache") == 0 && i + 1 < argc) {
+            programCacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-program-cache") == 0) {
+            programCacheDir = "";
+        } else if (strcmp(argv[i], "--startup-bench") == 0 && i + 1 < argc) {
+            startupRuns = atoi(argv[++i]);
+            if (startupRuns <= 0) {
+                fprintf(stderr, "--startup-bench needs a positive run count\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordOptions.dir = argv[++i];
+        } else if (strcmp(argv[i], "--record-format") == 0 && i + 1 < argc) {
+            const char* format = argv[++i];
+            if (strcmp(format, "png") == 0) {
+                recordOptions.format = RECORD_PNG;
+            } else if (strcmp(format, "ppm") == 0) {
+                recordOptions.format = RECORD_PPM;
+            } else {
+                fprintf(stderr, "--record-format expects 'ppm' or 'png'\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+            recordOptions.workers = atoi(argv[++i]);
+            if (recordOptions.workers < 1 || recordOptions.workers > RECORD_MAX_WORKERS) {
+                fprintf(stderr, "--record-threads must be between 1 and %d\n", RECORD_MAX_WORKERS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        }
+    }
+
+    // Scene file over the defaults and options
+    if (sceneFilePath && !loadSceneFile())
+        return 1;
+
+    // Vertex kernel comparison: CPU only, no GL at all
+    if (tessBenchU > 0)
+        return runTessBenchmark(tessBenchU, tessBenchV, bench.json);
+    // Mixer kernels on synthetic sources: no GL, no audio device
+    if (mixBenchSources > 0)
+        return runMixBenchmark(mixBenchSources, audio.deviceFrames, bench.json);
+    // Matrix kernels: CPU only
+    if (matrixBenchCount > 0)
+        return runMatrixBenchmark(matrixBenchCount, bench.json);
+    // Sample-rate converter: CPU only
+    if (resampleBenchSeconds > 0)
+        return runResampleBenchmark(resampleBenchSeconds, bench.json);
+    // Mesh cache comparison: offscreen GL, no frames drawn
+    if (startupRuns > 0)
+        return runStartupBenchmark(startupRuns, bench.json);
+
+    // The scene starts from the defaults and options above
+    scene.phiMax            = phi_max;
+    scene.innerRadiusFactor = innerRadiusFactor;
+    scene.concaveDepth      = concaveDepth;
+    simulationInit(scene);
+
+    // Sound runs on its own threads, in both window and bench mode
+    if (!audio.wavPaths.empty() && !audioStart(audio))
+        fprintf(stderr, "Continuing without audio\n");
+    if (cpuLoad > 0)
+        cpuLoadStart(cpuLoad);
+
+    // Headless benchmark: no GLUT window at all
+    if (bench.frames > 0) {
+        int status = runBenchmark(bench);
+        audioStop();
+        cpuLoadStop();
+        return status;
+    }
+
     // 1) Initialize GLUT
     glutInit(&argc, argv);
-    // Double-buffered, RGB color, with a depth buffer
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    // Double-buffered, RGB color, with depth and stencil buffers
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_STENCIL);
     // Initial window size
     glutInitWindowSize(800, 600);
     // Create a window with a title
@@ -644,6 +1920,13 @@ int main(int argc, char** argv)
 
     // 2) Initialize OpenGL states (texture, lighting, etc.)
     initGL();
+    // Frame pacing (vsync or timer)
+    schedulerInit();
+    // Camera, animation and input ticks from here on
+    simulationStart();
+    // Reloads while idle (frames check the file themselves)
+    if (sceneFilePath)
+        glutTimerFunc(SCENE_WATCH_POLL_MS, watchSceneFile, 0);
 
     // 3) Register GLUT callbacks
     glutDisplayFunc(display);     // Called to draw each frame
@@ -653,8 +1936,8 @@ int main(int argc, char** argv)
     glutMouseFunc(mouseButton);   // Mouse clicks
     glutMotionFunc(mouseMotion);  // Mouse dragging
 
-    // 4) Start a timer to rotate shape at about 60fps (16ms)
-    glutTimerFunc(16, timer, 0);
+    // 4) No timer here: the first display() arms the next frame
+    //    while something animates (see scheduler.h)
 
     // 5) Enter the infinite main loop
     //    (GLUT will now handle window events and call callbacks)
@@ -0,0 +1,83 @@
+/**********************************************************
+ *  Orator - orator.h
+ *
+ *  Entry points of the main application (orator.cpp) that
+ *  other modules, such as the offscreen benchmark, call.
+ **********************************************************/
+#ifndef ORATOR_H
+#define ORATOR_H
+
+#include "mesh.h"      // MeshParams
+#include "meshcache.h" // MeshCacheResult
+#include "lod.h"       // LOD_LEVELS
+
+#include <string>
+
+// --detail: largest tessellation multiplier
+#define MAX_MESH_DETAIL 16
+
+// How the speaker parts are drawn
+enum SpeakerPath {
+    PATH_RETAINED = 0,   // VBO/IBO meshes (mesh.h)
+    PATH_IMMEDIATE,      // The original glBegin/glEnd code
+    PATH_PROCEDURAL,     // Vertex shader from gl_VertexID (procedural.h)
+    PATH_COUNT
+};
+extern SpeakerPath speakerPath;
+const char* speakerPathName(SpeakerPath path);
+
+// Camera placed by the caller instead of the orbit around
+// the origin (--bench --fly), looking from eye to target
+struct CameraPose {
+    bool  active;
+    float eye[3];
+    float target[3];
+};
+extern CameraPose cameraPose;
+
+// Sets up texture, lighting and meshes in the current GL context
+void initGL();
+
+// Milliseconds since the last initGL() started (cold/warm
+// start: until the first frame is done)
+double msSinceInitGL();
+
+// Viewport + perspective projection for a w x h target
+void reshape(int w, int h);
+
+// Draws one complete frame (floor, speaker, shadow) without
+// presenting it, so it works for windows and offscreen targets
+void renderScene();
+
+// One simulation tick of 'seconds' on this thread, for
+// --bench, which runs no simulation thread (simulation.h)
+void advanceAnimation(double seconds);
+
+// Speaker shape: cap angle (radians), inner ring radius ratio
+// and concavity depth. Clamped; the meshes follow next frame.
+void setSpeakerShape(float phiMax, float innerFactor, float depth);
+
+// The same clamping, in place
+void clampSpeakerShape(float& phiMax, float& innerFactor, float& depth);
+
+// The current shape at the given tessellation
+MeshParams speakerShapeParams(int uSteps, int vSteps);
+
+// Retained speaker meshes, one set per level of detail
+extern MeshBuffer speakerMeshes[LOD_LEVELS][MESH_COMPONENT_COUNT];
+
+// (Re)tessellates whatever changed since the last call;
+// adds the buffers rebuilt per component to rebuilt[] if given
+void updateSpeakerMeshes(int* rebuilt = NULL);
+
+// Builds every retained speaker mesh, through the mesh cache
+// file unless the cache is off (--no-mesh-cache)
+MeshCacheResult loadSpeakerMeshes();
+
+// Frees them again (the next load starts from scratch)
+void destroySpeakerMeshes();
+
+// Cache file for the current shape and detail ("" = no cache)
+std::string speakerMeshCachePath();
+
+#endif // ORATOR_H
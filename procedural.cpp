@@ -0,0 +1,208 @@
+/**********************************************************
+ *  Orator - procedural.cpp
+ *
+ *  gl_VertexID-driven speaker parts (see procedural.h).
+ **********************************************************/
+#include "procedural.h"
+#include "shader.h"
+#include "glstate.h"
+
+#include <string>
+#include <vector>
+
+static GLuint proceduralProgram = 0;
+static GLint  uComponentLocation  = -1;
+static GLint  uStepsLocation      = -1;
+static GLint  uShapeLocation      = -1;
+static GLint  uPumpLocation       = -1;
+static GLint  uShadowPassLocation = -1;
+static GLint  uTexturedLocation   = -1;
+static ShaderUniforms proceduralUniforms;   // Transform and light
+
+// --------------------------------------------------------
+// SHADER
+// --------------------------------------------------------
+
+// gl_VertexID is the value from the index buffer, i.e. grid
+// vertex j*(uSteps+1) + i of the retained layout
+static const char* proceduralVertexHeader =
+    "#version 330 compatibility\n"
+    "uniform int   uComponent;\n"   // 0 cap, 1 ring, 2 concavity
+    "uniform ivec2 uSteps;\n"       // Cells around theta, along phi/radius
+    "uniform vec3  uShape;\n"       // phiMax, innerRadiusFactor, concaveDepth
+    "uniform vec2  uPump;\n"        // x = plane z, y = z-scale about it
+    "uniform bool  uShadowPass;\n"
+    "const float TWO_PI = 6.28318530717959;\n";
+
+static const char* proceduralVertexMain =
+    "void main()\n"
+    "{\n"
+    "    int   row  = gl_VertexID / (uSteps.x + 1);\n"
+    "    ivec2 grid = ivec2(gl_VertexID - row * (uSteps.x + 1), row);\n"
+    "    float theta = float(grid.x) * (TWO_PI / float(uSteps.x));\n"
+    "    float c = cos(theta), s = sin(theta);\n"
+    "    float t = float(grid.y) / float(uSteps.y);\n"
+    "    float rimR = sin(uShape.x), rimZ = cos(uShape.x);\n"
+    "    vec3 p, n;\n"
+    "    vec2 uv;\n"
+    "    if (uComponent == 0) {\n"
+    "        // Unit sphere, phi = 0..phiMax: normal = position\n"
+    "        float phi = float(grid.y) * (uShape.x / float(uSteps.y));\n"
+    "        p  = vec3(sin(phi) * c, sin(phi) * s, cos(phi));\n"
+    "        n  = p;\n"
+    "        uv = vec2(float(grid.x) / float(uSteps.x), t);\n"
+    "    } else if (uComponent == 1) {\n"
+    "        // Row 0 the outer edge, row 1 the inner edge\n"
+    "        float f = grid.y == 0 ? 1.0 : uShape.y;\n"
+    "        p  = vec3(rimR * f * c, rimR * f * s, rimZ);\n"
+    "        n  = vec3(0.0, 0.0, -1.0);\n"
+    "        uv = 0.5 + 0.5 * f * vec2(c, s);\n"
+    "    } else {\n"
+    "        // Shrinks and rises by concaveDepth towards the middle\n"
+    "        float innerR = rimR * uShape.y;\n"
+    "        float f = 1.0 - t;\n"
+    "        p  = vec3(innerR * f * c, innerR * f * s, rimZ + uShape.z * t);\n"
+    "        n  = normalize(vec3(-c, -s, uShape.z / innerR));\n"
+    "        uv = 0.5 + 0.5 * f * vec2(c, s);\n"
+    "    }\n"
+    "    p = vec3(p.xy, uPump.x + (p.z - uPump.x) * uPump.y);\n"
+    "    n = vec3(n.xy, n.z / uPump.y);\n"
+    "    gl_Position    = transformPosition(p);\n"
+    "    gl_TexCoord[0] = vec4(uv, 0.0, 1.0);\n"
+    "    gl_FrontColor  = uShadowPass ? vec4(0.0, 0.0, 0.0, 1.0)\n"
+    "                                 : fixedFunctionColor(p, n, gl_Color);\n"
+    "}\n";
+
+// --------------------------------------------------------
+// INDEX SETS
+// --------------------------------------------------------
+
+// The index buffers only depend on the component and its step
+// counts, so one per LOD level is built once and kept. Each
+// has its own VAO, which records nothing but the element
+// buffer binding.
+struct IndexSet {
+    MeshComponent component;
+    int           uSteps, rows;
+    GLuint        vao, ibo;
+    GLsizei       count;
+    unsigned      lastUse;
+};
+static std::vector<IndexSet> indexSets;
+static unsigned              indexSetClock = 0;
+
+/**********************************************************
+ * findIndexSet(...) - Cached index buffer, built on first use
+ *
+ * Each --detail multiplier brings its own step counts, and
+ * arbitrary ones could grow the cache without bound, so past
+ * PROCEDURAL_INDEX_SETS the least recently used set is
+ * replaced.
+ **********************************************************/
+static const IndexSet& findIndexSet(MeshComponent component, const MeshParams& p)
+{
+    int rows = component == MESH_RING ? 1 : p.vSteps;
+    ++indexSetClock;
+    for (size_t i = 0; i < indexSets.size(); ++i) {
+        IndexSet& set = indexSets[i];
+        if (set.component == component && set.uSteps == p.uSteps && set.rows == rows) {
+            set.lastUse = indexSetClock;
+            return set;
+        }
+    }
+
+    IndexSet* set;
+    if (indexSets.size() < PROCEDURAL_INDEX_SETS) {
+        IndexSet fresh = { component, 0, 0, 0, 0, 0, 0 };
+        glGenVertexArrays(1, &fresh.vao);
+        glGenBuffers(1, &fresh.ibo);
+        indexSets.push_back(fresh);
+        set = &indexSets.back();
+    } else {
+        set = &indexSets[0];
+        for (size_t i = 1; i < indexSets.size(); ++i)
+            if (indexSets[i].lastUse < set->lastUse)
+                set = &indexSets[i];
+    }
+
+    std::vector<GLuint> indices;
+    buildMeshIndices(component, p, indices);
+    glBindVertexArray(set->vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, set->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                 indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    set->component = component;
+    set->uSteps    = p.uSteps;
+    set->rows      = rows;
+    set->count     = (GLsizei)indices.size();
+    set->lastUse   = indexSetClock;
+    return *set;
+}
+
+/**********************************************************
+ * initProceduralSpeaker() - Compiles the program
+ **********************************************************/
+bool initProceduralSpeaker()
+{
+    if (proceduralProgram)
+        return true;
+
+    std::string vertexSource = std::string(proceduralVertexHeader) +
+                               shaderLightingGlsl + proceduralVertexMain;
+    proceduralProgram = buildProgram("procedural speaker",
+                                     vertexSource.c_str(), shaderModulateFragmentSource);
+    if (!proceduralProgram)
+        return false;
+
+    uComponentLocation  = glGetUniformLocation(proceduralProgram, "uComponent");
+    uStepsLocation      = glGetUniformLocation(proceduralProgram, "uSteps");
+    uShapeLocation      = glGetUniformLocation(proceduralProgram, "uShape");
+    uPumpLocation       = glGetUniformLocation(proceduralProgram, "uPump");
+    uShadowPassLocation = glGetUniformLocation(proceduralProgram, "uShadowPass");
+    uTexturedLocation   = glGetUniformLocation(proceduralProgram, "uTextured");
+    shaderFindUniforms(proceduralProgram, proceduralUniforms);
+    glUseProgram(proceduralProgram);
+    glUniform1i(glGetUniformLocation(proceduralProgram, "uTexture"), 0);
+    glUseProgram(0);
+    return true;
+}
+
+/**********************************************************
+ * proceduralSpeakerProgram() - For the draw list state key
+ **********************************************************/
+GLuint proceduralSpeakerProgram()
+{
+    return proceduralProgram;
+}
+
+/**********************************************************
+ * drawProceduralPart(...) - One indexed draw, no vertices
+ **********************************************************/
+void drawProceduralPart(MeshComponent component, const MeshParams& p,
+                        bool shadowPass, bool textured,
+                        float pumpPlaneZ, float pumpScale)
+{
+    if (!proceduralProgram)
+        return;
+    const IndexSet& set = findIndexSet(component, p);
+
+    stateUseProgram(proceduralProgram);
+    shaderApplyUniforms(proceduralUniforms);
+    glUniform1i(uComponentLocation, (GLint)component);
+    glUniform2i(uStepsLocation, set.uSteps, set.rows);
+    glUniform3f(uShapeLocation, p.phiMax, p.innerRadiusFactor, p.concaveDepth);
+    glUniform2f(uPumpLocation, pumpPlaneZ, pumpScale);
+    glUniform1i(uShadowPassLocation, shadowPass ? 1 : 0);
+    glUniform1i(uTexturedLocation, textured ? 1 : 0);
+
+    glBindVertexArray(set.vao);
+    glDrawElements(GL_TRIANGLES, set.count, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    frameStats.drawCalls += 1;
+    frameStats.triangles += set.count / 3;
+    frameStats.vertices  += set.count;
+}
@@ -0,0 +1,41 @@
+/**********************************************************
+ *  Orator - procedural.h
+ *
+ *  Attribute-less speaker drawing. The cap, ring and
+ *  concavity are analytic surfaces of theta and phi (or
+ *  radius), so a vertex shader can rebuild every vertex
+ *  from gl_VertexID and a few uniforms: the shape
+ *  (phi_max, innerRadiusFactor, concaveDepth) and the step
+ *  counts. No vertex buffer is uploaded at all; changing
+ *  the shape only changes uniforms.
+ *
+ *  Each component is one glDrawElements with the same index
+ *  buffer as the retained mesh (buildMeshIndices), so both
+ *  paths rasterize the same triangles and the GPU can reuse
+ *  shaded vertices shared by neighbouring cells. The index
+ *  buffers only depend on the step counts and are cached.
+ **********************************************************/
+#ifndef ORATOR_PROCEDURAL_H
+#define ORATOR_PROCEDURAL_H
+
+#include "mesh.h"
+
+// Cached index buffers (one per component and step counts)
+#define PROCEDURAL_INDEX_SETS 32
+
+// Compiles the program. Needs a current GL context; false if
+// GLSL 3.30 is not available.
+bool initProceduralSpeaker();
+
+// The program drawProceduralPart() binds (0 before init)
+GLuint proceduralSpeakerProgram();
+
+// Draws one component with p's step counts and shape. The
+// current modelview matrix and glColor apply. The program
+// stays bound (through the glstate.h cache) for the next part. The part is
+// stretched along z by pumpScale about z = pumpPlaneZ.
+void drawProceduralPart(MeshComponent component, const MeshParams& p,
+                        bool shadowPass, bool textured,
+                        float pumpPlaneZ, float pumpScale);
+
+#endif // ORATOR_PROCEDURAL_H
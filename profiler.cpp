@@ -0,0 +1,362 @@
+/**********************************************************
+ *  Orator - profiler.cpp
+ *
+ *  CPU stage timers, GL_TIME_ELAPSED query ring, HUD and
+ *  Chrome trace_event export. See profiler.h.
+ **********************************************************/
+#include "profiler.h"
+#include "glstate.h"    // State change counters for the HUD
+
+#include <GL/glut.h>   // Bitmap fonts for the HUD (pulls in GL too)
+#include <stdio.h>
+#include <stdlib.h>    // atexit
+#include <chrono>
+
+// --------------------------------------------------------
+// STATE
+// --------------------------------------------------------
+bool profilerEnabled = false;
+bool profilerHud     = false;
+
+// Names used in the HUD and in the trace file
+static const char* stageNames[STAGE_COUNT] = {
+    "load", "floor", "cap", "ring", "concave", "shadow matrix", "shadow draw", "cull", "occlusion",
+    "capture", "swap"
+};
+
+// Running numbers per stage
+struct StageTiming {
+    double cpuMs;        // Exponential moving average (for the HUD)
+    double gpuMs;
+    double cpuTotalMs;   // Sums for profilerPrintSummary()
+    double gpuTotalMs;
+    long   cpuSamples;
+    long   gpuSamples;
+};
+static StageTiming timings[STAGE_COUNT];
+
+// One frame's worth of GPU queries, reused every PROFILER_LATENCY frames
+struct FrameQueries {
+    GLuint query[STAGE_COUNT];
+    bool   issued[STAGE_COUNT];       // Was the query begun this frame?
+    double cpuStartUs[STAGE_COUNT];   // Anchors the GPU event in the trace
+    bool   pending;                   // Results not collected yet
+};
+static FrameQueries frameQueries[PROFILER_LATENCY];
+
+static bool   gpuTimers      = false;  // GL_TIME_ELAPSED supported?
+static bool   queryActive    = false;  // Time-elapsed queries cannot nest
+static long   frameNumber    = 0;
+static int    currentSlot    = 0;
+static long   missedResults  = 0;      // Queries not ready after the latency
+static double stageStartUs[STAGE_COUNT];
+static double frameStartUs   = 0.0;
+
+static FILE*  traceFile      = NULL;
+static bool   firstEvent     = true;
+static bool   closeAtExit    = false;  // atexit() handler registered?
+
+// All timestamps are microseconds since program start
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+/**********************************************************
+ * nowUs() - Microseconds since start of the program
+ **********************************************************/
+static double nowUs()
+{
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - epoch).count();
+}
+
+// --------------------------------------------------------
+// TRACE FILE
+// --------------------------------------------------------
+
+/**********************************************************
+ * writeTraceEvent(...) - One complete ("X") event
+ *
+ * tid 1 is the CPU (render thread), tid 2 the GPU.
+ **********************************************************/
+static void writeTraceEvent(const char* name, int tid, double tsUs, double durUs)
+{
+    if (!traceFile) return;
+    fprintf(traceFile, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                       "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+            firstEvent ? "" : ",\n", name, tid == 1 ? "cpu" : "gpu", tsUs, durUs, tid);
+    firstEvent = false;
+}
+
+/**********************************************************
+ * closeTrace() - Close the JSON array and the file
+ *
+ * Runs from atexit(), so every way out of the program
+ * (ESC, the end of --bench, exit() on an error, GLUT
+ * closing the window) leaves a complete file. No GL here:
+ * the context may already be gone.
+ **********************************************************/
+static void closeTrace()
+{
+    if (!traceFile) return;
+    fprintf(traceFile, "\n]\n");
+    fclose(traceFile);
+    traceFile = NULL;
+}
+
+/**********************************************************
+ * profilerOpenTrace(...) - Start a trace_event JSON array
+ **********************************************************/
+bool profilerOpenTrace(const char* path)
+{
+    traceFile = fopen(path, "w");
+    if (!traceFile) {
+        fprintf(stderr, "profiler: cannot write trace file %s\n", path);
+        return false;
+    }
+    // Array format; thread names make the tracks readable
+    fprintf(traceFile, "[\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+            "\"args\":{\"name\":\"CPU (render thread)\"}},\n"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+            "\"args\":{\"name\":\"GPU (GL_TIME_ELAPSED)\"}}");
+    firstEvent = false;
+    profilerEnabled = true;
+    if (!closeAtExit)
+        closeAtExit = atexit(closeTrace) == 0;
+    return true;
+}
+
+// --------------------------------------------------------
+// GPU QUERIES
+// --------------------------------------------------------
+
+/**********************************************************
+ * profilerInit() - Create the query ring if supported
+ **********************************************************/
+void profilerInit()
+{
+    GLint bits = 0;
+    glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &bits);
+    gpuTimers = (glGetError() == GL_NO_ERROR && bits > 0);
+    if (!gpuTimers)
+        return;
+
+    for (int f = 0; f < PROFILER_LATENCY; ++f) {
+        glGenQueries(STAGE_COUNT, frameQueries[f].query);
+        for (int s = 0; s < STAGE_COUNT; ++s)
+            frameQueries[f].issued[s] = false;
+        frameQueries[f].pending = false;
+    }
+}
+
+/**********************************************************
+ * addSample(...) - Update EMA and totals of one stage
+ **********************************************************/
+static void addSample(double& ema, double& total, long& samples, double ms)
+{
+    // EMA over roughly 30 frames keeps the HUD readable
+    ema = samples == 0 ? ms : ema + (ms - ema) * (1.0 / 30.0);
+    total += ms;
+    samples++;
+}
+
+/**********************************************************
+ * collectFrame(...) - Read back an old frame without waiting
+ *
+ * A query that is still not available after PROFILER_LATENCY
+ * frames is dropped (and counted) instead of blocking,
+ * unless 'wait' (profilerDrain()).
+ **********************************************************/
+static void collectFrame(FrameQueries& fq, bool wait)
+{
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        if (!fq.issued[s])
+            continue;
+        GLint available = 1;
+        if (!wait)
+            glGetQueryObjectiv(fq.query[s], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            missedResults++;
+            continue;
+        }
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(fq.query[s], GL_QUERY_RESULT, &ns);
+        double ms = ns / 1.0e6;
+        StageTiming& t = timings[s];
+        addSample(t.gpuMs, t.gpuTotalMs, t.gpuSamples, ms);
+        writeTraceEvent(stageNames[s], 2, fq.cpuStartUs[s], ns / 1.0e3);
+    }
+    fq.pending = false;
+}
+
+/**********************************************************
+ * profilerDrain() - Wait for the frames still in flight
+ *
+ * Oldest first, so the trace's GPU events stay in order.
+ **********************************************************/
+void profilerDrain()
+{
+    if (!gpuTimers)
+        return;
+    for (int i = 0; i < PROFILER_LATENCY; ++i) {
+        FrameQueries& fq = frameQueries[(frameNumber + i) % PROFILER_LATENCY];
+        if (fq.pending)
+            collectFrame(fq, true);
+    }
+}
+
+// --------------------------------------------------------
+// FRAME AND STAGE BRACKETS
+// --------------------------------------------------------
+
+/**********************************************************
+ * profilerBeginFrame() - Recycle the oldest query slot
+ **********************************************************/
+void profilerBeginFrame()
+{
+    if (!profilerEnabled) return;
+
+    currentSlot = (int)(frameNumber % PROFILER_LATENCY);
+    FrameQueries& fq = frameQueries[currentSlot];
+    if (gpuTimers && fq.pending)
+        collectFrame(fq, false);
+    for (int s = 0; s < STAGE_COUNT; ++s)
+        fq.issued[s] = false;
+
+    frameStartUs = nowUs();
+}
+
+/**********************************************************
+ * profilerEndFrame() - Mark this frame's queries in flight
+ **********************************************************/
+void profilerEndFrame()
+{
+    if (!profilerEnabled) return;
+
+    frameQueries[currentSlot].pending = true;
+    writeTraceEvent("frame", 1, frameStartUs, nowUs() - frameStartUs);
+    frameNumber++;
+}
+
+/**********************************************************
+ * profilerBeginStage(...) - Start CPU timer + GPU query
+ **********************************************************/
+void profilerBeginStage(ProfileStage stage)
+{
+    if (!profilerEnabled) return;
+
+    stageStartUs[stage] = nowUs();
+    if (gpuTimers && !queryActive) {
+        FrameQueries& fq = frameQueries[currentSlot];
+        glBeginQuery(GL_TIME_ELAPSED, fq.query[stage]);
+        fq.issued[stage]     = true;
+        fq.cpuStartUs[stage] = stageStartUs[stage];
+        queryActive = true;
+    }
+}
+
+/**********************************************************
+ * profilerEndStage(...) - Stop CPU timer + GPU query
+ **********************************************************/
+void profilerEndStage(ProfileStage stage)
+{
+    if (!profilerEnabled) return;
+
+    if (gpuTimers && queryActive && frameQueries[currentSlot].issued[stage]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryActive = false;
+    }
+    double endUs = nowUs();
+    StageTiming& t = timings[stage];
+    addSample(t.cpuMs, t.cpuTotalMs, t.cpuSamples, (endUs - stageStartUs[stage]) / 1.0e3);
+    writeTraceEvent(stageNames[stage], 1, stageStartUs[stage], endUs - stageStartUs[stage]);
+}
+
+// --------------------------------------------------------
+// OUTPUT
+// --------------------------------------------------------
+
+/**********************************************************
+ * drawHudLine(...) - One line of bitmap text
+ **********************************************************/
+static void drawHudLine(int x, int y, const char* text)
+{
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; ++c)
+        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
+}
+
+/**********************************************************
+ * profilerDrawHud(...) - Overlay with the smoothed timings
+ **********************************************************/
+void profilerDrawHud(int windowWidth, int windowHeight)
+{
+    if (!profilerEnabled || !profilerHud) return;
+
+    // Plain 2D text: no lighting, texture or depth test
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_DEPTH_TEST);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, windowWidth, 0, windowHeight, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glColor3f(1.0f, 1.0f, 0.0f);
+    char line[96];
+    int y = windowHeight - 16;
+    drawHudLine(8, y, "stage            cpu ms   gpu ms");
+    double cpuSum = 0.0, gpuSum = 0.0;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        y -= 14;
+        if (gpuTimers)
+            snprintf(line, sizeof(line), "%-14s %8.3f %8.3f",
+                     stageNames[s], timings[s].cpuMs, timings[s].gpuMs);
+        else
+            snprintf(line, sizeof(line), "%-14s %8.3f      n/a",
+                     stageNames[s], timings[s].cpuMs);
+        drawHudLine(8, y, line);
+        cpuSum += timings[s].cpuMs;
+        gpuSum += timings[s].gpuMs;
+    }
+    y -= 14;
+    snprintf(line, sizeof(line), "%-14s %8.3f %8.3f", "total", cpuSum, gpuSum);
+    drawHudLine(8, y, line);
+    y -= 14;
+    snprintf(line, sizeof(line), "state changes  %5ld set %5ld avoided",
+             stateStats.issued, stateStats.requested - stateStats.issued);
+    drawHudLine(8, y, line);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+/**********************************************************
+ * profilerPrintSummary() - Averages over the whole run
+ **********************************************************/
+void profilerPrintSummary()
+{
+    if (!profilerEnabled) return;
+
+    printf("Stage          cpu avg ms  gpu avg ms\n");
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const StageTiming& t = timings[s];
+        if (t.cpuSamples == 0)
+            continue;
+        double cpu = t.cpuTotalMs / t.cpuSamples;
+        if (t.gpuSamples > 0)
+            printf("%-14s %10.4f  %10.4f\n", stageNames[s], cpu, t.gpuTotalMs / t.gpuSamples);
+        else
+            printf("%-14s %10.4f         n/a\n", stageNames[s], cpu);
+    }
+    if (missedResults > 0)
+        printf("(%ld GPU query results were not ready after %d frames and were dropped)\n",
+               missedResults, PROFILER_LATENCY);
+}
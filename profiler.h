@@ -0,0 +1,70 @@
+/**********************************************************
+ *  Orator - profiler.h
+ *
+ *  Per-stage frame timing. Every stage of renderScene()
+ *  gets a CPU timer and a GL_TIME_ELAPSED query. Query
+ *  results are collected a few frames later so reading
+ *  them never stalls the pipeline. Results can be shown in
+ *  an on-screen HUD and written to a Chrome trace file
+ *  (open it in chrome://tracing or ui.perfetto.dev).
+ **********************************************************/
+#ifndef ORATOR_PROFILER_H
+#define ORATOR_PROFILER_H
+
+// The timed parts of one frame, in drawing order
+enum ProfileStage {
+    STAGE_LOAD = 0,        // --render-load: synthetic work (synthload.h)
+    STAGE_FLOOR,           // drawFoundation()
+    STAGE_CAP,             // Lit spherical cap
+    STAGE_RING,            // Lit flat ring
+    STAGE_CONCAVE,         // Lit concave center
+    STAGE_SHADOW_MATRIX,   // mat4PlanarShadow()
+    STAGE_SHADOW_DRAW,     // Flattened re-draw of the speaker
+    STAGE_CULL,            // Frustum/occlusion tests (culling.h)
+    STAGE_OCCLUSION,       // --occlusion: query boxes of the grid cells
+    STAGE_CAPTURE,         // --record: readback into the PBO ring
+    STAGE_SWAP,            // glutSwapBuffers()
+    STAGE_COUNT
+};
+
+// Number of frames between issuing a query and reading it back
+#define PROFILER_LATENCY 4
+
+extern bool profilerEnabled;   // Master switch; false = near zero cost
+extern bool profilerHud;       // Draw the HUD in the window
+
+// Creates the GL query objects; needs a current GL context
+void profilerInit();
+
+// Starts writing a Chrome trace_event JSON file. It is
+// finished at exit, however the program ends.
+bool profilerOpenTrace(const char* path);
+
+// Waits for the GPU queries still in flight and records them
+// (HUD totals and trace). Call while the GL context is still
+// current; without it the last frames' GPU events are lost.
+void profilerDrain();
+
+// Frame brackets; profilerBeginFrame() also collects the GPU
+// results of the frame issued PROFILER_LATENCY frames ago
+void profilerBeginFrame();
+void profilerEndFrame();
+
+// Stage brackets (prefer ProfileScope below)
+void profilerBeginStage(ProfileStage stage);
+void profilerEndStage(ProfileStage stage);
+
+// Times the enclosing block as one stage
+struct ProfileScope {
+    ProfileStage stage;
+    explicit ProfileScope(ProfileStage s) : stage(s) { profilerBeginStage(s); }
+    ~ProfileScope() { profilerEndStage(stage); }
+};
+
+// Draws the per-stage timings as text (needs an initialized GLUT)
+void profilerDrawHud(int windowWidth, int windowHeight);
+
+// Prints the average CPU/GPU time of each stage to stdout
+void profilerPrintSummary();
+
+#endif // ORATOR_PROFILER_H
@@ -0,0 +1,187 @@
+/**********************************************************
+ *  Orator - programcache.cpp
+ *
+ *  Program binary cache (see programcache.h).
+ **********************************************************/
+#include "programcache.h"
+#include "meshcache.h"   // meshCacheDefaultDir, cacheHash
+
+#include <GL/glext.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+std::string programCacheDir = meshCacheDefaultDir();
+ProgramCacheStats programCacheStats;
+
+// Identifies the file type and the writer's byte order
+static const char     programCacheMagic[8] = { 'O', 'R', 'P', 'R', 'O', 'G', '\0', '\0' };
+static const uint32_t programCacheByteOrder = 0x01020304;
+
+struct ProgramCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t format;         // From glGetProgramBinary
+    uint32_t binaryBytes;
+    uint64_t key;            // programCacheKey() of driver + sources
+};
+
+// --------------------------------------------------------
+// KEYS AND PATHS
+// --------------------------------------------------------
+
+/**********************************************************
+ * hashString(...) - Including the terminator, so "ab"+"c"
+ *                   and "a"+"bc" differ
+ **********************************************************/
+static uint64_t hashString(uint64_t hash, const char* text)
+{
+    if (!text)
+        text = "";
+    return cacheHash(hash, text, strlen(text) + 1);
+}
+
+/**********************************************************
+ * programCacheKey(...) - Hash of the driver and the sources
+ **********************************************************/
+static uint64_t programCacheKey(const char* vertexSource, const char* fragmentSource)
+{
+    uint64_t hash = CACHE_HASH_SEED;
+    uint32_t version = PROGRAM_CACHE_VERSION;
+    hash = cacheHash(hash, &version, sizeof(version));
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    hash = hashString(hash, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    return hash;
+}
+
+/**********************************************************
+ * programCachePath(...) - <dir>/program-<key>.bin
+ **********************************************************/
+static std::string programCachePath(uint64_t key)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "program-%016llx.bin", (unsigned long long)key);
+    return programCacheDir + "/" + name;
+}
+
+/**********************************************************
+ * programCacheSupported() - Any binary format at all?
+ *
+ * Asked once per run. Contexts without ARB_get_program_binary
+ * reject the query; the count then stays 0 and its one
+ * GL_INVALID_ENUM is taken off the error queue (anything
+ * raised before is left to whoever checks for it).
+ **********************************************************/
+bool programCacheSupported()
+{
+    static GLint formats = -1;
+    if (formats < 0) {
+        formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        glGetError();
+    }
+    return formats > 0;
+}
+
+// --------------------------------------------------------
+// LOADING AND STORING
+// --------------------------------------------------------
+
+/**********************************************************
+ * programCacheLoad(...) - Read, check, glProgramBinary
+ **********************************************************/
+GLuint programCacheLoad(const char* name, const char* vertexSource,
+                        const char* fragmentSource)
+{
+    if (programCacheDir.empty() || !programCacheSupported())
+        return 0;
+    uint64_t key = programCacheKey(vertexSource, fragmentSource);
+    std::string path = programCachePath(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;   // Not built on this driver yet
+
+    ProgramCacheHeader header;
+    std::vector<unsigned char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) == 0 &&
+                 header.version == PROGRAM_CACHE_VERSION &&
+                 header.byteOrder == programCacheByteOrder &&
+                 header.key == key && header.binaryBytes > 0;
+    if (valid) {
+        binary.resize(header.binaryBytes);
+        // Exactly binaryBytes left, to catch truncation
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size() &&
+                fgetc(file) == EOF;
+    }
+    fclose(file);
+    if (!valid)
+        return 0;   // Rewritten after the compile
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)header.format, binary.data(), (GLsizei)binary.size());
+    glGetError();   // An unknown format is an error (one), not a crash
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        fprintf(stderr, "Program cache: driver refused the binary of '%s', recompiling\n", name);
+        glDeleteProgram(program);
+        programCacheStats.rejected++;
+        return 0;
+    }
+    programCacheStats.loaded++;
+    return program;
+}
+
+/**********************************************************
+ * programCacheStore(...) - glGetProgramBinary to a file
+ *
+ * Written under a temporary name and renamed once complete,
+ * so a crash or a second instance never leaves half a file.
+ **********************************************************/
+void programCacheStore(const char* name, const char* vertexSource,
+                       const char* fragmentSource, GLuint program)
+{
+    if (programCacheDir.empty() || !programCacheSupported())
+        return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+    header.version     = PROGRAM_CACHE_VERSION;
+    header.byteOrder   = programCacheByteOrder;
+    header.format      = format;
+    header.binaryBytes = (uint32_t)length;
+    header.key         = programCacheKey(vertexSource, fragmentSource);
+
+    std::string path = programCachePath(header.key);
+    std::string temp = path + ".tmp" + std::to_string((long)getpid());
+    FILE* file = cacheMakeDirectories(programCacheDir) ? fopen(temp.c_str(), "wb") : NULL;
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(binary.data(), 1, (size_t)length, file) == (size_t)length;
+    ok = (file && fclose(file) == 0) && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "Program cache: cannot write '%s' for '%s'\n", path.c_str(), name);
+        unlink(temp.c_str());
+        return;
+    }
+    programCacheStats.written++;
+}
@@ -0,0 +1,58 @@
+/**********************************************************
+ *  Orator - programcache.h
+ *
+ *  On-disk cache of linked GLSL programs, so a start with
+ *  the same driver skips compiling and linking. After a
+ *  program is linked, buildProgram() saves it with
+ *  glGetProgramBinary; the next start hands the file to
+ *  glProgramBinary instead.
+ *
+ *  A file belongs to one program on one driver: its name is
+ *  a hash of GL_VENDOR, GL_RENDERER, GL_VERSION, the GLSL
+ *  version and both sources. A driver may still refuse a
+ *  binary (for example after an update that kept the version
+ *  string). The program is then compiled from source as
+ *  usual and the file is written again.
+ *
+ *  Layout (native byte order):
+ *    ProgramCacheHeader
+ *    binary (binaryBytes)
+ **********************************************************/
+#ifndef ORATOR_PROGRAMCACHE_H
+#define ORATOR_PROGRAMCACHE_H
+
+#include <GL/gl.h>
+
+#include <string>
+
+// Bump when the file layout changes
+#define PROGRAM_CACHE_VERSION 1
+
+// Default $XDG_CACHE_HOME/orator, like the mesh cache;
+// --program-cache DIR, or "" (--no-program-cache) for off
+extern std::string programCacheDir;
+
+// What happened to the programs built so far
+struct ProgramCacheStats {
+    int    loaded;       // From a cache file
+    int    compiled;     // From source (cache off, miss or rejected)
+    int    written;      // Files written for next time
+    int    rejected;     // Files the driver refused
+    double buildMs;      // In buildProgram(), all programs
+};
+extern ProgramCacheStats programCacheStats;
+
+// True if the current context can save program binaries
+bool programCacheSupported();
+
+// The program for this source from the cache, or 0 on a
+// miss, a refused binary or with the cache off
+GLuint programCacheLoad(const char* name, const char* vertexSource,
+                        const char* fragmentSource);
+
+// Saves a freshly linked program (linked with
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT) for next time
+void programCacheStore(const char* name, const char* vertexSource,
+                       const char* fragmentSource, GLuint program);
+
+#endif // ORATOR_PROGRAMCACHE_H
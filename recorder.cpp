@@ -0,0 +1,574 @@
+/**********************************************************
+ *  Orator - recorder.cpp
+ *
+ *  Pipelined frame capture to an image sequence (see
+ *  recorder.h).
+ **********************************************************/
+#include "recorder.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>   // mkdir
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// How long a map may wait for its readback before we give up
+// on that frame (only reached if the GPU hangs)
+#define RECORD_FENCE_TIMEOUT_NS 1000000000ull
+
+// One pixel buffer object of the readback ring
+struct ReadbackSlot {
+    GLuint        pbo;
+    GLsync        fence;     // Signalled once the copy is done
+    unsigned long frame;     // Sequence number of the frame in it
+    bool          pending;   // Read into, not mapped yet
+};
+
+// A frame on its way to disk (RGBA, bottom row first, as GL
+// reads it)
+struct FrameJob {
+    std::vector<unsigned char> pixels;
+    int           width;
+    int           height;
+    unsigned long frame;
+};
+
+struct RecorderState {
+    bool          active;
+    std::string   dir;
+    RecordFormat  format;
+    ReadbackSlot  ring[RECORD_PBO_COUNT];
+    int           next;              // Slot the next frame goes into
+    int           width, height;     // Size the PBOs were made for
+
+    // Render thread <-> workers
+    std::mutex               lock;
+    std::condition_variable  wake;   // A job was queued, or stop
+    std::condition_variable  done;   // A job finished
+    std::vector<FrameJob*>   freeJobs;
+    std::deque<FrameJob*>    queue;
+    std::vector<FrameJob*>   allJobs;
+    int                      busy;   // Jobs being encoded right now
+    bool                     stopRequested;
+    std::vector<std::thread> workers;
+
+    unsigned long requested;         // Render thread only
+    unsigned long dropped;
+    unsigned long stalls;
+    unsigned long long readbackNs;
+    unsigned long readbacks;
+    std::atomic<unsigned long> written;
+    std::atomic<unsigned long> writeErrors;
+    std::atomic<unsigned long long> encodeNs;
+    int workerCount;
+};
+
+static RecorderState recorder;
+
+// --------------------------------------------------------
+// ENCODING (worker threads)
+// --------------------------------------------------------
+
+// CRC-32 tables for slicing-by-4: crcTable[k][n] is the CRC
+// of byte n followed by k zero bytes
+static uint32_t crcTable[4][256];
+
+/**********************************************************
+ * initCrcTable() - Tables for the PNG chunk CRC-32
+ **********************************************************/
+static void initCrcTable()
+{
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; ++n)
+        for (int k = 1; k < 4; ++k)
+            crcTable[k][n] = crcTable[0][crcTable[k - 1][n] & 0xFF] ^ (crcTable[k - 1][n] >> 8);
+}
+
+/**********************************************************
+ * crc32Update(...) - Four bytes per step (little endian)
+ **********************************************************/
+static uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t bytes)
+{
+    for (; bytes >= 4; bytes -= 4, data += 4) {
+        crc ^= (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+               (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+        crc = crcTable[3][crc & 0xFF] ^ crcTable[2][(crc >> 8) & 0xFF] ^
+              crcTable[1][(crc >> 16) & 0xFF] ^ crcTable[0][crc >> 24];
+    }
+    for (; bytes > 0; --bytes)
+        crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/**********************************************************
+ * adler32Update(...) - zlib checksum over more data
+ *
+ * The sums are reduced every ADLER_NMAX bytes, the most that
+ * fits in 32 bits without overflowing.
+ **********************************************************/
+#define ADLER_MOD  65521u
+#define ADLER_NMAX 5552
+
+static void adler32Update(uint32_t& a, uint32_t& b, const unsigned char* data, size_t bytes)
+{
+    while (bytes > 0) {
+        size_t n = bytes < ADLER_NMAX ? bytes : ADLER_NMAX;
+        bytes -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+}
+
+static void putBigEndian(unsigned char* out, uint32_t value)
+{
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+/**********************************************************
+ * writeChunk(...) - One PNG chunk: length, type, data, CRC
+ **********************************************************/
+static bool writeChunk(FILE* file, const char* type,
+                       const unsigned char* data, size_t bytes)
+{
+    unsigned char head[8], tail[4];
+    putBigEndian(head, (uint32_t)bytes);
+    memcpy(head + 4, type, 4);
+    uint32_t crc = crc32Update(0xFFFFFFFFu, head + 4, 4);
+    crc = crc32Update(crc, data, bytes) ^ 0xFFFFFFFFu;
+    putBigEndian(tail, crc);
+    return fwrite(head, 1, 8, file) == 8 &&
+           (bytes == 0 || fwrite(data, 1, bytes, file) == bytes) &&
+           fwrite(tail, 1, 4, file) == 4;
+}
+
+/**********************************************************
+ * encodePng(...) - RGB rows -> PNG with stored deflate
+ *
+ * Each row gets filter byte 0; the zlib stream is split
+ * into stored (uncompressed) blocks of at most 65535 bytes.
+ * Larger files than a real deflate, but encoding is a copy,
+ * so the workers keep up at 1080p without any library.
+ **********************************************************/
+static bool encodePng(FILE* file, const unsigned char* rgb, int width, int height,
+                      std::vector<unsigned char>& scratch)
+{
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    const size_t rowBytes = (size_t)width * 3;
+    const size_t rawBytes = (rowBytes + 1) * height;
+    const size_t blocks   = (rawBytes + 65534) / 65535;
+
+    unsigned char header[13];
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header + 4, (uint32_t)height);
+    header[8]  = 8;    // Bits per channel
+    header[9]  = 2;    // Truecolor RGB
+    header[10] = 0;    // Deflate
+    header[11] = 0;    // Adaptive filtering
+    header[12] = 0;    // No interlace
+
+    // zlib header, blocks of (5-byte header + data), Adler-32
+    scratch.resize(2 + blocks * 5 + rawBytes + 4);
+    unsigned char* out = scratch.data();
+    *out++ = 0x78;
+    *out++ = 0x01;
+    uint32_t a = 1, b = 0;
+    size_t row = 0, column = 0;      // Position in the raw stream
+    size_t left = rawBytes;
+    while (left > 0) {
+        uint16_t len = (uint16_t)(left < 65535 ? left : 65535);
+        left -= len;
+        *out++ = left == 0 ? 1 : 0;  // BFINAL, BTYPE = stored
+        out[0] = (unsigned char)len;
+        out[1] = (unsigned char)(len >> 8);
+        out[2] = (unsigned char)~len;
+        out[3] = (unsigned char)(~len >> 8);
+        out += 4;
+        for (size_t n = len; n > 0; ) {
+            // Either the filter byte or part of a pixel row
+            const unsigned char* src;
+            size_t take;
+            static const unsigned char filterNone = 0;
+            if (column == 0) {
+                src = &filterNone;
+                take = 1;
+            } else {
+                src = rgb + row * rowBytes + (column - 1);
+                take = rowBytes + 1 - column;
+                if (take > n) take = n;
+            }
+            memcpy(out, src, take);
+            adler32Update(a, b, out, take);
+            out += take;
+            n -= take;
+            column += take;
+            if (column == rowBytes + 1) {
+                column = 0;
+                row++;
+            }
+        }
+    }
+    putBigEndian(out, (b << 16) | a);
+
+    return fwrite(signature, 1, 8, file) == 8 &&
+           writeChunk(file, "IHDR", header, sizeof(header)) &&
+           writeChunk(file, "IDAT", scratch.data(), scratch.size()) &&
+           writeChunk(file, "IEND", NULL, 0);
+}
+
+/**********************************************************
+ * writeFrame(...) - Flip, drop alpha, encode, write
+ **********************************************************/
+static bool writeFrame(const FrameJob& job, std::vector<unsigned char>& rgb,
+                       std::vector<unsigned char>& scratch)
+{
+    const size_t rowBytes = (size_t)job.width * 3;
+    rgb.resize(rowBytes * job.height);
+    for (int y = 0; y < job.height; ++y) {
+        const unsigned char* src = &job.pixels[(size_t)(job.height - 1 - y) * job.width * 4];
+        unsigned char* dst = &rgb[y * rowBytes];
+        for (int x = 0; x < job.width; ++x) {
+            dst[3 * x + 0] = src[4 * x + 0];
+            dst[3 * x + 1] = src[4 * x + 1];
+            dst[3 * x + 2] = src[4 * x + 2];
+        }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/frame-%06lu.%s", job.frame, recordFormatName(recorder.format));
+    std::string path = recorder.dir + name;
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok;
+    if (recorder.format == RECORD_PNG) {
+        ok = encodePng(file, rgb.data(), job.width, job.height, scratch);
+    } else {
+        ok = fprintf(file, "P6\n%d %d\n255\n", job.width, job.height) > 0 &&
+             fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+/**********************************************************
+ * workerMain() - Encodes queued frames until stopped
+ **********************************************************/
+static void workerMain()
+{
+    typedef std::chrono::steady_clock Clock;
+    std::vector<unsigned char> rgb, scratch;   // Reused per frame
+
+    std::unique_lock<std::mutex> guard(recorder.lock);
+    for (;;) {
+        while (recorder.queue.empty() && !recorder.stopRequested)
+            recorder.wake.wait(guard);
+        if (recorder.queue.empty())
+            return;   // Stop requested and nothing left
+        FrameJob* job = recorder.queue.front();
+        recorder.queue.pop_front();
+        recorder.busy++;
+        guard.unlock();
+
+        Clock::time_point start = Clock::now();
+        if (writeFrame(*job, rgb, scratch)) {
+            recorder.written.fetch_add(1, std::memory_order_relaxed);
+        } else if (recorder.writeErrors.fetch_add(1) == 0) {
+            fprintf(stderr, "Recorder: cannot write frame %lu to '%s': %s\n",
+                    job->frame, recorder.dir.c_str(), strerror(errno));
+        }
+        recorder.encodeNs.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(),
+            std::memory_order_relaxed);
+
+        guard.lock();
+        recorder.busy--;
+        recorder.freeJobs.push_back(job);
+        recorder.done.notify_all();
+    }
+}
+
+// --------------------------------------------------------
+// READBACK RING (render thread)
+// --------------------------------------------------------
+
+/**********************************************************
+ * collectSlot(...) - Map a finished readback, queue it
+ *
+ * With 'wait' false (normal frames) a frame that finds no
+ * free buffer is dropped. With 'wait' true (stop, resize)
+ * it waits for a worker instead, so nothing is lost.
+ **********************************************************/
+static void collectSlot(ReadbackSlot& slot, bool wait)
+{
+    typedef std::chrono::steady_clock Clock;
+    if (!slot.pending)
+        return;
+    slot.pending = false;
+
+    Clock::time_point start = Clock::now();
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        recorder.stalls++;
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  RECORD_FENCE_TIMEOUT_NS);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        recorder.dropped++;
+        return;
+    }
+
+    FrameJob* job = NULL;
+    {
+        std::unique_lock<std::mutex> guard(recorder.lock);
+        while (wait && recorder.freeJobs.empty())
+            recorder.done.wait(guard);
+        if (!recorder.freeJobs.empty()) {
+            job = recorder.freeJobs.back();
+            recorder.freeJobs.pop_back();
+        }
+    }
+    if (!job) {
+        recorder.dropped++;
+        return;
+    }
+
+    size_t bytes = (size_t)recorder.width * recorder.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    bool ok = mapped != NULL;
+    if (ok) {
+        job->pixels.resize(bytes);
+        memcpy(job->pixels.data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    job->width  = recorder.width;
+    job->height = recorder.height;
+    job->frame  = slot.frame;
+
+    {
+        std::lock_guard<std::mutex> guard(recorder.lock);
+        if (ok)
+            recorder.queue.push_back(job);
+        else
+            recorder.freeJobs.push_back(job);
+    }
+    if (ok) {
+        recorder.wake.notify_one();
+    } else {
+        recorder.dropped++;
+    }
+    recorder.readbackNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+    recorder.readbacks++;
+}
+
+/**********************************************************
+ * drainRing() - Collect every pending slot, oldest first
+ **********************************************************/
+static void drainRing()
+{
+    for (int i = 0; i < RECORD_PBO_COUNT; ++i)
+        collectSlot(recorder.ring[(recorder.next + i) % RECORD_PBO_COUNT], true);
+}
+
+// --------------------------------------------------------
+// PUBLIC INTERFACE
+// --------------------------------------------------------
+
+/**********************************************************
+ * recordFormatName(...) - Also the file extension
+ **********************************************************/
+const char* recordFormatName(RecordFormat format)
+{
+    return format == RECORD_PNG ? "png" : "ppm";
+}
+
+/**********************************************************
+ * recorderStart(...) - Directory, PBO ring, worker pool
+ **********************************************************/
+bool recorderStart(const RecordOptions& options)
+{
+    if (recorder.active || !options.dir)
+        return false;
+    if (mkdir(options.dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Recorder: cannot create '%s': %s\n", options.dir, strerror(errno));
+        return false;
+    }
+
+    int workers = options.workers;
+    if (workers <= 0) {
+        workers = (int)std::thread::hardware_concurrency() - 1;
+        if (workers < 1) workers = 1;
+    }
+    if (workers > RECORD_MAX_WORKERS)
+        workers = RECORD_MAX_WORKERS;
+
+    initCrcTable();
+    recorder.dir    = options.dir;
+    recorder.format = options.format;
+    recorder.next   = 0;
+    recorder.width  = recorder.height = 0;
+    for (int i = 0; i < RECORD_PBO_COUNT; ++i) {
+        ReadbackSlot& slot = recorder.ring[i];
+        glGenBuffers(1, &slot.pbo);
+        slot.fence   = 0;
+        slot.frame   = 0;
+        slot.pending = false;
+    }
+
+    recorder.requested = recorder.dropped = recorder.stalls = 0;
+    recorder.readbackNs = 0;
+    recorder.readbacks  = 0;
+    recorder.written.store(0);
+    recorder.writeErrors.store(0);
+    recorder.encodeNs.store(0);
+    recorder.busy = 0;
+    recorder.stopRequested = false;
+    recorder.workerCount = workers;
+
+    // Frame buffers are allocated once and grow on first use
+    for (int i = 0; i < workers * RECORD_FRAMES_PER_WORKER; ++i) {
+        FrameJob* job = new FrameJob();
+        recorder.allJobs.push_back(job);
+        recorder.freeJobs.push_back(job);
+    }
+    for (int i = 0; i < workers; ++i)
+        recorder.workers.push_back(std::thread(workerMain));
+
+    recorder.active = true;
+    return true;
+}
+
+/**********************************************************
+ * recorderCapture(...) - Queue this frame's readback
+ *
+ * First maps the slot about to be reused: that frame was
+ * read RECORD_PBO_COUNT frames ago.
+ **********************************************************/
+void recorderCapture(int width, int height)
+{
+    if (!recorder.active || width <= 0 || height <= 0)
+        return;
+
+    // New size (window resize): finish the old frames first
+    if (width != recorder.width || height != recorder.height) {
+        drainRing();
+        for (int i = 0; i < RECORD_PBO_COUNT; ++i) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder.ring[i].pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4,
+                         NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        recorder.width  = width;
+        recorder.height = height;
+    }
+
+    ReadbackSlot& slot = recorder.ring[recorder.next];
+    collectSlot(slot, false);
+
+    // Only queues the copy; the buffer is mapped much later
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence   = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame   = recorder.requested++;
+    slot.pending = true;
+    recorder.next = (recorder.next + 1) % RECORD_PBO_COUNT;
+}
+
+/**********************************************************
+ * recorderStop() - Flush the ring, finish every file
+ **********************************************************/
+void recorderStop()
+{
+    if (!recorder.active)
+        return;
+    drainRing();
+    {
+        std::lock_guard<std::mutex> guard(recorder.lock);
+        recorder.stopRequested = true;
+    }
+    recorder.wake.notify_all();
+    for (size_t i = 0; i < recorder.workers.size(); ++i)
+        recorder.workers[i].join();
+    recorder.workers.clear();
+
+    for (int i = 0; i < RECORD_PBO_COUNT; ++i)
+        glDeleteBuffers(1, &recorder.ring[i].pbo);
+    for (size_t i = 0; i < recorder.allJobs.size(); ++i)
+        delete recorder.allJobs[i];
+    recorder.allJobs.clear();
+    recorder.freeJobs.clear();
+    recorder.active = false;
+}
+
+/**********************************************************
+ * recorderActive() - True between start and stop
+ **********************************************************/
+bool recorderActive()
+{
+    return recorder.active;
+}
+
+/**********************************************************
+ * recorderGetStats(...) - Counters for bench output
+ **********************************************************/
+void recorderGetStats(RecordStats& stats)
+{
+    stats.requested   = recorder.requested;
+    stats.written     = recorder.written.load();
+    stats.dropped     = recorder.dropped;
+    stats.stalls      = recorder.stalls;
+    stats.writeErrors = recorder.writeErrors.load();
+    stats.meanReadbackMs = recorder.readbacks
+        ? recorder.readbackNs / 1.0e6 / recorder.readbacks : 0.0;
+    stats.meanEncodeMs = stats.written
+        ? recorder.encodeNs.load() / 1.0e6 / stats.written : 0.0;
+    stats.workers = recorder.workerCount;
+}
+
+/**********************************************************
+ * recorderPrintStats() - Summary after a recording
+ **********************************************************/
+void recorderPrintStats()
+{
+    if (recorder.requested == 0)
+        return;
+    RecordStats s;
+    recorderGetStats(s);
+    printf("Recording     : %lu of %lu frames written (%s, %d workers), %lu dropped, "
+           "%lu readback stalls\n",
+           s.written, s.requested, recordFormatName(recorder.format), s.workers,
+           s.dropped, s.stalls);
+    printf("Record cost   : %.3f ms map + copy per frame (render thread), "
+           "%.3f ms encode + write per frame (worker)\n",
+           s.meanReadbackMs, s.meanEncodeMs);
+    if (s.writeErrors)
+        printf("Record errors : %lu frames could not be written\n", s.writeErrors);
+}
@@ -0,0 +1,75 @@
+/**********************************************************
+ *  Orator - recorder.h
+ *
+ *  --record DIR: writes every drawn frame as a numbered
+ *  image (frame-000000.ppm, ...) without stalling the GPU.
+ *
+ *  glReadPixels into a plain pointer waits until the GPU
+ *  has finished the frame. Here each frame is read into the
+ *  next of RECORD_PBO_COUNT pixel buffer objects instead,
+ *  which only queues the copy. A buffer is mapped when the
+ *  ring comes back round to it, RECORD_PBO_COUNT - 1 frames
+ *  later, by which time the copy is long done. The mapped
+ *  pixels are copied into a free frame buffer and handed to
+ *  a pool of worker threads that flip, convert and encode
+ *  them (PPM or PNG) and write the file.
+ *
+ *  The render thread never waits for the encoders: if every
+ *  frame buffer is still queued, that frame is dropped and
+ *  counted, and its number is missing from the sequence.
+ **********************************************************/
+#ifndef ORATOR_RECORDER_H
+#define ORATOR_RECORDER_H
+
+// Readback ring depth: frames in flight between glReadPixels
+// and the map (at least 3, so the GPU is never waited on)
+#define RECORD_PBO_COUNT 4
+
+// Frames that may wait for or be in encoding, per worker
+#define RECORD_FRAMES_PER_WORKER 2
+
+// Largest --record-threads
+#define RECORD_MAX_WORKERS 16
+
+enum RecordFormat {
+    RECORD_PPM = 0,   // Binary P6, fastest to write
+    RECORD_PNG        // Uncompressed (stored) deflate, no zlib needed
+};
+
+struct RecordOptions {
+    const char*  dir;       // Output directory (NULL = not recording)
+    RecordFormat format;
+    int          workers;   // Encoder threads (0 = cores - 1)
+};
+
+struct RecordStats {
+    unsigned long requested;    // recorderCapture() calls
+    unsigned long written;      // Files written
+    unsigned long dropped;      // No free frame buffer (encoders behind)
+    unsigned long stalls;       // Readback not done when mapped
+    unsigned long writeErrors;
+    double meanReadbackMs;      // Map + copy, render thread
+    double meanEncodeMs;        // Flip + encode + write, per worker job
+    int    workers;
+};
+
+// Creates the output directory and starts the workers.
+// Needs a current GL context for the pixel buffers.
+bool recorderStart(const RecordOptions& options);
+
+// After the frame is drawn, before the swap: reads the
+// current read buffer (w x h) into the ring
+void recorderCapture(int width, int height);
+
+// Maps the frames still in the ring, waits until every
+// queued frame is written and stops the workers
+void recorderStop();
+
+bool recorderActive();
+void recorderGetStats(RecordStats& stats);
+const char* recordFormatName(RecordFormat format);
+
+// One-line summary on stdout (nothing if never started)
+void recorderPrintStats();
+
+#endif // ORATOR_RECORDER_H
@@ -0,0 +1,464 @@
+/**********************************************************
+ *  Orator - resampler.cpp
+ *
+ *  Polyphase windowed-sinc sample-rate conversion with
+ *  scalar, SSE2 and AVX dot-product kernels (see
+ *  resampler.h).
+ *
+ *  The filter is designed in double precision and stored as
+ *  floats. Each phase row is normalised to a sum of exactly
+ *  1, so a constant input comes out unchanged whatever the
+ *  fraction, instead of rippling at the phase rate.
+ **********************************************************/
+#include "resampler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RESAMPLE_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Rates further apart than this are refused
+#define RESAMPLE_MAX_RATIO 16
+
+// Interpolated phase counter: 32 fraction bits
+#define RESAMPLE_FRACTION_BITS 32
+
+// Filter shape of one quality tier. 'cutoff' is the middle
+// of the transition band, as a fraction of the lower
+// Nyquist frequency; Kaiser's formula for 'beta' and 'taps'
+// puts the stopband edge just above that Nyquist frequency,
+// so what aliases lands above the passband.
+struct QualityTier {
+    int    taps;
+    double beta;
+    double cutoff;
+};
+
+static const QualityTier tiers[] = {
+    { 16,  5.0, 0.80 },   // Fast:   passband to ~0.60 Nyquist
+    { 32,  8.0, 0.88 },   // Medium: passband to ~0.72 Nyquist
+    { 64, 10.0, 0.92 },   // Best:   passband to ~0.82 Nyquist
+};
+
+static ResampleBackend currentBackend = resampleBestBackend();
+
+// --------------------------------------------------------
+// FILTER DESIGN
+// --------------------------------------------------------
+
+/**********************************************************
+ * besselI0(...) - Modified Bessel function, for the window
+ **********************************************************/
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0, half = x * 0.5;
+    for (int k = 1; k < 64; ++k) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-17)
+            break;
+    }
+    return sum;
+}
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**********************************************************
+ * resampleFilterInit(...) - Rates -> phase table
+ *
+ * Row p holds the taps for an output that lies p/phases of
+ * the way from input frame i to i + 1. Tap k multiplies
+ * input frame i - (taps/2 - 1) + k, whose distance from the
+ * output is d = k - (taps/2 - 1) - p/phases. When the rate
+ * goes down the cutoff moves down with it, and the filter
+ * gets longer by the same factor to keep its steepness.
+ **********************************************************/
+bool resampleFilterInit(ResampleFilter& filter, int inRate, int outRate,
+                        ResampleQuality quality)
+{
+    if (inRate <= 0 || outRate <= 0 ||
+        inRate > outRate * RESAMPLE_MAX_RATIO || outRate > inRate * RESAMPLE_MAX_RATIO) {
+        fprintf(stderr, "Cannot resample %d Hz to %d Hz\n", inRate, outRate);
+        return false;
+    }
+    const QualityTier& tier = tiers[quality];
+
+    filter.inRate  = inRate;
+    filter.outRate = outRate;
+    filter.quality = quality;
+
+    int divisor = greatestCommonDivisor(inRate, outRate);
+    int up = outRate / divisor, down = inRate / divisor;   // in/out = down/up
+    if (up <= RESAMPLE_MAX_PHASES) {
+        filter.interpolate = false;
+        filter.phases  = up;
+        filter.den     = (uint64_t)up;
+        filter.stepInt = (uint64_t)(down / up);
+        filter.stepNum = (uint64_t)(down % up);
+    } else {
+        filter.interpolate = true;
+        filter.phases  = RESAMPLE_INTERP_PHASES;
+        filter.den     = (uint64_t)1 << RESAMPLE_FRACTION_BITS;
+        filter.stepInt = (uint64_t)(inRate / outRate);
+        filter.stepNum = ((uint64_t)(inRate % outRate) << RESAMPLE_FRACTION_BITS) / (uint64_t)outRate;
+    }
+
+    double scale = inRate > outRate ? (double)outRate / inRate : 1.0;
+    int taps = (int)ceil(tier.taps / scale);
+    taps = (taps + 7) & ~7;
+    if (taps > RESAMPLE_MAX_TAPS)
+        taps = RESAMPLE_MAX_TAPS;
+    filter.taps = taps;
+
+    double cutoff = tier.cutoff * scale;   // Fraction of the input Nyquist
+    double half   = taps * 0.5;
+    double window = besselI0(tier.beta);
+
+    filter.coeffs.assign((size_t)(filter.phases + 1) * taps, 0.0f);
+    std::vector<double> row(taps);
+    for (int p = 0; p <= filter.phases; ++p) {
+        double fraction = (double)p / filter.phases;
+        double sum = 0.0;
+        for (int k = 0; k < taps; ++k) {
+            double d = k - (half - 1.0) - fraction;
+            double x = d / half;
+            double w = fabs(x) < 1.0 ? besselI0(tier.beta * sqrt(1.0 - x * x)) / window : 0.0;
+            double s = fabs(d) < 1e-12 ? 1.0 : sin(M_PI * cutoff * d) / (M_PI * cutoff * d);
+            row[k] = cutoff * s * w;
+            sum += row[k];
+        }
+        for (int k = 0; k < taps; ++k)
+            filter.coeffs[(size_t)p * taps + k] = (float)(row[k] / sum);
+    }
+    return true;
+}
+
+// --------------------------------------------------------
+// DOT-PRODUCT KERNELS: one output frame, every channel
+// --------------------------------------------------------
+
+// out[c] = taps . row c at x (rows 'stride' floats apart);
+// taps % 8 == 0. Stereo shares each load of the taps.
+typedef void (*FrameFunction)(const float* x, size_t stride, int channels,
+                              const float* h, int taps, float* out);
+
+static void frameScalar(const float* x, size_t stride, int channels,
+                        const float* h, int taps, float* out)
+{
+    for (int c = 0; c < channels; ++c, x += stride) {
+        float a = 0.0f, b = 0.0f, d = 0.0f, e = 0.0f;
+        for (int k = 0; k < taps; k += 4) {
+            a += x[k]     * h[k];
+            b += x[k + 1] * h[k + 1];
+            d += x[k + 2] * h[k + 2];
+            e += x[k + 3] * h[k + 3];
+        }
+        out[c] = (a + b) + (d + e);
+    }
+}
+
+#ifdef RESAMPLE_X86
+__attribute__((target("sse2")))
+static inline float sumSse2(__m128 a)
+{
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+    return _mm_cvtss_f32(a);
+}
+
+__attribute__((target("sse2")))
+static void frameSse2(const float* x, size_t stride, int channels,
+                      const float* h, int taps, float* out)
+{
+    int c = 0;
+    for (; c + 2 <= channels; c += 2, x += 2 * stride) {
+        const float* y = x + stride;
+        __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+        for (int k = 0; k < taps; k += 4) {
+            __m128 t = _mm_loadu_ps(h + k);
+            a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + k), t));
+            b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(y + k), t));
+        }
+        out[c]     = sumSse2(a);
+        out[c + 1] = sumSse2(b);
+    }
+    if (c < channels) {
+        __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+        for (int k = 0; k < taps; k += 8) {
+            a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + k),     _mm_loadu_ps(h + k)));
+            b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(x + k + 4), _mm_loadu_ps(h + k + 4)));
+        }
+        out[c] = sumSse2(_mm_add_ps(a, b));
+    }
+}
+
+__attribute__((target("avx")))
+static inline float sumAvx(__m256 a)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx")))
+static void frameAvx(const float* x, size_t stride, int channels,
+                     const float* h, int taps, float* out)
+{
+    int c = 0;
+    for (; c + 2 <= channels; c += 2, x += 2 * stride) {
+        const float* y = x + stride;
+        __m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps();
+        for (int k = 0; k < taps; k += 8) {
+            __m256 t = _mm256_loadu_ps(h + k);
+            a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(x + k), t));
+            b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_loadu_ps(y + k), t));
+        }
+        out[c]     = sumAvx(a);
+        out[c + 1] = sumAvx(b);
+    }
+    if (c < channels) {
+        __m256 a = _mm256_setzero_ps();
+        for (int k = 0; k < taps; k += 8)
+            a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(h + k)));
+        out[c] = sumAvx(a);
+    }
+}
+#endif
+
+static FrameFunction frameFunction()
+{
+#ifdef RESAMPLE_X86
+    if (currentBackend == RESAMPLE_AVX)  return frameAvx;
+    if (currentBackend == RESAMPLE_SSE2) return frameSse2;
+#endif
+    return frameScalar;
+}
+
+// --------------------------------------------------------
+// STREAMING
+// --------------------------------------------------------
+
+/**********************************************************
+ * resamplerInit(...) - History rows for one stream
+ **********************************************************/
+bool resamplerInit(Resampler& r, const ResampleFilter& filter, int channels)
+{
+    if (channels < 1 || channels > RESAMPLE_MAX_CHANNELS)
+        return false;
+    r.filter   = &filter;
+    r.channels = channels;
+    r.capacity = (size_t)filter.taps + RESAMPLE_BLOCK_FRAMES;
+    r.history.assign(r.capacity * channels, 0.0f);
+    resamplerReset(r);
+    return true;
+}
+
+/**********************************************************
+ * resamplerReset(...) - Silence before the first frame
+ *
+ * The first output is centred on input frame 0, so its
+ * taps reach taps/2 - 1 frames before the stream starts.
+ **********************************************************/
+void resamplerReset(Resampler& r)
+{
+    size_t lead = (size_t)r.filter->taps / 2 - 1;
+    for (int c = 0; c < r.channels; ++c)
+        memset(&r.history[c * r.capacity], 0, lead * sizeof(float));
+    r.filled       = lead;
+    r.pos          = 0;
+    r.phase        = 0;
+    r.pendingZeros = 0;
+    r.finished     = false;
+}
+
+/**********************************************************
+ * compact(...) - Drops frames no output needs any more
+ *
+ * At most taps + 1 frames per row are moved.
+ **********************************************************/
+static void compact(Resampler& r)
+{
+    if (r.pos == 0)
+        return;
+    size_t keep = r.filled - r.pos;
+    for (int c = 0; c < r.channels; ++c) {
+        float* row = &r.history[c * r.capacity];
+        memmove(row, row + r.pos, keep * sizeof(float));
+    }
+    r.filled = keep;
+    r.pos    = 0;
+}
+
+/**********************************************************
+ * appendZeros(...) - End-of-stream padding that fits
+ **********************************************************/
+static void appendZeros(Resampler& r)
+{
+    if (r.pendingZeros == 0)
+        return;
+    compact(r);
+    size_t n = r.capacity - r.filled;
+    if (n > r.pendingZeros) n = r.pendingZeros;
+    for (int c = 0; c < r.channels; ++c)
+        memset(&r.history[c * r.capacity + r.filled], 0, n * sizeof(float));
+    r.filled       += n;
+    r.pendingZeros -= n;
+}
+
+/**********************************************************
+ * resampleSpace(...) - Input frames that fit now
+ **********************************************************/
+size_t resampleSpace(Resampler& r)
+{
+    if (r.finished)
+        return 0;
+    compact(r);
+    return r.capacity - r.filled;
+}
+
+/**********************************************************
+ * resampleWrite(...) - Interleaved in, planar rows
+ **********************************************************/
+size_t resampleWrite(Resampler& r, const float* in, size_t frames)
+{
+    size_t n = resampleSpace(r);
+    if (n > frames) n = frames;
+    int channels = r.channels;
+    for (int c = 0; c < channels; ++c) {
+        float* row = &r.history[c * r.capacity + r.filled];
+        for (size_t i = 0; i < n; ++i)
+            row[i] = in[i * channels + c];
+    }
+    r.filled += n;
+    return n;
+}
+
+/**********************************************************
+ * resampleFinish(...) - Flushes the filter's last half
+ *
+ * The outputs up to the last input frame need taps/2
+ * frames after it, which do not exist: they are silence.
+ **********************************************************/
+void resampleFinish(Resampler& r)
+{
+    if (r.finished)
+        return;
+    r.finished     = true;
+    r.pendingZeros = (size_t)r.filter->taps / 2;
+    appendZeros(r);
+}
+
+/**********************************************************
+ * resampleRead(...) - One dot product per channel and frame
+ **********************************************************/
+size_t resampleRead(Resampler& r, float* out, size_t maxFrames)
+{
+    appendZeros(r);
+
+    const ResampleFilter& f = *r.filter;
+    FrameFunction frame = frameFunction();
+    size_t taps = (size_t)f.taps;
+    int channels = r.channels;
+    float next[RESAMPLE_MAX_CHANNELS];
+
+    size_t n = 0;
+    while (n < maxFrames && r.pos + taps <= r.filled) {
+        float* y = out + n * channels;
+        const float* x = &r.history[r.pos];
+        if (!f.interpolate) {
+            frame(x, r.capacity, channels, &f.coeffs[(size_t)r.phase * taps], f.taps, y);
+        } else {
+            // Between rows 'row' and 'row + 1' of the table
+            uint64_t scaled = r.phase * (uint64_t)f.phases;
+            size_t row   = (size_t)(scaled >> RESAMPLE_FRACTION_BITS);
+            float weight = (float)((double)(scaled & (f.den - 1)) / (double)f.den);
+            const float* h = &f.coeffs[row * taps];
+            frame(x, r.capacity, channels, h, f.taps, y);
+            frame(x, r.capacity, channels, h + taps, f.taps, next);
+            for (int c = 0; c < channels; ++c)
+                y[c] += weight * (next[c] - y[c]);
+        }
+
+        r.pos   += f.stepInt;
+        r.phase += f.stepNum;
+        if (r.phase >= f.den) {
+            r.phase -= f.den;
+            r.pos++;
+        }
+        ++n;
+    }
+    return n;
+}
+
+// --------------------------------------------------------
+// NAMES AND BACKEND SELECTION
+// --------------------------------------------------------
+
+const char* resampleQualityName(ResampleQuality quality)
+{
+    switch (quality) {
+        case RESAMPLE_FAST: return "fast";
+        case RESAMPLE_BEST: return "best";
+        default:            return "medium";
+    }
+}
+
+/**********************************************************
+ * resampleBestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+ResampleBackend resampleBestBackend()
+{
+#ifdef RESAMPLE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))  return RESAMPLE_AVX;
+    if (__builtin_cpu_supports("sse2")) return RESAMPLE_SSE2;
+#endif
+    return RESAMPLE_SCALAR;
+}
+
+/**********************************************************
+ * resampleCurrentBackend() - Kernel the converters use
+ **********************************************************/
+ResampleBackend resampleCurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * resampleSetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+ResampleBackend resampleSetBackend(ResampleBackend backend)
+{
+    ResampleBackend best = resampleBestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * resampleBackendName(...) - For logs and bench output
+ **********************************************************/
+const char* resampleBackendName(ResampleBackend backend)
+{
+    switch (backend) {
+        case RESAMPLE_AVX:  return "avx";
+        case RESAMPLE_SSE2: return "sse2";
+        default:            return "scalar";
+    }
+}
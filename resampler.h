@@ -0,0 +1,121 @@
+/**********************************************************
+ *  Orator - resampler.h
+ *
+ *  Streaming sample-rate converter for the audio decoder
+ *  thread: every file is converted to the device rate before
+ *  it goes into its ring, so SDL never has to convert and
+ *  22.05, 44.1, 48 and 96 kHz files can be mixed together.
+ *
+ *  Polyphase windowed sinc. The ratio of the two rates is
+ *  reduced to in/out = M/L; an output sample then always
+ *  falls on one of L fixed fractions of an input sample, and
+ *  each fraction (phase) has its own row of precomputed
+ *  Kaiser-windowed sinc taps. Rate pairs with no small ratio
+ *  (L > RESAMPLE_MAX_PHASES) use RESAMPLE_INTERP_PHASES rows
+ *  and interpolate between the two nearest ones. Output
+ *  frame n is input time n * inRate / outRate: the filter
+ *  is centred on it, so the stream is not delayed.
+ *
+ *  Channels are kept in separate (planar) history rows, so
+ *  the inner loop is one contiguous dot product of samples
+ *  and taps: scalar, SSE2 or AVX, picked at run time like
+ *  the FFT. All buffers are allocated when the converter is
+ *  made; converting never allocates.
+ **********************************************************/
+#ifndef ORATOR_RESAMPLER_H
+#define ORATOR_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Exact phase tables up to this many rows (L)
+#define RESAMPLE_MAX_PHASES 1024
+
+// Rows of an interpolated table
+#define RESAMPLE_INTERP_PHASES 512
+
+// Longest filter; reached only when dividing the rate by 8 or more
+#define RESAMPLE_MAX_TAPS 512
+
+// Most channels of one stream
+#define RESAMPLE_MAX_CHANNELS 8
+
+// Input frames a converter buffers beyond its filter length
+#define RESAMPLE_BLOCK_FRAMES 1024
+
+enum ResampleQuality {
+    RESAMPLE_FAST = 0,   // 16 taps, ~54 dB stopband
+    RESAMPLE_MEDIUM,     // 32 taps, ~80 dB
+    RESAMPLE_BEST        // 64 taps, ~100 dB
+};
+
+enum ResampleBackend {
+    RESAMPLE_SCALAR = 0,
+    RESAMPLE_SSE2,
+    RESAMPLE_AVX
+};
+
+// Taps for one rate pair; read-only once built, so many
+// converters (one per source) can share it
+struct ResampleFilter {
+    int      inRate;
+    int      outRate;
+    ResampleQuality quality;
+    int      taps;          // Per phase, a multiple of 8
+    int      phases;        // Rows (L, or RESAMPLE_INTERP_PHASES)
+    bool     interpolate;   // Blend the two nearest rows
+    uint64_t den;           // Phase counter wraps at this (L, or 2^32)
+    uint64_t stepInt;       // Input frames per output frame, whole part
+    uint64_t stepNum;       // ... and fraction, in 1/den
+    std::vector<float> coeffs;   // (phases + 1) rows of 'taps'
+};
+
+// One stream being converted
+struct Resampler {
+    const ResampleFilter* filter;
+    int      channels;
+    size_t   capacity;      // Frames per history row
+    std::vector<float> history;   // 'channels' rows of 'capacity'
+    size_t   filled;        // Frames in the rows
+    size_t   pos;           // First tap of the next output frame
+    uint64_t phase;         // Position between input frames, in 1/den
+    size_t   pendingZeros;  // End-of-stream padding still to append
+    bool     finished;
+};
+
+// Designs the taps for inRate -> outRate; false (with a
+// message) if either rate is unusable
+bool resampleFilterInit(ResampleFilter& filter, int inRate, int outRate,
+                        ResampleQuality quality);
+
+// A converter for interleaved frames of 'channels' channels
+bool resamplerInit(Resampler& r, const ResampleFilter& filter, int channels);
+
+// Back to the start of a stream (history cleared)
+void resamplerReset(Resampler& r);
+
+// Input frames resampleWrite() would take right now
+size_t resampleSpace(Resampler& r);
+
+// Takes up to 'frames' interleaved input frames; returns how many
+size_t resampleWrite(Resampler& r, const float* in, size_t frames);
+
+// Converts as much buffered input as it can, up to
+// maxFrames interleaved output frames; returns how many.
+// 0 after resampleFinish() means the stream is fully out.
+size_t resampleRead(Resampler& r, float* out, size_t maxFrames);
+
+// End of the input: the last frames are flushed out by the
+// next reads
+void resampleFinish(Resampler& r);
+
+const char* resampleQualityName(ResampleQuality quality);
+
+ResampleBackend resampleBestBackend();
+ResampleBackend resampleCurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+ResampleBackend resampleSetBackend(ResampleBackend backend);
+const char* resampleBackendName(ResampleBackend backend);
+
+#endif // ORATOR_RESAMPLER_H
@@ -0,0 +1,163 @@
+/**********************************************************
+ *  Orator - ringbuffer.cpp
+ *
+ *  SPSC sample ring (see ringbuffer.h).
+ *
+ *  Memory ordering: the writer copies samples, then
+ *  publishes writePos with release; the reader loads it with
+ *  acquire before touching the samples (and the same in the
+ *  other direction for readPos). Each side reads its own
+ *  counter relaxed, since nobody else changes it.
+ **********************************************************/
+#include "ringbuffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**********************************************************
+ * ringInit(...) - Allocates a power-of-two sample buffer
+ **********************************************************/
+bool ringInit(AudioRing& ring, size_t minSamples)
+{
+    size_t capacity = 1;
+    while (capacity < minSamples)
+        capacity <<= 1;
+
+    ring.data = (float*)calloc(capacity, sizeof(float));
+    if (!ring.data) {
+        ring.capacity = ring.mask = 0;
+        return false;
+    }
+    ring.capacity = capacity;
+    ring.mask     = capacity - 1;
+    ringReset(ring);
+    return true;
+}
+
+/**********************************************************
+ * ringFree(...) - Releases the sample buffer
+ **********************************************************/
+void ringFree(AudioRing& ring)
+{
+    free(ring.data);
+    ring.data = NULL;
+    ring.capacity = ring.mask = 0;
+}
+
+/**********************************************************
+ * ringReset(...) - Back to empty
+ **********************************************************/
+void ringReset(AudioRing& ring)
+{
+    ring.writePos.store(0, std::memory_order_relaxed);
+    ring.readPos.store(0, std::memory_order_relaxed);
+}
+
+/**********************************************************
+ * ringSpace(...) - Free samples, as seen by the producer
+ **********************************************************/
+size_t ringSpace(const AudioRing& ring)
+{
+    size_t w = ring.writePos.load(std::memory_order_relaxed);
+    size_t r = ring.readPos.load(std::memory_order_acquire);
+    return ring.capacity - (w - r);
+}
+
+/**********************************************************
+ * ringFill(...) - Readable samples, as seen by the consumer
+ **********************************************************/
+size_t ringFill(const AudioRing& ring)
+{
+    size_t w = ring.writePos.load(std::memory_order_acquire);
+    size_t r = ring.readPos.load(std::memory_order_relaxed);
+    return w - r;
+}
+
+/**********************************************************
+ * ringWrite(...) - Producer: copy in, then publish
+ **********************************************************/
+size_t ringWrite(AudioRing& ring, const float* samples, size_t count)
+{
+    size_t w = ring.writePos.load(std::memory_order_relaxed);
+    size_t r = ring.readPos.load(std::memory_order_acquire);
+    size_t space = ring.capacity - (w - r);
+    if (count > space) count = space;
+    if (count == 0) return 0;
+
+    // At most two copies: up to the end of the buffer, then from the start
+    size_t start = w & ring.mask;
+    size_t first = ring.capacity - start;
+    if (first > count) first = count;
+    memcpy(ring.data + start, samples, first * sizeof(float));
+    memcpy(ring.data, samples + first, (count - first) * sizeof(float));
+
+    ring.writePos.store(w + count, std::memory_order_release);
+    return count;
+}
+
+/**********************************************************
+ * ringWriteRegion(...) - Producer: contiguous free space
+ **********************************************************/
+size_t ringWriteRegion(AudioRing& ring, float** region)
+{
+    size_t w = ring.writePos.load(std::memory_order_relaxed);
+    size_t r = ring.readPos.load(std::memory_order_acquire);
+    size_t space = ring.capacity - (w - r);
+    size_t start = w & ring.mask;
+    size_t toEnd = ring.capacity - start;
+    *region = ring.data + start;
+    return space < toEnd ? space : toEnd;
+}
+
+/**********************************************************
+ * ringCommitWrite(...) - Producer: publish filled samples
+ **********************************************************/
+void ringCommitWrite(AudioRing& ring, size_t count)
+{
+    size_t w = ring.writePos.load(std::memory_order_relaxed);
+    ring.writePos.store(w + count, std::memory_order_release);
+}
+
+/**********************************************************
+ * ringRead(...) - Consumer: copy out, then free the space
+ **********************************************************/
+size_t ringRead(AudioRing& ring, float* samples, size_t count)
+{
+    size_t r = ring.readPos.load(std::memory_order_relaxed);
+    size_t w = ring.writePos.load(std::memory_order_acquire);
+    size_t fill = w - r;
+    if (count > fill) count = fill;
+    if (count == 0) return 0;
+
+    size_t start = r & ring.mask;
+    size_t first = ring.capacity - start;
+    if (first > count) first = count;
+    memcpy(samples, ring.data + start, first * sizeof(float));
+    memcpy(samples + first, ring.data, (count - first) * sizeof(float));
+
+    ring.readPos.store(r + count, std::memory_order_release);
+    return count;
+}
+
+/**********************************************************
+ * ringReadRegion(...) - Consumer: contiguous readable samples
+ **********************************************************/
+size_t ringReadRegion(AudioRing& ring, const float** region)
+{
+    size_t r = ring.readPos.load(std::memory_order_relaxed);
+    size_t w = ring.writePos.load(std::memory_order_acquire);
+    size_t fill = w - r;
+    size_t start = r & ring.mask;
+    size_t toEnd = ring.capacity - start;
+    *region = ring.data + start;
+    return fill < toEnd ? fill : toEnd;
+}
+
+/**********************************************************
+ * ringCommitRead(...) - Consumer: hand samples back
+ **********************************************************/
+void ringCommitRead(AudioRing& ring, size_t count)
+{
+    size_t r = ring.readPos.load(std::memory_order_relaxed);
+    ring.readPos.store(r + count, std::memory_order_release);
+}
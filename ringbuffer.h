@@ -0,0 +1,62 @@
+/**********************************************************
+ *  Orator - ringbuffer.h
+ *
+ *  Lock-free single-producer / single-consumer ring of
+ *  float samples. The decoder thread is the only writer and
+ *  the SDL audio callback the only reader, so two atomic
+ *  counters are all the synchronization needed: no locks,
+ *  no allocation and no system calls on either side.
+ **********************************************************/
+#ifndef ORATOR_RINGBUFFER_H
+#define ORATOR_RINGBUFFER_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Keep the two counters on separate cache lines so the
+// producer and consumer cores do not fight over one line
+#define RING_CACHE_LINE 64
+
+struct AudioRing {
+    float* data;        // capacity samples
+    size_t capacity;    // Power of two
+    size_t mask;        // capacity - 1
+
+    // Total samples ever written / read. They only grow, so
+    // writePos - readPos is the fill level (no wrap-around
+    // ambiguity between "full" and "empty").
+    alignas(RING_CACHE_LINE) std::atomic<size_t> writePos;
+    alignas(RING_CACHE_LINE) std::atomic<size_t> readPos;
+};
+
+// Allocates room for at least minSamples (rounded up to a
+// power of two). Call before either thread starts.
+bool ringInit(AudioRing& ring, size_t minSamples);
+void ringFree(AudioRing& ring);
+
+// Empties the ring; only while neither thread is running
+void ringReset(AudioRing& ring);
+
+// Producer side: copies up to count samples, returns how many fit
+size_t ringWrite(AudioRing& ring, const float* samples, size_t count);
+// Samples the producer can write right now
+size_t ringSpace(const AudioRing& ring);
+
+// Zero-copy producer side: *region points at the free samples
+// up to the end of the buffer (may be fewer than ringSpace()).
+// Fill some of them, then publish with ringCommitWrite().
+size_t ringWriteRegion(AudioRing& ring, float** region);
+void ringCommitWrite(AudioRing& ring, size_t count);
+
+// Consumer side: copies up to count samples, returns how many were read
+size_t ringRead(AudioRing& ring, float* samples, size_t count);
+// Samples the consumer can read right now
+size_t ringFill(const AudioRing& ring);
+
+// Zero-copy consumer side: *region points at readable samples
+// up to the end of the buffer (may be fewer than ringFill()).
+// Use some of them, then free them with ringCommitRead().
+size_t ringReadRegion(AudioRing& ring, const float** region);
+void ringCommitRead(AudioRing& ring, size_t count);
+
+#endif // ORATOR_RINGBUFFER_H
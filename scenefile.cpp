@@ -0,0 +1,200 @@
+/**********************************************************
+ *  Orator - scenefile.cpp
+ *
+ *  Scene file parser and watcher (see scenefile.h).
+ **********************************************************/
+#include "scenefile.h"
+#include "orator.h"    // MAX_MESH_DETAIL
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <string>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static int         watchFd = -1;
+static std::string watchName;      // File name inside the watched directory
+static bool        watchChanged;   // Seen by sceneWatchPending(), not yet taken
+
+// --------------------------------------------------------
+// PARSING
+// --------------------------------------------------------
+
+/**********************************************************
+ * parseNumbers(...) - Up to 'max' numbers, nothing else
+ *
+ * Returns how many there were, or -1 for anything that is
+ * not a number (or one too many).
+ **********************************************************/
+static int parseNumbers(const char* text, float* out, int max)
+{
+    int count = 0;
+    for (;;) {
+        while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')
+            text++;
+        if (!*text)
+            return count;
+        char* end;
+        float value = strtof(text, &end);
+        if (end == text || count == max || !isfinite(value))
+            return -1;
+        out[count++] = value;
+        text = end;
+    }
+}
+
+/**********************************************************
+ * sceneFileRead(...) - All or nothing
+ **********************************************************/
+bool sceneFileRead(const char* path, SceneConfig& config)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Scene: cannot read '%s'\n", path);
+        return false;
+    }
+    SceneConfig next = config;
+    char line[256];
+    char error[64] = "";
+    int lineNumber = 0;
+    while (!error[0] && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (!strchr(line, '\n')) {
+            int c = getc(file);
+            if (c != EOF) {   // Not just a last line without a newline
+                snprintf(error, sizeof(error), "line longer than %d characters",
+                         (int)sizeof(line) - 2);
+                break;
+            }
+        }
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        char key[32];
+        int  keyEnd = 0;
+        if (sscanf(line, " %31s%n", key, &keyEnd) != 1)
+            continue;   // Blank or only a comment
+
+        float v[4];
+        int n = parseNumbers(line + keyEnd, v, 4);
+        if (strcmp(key, "light") == 0) {
+            if (n == 3 || n == 4) {
+                memcpy(next.light, v, 3 * sizeof(float));
+                next.light[3] = n == 4 ? v[3] : 1.0f;
+                if (next.light[3] == 0.0f && v[0] == 0.0f && v[1] == 0.0f && v[2] == 0.0f)
+                    snprintf(error, sizeof(error), "a directional light needs a direction");
+            } else {
+                snprintf(error, sizeof(error), "light expects x y z [w]");
+            }
+        } else if (strcmp(key, "floor") != 0 && strcmp(key, "cap-angle") != 0 &&
+                   strcmp(key, "inner-ring") != 0 && strcmp(key, "concavity") != 0 &&
+                   strcmp(key, "detail") != 0) {
+            snprintf(error, sizeof(error), "unknown setting '%s'", key);
+        } else if (n != 1) {
+            snprintf(error, sizeof(error), "%s expects one number", key);
+        } else if (strcmp(key, "floor") == 0) {
+            next.floorHeight = v[0];
+        } else if (strcmp(key, "cap-angle") == 0) {
+            next.phiMax = v[0] * (float)M_PI / 180.0f;
+        } else if (strcmp(key, "inner-ring") == 0) {
+            next.innerRing = v[0];
+        } else if (strcmp(key, "concavity") == 0) {
+            next.concavity = v[0];
+        } else {
+            if (v[0] < 1.0f || v[0] > MAX_MESH_DETAIL || v[0] != floorf(v[0]))
+                snprintf(error, sizeof(error), "detail must be a whole number from 1 to %d",
+                         MAX_MESH_DETAIL);
+            else
+                next.detail = (int)v[0];
+        }
+    }
+    fclose(file);
+
+    if (error[0]) {
+        fprintf(stderr, "Scene: %s:%d: %s\n", path, lineNumber, error);
+        return false;
+    }
+    config = next;
+    return true;
+}
+
+// --------------------------------------------------------
+// WATCHING
+// --------------------------------------------------------
+
+/**********************************************************
+ * sceneWatchStart(...) - Watch the directory for the file
+ **********************************************************/
+bool sceneWatchStart(const char* path)
+{
+    std::string full = path;
+    size_t slash = full.rfind('/');
+    std::string dir = slash == std::string::npos ? "."
+                    : slash == 0                 ? "/" : full.substr(0, slash);
+    watchName = slash == std::string::npos ? full : full.substr(slash + 1);
+
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0)
+        return false;
+    // Written in place, or renamed over the old file
+    if (inotify_add_watch(watchFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(watchFd);
+        watchFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**********************************************************
+ * readWatchEvents() - Drain; remember if the file was written
+ *
+ * Other files in the same directory show up as well and
+ * are skipped.
+ **********************************************************/
+static void readWatchEvents()
+{
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t bytes = read(watchFd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+            return;   // EAGAIN: nothing more
+        for (char* p = buffer; p < buffer + bytes; ) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            if (event->len > 0 && watchName == event->name)
+                watchChanged = true;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+/**********************************************************
+ * sceneWatchPending() - Written? Keeps the answer
+ **********************************************************/
+bool sceneWatchPending()
+{
+    if (watchFd < 0)
+        return false;
+    readWatchEvents();
+    return watchChanged;
+}
+
+/**********************************************************
+ * sceneWatchChanged() - Written? Takes the answer
+ *
+ * Several saves since the last frame give one reload.
+ **********************************************************/
+bool sceneWatchChanged()
+{
+    if (watchFd < 0)
+        return false;
+    readWatchEvents();
+    bool changed = watchChanged;
+    watchChanged = false;
+    return changed;
+}
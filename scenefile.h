@@ -0,0 +1,58 @@
+/**********************************************************
+ *  Orator - scenefile.h
+ *
+ *  Scene file (--scene FILE): light, floor, shape and
+ *  tessellation detail as plain text, read at startup and
+ *  again whenever the file is saved. One setting per line,
+ *  '#' starts a comment:
+ *
+ *    light      5 5 5 1     # x y z [w], w = 0: directional
+ *    floor      -10         # z of the floor
+ *    cap-angle  135         # degrees, as --cap-angle
+ *    inner-ring 0.4         # as --inner-ring
+ *    concavity  0.1         # as --concavity
+ *    detail     1           # as --detail
+ *
+ *  A setting left out keeps its current value. A file with
+ *  an error is not applied at all, so a half-saved file
+ *  changes nothing.
+ *
+ *  The file is watched with inotify. The render thread asks
+ *  once per frame whether it was written (one non-blocking
+ *  read); orator.cpp then applies only what changed, see
+ *  reloadSceneFile().
+ **********************************************************/
+#ifndef ORATOR_SCENEFILE_H
+#define ORATOR_SCENEFILE_H
+
+#include <GL/gl.h>
+
+// How often an idle window looks for a saved file (ms)
+#define SCENE_WATCH_POLL_MS 250
+
+struct SceneConfig {
+    GLfloat light[4];      // Light position (w = 1) or direction
+    float   floorHeight;   // z of the floor
+    float   phiMax;        // Cap angle, radians
+    float   innerRing;
+    float   concavity;
+    int     detail;        // 1..MAX_MESH_DETAIL
+};
+
+// Reads 'path' over 'config'. On an error prints it with the
+// line number and leaves 'config' as it was.
+bool sceneFileRead(const char* path, SceneConfig& config);
+
+// inotify on the file's directory (editors that save by
+// renaming a new file over the old one replace its inode)
+bool sceneWatchStart(const char* path);
+
+// Has the file been written since the last sceneWatchChanged()?
+// Events for other files in the directory do not count. Leaves
+// the answer for sceneWatchChanged(): for the idle window's timer.
+bool sceneWatchPending();
+
+// Same, but takes the answer: true once per batch of writes
+bool sceneWatchChanged();
+
+#endif // ORATOR_SCENEFILE_H
@@ -0,0 +1,157 @@
+/**********************************************************
+ *  Orator - scheduler.cpp
+ *
+ *  Event-driven frame pacing (see scheduler.h).
+ **********************************************************/
+#include "scheduler.h"
+
+#include <GL/glut.h>
+#include <GL/glx.h>    // Swap interval for --vsync
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+bool schedulerVsync = false;
+int  schedulerFps   = SCHEDULER_DEFAULT_FPS;
+
+static bool frameArmed = false;          // A redisplay is on its way
+static bool animatingLastFrame = false;  // Was the previous frame part of an animation?
+static Clock::time_point lastFrameStart;
+static bool haveLastFrame = false;
+
+// Counters for schedulerPrintStats()
+static unsigned long framesDrawn = 0;
+static unsigned long redrawsMerged = 0;
+static unsigned long idlePeriods = 0;
+
+// Swap-interval entry points (GLX_EXT/MESA/SGI_swap_control)
+typedef void (*SwapIntervalExtProc)(Display*, GLXDrawable, int);
+typedef int  (*SwapIntervalMesaProc)(unsigned int);
+typedef int  (*SwapIntervalSgiProc)(int);
+
+/**********************************************************
+ * setSwapInterval(...) - First swap-control extension found
+ **********************************************************/
+static bool setSwapInterval(int interval)
+{
+    SwapIntervalExtProc ext = (SwapIntervalExtProc)
+        glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalEXT");
+    Display* display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (ext && display && drawable) {
+        ext(display, drawable, interval);
+        return true;
+    }
+    SwapIntervalMesaProc mesa = (SwapIntervalMesaProc)
+        glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+    if (mesa && mesa(interval) == 0)
+        return true;
+    SwapIntervalSgiProc sgi = (SwapIntervalSgiProc)
+        glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+    if (sgi && interval > 0 && sgi(interval) == 0)
+        return true;
+    return false;
+}
+
+/**********************************************************
+ * schedulerInit() - Swap interval: 1 with --vsync, else 0
+ *
+ * Without vsync the timer does the pacing, so the swap
+ * must not block as well.
+ **********************************************************/
+void schedulerInit()
+{
+    if (!setSwapInterval(schedulerVsync ? 1 : 0) && schedulerVsync) {
+        fprintf(stderr, "No GLX swap control extension; using timer pacing\n");
+        schedulerVsync = false;
+    }
+    if (schedulerFps < 1) schedulerFps = SCHEDULER_DEFAULT_FPS;
+}
+
+/**********************************************************
+ * frameDue(...) - GLUT timer: time for the armed frame
+ **********************************************************/
+static void frameDue(int value)
+{
+    (void)value;
+    glutPostRedisplay();
+}
+
+/**********************************************************
+ * armFrame() - One redisplay at the next frame slot
+ **********************************************************/
+static void armFrame()
+{
+    frameArmed = true;
+    if (schedulerVsync || !haveLastFrame) {
+        glutPostRedisplay();   // The swap (or nothing) paces us
+        return;
+    }
+    // Next slot is one frame interval after the last frame began
+    double interval = 1.0 / schedulerFps;
+    double since = std::chrono::duration<double>(Clock::now() - lastFrameStart).count();
+    double wait = interval - since;
+    if (wait <= 0.0)
+        glutPostRedisplay();
+    else
+        glutTimerFunc((unsigned int)ceil(wait * 1000.0), frameDue, 0);
+}
+
+/**********************************************************
+ * requestRedraw() - Coalescing redraw request
+ **********************************************************/
+void requestRedraw()
+{
+    if (frameArmed) {
+        redrawsMerged++;
+        return;
+    }
+    armFrame();
+}
+
+/**********************************************************
+ * schedulerBeginFrame() - Elapsed time for the animation
+ **********************************************************/
+double schedulerBeginFrame()
+{
+    Clock::time_point now = Clock::now();
+    double dt = 0.0;
+    // After an idle period the gap is not animation time
+    if (haveLastFrame && animatingLastFrame)
+        dt = std::chrono::duration<double>(now - lastFrameStart).count();
+    if (dt > SCHEDULER_MAX_STEP)
+        dt = SCHEDULER_MAX_STEP;
+
+    lastFrameStart = now;
+    haveLastFrame = true;
+    frameArmed = false;
+    framesDrawn++;
+    return dt;
+}
+
+/**********************************************************
+ * schedulerEndFrame(...) - Keep going, or go idle
+ **********************************************************/
+void schedulerEndFrame(bool animating)
+{
+    if (animating) {
+        if (!frameArmed)
+            armFrame();
+    } else if (animatingLastFrame) {
+        idlePeriods++;   // Nothing armed: GLUT sleeps until input
+    }
+    animatingLastFrame = animating;
+}
+
+/**********************************************************
+ * schedulerPrintStats() - Summary on exit
+ **********************************************************/
+void schedulerPrintStats()
+{
+    printf("Scheduler     : %s, %lu frames drawn, %lu redraw requests merged, "
+           "%lu idle periods\n",
+           schedulerVsync ? "vsync" : "timer", framesDrawn, redrawsMerged, idlePeriods);
+}
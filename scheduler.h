@@ -0,0 +1,42 @@
+/**********************************************************
+ *  Orator - scheduler.h
+ *
+ *  Frame pacing for the GLUT window. Instead of a timer
+ *  that re-arms itself every 16 ms forever:
+ *   - animation advances on the simulation thread
+ *     (simulation.h); a frame only shows where it is,
+ *   - input only marks the window dirty; any number of
+ *     events before the next frame slot give one redraw,
+ *   - when nothing animates and no input arrives, no timer
+ *     is armed at all and GLUT sleeps in its event wait,
+ *   - with --vsync the buffer swap (swap interval 1) paces
+ *     continuous animation instead of a timer.
+ **********************************************************/
+#ifndef ORATOR_SCHEDULER_H
+#define ORATOR_SCHEDULER_H
+
+#define SCHEDULER_DEFAULT_FPS 60
+// Longest frame gap schedulerBeginFrame() reports (seconds)
+#define SCHEDULER_MAX_STEP    0.25
+
+extern bool schedulerVsync;   // --vsync
+extern int  schedulerFps;     // --fps N (timer pacing without vsync)
+
+// After the window exists: applies the swap interval
+void schedulerInit();
+
+// Something changed (input, toggles): draw one frame soon.
+// Calls before that frame are merged into it.
+void requestRedraw();
+
+// Frame brackets, called from display(). schedulerBeginFrame()
+// returns the seconds since the previous frame (0 for the
+// first frame after an idle period). schedulerEndFrame() arms
+// the next frame if the scene is still animating.
+double schedulerBeginFrame();
+void   schedulerEndFrame(bool animating);
+
+// Frames drawn, redraw requests merged, idle periods
+void schedulerPrintStats();
+
+#endif // ORATOR_SCHEDULER_H
@@ -0,0 +1,268 @@
+/**********************************************************
+ *  Orator - shader.cpp
+ *
+ *  GLSL compile/link helpers (see shader.h).
+ **********************************************************/
+#include "shader.h"
+#include "programcache.h"   // Linked programs from an earlier start
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+// Bumped by every change, so a program knows what it missed
+static unsigned long transformVersion = 1;
+static unsigned long lightVersion     = 1;
+static mat4 currentProjection = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+static mat4 currentModelview  = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+static ShaderLight currentLight;
+
+/**********************************************************
+ * compileStage(...) - Compile one shader stage
+ **********************************************************/
+static GLuint compileStage(const char* name, GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length > 1 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, log.data());
+        fprintf(stderr, "shader '%s': %s stage failed to compile:\n%s\n", name,
+                type == GL_VERTEX_SHADER ? "vertex" : "fragment", log.data());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/**********************************************************
+ * linkProgram(...) - Compile + link a vertex/fragment pair
+ **********************************************************/
+static GLuint linkProgram(const char* name,
+                          const char* vertexSource,
+                          const char* fragmentSource)
+{
+    GLuint vs = compileStage(name, GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compileStage(name, GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    // Lets the driver keep what glGetProgramBinary returns
+    if (programCacheSupported())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
+
+    // The program keeps the compiled code; the shader objects can go
+    glDetachShader(program, vs);
+    glDetachShader(program, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length > 1 ? length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, log.data());
+        fprintf(stderr, "shader '%s': link failed:\n%s\n", name, log.data());
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/**********************************************************
+ * buildProgram(...) - From the program cache, or compiled
+ *                     (and then saved to it)
+ **********************************************************/
+GLuint buildProgram(const char* name,
+                    const char* vertexSource,
+                    const char* fragmentSource)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    GLuint program = programCacheLoad(name, vertexSource, fragmentSource);
+    if (!program) {
+        program = linkProgram(name, vertexSource, fragmentSource);
+        if (program) {
+            programCacheStats.compiled++;
+            programCacheStore(name, vertexSource, fragmentSource, program);
+        }
+    }
+
+    programCacheStats.buildMs +=
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return program;
+}
+
+// --------------------------------------------------------
+// TRANSFORMS AND LIGHT
+// --------------------------------------------------------
+
+/**********************************************************
+ * shaderFindUniforms(...) - Locations, nothing uploaded yet
+ **********************************************************/
+void shaderFindUniforms(GLuint program, ShaderUniforms& u)
+{
+    u.program             = program;
+    u.modelview           = glGetUniformLocation(program, "uModelview");
+    u.modelviewProjection = glGetUniformLocation(program, "uModelviewProjection");
+    u.normalMatrix        = glGetUniformLocation(program, "uNormalMatrix");
+    u.lightPosition       = glGetUniformLocation(program, "uLightPosition");
+    u.lightAmbient        = glGetUniformLocation(program, "uLightAmbient");
+    u.lightDiffuse        = glGetUniformLocation(program, "uLightDiffuse");
+    u.lightSpecular       = glGetUniformLocation(program, "uLightSpecular");
+    u.globalAmbient       = glGetUniformLocation(program, "uGlobalAmbient");
+    u.materialSpecular    = glGetUniformLocation(program, "uMaterialSpecular");
+    u.shininess           = glGetUniformLocation(program, "uShininess");
+    u.transformVersion    = 0;
+    u.lightVersion        = 0;
+}
+
+/**********************************************************
+ * shaderSetLight(...) - For the programs and GL_LIGHT0
+ *
+ * The position is given in eye space, so it is set with an
+ * identity modelview.
+ **********************************************************/
+void shaderSetLight(const ShaderLight& light)
+{
+    currentLight = light;
+    lightVersion++;
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glLightfv(GL_LIGHT0, GL_POSITION, light.position);
+    glLoadMatrixf(currentModelview.m);
+    glLightfv(GL_LIGHT0, GL_AMBIENT,  light.ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE,  light.diffuse);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, light.specular);
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, light.globalAmbient);
+}
+
+/**********************************************************
+ * shaderSetProjection(...) / shaderSetModelview(...)
+ *
+ * The GL copy is what the fixed-function draws use; the
+ * modelview stack is left in GL_MODELVIEW mode.
+ **********************************************************/
+void shaderSetProjection(const mat4& projection)
+{
+    currentProjection = projection;
+    transformVersion++;
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(projection.m);
+    glMatrixMode(GL_MODELVIEW);
+}
+
+void shaderSetModelview(const mat4& modelview)
+{
+    currentModelview = modelview;
+    transformVersion++;
+    glLoadMatrixf(modelview.m);
+}
+
+const mat4& shaderProjection()
+{
+    return currentProjection;
+}
+
+const mat4& shaderModelview()
+{
+    return currentModelview;
+}
+
+/**********************************************************
+ * shaderApplyUniforms(...) - Upload what the program missed
+ **********************************************************/
+void shaderApplyUniforms(ShaderUniforms& u)
+{
+    if (u.transformVersion != transformVersion) {
+        mat4 modelviewProjection;
+        float normalMatrix[9];
+        mat4Multiply(modelviewProjection, currentProjection, currentModelview);
+        mat4NormalMatrix(currentModelview, normalMatrix);
+        glUniformMatrix4fv(u.modelview, 1, GL_FALSE, currentModelview.m);
+        glUniformMatrix4fv(u.modelviewProjection, 1, GL_FALSE, modelviewProjection.m);
+        glUniformMatrix3fv(u.normalMatrix, 1, GL_FALSE, normalMatrix);
+        u.transformVersion = transformVersion;
+    }
+    if (u.lightVersion != lightVersion) {
+        const ShaderLight& l = currentLight;
+        glUniform4fv(u.lightPosition,    1, l.position);
+        glUniform4fv(u.lightAmbient,     1, l.ambient);
+        glUniform4fv(u.lightDiffuse,     1, l.diffuse);
+        glUniform4fv(u.lightSpecular,    1, l.specular);
+        glUniform4fv(u.globalAmbient,    1, l.globalAmbient);
+        glUniform4fv(u.materialSpecular, 1, l.materialSpecular);
+        glUniform1f(u.shininess, l.shininess);
+        u.lightVersion = lightVersion;
+    }
+}
+
+// --------------------------------------------------------
+// SHARED GLSL
+// --------------------------------------------------------
+
+// Global ambient + LIGHT0 ambient/diffuse/specular with
+// GL_COLOR_MATERIAL on ambient and diffuse, infinite viewer,
+// all from uniforms (shaderApplyUniforms). The result goes
+// to gl_FrontColor, so glShadeModel(GL_FLAT) keeps working.
+const char* const shaderLightingGlsl =
+    "uniform mat4  uModelview;\n"
+    "uniform mat4  uModelviewProjection;\n"
+    "uniform mat3  uNormalMatrix;\n"
+    "uniform vec4  uLightPosition;\n"   // Eye space
+    "uniform vec4  uLightAmbient;\n"
+    "uniform vec4  uLightDiffuse;\n"
+    "uniform vec4  uLightSpecular;\n"
+    "uniform vec4  uGlobalAmbient;\n"
+    "uniform vec4  uMaterialSpecular;\n"
+    "uniform float uShininess;\n"
+    "vec4 fixedFunctionColor(vec3 p, vec3 n, vec4 color)\n"
+    "{\n"
+    "    vec3 N = normalize(uNormalMatrix * n);\n"
+    "    vec3 eyePos = (uModelview * vec4(p, 1.0)).xyz;\n"
+    "    vec4 lp = uLightPosition;\n"
+    "    vec3 L = normalize(lp.w == 0.0 ? lp.xyz : lp.xyz - eyePos);\n"
+    "    float NdotL = max(dot(N, L), 0.0);\n"
+    "    vec4 lit = uGlobalAmbient * color\n"
+    "             + uLightAmbient * color\n"
+    "             + uLightDiffuse * color * NdotL;\n"
+    "    if (NdotL > 0.0) {\n"
+    "        vec3 H = normalize(L + vec3(0.0, 0.0, 1.0));\n"
+    "        lit += uLightSpecular * uMaterialSpecular *\n"
+    "               pow(max(dot(N, H), 0.0), uShininess);\n"
+    "    }\n"
+    "    return vec4(clamp(lit.rgb, 0.0, 1.0), color.a);\n"
+    "}\n"
+    "vec4 transformPosition(vec3 p)\n"
+    "{\n"
+    "    return uModelviewProjection * vec4(p, 1.0);\n"
+    "}\n";
+
+const char* const shaderModulateFragmentSource =
+    "#version 330 compatibility\n"
+    "uniform bool      uTextured;\n"
+    "uniform sampler2D uTexture;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 color = gl_Color;\n"
+    "    if (uTextured)\n"
+    "        color *= texture(uTexture, gl_TexCoord[0].st);\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
@@ -0,0 +1,80 @@
+/**********************************************************
+ *  Orator - shader.h
+ *
+ *  Small helpers to compile and link GLSL programs, and the
+ *  transform and light state the programs read as uniforms.
+ *  Matrices are composed on the CPU (mat4.h); the current
+ *  modelview and projection are loaded into GL for the
+ *  fixed-function draws and uploaded to a program when it
+ *  is drawn with and they changed since its last upload.
+ *  (The shaders still use the compatibility profile for
+ *  gl_Color, gl_TexCoord and gl_FrontColor.)
+ **********************************************************/
+#ifndef ORATOR_SHADER_H
+#define ORATOR_SHADER_H
+
+#include "mat4.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+// Compiles both stages and links them, or loads the linked
+// program from the program cache (programcache.h). 'name' is
+// only used in messages. Returns 0 (and prints the log) on
+// failure.
+GLuint buildProgram(const char* name,
+                    const char* vertexSource,
+                    const char* fragmentSource);
+
+// The light of initLighting(), position in eye space
+struct ShaderLight {
+    GLfloat position[4];
+    GLfloat ambient[4];
+    GLfloat diffuse[4];
+    GLfloat specular[4];
+    GLfloat globalAmbient[4];     // GL_LIGHT_MODEL_AMBIENT
+    GLfloat materialSpecular[4];
+    GLfloat shininess;
+};
+
+// Uniform locations of one program, and what it last got
+struct ShaderUniforms {
+    GLuint program;
+    GLint  modelview, modelviewProjection, normalMatrix;
+    GLint  lightPosition, lightAmbient, lightDiffuse, lightSpecular;
+    GLint  globalAmbient, materialSpecular, shininess;
+    unsigned long transformVersion;   // 0 = never uploaded
+    unsigned long lightVersion;
+};
+
+// Looks up the uniforms of shaderLightingGlsl in 'program'
+void shaderFindUniforms(GLuint program, ShaderUniforms& uniforms);
+
+// Sets the light for every program (and GL_LIGHT0)
+void shaderSetLight(const ShaderLight& light);
+
+// Current transforms: loaded into GL right away, uploaded to
+// programs by shaderApplyUniforms()
+void shaderSetProjection(const mat4& projection);
+void shaderSetModelview(const mat4& modelview);
+const mat4& shaderProjection();
+const mat4& shaderModelview();
+
+// After binding the program: uploads whatever changed
+void shaderApplyUniforms(ShaderUniforms& uniforms);
+
+// GLSL shared by the shader-based speaker paths (instanced
+// arrays, procedural mesh). shaderLightingGlsl declares the
+// transform and light uniforms and defines
+//   vec4 fixedFunctionColor(vec3 p, vec3 n, vec4 color)
+// which redoes initLighting() for the object-space point p
+// with normal n, and
+//   vec4 transformPosition(vec3 p)
+// for gl_Position; put it between the declarations and main().
+extern const char* const shaderLightingGlsl;
+
+// Fragment shader: gl_Color, times the texture if uTextured
+// (GL_MODULATE, like the fixed-function path)
+extern const char* const shaderModulateFragmentSource;
+
+#endif // ORATOR_SHADER_H
@@ -0,0 +1,219 @@
+/**********************************************************
+ *  Orator - shadow.cpp
+ *
+ *  Silhouette extraction and projection for the planar
+ *  shadow (see shadow.h).
+ **********************************************************/
+#include "shadow.h"
+#include "mesh.h"      // frameStats
+#include "arena.h"     // Points, hull and outline live for one frame
+
+#include <math.h>
+#include <algorithm>   // std::sort
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+ShadowMode shadowMode = SHADOW_SILHOUETTE;
+
+// 2D point in the floor plane's own coordinates, plus the 3D point
+struct PlanePoint {
+    float u, v;
+    ShadowPoint world;
+};
+
+// --------------------------------------------------------
+// PLACEMENT
+// --------------------------------------------------------
+
+/**********************************************************
+ * buildObjectMatrix(...) - T * Rx * Ry * Rz
+ **********************************************************/
+void buildObjectMatrix(mat4& m, float tx, float ty, float tz,
+                       float rx, float ry, float rz)
+{
+    mat4Identity(m);
+    mat4Translate(m, tx, ty, tz);
+    mat4Rotate(m, rx, 1, 0, 0);
+    mat4Rotate(m, ry, 0, 1, 0);
+    mat4Rotate(m, rz, 0, 0, 1);
+}
+
+// --------------------------------------------------------
+// SILHOUETTE
+// --------------------------------------------------------
+
+/**********************************************************
+ * projectPoint(...) - Object point -> shadow point on plane
+ **********************************************************/
+static bool projectPoint(const mat4& objectMatrix, const mat4& shadowMatrix,
+                         const float p[3], ShadowPoint& out)
+{
+    vec4 object = { { p[0], p[1], p[2], 1.0f } };
+    vec4 s = mat4Transform(shadowMatrix, mat4Transform(objectMatrix, object));
+    // s.v[3] <= 0 means the point is level with or above the light
+    if (s.v[3] <= 1.0e-6f)
+        return false;
+    out.x = s.v[0] / s.v[3];
+    out.y = s.v[1] / s.v[3];
+    out.z = s.v[2] / s.v[3];
+    return true;
+}
+
+/**********************************************************
+ * cross2(...) - z of (b - o) x (c - o), > 0 for a left turn
+ **********************************************************/
+static float cross2(const PlanePoint& o, const PlanePoint& b, const PlanePoint& c)
+{
+    return (b.u - o.u) * (c.v - o.v) - (b.v - o.v) * (c.u - o.u);
+}
+
+/**********************************************************
+ * comparePlanePoints(...) - Lexicographic order for the hull
+ **********************************************************/
+static bool comparePlanePoints(const PlanePoint& a, const PlanePoint& b)
+{
+    return a.u < b.u || (a.u == b.u && a.v < b.v);
+}
+
+/**********************************************************
+ * buildSilhouetteShadow(...) - Hull of the projected outline
+ **********************************************************/
+bool buildSilhouetteShadow(const mat4& objectMatrix,
+                           const mat4& shadowMatrix,
+                           const GLfloat lightPos[4],
+                           const GLfloat plane[4],
+                           float phiMax, float capScaleZ, int steps,
+                           ShadowPoint** outline, int* count)
+{
+    *outline = NULL;
+    *count   = 0;
+    if (steps < 3) steps = 3;
+
+    // Light in object space: R^T * (L - t) for a point light,
+    // R^T * L for a directional one (w = 0)
+    float lw[3];
+    if (lightPos[3] != 0.0f) {
+        for (int k = 0; k < 3; ++k)
+            lw[k] = lightPos[k] / lightPos[3] - objectMatrix.m[12 + k];
+    } else {
+        for (int k = 0; k < 3; ++k)
+            lw[k] = lightPos[k];
+    }
+    float lo[3];
+    for (int k = 0; k < 3; ++k)
+        lo[k] = objectMatrix.m[k*4 + 0] * lw[0] +
+                objectMatrix.m[k*4 + 1] * lw[1] +
+                objectMatrix.m[k*4 + 2] * lw[2];
+
+    // The stretched cap is a unit sphere in coordinates where z
+    // is shrunk back about the rim plane; work there and stretch
+    // the grazing points again before projecting them
+    float zRim = cosf(phiMax);
+    if (lightPos[3] != 0.0f)
+        lo[2] = zRim + (lo[2] - zRim) / capScaleZ;
+    else
+        lo[2] /= capScaleZ;
+
+    // Grazing circle on the unit sphere: points p with p.(p - L) = 0,
+    // i.e. p.L = 1. Center L/|L|^2, radius sqrt(1 - 1/|L|^2).
+    // For a directional light it is the great circle normal to L.
+    float len2 = lo[0]*lo[0] + lo[1]*lo[1] + lo[2]*lo[2];
+    if (len2 <= 1.0f + 1.0e-4f && lightPos[3] != 0.0f)
+        return false;   // Light inside the sphere
+    float len = sqrtf(len2);
+    float d[3] = { lo[0] / len, lo[1] / len, lo[2] / len };
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    float radius = 1.0f;
+    if (lightPos[3] != 0.0f) {
+        for (int k = 0; k < 3; ++k) center[k] = lo[k] / len2;
+        radius = sqrtf(1.0f - 1.0f / len2);
+    }
+    // Two unit vectors spanning the circle's plane
+    float a[3] = { 1.0f, 0.0f, 0.0f };
+    if (fabsf(d[0]) > 0.9f) { a[0] = 0.0f; a[1] = 1.0f; }
+    float e1[3] = { d[1]*a[2] - d[2]*a[1], d[2]*a[0] - d[0]*a[2], d[0]*a[1] - d[1]*a[0] };
+    float e1len = sqrtf(e1[0]*e1[0] + e1[1]*e1[1] + e1[2]*e1[2]);
+    for (int k = 0; k < 3; ++k) e1[k] /= e1len;
+    float e2[3] = { d[1]*e1[2] - d[2]*e1[1], d[2]*e1[0] - d[0]*e1[2], d[0]*e1[1] - d[1]*e1[0] };
+
+    // 2D frame in the floor plane, right-handed with its normal
+    float n[3] = { plane[0], plane[1], plane[2] };
+    float nlen = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    for (int k = 0; k < 3; ++k) n[k] /= nlen;
+    float b[3] = { 1.0f, 0.0f, 0.0f };
+    if (fabsf(n[0]) > 0.9f) { b[0] = 0.0f; b[1] = 1.0f; }
+    float pu[3] = { n[1]*b[2] - n[2]*b[1], n[2]*b[0] - n[0]*b[2], n[0]*b[1] - n[1]*b[0] };
+    float pulen = sqrtf(pu[0]*pu[0] + pu[1]*pu[1] + pu[2]*pu[2]);
+    for (int k = 0; k < 3; ++k) pu[k] /= pulen;
+    float pv[3] = { n[1]*pu[2] - n[2]*pu[1], n[2]*pu[0] - n[0]*pu[2], n[0]*pu[1] - n[1]*pu[0] };
+
+    float rimR   = sinf(phiMax);
+    PlanePoint* points = arenaArray<PlanePoint>(steps * 2);
+    size_t pointCount = 0;
+
+    for (int i = 0; i < steps; ++i) {
+        float t = i * (2.0f * (float)M_PI) / steps;
+        float ct = cosf(t), st = sinf(t);
+        PlanePoint pp;
+
+        // Rim of the cap (the ring's outer edge)
+        float rim[3] = { rimR * ct, rimR * st, zRim };
+        if (!projectPoint(objectMatrix, shadowMatrix, rim, pp.world))
+            return false;
+        pp.u = pp.world.x*pu[0] + pp.world.y*pu[1] + pp.world.z*pu[2];
+        pp.v = pp.world.x*pv[0] + pp.world.y*pv[1] + pp.world.z*pv[2];
+        points[pointCount++] = pp;
+
+        // Grazing circle, only where it lies on the cap
+        float g[3];
+        for (int k = 0; k < 3; ++k)
+            g[k] = center[k] + radius * (ct * e1[k] + st * e2[k]);
+        if (g[2] >= zRim) {
+            g[2] = zRim + (g[2] - zRim) * capScaleZ;
+            if (!projectPoint(objectMatrix, shadowMatrix, g, pp.world))
+                return false;
+            pp.u = pp.world.x*pu[0] + pp.world.y*pu[1] + pp.world.z*pu[2];
+            pp.v = pp.world.x*pv[0] + pp.world.y*pv[1] + pp.world.z*pv[2];
+            points[pointCount++] = pp;
+        }
+    }
+
+    // Andrew's monotone chain: lower hull, then upper hull
+    std::sort(points, points + pointCount, comparePlanePoints);
+    PlanePoint* hull = arenaArray<PlanePoint>(pointCount * 2);
+    size_t h = 0;
+    for (size_t i = 0; i < pointCount; ++i) {
+        while (h >= 2 && cross2(hull[h-2], hull[h-1], points[i]) <= 0.0f) h--;
+        hull[h++] = points[i];
+    }
+    for (size_t i = pointCount - 1, lower = h + 1; i-- > 0; ) {
+        while (h >= lower && cross2(hull[h-2], hull[h-1], points[i]) <= 0.0f) h--;
+        hull[h++] = points[i];
+    }
+    if (h < 4)
+        return false;   // Degenerate (e.g. light in the floor plane)
+
+    // The last point repeats the first one
+    *count   = (int)h - 1;
+    *outline = arenaArray<ShadowPoint>(*count);
+    for (int i = 0; i < *count; ++i)
+        (*outline)[i] = hull[i].world;
+    return true;
+}
+
+/**********************************************************
+ * drawShadowOutline(...) - Convex polygon as a triangle fan
+ **********************************************************/
+void drawShadowOutline(const ShadowPoint* outline, int count)
+{
+    glBegin(GL_TRIANGLE_FAN);
+    for (int i = 0; i < count; ++i)
+        glVertex3f(outline[i].x, outline[i].y, outline[i].z);
+    glEnd();
+
+    frameStats.drawCalls += 1;
+    frameStats.triangles += count - 2;
+    frameStats.vertices  += count;
+}
@@ -0,0 +1,55 @@
+/**********************************************************
+ *  Orator - shadow.h
+ *
+ *  Planar shadow from the speaker's silhouette. The speaker
+ *  (a sphere cut off by the plane of its ring) is convex, so
+ *  its shadow is the convex hull of two projected curves:
+ *  the circle where light rays graze the sphere, and the rim
+ *  of the cap. Both are projected onto planeFloor and the
+ *  hull is drawn as one small triangle fan, instead of
+ *  flattening the whole mesh with the shadow matrix.
+ **********************************************************/
+#ifndef ORATOR_SHADOW_H
+#define ORATOR_SHADOW_H
+
+#include "mat4.h"
+
+#include <GL/gl.h>
+
+// How the planar shadow is produced
+enum ShadowMode {
+    SHADOW_MESH = 0,     // Re-draw the full mesh through the shadow matrix
+    SHADOW_SILHOUETTE    // Project the outline only (default)
+};
+
+extern ShadowMode shadowMode;
+
+// Point on the floor plane, in world coordinates
+struct ShadowPoint {
+    GLfloat x, y, z;
+};
+
+// Object-to-world matrix for a translation followed by
+// rotations about X, Y and Z (degrees), i.e. T * Rx * Ry * Rz
+void buildObjectMatrix(mat4& m, float tx, float ty, float tz,
+                       float rx, float ry, float rz);
+
+// Outline of the speaker's shadow as a convex polygon in
+// counter-clockwise order (seen from the plane's front side).
+// capScaleZ stretches the cap along z about its rim plane
+// (the audio pump; 1 = a plain sphere). 'steps' points are
+// used per circle. The outline is in the frame arena
+// (arena.h), so it lasts until the frame ends. Returns false when no
+// outline can be built (e.g. the light is inside the speaker);
+// callers then fall back to SHADOW_MESH.
+bool buildSilhouetteShadow(const mat4& objectMatrix,
+                           const mat4& shadowMatrix,
+                           const GLfloat lightPos[4],
+                           const GLfloat plane[4],
+                           float phiMax, float capScaleZ, int steps,
+                           ShadowPoint** outline, int* count);
+
+// Draws the outline as one GL_TRIANGLE_FAN (current color)
+void drawShadowOutline(const ShadowPoint* outline, int count);
+
+#endif // ORATOR_SHADOW_H
@@ -0,0 +1,438 @@
+/**********************************************************
+ *  Orator - simulation.cpp
+ *
+ *  Fixed-tick simulation thread and the render thread's
+ *  interpolated view of it (see simulation.h).
+ **********************************************************/
+#include "simulation.h"
+#include "analysis.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+// Animation and input rates
+const float spinDegreesPerSecond = 30.0f;
+const float orbitDegreesPerStep  = 5.0f;   // Per arrow key press
+const float dragDegreesPerPixel  = 0.5f;
+const float cameraAngleYLimit    = 89.0f;  // Avoid flipping over the pole
+
+// Audio-reactive "pump": cap and concavity are stretched along z
+// about the rim plane by the bass level
+const float capPumpAmount     = 0.12f;  // Cap height +12% at full bass
+const float concavePumpAmount = 2.0f;   // Concavity depth x3 at full bass
+
+int simulationTickRate = SIM_DEFAULT_TICK_RATE;
+
+struct SimulationState {
+    SceneSnapshot state;            // Simulation thread only (once started)
+    SpscQueue<InputEvent, SIM_INPUT_QUEUE> inputs;    // GLUT -> simulation
+    TripleBuffer<SceneSnapshot> snapshots;            // Simulation -> render
+    std::atomic<unsigned long> posted;   // Events queued (GLUT thread writes)
+    bool threaded;                       // Between start and stop (render thread)
+
+    std::thread worker;
+    std::atomic<bool> stopRequested;
+    std::mutex wakeMutex;                // Only to sleep while idle
+    std::condition_variable wake;
+
+    std::atomic<unsigned long> ticks;
+    std::atomic<unsigned long> lateTicks;
+    std::atomic<unsigned long> droppedInputs;
+    std::atomic<unsigned long> idlePeriods;
+    std::atomic<unsigned long long> tickNs;   // Sum over all ticks
+};
+
+static SimulationState sim;
+
+// Render thread: the two newest snapshots it has seen
+static SceneSnapshot viewPrevious, viewCurrent;
+static bool viewInterpolating = false;
+
+/**********************************************************
+ * clockSeconds(...) - Steady clock time as plain seconds
+ **********************************************************/
+static double clockSeconds(Clock::time_point t)
+{
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+// --------------------------------------------------------
+// TICK
+// --------------------------------------------------------
+
+/**********************************************************
+ * printShape(...) - Shape after a key edit
+ **********************************************************/
+static void printShape(const SceneSnapshot& s)
+{
+    printf("Shape: cap %.0f deg, inner ring %.2f, concavity %.2f\n",
+           s.phiMax * 180.0f / M_PI, s.innerRadiusFactor, s.concaveDepth);
+}
+
+/**********************************************************
+ * editShape(...) - Clamped like setSpeakerShape()
+ **********************************************************/
+static void editShape(SceneSnapshot& s, float phiMax, float innerFactor, float depth)
+{
+    s.phiMax            = fminf(fmaxf(phiMax, phiMaxMin), phiMaxMax);
+    s.innerRadiusFactor = fminf(fmaxf(innerFactor, innerFactorMin), innerFactorMax);
+    s.concaveDepth      = fminf(fmaxf(depth, 0.0f), concaveDepthMax);
+    s.shapeVersion++;
+    printShape(s);
+}
+
+/**********************************************************
+ * applyKey(...) - Scene keys (the rest stay on the GLUT side)
+ **********************************************************/
+static void applyKey(SceneSnapshot& s, int key)
+{
+    switch (key) {
+        // 't': toggle texture
+        case 't':
+            s.textureEnabled = !s.textureEnabled;
+            break;
+        // 's': toggle shading mode
+        case 's':
+            s.smoothShading = !s.smoothShading;
+            break;
+        // 'd': toggle depth test
+        case 'd':
+            s.depthTestEnabled = !s.depthTestEnabled;
+            break;
+        // '[' / ']': smaller / larger spherical cap
+        case '[':
+        case ']':
+            editShape(s, s.phiMax + (key == ']' ? phiMaxStep : -phiMaxStep),
+                      s.innerRadiusFactor, s.concaveDepth);
+            break;
+        // '-' / '=': smaller / larger inner ring radius
+        case '-':
+        case '=':
+            editShape(s, s.phiMax,
+                      s.innerRadiusFactor + (key == '=' ? innerFactorStep : -innerFactorStep),
+                      s.concaveDepth);
+            break;
+        // ',' / '.': shallower / deeper concavity
+        case ',':
+        case '.':
+            editShape(s, s.phiMax, s.innerRadiusFactor,
+                      s.concaveDepth + (key == '.' ? concaveDepthStep : -concaveDepthStep));
+            break;
+        // Space: pause/resume the automatic spin
+        case ' ':
+            s.autoSpin = !s.autoSpin;
+            break;
+        // 'a': toggle the audio-reactive pump
+        case 'a':
+            s.audioReactive = !s.audioReactive;
+            break;
+        default:
+            break;
+    }
+}
+
+/**********************************************************
+ * applyInput(...) - One queued event
+ **********************************************************/
+static void applyInput(SceneSnapshot& s, const InputEvent& e)
+{
+    switch (e.type) {
+        case INPUT_KEY:
+            applyKey(s, e.key);
+            break;
+        case INPUT_ORBIT:
+            s.cameraAngleX += e.dx * orbitDegreesPerStep;
+            s.cameraAngleY += e.dy * orbitDegreesPerStep;
+            s.cameraAngleY = fminf(fmaxf(s.cameraAngleY, -cameraAngleYLimit), cameraAngleYLimit);
+            break;
+        case INPUT_DRAG:
+            s.rotationX += e.dy * dragDegreesPerPixel;
+            s.rotationY += e.dx * dragDegreesPerPixel;
+            break;
+        case INPUT_SHAPE:
+            editShape(s, e.shape[0], e.shape[1], e.shape[2]);
+            break;
+    }
+}
+
+/**********************************************************
+ * updatePump(...) - z-scales from the latest audio levels
+ *
+ * Only reads what the analysis thread published last
+ * (wait-free); all the DSP happens on that thread.
+ **********************************************************/
+static void updatePump(SceneSnapshot& s)
+{
+    AudioLevels levels;
+    if (!s.audioReactive || !analysisLatest(levels)) {
+        s.capPump = s.concavePump = 1.0f;
+        return;
+    }
+    s.capPump     = 1.0f + capPumpAmount     * levels.bass;
+    s.concavePump = 1.0f + concavePumpAmount * levels.bass;
+}
+
+/**********************************************************
+ * runTick(...) - Inputs, spin and pump, then publish
+ **********************************************************/
+static void runTick(double seconds, double time)
+{
+    Clock::time_point start = Clock::now();
+    SceneSnapshot& s = sim.state;
+
+    InputEvent event;
+    while (spscPop(sim.inputs, event)) {
+        applyInput(s, event);
+        s.inputs++;
+    }
+    if (s.autoSpin)
+        s.shapeRotationAngle = fmodf(s.shapeRotationAngle + (float)(spinDegreesPerSecond * seconds),
+                                     360.0f);
+    updatePump(s);
+    s.time = time;
+    s.tick++;
+
+    tripleWriteSlot(sim.snapshots) = s;
+    triplePublish(sim.snapshots);
+
+    sim.ticks.fetch_add(1, std::memory_order_relaxed);
+    sim.tickNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             Clock::now() - start).count(), std::memory_order_relaxed);
+}
+
+/**********************************************************
+ * idle(...) - Would the next tick change nothing?
+ **********************************************************/
+static bool idle(const SceneSnapshot& s)
+{
+    return !s.autoSpin && !(s.audioReactive && analysisRunning()) &&
+           sim.posted.load(std::memory_order_acquire) == s.inputs;
+}
+
+/**********************************************************
+ * simulationMain() - Tick at simulationTickRate
+ *
+ * Ticks are stamped with the time they were due, not when
+ * the thread got to them, so they stay evenly spaced for
+ * the interpolation. After a stall the missed ticks are
+ * run back to back, up to SIM_MAX_STEP worth. With nothing
+ * to animate the thread sleeps until the next input.
+ **********************************************************/
+static void simulationMain()
+{
+    double period = 1.0 / simulationTickRate;
+    Clock::duration step = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(period));
+    Clock::duration maxStep = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(SIM_MAX_STEP));
+    Clock::time_point next = Clock::now();
+
+    while (!sim.stopRequested.load(std::memory_order_relaxed)) {
+        if (idle(sim.state)) {
+            std::unique_lock<std::mutex> lock(sim.wakeMutex);
+            sim.idlePeriods.fetch_add(1, std::memory_order_relaxed);
+            sim.wake.wait(lock, [] {
+                return sim.stopRequested.load() || !idle(sim.state);
+            });
+            next = Clock::now();   // The gap is not animation time
+        } else {
+            std::this_thread::sleep_until(next);
+        }
+
+        Clock::time_point now = Clock::now();
+        if (now - next > maxStep)
+            next = now - maxStep;
+        while (next <= now) {
+            if (now - next >= step)
+                sim.lateTicks.fetch_add(1, std::memory_order_relaxed);
+            runTick(period, clockSeconds(next));
+            next += step;
+        }
+    }
+}
+
+// --------------------------------------------------------
+// CONTROL
+// --------------------------------------------------------
+
+/**********************************************************
+ * simulationInit(...) - Initial state, published once
+ **********************************************************/
+void simulationInit(const SceneSnapshot& initial)
+{
+    sim.state = initial;
+    sim.state.time = clockSeconds(Clock::now());
+    tripleWriteSlot(sim.snapshots) = sim.state;
+    triplePublish(sim.snapshots);
+    viewPrevious = viewCurrent = sim.state;
+}
+
+/**********************************************************
+ * simulationStart() - Simulation thread
+ **********************************************************/
+bool simulationStart()
+{
+    if (sim.threaded)
+        return false;
+    if (simulationTickRate < 1)
+        simulationTickRate = SIM_DEFAULT_TICK_RATE;
+    sim.stopRequested.store(false);
+    sim.worker = std::thread(simulationMain);
+    sim.threaded = true;
+    return true;
+}
+
+/**********************************************************
+ * simulationStop() - Joins the thread; state stays valid
+ **********************************************************/
+void simulationStop()
+{
+    if (!sim.threaded)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(sim.wakeMutex);
+        sim.stopRequested.store(true);
+    }
+    sim.wake.notify_one();
+    sim.worker.join();
+    sim.threaded = false;
+}
+
+/**********************************************************
+ * simulationStep(...) - One tick on the caller's thread
+ **********************************************************/
+void simulationStep(double seconds)
+{
+    if (sim.threaded)
+        return;
+    runTick(seconds, sim.state.time + seconds);
+}
+
+/**********************************************************
+ * simulationPost(...) - GLUT callbacks: queue an event
+ *
+ * A full queue (the simulation thread stalled for hundreds
+ * of events) drops the event rather than wait.
+ **********************************************************/
+void simulationPost(const InputEvent& event)
+{
+    if (!spscPush(sim.inputs, event)) {
+        sim.droppedInputs.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // The lock orders this with the thread's idle check
+    {
+        std::lock_guard<std::mutex> lock(sim.wakeMutex);
+        sim.posted.fetch_add(1, std::memory_order_release);
+    }
+    if (sim.threaded)
+        sim.wake.notify_one();
+    else
+        simulationStep(0.0);   // No thread: apply it right away
+}
+
+// --------------------------------------------------------
+// RENDER SIDE
+// --------------------------------------------------------
+
+/**********************************************************
+ * lerpAngle(...) - Shortest way round, result in [0, 360)
+ **********************************************************/
+static float lerpAngle(float a, float b, float t)
+{
+    float d = b - a;
+    if (d >  180.0f) d -= 360.0f;
+    if (d < -180.0f) d += 360.0f;
+    float r = fmodf(a + d * t, 360.0f);
+    return r < 0.0f ? r + 360.0f : r;
+}
+
+/**********************************************************
+ * simulationView(...) - This frame's scene
+ *
+ * Drawn one tick behind: the time shown is now minus one
+ * period, which lies between the two newest snapshots
+ * while the thread keeps up. Continuous values are
+ * interpolated; toggles and the shape come from the newest.
+ **********************************************************/
+void simulationView(SceneSnapshot& scene)
+{
+    const SceneSnapshot* latest;
+    if (tripleRead(sim.snapshots, &latest)) {
+        viewPrevious = viewCurrent;
+        viewCurrent  = *latest;
+    }
+    scene = viewCurrent;
+    viewInterpolating = false;
+    if (!sim.threaded)
+        return;
+
+    double span = viewCurrent.time - viewPrevious.time;
+    if (span <= 0.0)
+        return;
+    double shown = clockSeconds(Clock::now()) - 1.0 / simulationTickRate;
+    float t = (float)((shown - viewPrevious.time) / span);
+    if (t >= 1.0f)
+        return;
+    if (t < 0.0f) t = 0.0f;
+    viewInterpolating = true;
+
+    const SceneSnapshot& a = viewPrevious;
+    const SceneSnapshot& b = viewCurrent;
+    scene.cameraAngleX       = a.cameraAngleX + (b.cameraAngleX - a.cameraAngleX) * t;
+    scene.cameraAngleY       = a.cameraAngleY + (b.cameraAngleY - a.cameraAngleY) * t;
+    scene.distance           = a.distance     + (b.distance     - a.distance)     * t;
+    scene.rotationX          = a.rotationX    + (b.rotationX    - a.rotationX)    * t;
+    scene.rotationY          = a.rotationY    + (b.rotationY    - a.rotationY)    * t;
+    scene.shapeRotationAngle = lerpAngle(a.shapeRotationAngle, b.shapeRotationAngle, t);
+    scene.capPump            = a.capPump      + (b.capPump      - a.capPump)      * t;
+    scene.concavePump        = a.concavePump  + (b.concavePump  - a.concavePump)  * t;
+}
+
+/**********************************************************
+ * simulationSettling() - More frames needed without input?
+ **********************************************************/
+bool simulationSettling()
+{
+    return viewInterpolating ||
+           viewCurrent.inputs != sim.posted.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// STATISTICS
+// --------------------------------------------------------
+
+/**********************************************************
+ * simulationGetStats(...) - Counters for the exit summary
+ **********************************************************/
+void simulationGetStats(SimulationStats& stats)
+{
+    stats.tickRate      = simulationTickRate;
+    stats.ticks         = sim.ticks.load();
+    stats.lateTicks     = sim.lateTicks.load();
+    stats.inputs        = sim.posted.load();
+    stats.droppedInputs = sim.droppedInputs.load();
+    stats.idlePeriods   = sim.idlePeriods.load();
+    stats.meanTickUs    = stats.ticks ? sim.tickNs.load() / 1000.0 / stats.ticks : 0.0;
+}
+
+/**********************************************************
+ * simulationPrintStats() - Summary on exit
+ **********************************************************/
+void simulationPrintStats()
+{
+    SimulationStats s;
+    simulationGetStats(s);
+    printf("Simulation    : %d Hz, %lu ticks (%lu late), %.1f us per tick, %lu inputs "
+           "(%lu dropped), %lu idle periods\n",
+           s.tickRate, s.ticks, s.lateTicks, s.meanTickUs, s.inputs, s.droppedInputs,
+           s.idlePeriods);
+}
@@ -0,0 +1,126 @@
+/**********************************************************
+ *  Orator - simulation.h
+ *
+ *  Scene state on its own thread. Everything that changes
+ *  while the program runs (camera, mouse and automatic
+ *  rotation, the audio pump, shape edits, toggles) lives
+ *  in one SceneSnapshot. A simulation thread owns the only
+ *  writable copy: at a fixed tick rate it applies the input
+ *  events the GLUT callbacks queued (spscqueue.h), advances
+ *  the spin, picks up the analysis thread's band levels and
+ *  publishes a snapshot through a wait-free triple buffer
+ *  (triplebuffer.h).
+ *
+ *  The render thread reads the latest snapshot once per
+ *  frame, without locks, and draws one tick behind,
+ *  interpolated between the two newest snapshots. A slow
+ *  frame therefore delays neither input nor animation; it
+ *  only shows fewer of the ticks.
+ *
+ *  --bench runs no thread: simulationStep() advances the
+ *  same state by a fixed step on the caller's thread.
+ **********************************************************/
+#ifndef ORATOR_SIMULATION_H
+#define ORATOR_SIMULATION_H
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SIM_DEFAULT_TICK_RATE 120   // Ticks per second (--tick-rate)
+#define SIM_INPUT_QUEUE       256   // Input events queued for the next tick
+// Most time the simulation catches up after a stall (seconds)
+#define SIM_MAX_STEP          0.25
+
+// Limits and key steps for the shape edits
+const float phiMaxMin        = 20.0f  * M_PI / 180.0f;
+const float phiMaxMax        = 170.0f * M_PI / 180.0f;
+const float phiMaxStep       = 5.0f   * M_PI / 180.0f;
+const float innerFactorMin   = 0.05f;
+const float innerFactorMax   = 0.95f;
+const float innerFactorStep  = 0.05f;
+const float concaveDepthMax  = 0.5f;
+const float concaveDepthStep = 0.02f;
+
+// Everything one frame needs to know about the scene
+struct SceneSnapshot {
+    double time;                  // Tick time, steady clock seconds
+    unsigned long tick;           // Ticks so far
+    unsigned long inputs;         // Input events applied so far
+
+    float cameraAngleX;           // Horizontal camera angle
+    float cameraAngleY;           // Vertical camera angle
+    float distance;               // Distance from origin (zoom)
+    float rotationX;              // Rotation around X set by mouse drag
+    float rotationY;              // Rotation around Y set by mouse drag
+    float shapeRotationAngle;     // Automatic spin, [0, 360)
+
+    float capPump;                // z-scale of the cap from the bass level
+    float concavePump;            // ... and of the concavity
+
+    float phiMax;                 // Shape (see setSpeakerShape)
+    float innerRadiusFactor;
+    float concaveDepth;
+    unsigned long shapeVersion;   // Bumped by every shape edit
+
+    bool textureEnabled;          // Checkerboard texture
+    bool smoothShading;           // GL_SMOOTH, else GL_FLAT
+    bool depthTestEnabled;
+    bool autoSpin;                // Space pauses/resumes the spin
+    bool audioReactive;           // 'a' toggles the pump
+};
+
+// What the GLUT callbacks queue for the simulation
+enum InputType {
+    INPUT_KEY = 0,   // A scene key ('t', 's', '[', Space, ...)
+    INPUT_ORBIT,     // Arrow key: dx/dy = -1, 0 or +1 camera steps
+    INPUT_DRAG,      // Mouse drag: dx/dy in pixels
+    INPUT_SHAPE      // Scene file: shape[] = cap angle, inner ring, concavity
+};
+
+struct InputEvent {
+    InputType type;
+    int key;
+    int dx, dy;
+    float shape[3];
+};
+
+struct SimulationStats {
+    int tickRate;
+    unsigned long ticks;
+    unsigned long lateTicks;       // Run to catch up after a stall
+    unsigned long inputs;          // Queued
+    unsigned long droppedInputs;   // Queue was full
+    unsigned long idlePeriods;     // Nothing to do: slept until input
+    double meanTickUs;
+};
+
+extern int simulationTickRate;   // --tick-rate HZ
+
+// Makes 'initial' the current state (no thread yet)
+void simulationInit(const SceneSnapshot& initial);
+
+// Ticks on a thread of its own until simulationStop()
+bool simulationStart();
+void simulationStop();
+
+// Without the thread: one tick of 'seconds' on this thread
+void simulationStep(double seconds);
+
+// GLUT callbacks: queue one input event for the next tick
+void simulationPost(const InputEvent& event);
+
+// Render thread: the scene for this frame, interpolated
+// between the two newest ticks (the newest without the thread)
+void simulationView(SceneSnapshot& scene);
+
+// Render thread: input still on its way, or the last view
+// was interpolated (more frames are needed to catch up)
+bool simulationSettling();
+
+void simulationGetStats(SimulationStats& stats);
+void simulationPrintStats();
+
+#endif // ORATOR_SIMULATION_H
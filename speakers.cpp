@@ -0,0 +1,399 @@
+/**********************************************************
+ *  Orator - speakers.cpp
+ *
+ *  Instance layout, instance buffer and the instancing
+ *  shader for speaker arrays (see speakers.h).
+ **********************************************************/
+#include "speakers.h"
+#include "shader.h"
+#include "glstate.h"
+
+#include <math.h>
+#include <stddef.h>    // offsetof
+#include <string>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// --------------------------------------------------------
+// STATE
+// --------------------------------------------------------
+int speakerCount = 0;
+std::vector<SpeakerInstance> speakerInstances;
+std::vector<unsigned char>   speakerLod;
+std::vector<unsigned char>   speakerVisible;
+int speakerLodFirst[LOD_LEVELS];
+int speakerLodCount[LOD_LEVELS];
+
+// GPU copy of the instances, grouped by LOD level, which
+// speaker each slot holds and the slots to upload again
+static std::vector<SpeakerInstance> groupedInstances;
+static std::vector<int>             groupedSpeaker;
+static std::vector<unsigned char>   groupedDirty;
+
+// Unchanged slots between two changed ones that still go up in
+// one glBufferSubData() instead of two
+#define SPEAKER_UPLOAD_GAP 16
+
+static GLuint instanceVbo     = 0;
+static GLuint instanceProgram = 0;
+static GLint  uSpinLocation       = -1;
+static GLint  uShadowPassLocation = -1;
+static GLint  uTexturedLocation   = -1;
+static GLint  uPumpLocation       = -1;
+static ShaderUniforms instanceUniforms;   // Transform and light
+
+// One VAO per LOD level and component: mesh + instance attributes
+struct InstancedVao {
+    GLuint vao;
+    GLuint meshVbo;         // Mesh VBO the attributes point into
+    int    firstInstance;   // Instance the per-instance attributes start at
+};
+static InstancedVao instancedVaos[LOD_LEVELS][MESH_COMPONENT_COUNT];
+
+// Attribute locations shared by the C++ and GLSL side
+enum {
+    ATTRIB_POSITION = 0,
+    ATTRIB_NORMAL,
+    ATTRIB_TEXCOORD,
+    ATTRIB_OFFSET_SCALE,   // Per instance from here on
+    ATTRIB_PHASE,
+    ATTRIB_COLOR
+};
+
+// --------------------------------------------------------
+// SHADERS
+// --------------------------------------------------------
+
+// Declarations; the lighting function (shader.h) and main()
+// follow, see initSpeakerArray()
+static const char* instanceVertexHeader =
+    "#version 330 compatibility\n"
+    "layout(location = 0) in vec3  aPosition;\n"
+    "layout(location = 1) in vec3  aNormal;\n"
+    "layout(location = 2) in vec2  aTexCoord;\n"
+    "layout(location = 3) in vec4  aOffsetScale;\n"
+    "layout(location = 4) in float aPhase;\n"
+    "layout(location = 5) in vec4  aColor;\n"
+    "uniform float uSpin;\n"
+    "uniform bool  uShadowPass;\n"
+    "uniform vec2  uPump;\n";  // x = plane z, y = z-scale about it
+
+static const char* instanceVertexMain =
+    "void main()\n"
+    "{\n"
+    "    vec3 pumped = vec3(aPosition.xy, uPump.x + (aPosition.z - uPump.x) * uPump.y);\n"
+    "    vec3 normal = vec3(aNormal.xy, aNormal.z / uPump.y);\n"
+    "    float a = uSpin + aPhase;\n"
+    "    float c = cos(a), s = sin(a);\n"
+    "    vec3 p = pumped * aOffsetScale.w;\n"
+    "    p = vec3(c * p.x - s * p.y, s * p.x + c * p.y, p.z) + aOffsetScale.xyz;\n"
+    "    gl_Position    = transformPosition(p);\n"
+    "    gl_TexCoord[0] = vec4(aTexCoord, 0.0, 1.0);\n"
+    "    if (uShadowPass) {\n"
+    "        gl_FrontColor = vec4(0.0, 0.0, 0.0, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec3 n = vec3(c * normal.x - s * normal.y, s * normal.x + c * normal.y, normal.z);\n"
+    "    gl_FrontColor = fixedFunctionColor(p, n, aColor);\n"
+    "}\n";
+
+// --------------------------------------------------------
+// LAYOUT
+// --------------------------------------------------------
+
+/**********************************************************
+ * buildSpeakerLayout(...) - Square grid in the x-y plane
+ *
+ * A single speaker sits at the origin, white and unrotated,
+ * so --speakers 1 looks like the classic scene.
+ **********************************************************/
+void buildSpeakerLayout(int count, std::vector<SpeakerInstance>& out)
+{
+    const float spacing = 3.0f;   // Speaker diameter is 2
+    int side = (int)ceil(sqrt((double)count));
+    float start = -0.5f * (side - 1) * spacing;
+
+    out.resize(count);
+    unsigned int seed = 12345u;
+    for (int k = 0; k < count; ++k) {
+        SpeakerInstance& s = out[k];
+        int row = k / side;
+        int col = k % side;
+        s.offset[0] = start + col * spacing;
+        s.offset[1] = start + row * spacing;
+        s.offset[2] = 0.0f;
+        s.scale     = 1.0f;
+
+        // Cheap LCG so every run gets the same "random" look
+        seed = seed * 1664525u + 1013904223u;
+        s.phase = count == 1 ? 0.0f : (seed >> 8) * (2.0f * (float)M_PI / 16777216.0f);
+
+        if (count == 1) {
+            s.color[0] = s.color[1] = s.color[2] = 255;
+        } else {
+            s.color[0] = (GLubyte)(155 + (col * 100) / side);
+            s.color[1] = (GLubyte)(155 + (row * 100) / side);
+            s.color[2] = (GLubyte)(155 + ((seed >> 16) % 100));
+        }
+        s.color[3] = 255;
+    }
+}
+
+// --------------------------------------------------------
+// GPU SETUP
+// --------------------------------------------------------
+
+/**********************************************************
+ * initSpeakerArray(...) - Layout, instance VBO and shader
+ **********************************************************/
+bool initSpeakerArray(int count)
+{
+    if (count < 1) count = 1;
+    if (count > MAX_SPEAKERS) count = MAX_SPEAKERS;
+    speakerCount = count;
+    buildSpeakerLayout(count, speakerInstances);
+
+    // Everybody starts at the finest level; the first
+    // updateSpeakerLods() call sorts them out
+    speakerLod.assign(count, 0);
+    speakerVisible.assign(count, 1);
+    groupedInstances = speakerInstances;
+    groupedSpeaker.resize(count);
+    for (int k = 0; k < count; ++k)
+        groupedSpeaker[k] = k;
+    groupedDirty.assign(count, 0);
+    for (int l = 0; l < LOD_LEVELS; ++l) {
+        speakerLodFirst[l] = 0;
+        speakerLodCount[l] = 0;
+    }
+    speakerLodCount[0] = count;
+
+    if (!instanceProgram) {
+        std::string vertexSource = std::string(instanceVertexHeader) +
+                                   shaderLightingGlsl + instanceVertexMain;
+        instanceProgram = buildProgram("speaker instancing",
+                                       vertexSource.c_str(), shaderModulateFragmentSource);
+        if (!instanceProgram)
+            return false;
+        uSpinLocation       = glGetUniformLocation(instanceProgram, "uSpin");
+        uShadowPassLocation = glGetUniformLocation(instanceProgram, "uShadowPass");
+        uTexturedLocation   = glGetUniformLocation(instanceProgram, "uTextured");
+        uPumpLocation       = glGetUniformLocation(instanceProgram, "uPump");
+        shaderFindUniforms(instanceProgram, instanceUniforms);
+        glUseProgram(instanceProgram);
+        glUniform1i(glGetUniformLocation(instanceProgram, "uTexture"), 0);
+        glUseProgram(0);
+    }
+
+    if (!instanceVbo)
+        glGenBuffers(1, &instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, groupedInstances.size() * sizeof(SpeakerInstance),
+                 groupedInstances.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+/**********************************************************
+ * speakerArrayProgram() - For the draw list state key
+ **********************************************************/
+GLuint speakerArrayProgram()
+{
+    return instanceProgram;
+}
+
+/**********************************************************
+ * pointInstanceAttributes(...) - Instance attributes starting
+ *    at 'firstInstance' (VAO must be bound)
+ **********************************************************/
+static void pointInstanceAttributes(int firstInstance)
+{
+    const GLsizei istride = sizeof(SpeakerInstance);
+    const size_t  base    = (size_t)firstInstance * istride;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    glVertexAttribPointer(ATTRIB_OFFSET_SCALE, 4, GL_FLOAT, GL_FALSE, istride,
+                          (const GLvoid*)(base + offsetof(SpeakerInstance, offset)));
+    glVertexAttribPointer(ATTRIB_PHASE, 1, GL_FLOAT, GL_FALSE, istride,
+                          (const GLvoid*)(base + offsetof(SpeakerInstance, phase)));
+    glVertexAttribPointer(ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, istride,
+                          (const GLvoid*)(base + offsetof(SpeakerInstance, color)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**********************************************************
+ * setupInstancedVao(...) - Mesh + instance attribute layout
+ **********************************************************/
+static void setupInstancedVao(InstancedVao& iv, const MeshBuffer& mesh, int firstInstance)
+{
+    if (!iv.vao)
+        glGenVertexArrays(1, &iv.vao);
+    glBindVertexArray(iv.vao);
+
+    // Per-vertex attributes from the retained mesh
+    const GLsizei vstride = sizeof(MeshVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glEnableVertexAttribArray(ATTRIB_POSITION);
+    glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, vstride,
+                          (const GLvoid*)offsetof(MeshVertex, position));
+    glEnableVertexAttribArray(ATTRIB_NORMAL);
+    glVertexAttribPointer(ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, vstride,
+                          (const GLvoid*)offsetof(MeshVertex, normal));
+    glEnableVertexAttribArray(ATTRIB_TEXCOORD);
+    glVertexAttribPointer(ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, vstride,
+                          (const GLvoid*)offsetof(MeshVertex, texCoord));
+
+    // Per-instance attributes, advancing once per instance
+    glEnableVertexAttribArray(ATTRIB_OFFSET_SCALE);
+    glVertexAttribDivisor(ATTRIB_OFFSET_SCALE, 1);
+    glEnableVertexAttribArray(ATTRIB_PHASE);
+    glVertexAttribDivisor(ATTRIB_PHASE, 1);
+    glEnableVertexAttribArray(ATTRIB_COLOR);
+    glVertexAttribDivisor(ATTRIB_COLOR, 1);
+    pointInstanceAttributes(firstInstance);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    iv.meshVbo       = mesh.vbo;
+    iv.firstInstance = firstInstance;
+}
+
+// --------------------------------------------------------
+// LEVEL OF DETAIL
+// --------------------------------------------------------
+
+/**********************************************************
+ * updateSpeakerLods(...) - Per-speaker level + regrouping
+ *
+ * Counting sort by level into groupedInstances, so every
+ * level is one contiguous range of the instance buffer.
+ * Culled speakers go to the end, past the last range, and
+ * keep their level until they are drawn again: selectLod()
+ * then catches up from it, so a large array pays nothing
+ * for the part out of view. Only slots that now hold a
+ * different speaker are uploaded.
+ **********************************************************/
+void updateSpeakerLods(const float cameraLocal[3], float pixelScale, bool lodEnabled,
+                       const unsigned char* visible)
+{
+    if (speakerCount == 0) return;
+
+    LodDistances thresholds;
+    if (lodEnabled)
+        lodDistances(pixelScale, thresholds);
+
+    bool changed = false;
+    int counts[LOD_LEVELS + 1] = { 0 };
+    for (int k = 0; k < speakerCount; ++k) {
+        const SpeakerInstance& inst = speakerInstances[k];
+        unsigned char drawn = visible ? visible[k] : 1;
+        if (drawn != speakerVisible[k]) {
+            speakerVisible[k] = drawn;
+            changed = true;
+        }
+        int level = speakerLod[k];
+        if (!lodEnabled) {
+            level = 0;
+        } else if (drawn) {
+            float dx = inst.offset[0] - cameraLocal[0];
+            float dy = inst.offset[1] - cameraLocal[1];
+            float dz = inst.offset[2] - cameraLocal[2];
+            level = selectLodSquared(level, dx*dx + dy*dy + dz*dz, inst.scale * inst.scale,
+                                     thresholds);
+        }
+        if (level != speakerLod[k]) {
+            speakerLod[k] = (unsigned char)level;
+            changed = changed || drawn;   // A culled one's place does not move
+        }
+        counts[drawn ? level : LOD_LEVELS]++;
+    }
+    if (!changed)
+        return;   // Same grouping as last frame, buffer is still valid
+
+    int next[LOD_LEVELS + 1];
+    int first = 0;
+    for (int l = 0; l <= LOD_LEVELS; ++l) {
+        if (l < LOD_LEVELS) {
+            speakerLodFirst[l] = first;
+            speakerLodCount[l] = counts[l];
+        }
+        next[l] = first;
+        first += counts[l];
+    }
+    for (int k = 0; k < speakerCount; ++k) {
+        int slot = next[speakerVisible[k] ? speakerLod[k] : LOD_LEVELS]++;
+        if (groupedSpeaker[slot] != k) {
+            groupedSpeaker[slot]   = k;
+            groupedInstances[slot] = speakerInstances[k];
+            groupedDirty[slot]     = 1;
+        }
+    }
+
+    // Changed slots in runs; the unchanged rest of the buffer
+    // stays as it is
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    int runFirst = -1, runLast = -1;
+    for (int slot = 0; slot <= speakerCount; ++slot) {
+        bool dirty = slot < speakerCount && groupedDirty[slot];
+        bool flush = runFirst >= 0 &&
+                     (slot == speakerCount || (dirty && slot - runLast > SPEAKER_UPLOAD_GAP));
+        if (flush) {
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)runFirst * sizeof(SpeakerInstance),
+                            (GLsizeiptr)(runLast - runFirst + 1) * sizeof(SpeakerInstance),
+                            &groupedInstances[runFirst]);
+            runFirst = -1;
+        }
+        if (dirty) {
+            groupedDirty[slot] = 0;
+            if (runFirst < 0)
+                runFirst = slot;
+            runLast = slot;
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --------------------------------------------------------
+// DRAWING
+// --------------------------------------------------------
+
+/**********************************************************
+ * drawSpeakerInstances(...) - One instanced draw call
+ **********************************************************/
+void drawSpeakerInstances(const MeshBuffer& mesh, int lodLevel, MeshComponent component,
+                          float spinDegrees, bool shadowPass, bool textured,
+                          float pumpPlaneZ, float pumpScale)
+{
+    int count = speakerLodCount[lodLevel];
+    int first = speakerLodFirst[lodLevel];
+    if (!instanceProgram || !mesh.built || count == 0)
+        return;
+
+    InstancedVao& iv = instancedVaos[lodLevel][component];
+    if (iv.meshVbo != mesh.vbo) {
+        setupInstancedVao(iv, mesh, first);
+    } else if (iv.firstInstance != first) {
+        glBindVertexArray(iv.vao);
+        pointInstanceAttributes(first);
+        glBindVertexArray(0);
+        iv.firstInstance = first;
+    }
+
+    stateUseProgram(instanceProgram);
+    shaderApplyUniforms(instanceUniforms);
+    glUniform1f(uSpinLocation, spinDegrees * (float)M_PI / 180.0f);
+    glUniform1i(uShadowPassLocation, shadowPass ? 1 : 0);
+    glUniform1i(uTexturedLocation, textured ? 1 : 0);
+    glUniform2f(uPumpLocation, pumpPlaneZ, pumpScale);
+
+    glBindVertexArray(iv.vao);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0, count);
+    glBindVertexArray(0);
+
+    frameStats.drawCalls += 1;
+    frameStats.triangles += (long)(mesh.indexCount / 3) * count;
+    frameStats.vertices  += (long)mesh.indexCount * count;
+}
@@ -0,0 +1,68 @@
+/**********************************************************
+ *  Orator - speakers.h
+ *
+ *  Speaker arrays: many copies of the speaker drawn with
+ *  hardware instancing. Per-instance data (position, scale,
+ *  rotation phase, color) lives in one packed vertex buffer,
+ *  grouped by level of detail; each mesh component is then a
+ *  single instanced draw per LOD level in use.
+ **********************************************************/
+#ifndef ORATOR_SPEAKERS_H
+#define ORATOR_SPEAKERS_H
+
+#include "mesh.h"
+#include "lod.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <vector>
+
+// Upper limit for --speakers
+#define MAX_SPEAKERS 100000
+
+// One speaker in the array, 24 bytes, uploaded as-is
+struct SpeakerInstance {
+    GLfloat offset[3];   // World position of the speaker center
+    GLfloat scale;       // Uniform scale
+    GLfloat phase;       // Added to the spin angle (radians)
+    GLubyte color[4];    // Diffuse/ambient color (RGBA8)
+};
+
+extern int speakerCount;                              // 0 = classic single speaker
+extern std::vector<SpeakerInstance> speakerInstances;  // Layout order
+extern std::vector<unsigned char>   speakerLod;        // Current level per speaker
+extern std::vector<unsigned char>   speakerVisible;    // Not culled (culling.h)
+
+// Where each LOD level's speakers sit in the GPU instance buffer
+extern int speakerLodFirst[LOD_LEVELS];
+extern int speakerLodCount[LOD_LEVELS];
+
+// Lays out 'count' speakers on a square grid around the origin
+void buildSpeakerLayout(int count, std::vector<SpeakerInstance>& out);
+
+// Builds the layout, uploads the instance buffer and compiles
+// the instancing shader. Needs a current GL context.
+bool initSpeakerArray(int count);
+
+// The instancing program (0 before initSpeakerArray)
+GLuint speakerArrayProgram();
+
+// Picks a level for every speaker from its distance to the
+// camera (given in the array's own coordinate frame) and
+// regroups the instance buffer. The buffer is only uploaded
+// again when at least one speaker changed level. Speakers
+// with visible[k] == 0 are left out of every level (NULL:
+// all are drawn).
+void updateSpeakerLods(const float cameraLocal[3], float pixelScale, bool lodEnabled,
+                       const unsigned char* visible);
+
+// Draws one mesh component for all speakers of one LOD level
+// with a single glDrawElementsInstanced call. The current
+// modelview matrix is applied on top of each instance transform.
+// The mesh is first stretched along z by pumpScale about the
+// plane z = pumpPlaneZ (the audio-reactive pump; 1 = none).
+void drawSpeakerInstances(const MeshBuffer& mesh, int lodLevel, MeshComponent component,
+                          float spinDegrees, bool shadowPass, bool textured,
+                          float pumpPlaneZ, float pumpScale);
+
+#endif // ORATOR_SPEAKERS_H
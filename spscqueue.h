@@ -0,0 +1,60 @@
+/**********************************************************
+ *  Orator - spscqueue.h
+ *
+ *  Lock-free single-producer / single-consumer queue of
+ *  small fixed-size messages, e.g. parameter changes from
+ *  the render thread to the audio callback. The same scheme
+ *  as the sample ring (ringbuffer.h): the two positions only
+ *  grow, each side owns one of them, and a release store on
+ *  one is paired with an acquire load on the other. No
+ *  locks, no allocation; a full queue refuses the message
+ *  instead of blocking the producer.
+ **********************************************************/
+#ifndef ORATOR_SPSCQUEUE_H
+#define ORATOR_SPSCQUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Keep the positions on separate cache lines (as in the ring)
+#define SPSC_CACHE_LINE 64
+
+// N must be a power of two
+template <typename T, size_t N>
+struct SpscQueue {
+    T items[N];
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> writePos;
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> readPos;
+
+    SpscQueue() : writePos(0), readPos(0) {}
+};
+
+/**********************************************************
+ * spscPush(...) - Producer: false if the queue is full
+ **********************************************************/
+template <typename T, size_t N>
+bool spscPush(SpscQueue<T, N>& q, const T& item)
+{
+    size_t w = q.writePos.load(std::memory_order_relaxed);
+    if (w - q.readPos.load(std::memory_order_acquire) == N)
+        return false;
+    q.items[w & (N - 1)] = item;
+    q.writePos.store(w + 1, std::memory_order_release);
+    return true;
+}
+
+/**********************************************************
+ * spscPop(...) - Consumer: false if the queue is empty
+ **********************************************************/
+template <typename T, size_t N>
+bool spscPop(SpscQueue<T, N>& q, T& item)
+{
+    size_t r = q.readPos.load(std::memory_order_relaxed);
+    if (r == q.writePos.load(std::memory_order_acquire))
+        return false;
+    item = q.items[r & (N - 1)];
+    q.readPos.store(r + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // ORATOR_SPSCQUEUE_H
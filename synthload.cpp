@@ -0,0 +1,90 @@
+/**********************************************************
+ *  Orator - synthload.cpp
+ *
+ *  Render-thread and background CPU load (see synthload.h).
+ **********************************************************/
+#include "synthload.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Bytes touched between two clock checks
+#define SYNTH_LOAD_STEP (64u << 10)
+
+float renderLoadMs = 0.0f;
+
+static std::vector<std::thread> loadThreads;
+static std::atomic<bool> loadStop(false);
+
+/**********************************************************
+ * work(...) - Reads and writes 'buffer' for 'ms' ms, or
+ *             until 'stop' is set
+ *
+ * One byte in every 64-byte cache line is incremented, so the
+ * loop is bound by memory traffic, like a renderer walking
+ * through vertex data, and cannot be optimised away.
+ **********************************************************/
+static void work(std::vector<uint8_t>& buffer, double ms, const std::atomic<bool>* stop)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(ms));
+    size_t offset = 0;
+    do {
+        for (size_t i = 0; i < SYNTH_LOAD_STEP; i += 64)
+            buffer[(offset + i) % buffer.size()]++;
+        offset = (offset + SYNTH_LOAD_STEP) % buffer.size();
+        if (stop && stop->load(std::memory_order_relaxed))
+            return;
+    } while (stop || Clock::now() < end);
+}
+
+/**********************************************************
+ * applyRenderLoad() - renderLoadMs of work on this thread
+ **********************************************************/
+void applyRenderLoad()
+{
+    static std::vector<uint8_t> buffer;
+    if (renderLoadMs <= 0.0f)
+        return;
+    if (buffer.empty())
+        buffer.assign(SYNTH_LOAD_BYTES, 0);
+    work(buffer, renderLoadMs, NULL);
+}
+
+/**********************************************************
+ * cpuLoadStart(...) - Background threads, each with its
+ *                     own buffer
+ **********************************************************/
+bool cpuLoadStart(int threads)
+{
+    if (threads < 1 || threads > SYNTH_LOAD_MAX_THREADS || !loadThreads.empty())
+        return false;
+    loadStop.store(false);
+    for (int t = 0; t < threads; ++t)
+        loadThreads.push_back(std::thread([] {
+            std::vector<uint8_t> buffer(SYNTH_LOAD_BYTES, 0);
+            work(buffer, 0.0, &loadStop);
+        }));
+    return true;
+}
+
+/**********************************************************
+ * cpuLoadStop() - Joins the background threads
+ **********************************************************/
+void cpuLoadStop()
+{
+    loadStop.store(true);
+    for (size_t t = 0; t < loadThreads.size(); ++t)
+        loadThreads[t].join();
+    loadThreads.clear();
+}
+
+int cpuLoadThreads()
+{
+    return (int)loadThreads.size();
+}
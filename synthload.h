@@ -0,0 +1,36 @@
+/**********************************************************
+ *  Orator - synthload.h
+ *
+ *  Synthetic CPU load, to check that a busy renderer never
+ *  starves the audio threads (audiotiming.h shows whether
+ *  it did).
+ *
+ *  --render-load MS makes the render thread work for MS
+ *  milliseconds in every frame, as a heavy scene would. The
+ *  work streams through a buffer larger than the caches,
+ *  so the audio threads also lose their cached data.
+ *  --cpu-load N adds N background threads that do the same
+ *  work without pause, so there are more runnable threads
+ *  than cores.
+ **********************************************************/
+#ifndef ORATOR_SYNTHLOAD_H
+#define ORATOR_SYNTHLOAD_H
+
+// Bytes each load streams through
+#define SYNTH_LOAD_BYTES (32u << 20)
+
+// Most --cpu-load threads
+#define SYNTH_LOAD_MAX_THREADS 64
+
+// Per-frame work on the render thread, ms (0 = none)
+extern float renderLoadMs;
+
+// Called by renderScene(): works for renderLoadMs
+void applyRenderLoad();
+
+// Starts / stops the background threads
+bool cpuLoadStart(int threads);
+void cpuLoadStop();
+int  cpuLoadThreads();
+
+#endif // ORATOR_SYNTHLOAD_H
@@ -0,0 +1,679 @@
+/**********************************************************
+ *  Orator - tessellate.cpp
+ *
+ *  Scalar, table, SSE2 and AVX2 vertex generation for the
+ *  speaker parts (see tessellate.h). The SIMD kernels use
+ *  per-function target attributes, so the program itself
+ *  needs no -mavx2 and still runs on older CPUs.
+ **********************************************************/
+#include "tessellate.h"
+#include "tesstable.h"
+#include "arena.h"      // Per-call phi tables
+
+#include <math.h>
+#include <stdint.h>    // uintptr_t
+#include <string.h>    // memcpy
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TESS_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// The kernels store a vertex as 8 consecutive floats
+static_assert(sizeof(MeshVertex) == 8 * sizeof(float), "MeshVertex must be 8 packed floats");
+
+// From this many vertices on, the SIMD kernels write with
+// non-temporal stores: the output is far bigger than the
+// cache and is not read back by the CPU
+#define TESS_STREAM_MIN_VERTICES 65536
+
+static TessBackend currentBackend = tessBestBackend();
+
+// One row of the grid. Attribute a (in MeshVertex order x, y,
+// z, nx, ny, nz, u, v) of column i is
+//   c[a]*cos(theta_i) + s[a]*sin(theta_i) + u[a]*U_i + k[a]
+struct RowTerms {
+    float c[8], s[8], u[8], k[8];
+};
+
+// Per-column inputs shared by all rows (structure of arrays),
+// pointing into the level's TessTable
+struct ColumnTables {
+    int columns;
+    const float* cosTheta;
+    const float* sinTheta;
+    const float* texU;
+};
+
+/**********************************************************
+ * setVertex(...) - Fills one interleaved vertex
+ **********************************************************/
+static void setVertex(MeshVertex& v,
+                      float x,  float y,  float z,
+                      float nx, float ny, float nz,
+                      float u,  float t)
+{
+    v.position[0] = x;  v.position[1] = y;  v.position[2] = z;
+    v.normal[0]   = nx; v.normal[1]   = ny; v.normal[2]   = nz;
+    v.texCoord[0] = u;  v.texCoord[1] = t;
+}
+
+// --------------------------------------------------------
+// SCALAR REFERENCE (sin/cos for every vertex)
+// --------------------------------------------------------
+
+/**********************************************************
+ * capScalar(...) - partial sphere, phi = 0..phiMax
+ *
+ * Vertex (i,j) sits at theta = i*dTheta, phi = j*dPhi. The
+ * column i = uSteps repeats i = 0 with texture U = 1.
+ **********************************************************/
+static void capScalar(const MeshParams& p, MeshVertex* out)
+{
+    const int uSteps = p.uSteps;
+    const int vSteps = p.vSteps;
+    float dTheta = (2.0f * M_PI) / uSteps;
+    float dPhi   = p.phiMax / vSteps;
+
+    for (int j = 0; j <= vSteps; ++j) {
+        float phi    = j * dPhi;
+        float sinPhi = sin(phi);
+        float cosPhi = cos(phi);
+        for (int i = 0; i <= uSteps; ++i) {
+            float theta = i * dTheta;
+            // Unit sphere: the normal equals the position
+            float x = sinPhi * cos(theta);
+            float y = sinPhi * sin(theta);
+            float z = cosPhi;
+            setVertex(out[j * (uSteps + 1) + i],
+                      x, y, z,
+                      x, y, z,
+                      theta / (2.0f * M_PI), phi / p.phiMax);
+        }
+    }
+}
+
+/**********************************************************
+ * ringScalar(...) - Row 0 the outer edge, row 1 the inner
+ **********************************************************/
+static void ringScalar(const MeshParams& p, MeshVertex* out)
+{
+    const int uSteps = p.uSteps;
+    float outerRadius = sin(p.phiMax);
+    float innerRadius = outerRadius * p.innerRadiusFactor;
+    float z           = cos(p.phiMax);
+    float texScale    = innerRadius / outerRadius;
+
+    for (int i = 0; i <= uSteps; ++i) {
+        float theta    = i * (2.0f * M_PI) / uSteps;
+        float cosTheta = cos(theta);
+        float sinTheta = sin(theta);
+
+        // Normal pointing downward (z = -1) for both edges
+        setVertex(out[i],
+                  outerRadius * cosTheta, outerRadius * sinTheta, z,
+                  0.0f, 0.0f, -1.0f,
+                  0.5f + 0.5f * cosTheta, 0.5f + 0.5f * sinTheta);
+        setVertex(out[(uSteps + 1) + i],
+                  innerRadius * cosTheta, innerRadius * sinTheta, z,
+                  0.0f, 0.0f, -1.0f,
+                  0.5f + 0.5f * texScale * cosTheta,
+                  0.5f + 0.5f * texScale * sinTheta);
+    }
+}
+
+/**********************************************************
+ * concaveScalar(...) - Row j at radius innerR*(1 - j/vSteps)
+ *
+ * Rising by concaveDepth*(j/vSteps) towards the middle.
+ **********************************************************/
+static void concaveScalar(const MeshParams& p, MeshVertex* out)
+{
+    const int uSteps = p.uSteps;
+    const int vSteps = p.vSteps;
+    float innerR = sin(p.phiMax) * p.innerRadiusFactor;
+    float zBase  = cos(p.phiMax);
+    float maxD   = p.concaveDepth;
+
+    for (int i = 0; i <= uSteps; ++i) {
+        float theta = i * (2.0f * M_PI) / uSteps;
+        float cosT  = cos(theta);
+        float sinT  = sin(theta);
+
+        // The normal only depends on theta: inward and up
+        float nx = -cosT;
+        float ny = -sinT;
+        float nz = maxD / innerR;
+        float len = sqrt(nx*nx + ny*ny + nz*nz);
+        if (len != 0.f) {
+            nx /= len; ny /= len; nz /= len;
+        }
+
+        for (int j = 0; j <= vSteps; ++j) {
+            float r = innerR * (1 - (float)j / vSteps);
+            float z = zBase + maxD * ((float)j / vSteps);
+            float x = r * cosT;
+            float y = r * sinT;
+            setVertex(out[j * (uSteps + 1) + i],
+                      x, y, z,
+                      nx, ny, nz,
+                      0.5f + 0.5f * (x / innerR), 0.5f + 0.5f * (y / innerR));
+        }
+    }
+}
+
+// --------------------------------------------------------
+// BATCHED SINCOS
+// --------------------------------------------------------
+
+// Cephes-style single precision sincos: x is reduced to
+// [-pi/4, pi/4] around the nearest even multiple j of pi/4
+// (pi/4 split in three parts so x - j*pi/4 stays exact), then
+// minimax polynomials give sin and cos; the octant j picks
+// which one is which and their signs. Max error ~1 ulp for
+// the angle range used here (0..2*pi).
+#define TESS_FOUR_OVER_PI 1.27323954473516f
+#define TESS_DP1          0.78515625f
+#define TESS_DP2          2.4187564849853515625e-4f
+#define TESS_DP3          3.77489497744594108e-8f
+#define TESS_SIN_P0      -1.9515295891e-4f
+#define TESS_SIN_P1       8.3321608736e-3f
+#define TESS_SIN_P2      -1.6666654611e-1f
+#define TESS_COS_P0       2.443315711809948e-5f
+#define TESS_COS_P1      -1.388731625493765e-3f
+#define TESS_COS_P2       4.166664568298827e-2f
+
+/**********************************************************
+ * sinCosLibm(...) - One angle at a time
+ **********************************************************/
+static void sinCosLibm(const float* angles, float* sines, float* cosines, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        sines[i]   = sinf(angles[i]);
+        cosines[i] = cosf(angles[i]);
+    }
+}
+
+#ifdef TESS_X86
+/**********************************************************
+ * sinCos4(...) - 4 lanes of the Cephes sincos
+ **********************************************************/
+__attribute__((target("sse2")))
+static inline void sinCos4(__m128 x, __m128& sinOut, __m128& cosOut)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+
+    // Even octant j and the reduced angle
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(TESS_FOUR_OVER_PI)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(j);
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(TESS_DP1)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(TESS_DP2)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(TESS_DP3)));
+
+    // Octant -> signs, and whether sin/cos swap polynomials
+    __m128i four = _mm_set1_epi32(4);
+    signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29)));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), four), 29));
+    __m128 noSwap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+        _mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+    __m128 z = _mm_mul_ps(x, x);
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TESS_COS_P0), z), _mm_set1_ps(TESS_COS_P1));
+    pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(TESS_COS_P2));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TESS_SIN_P0), z), _mm_set1_ps(TESS_SIN_P1));
+    ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(TESS_SIN_P2));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+    __m128 s = _mm_or_ps(_mm_and_ps(noSwap, ps), _mm_andnot_ps(noSwap, pc));
+    __m128 c = _mm_or_ps(_mm_and_ps(noSwap, pc), _mm_andnot_ps(noSwap, ps));
+    sinOut = _mm_xor_ps(s, signSin);
+    cosOut = _mm_xor_ps(c, signCos);
+}
+
+/**********************************************************
+ * sinCosSse2(...) - 4 angles per step, padded tail
+ **********************************************************/
+__attribute__((target("sse2")))
+static void sinCosSse2(const float* angles, float* sines, float* cosines, int n)
+{
+    int i = 0;
+    __m128 s, c;
+    for (; i + 4 <= n; i += 4) {
+        sinCos4(_mm_loadu_ps(angles + i), s, c);
+        _mm_storeu_ps(sines + i, s);
+        _mm_storeu_ps(cosines + i, c);
+    }
+    if (i < n) {
+        // Same kernel for the tail, so every column matches
+        float a[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, sv[4], cv[4];
+        memcpy(a, angles + i, (n - i) * sizeof(float));
+        sinCos4(_mm_loadu_ps(a), s, c);
+        _mm_storeu_ps(sv, s);
+        _mm_storeu_ps(cv, c);
+        memcpy(sines + i, sv, (n - i) * sizeof(float));
+        memcpy(cosines + i, cv, (n - i) * sizeof(float));
+    }
+}
+
+/**********************************************************
+ * sinCos8(...) - 8 lanes of the Cephes sincos
+ **********************************************************/
+__attribute__((target("avx2")))
+static inline void sinCos8(__m256 x, __m256& sinOut, __m256& cosOut)
+{
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    __m256 signSin = _mm256_and_ps(x, signMask);
+    x = _mm256_andnot_ps(signMask, x);
+
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TESS_FOUR_OVER_PI)));
+    j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(j);
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(TESS_DP1)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(TESS_DP2)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(TESS_DP3)));
+
+    __m256i four = _mm256_set1_epi32(4);
+    signSin = _mm256_xor_ps(signSin, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29)));
+    __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), four), 29));
+    __m256 noSwap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+        _mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+
+    __m256 z = _mm256_mul_ps(x, x);
+    __m256 pc = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TESS_COS_P0), z), _mm256_set1_ps(TESS_COS_P1));
+    pc = _mm256_add_ps(_mm256_mul_ps(pc, z), _mm256_set1_ps(TESS_COS_P2));
+    pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+    pc = _mm256_add_ps(_mm256_sub_ps(pc, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+    __m256 ps = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TESS_SIN_P0), z), _mm256_set1_ps(TESS_SIN_P1));
+    ps = _mm256_add_ps(_mm256_mul_ps(ps, z), _mm256_set1_ps(TESS_SIN_P2));
+    ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, z), x), x);
+
+    sinOut = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, noSwap), signSin);
+    cosOut = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, noSwap), signCos);
+}
+
+/**********************************************************
+ * sinCosAvx2(...) - 8 angles per step, padded tail
+ **********************************************************/
+__attribute__((target("avx2")))
+static void sinCosAvx2(const float* angles, float* sines, float* cosines, int n)
+{
+    int i = 0;
+    __m256 s, c;
+    for (; i + 8 <= n; i += 8) {
+        sinCos8(_mm256_loadu_ps(angles + i), s, c);
+        _mm256_storeu_ps(sines + i, s);
+        _mm256_storeu_ps(cosines + i, c);
+    }
+    if (i < n) {
+        float a[8] = { 0.0f }, sv[8], cv[8];
+        memcpy(a, angles + i, (n - i) * sizeof(float));
+        sinCos8(_mm256_loadu_ps(a), s, c);
+        _mm256_storeu_ps(sv, s);
+        _mm256_storeu_ps(cv, c);
+        memcpy(sines + i, sv, (n - i) * sizeof(float));
+        memcpy(cosines + i, cv, (n - i) * sizeof(float));
+    }
+}
+#endif
+
+/**********************************************************
+ * tessSinCos(...) - Batched sin/cos with the current backend
+ **********************************************************/
+void tessSinCos(const float* angles, float* sines, float* cosines, int n)
+{
+#ifdef TESS_X86
+    if (currentBackend == TESS_AVX2) { sinCosAvx2(angles, sines, cosines, n); return; }
+    if (currentBackend == TESS_SSE2) { sinCosSse2(angles, sines, cosines, n); return; }
+#endif
+    sinCosLibm(angles, sines, cosines, n);
+}
+
+// --------------------------------------------------------
+// ROW KERNELS
+// --------------------------------------------------------
+
+/**********************************************************
+ * rowScalar(...) - Columns [first, columns) one by one
+ **********************************************************/
+static void rowScalar(const RowTerms& t, const ColumnTables& cols,
+                      int first, MeshVertex* out)
+{
+    for (int i = first; i < cols.columns; ++i) {
+        float c = cols.cosTheta[i], s = cols.sinTheta[i], u = cols.texU[i];
+        float v[8];
+        for (int a = 0; a < 8; ++a)
+            v[a] = (t.c[a] * c + t.s[a] * s) + (t.u[a] * u + t.k[a]);
+        memcpy(&out[i], v, sizeof(v));
+    }
+}
+
+#ifdef TESS_X86
+/**********************************************************
+ * rowSse2(...) - 4 columns per step
+ *
+ * r[a] holds attribute a of 4 vertices; two 4x4 transposes
+ * turn that into the first and second half of each vertex.
+ **********************************************************/
+__attribute__((target("sse2")))
+static void rowSse2(const RowTerms& t, const ColumnTables& cols,
+                    MeshVertex* out, bool stream)
+{
+    int i = 0;
+    for (; i + 4 <= cols.columns; i += 4) {
+        __m128 c = _mm_loadu_ps(&cols.cosTheta[i]);
+        __m128 s = _mm_loadu_ps(&cols.sinTheta[i]);
+        __m128 u = _mm_loadu_ps(&cols.texU[i]);
+        __m128 r[8];
+        for (int a = 0; a < 8; ++a)
+            r[a] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(t.c[a])),
+                                         _mm_mul_ps(s, _mm_set1_ps(t.s[a]))),
+                              _mm_add_ps(_mm_mul_ps(u, _mm_set1_ps(t.u[a])),
+                                         _mm_set1_ps(t.k[a])));
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+
+        float* dst = (float*)(out + i);
+        for (int q = 0; q < 4; ++q) {
+            if (stream) {
+                _mm_stream_ps(dst + 8 * q,     r[q]);
+                _mm_stream_ps(dst + 8 * q + 4, r[4 + q]);
+            } else {
+                _mm_storeu_ps(dst + 8 * q,     r[q]);
+                _mm_storeu_ps(dst + 8 * q + 4, r[4 + q]);
+            }
+        }
+    }
+    rowScalar(t, cols, i, out);
+}
+
+/**********************************************************
+ * transpose8(...) - 8x8 float transpose in registers
+ **********************************************************/
+__attribute__((target("avx2")))
+static inline void transpose8(__m256* r)
+{
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+/**********************************************************
+ * rowAvx2(...) - 8 columns per step
+ *
+ * r[a] holds attribute a of 8 vertices; after the 8x8
+ * transpose r[q] is vertex q, exactly one MeshVertex.
+ **********************************************************/
+__attribute__((target("avx2")))
+static void rowAvx2(const RowTerms& t, const ColumnTables& cols,
+                    MeshVertex* out, bool stream)
+{
+    __m256 tc[8], ts[8], tu[8], tk[8];
+    for (int a = 0; a < 8; ++a) {
+        tc[a] = _mm256_set1_ps(t.c[a]);  ts[a] = _mm256_set1_ps(t.s[a]);
+        tu[a] = _mm256_set1_ps(t.u[a]);  tk[a] = _mm256_set1_ps(t.k[a]);
+    }
+
+    int i = 0;
+    for (; i + 8 <= cols.columns; i += 8) {
+        __m256 c = _mm256_loadu_ps(&cols.cosTheta[i]);
+        __m256 s = _mm256_loadu_ps(&cols.sinTheta[i]);
+        __m256 u = _mm256_loadu_ps(&cols.texU[i]);
+        __m256 r[8];
+        for (int a = 0; a < 8; ++a)
+            r[a] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c, tc[a]), _mm256_mul_ps(s, ts[a])),
+                                 _mm256_add_ps(_mm256_mul_ps(u, tu[a]), tk[a]));
+        transpose8(r);
+
+        float* dst = (float*)(out + i);
+        for (int q = 0; q < 8; ++q) {
+            if (stream) _mm256_stream_ps(dst + 8 * q, r[q]);
+            else        _mm256_storeu_ps(dst + 8 * q, r[q]);
+        }
+    }
+    rowScalar(t, cols, i, out);
+}
+#endif
+
+/**********************************************************
+ * emitRow(...) - One grid row with the current backend
+ **********************************************************/
+static void emitRow(const RowTerms& t, const ColumnTables& cols,
+                    MeshVertex* out, bool stream)
+{
+#ifdef TESS_X86
+    if (currentBackend == TESS_AVX2) { rowAvx2(t, cols, out, stream); return; }
+    if (currentBackend == TESS_SSE2) { rowSse2(t, cols, out, stream); return; }
+#endif
+    rowScalar(t, cols, 0, out);
+}
+
+// --------------------------------------------------------
+// COMPONENTS
+// --------------------------------------------------------
+
+/**********************************************************
+ * columnsOf(...) - cos/sin/U of theta = 0..2*pi
+ *
+ * Straight from the angle table, no trigonometry.
+ **********************************************************/
+static ColumnTables columnsOf(const TessTableView& table)
+{
+    ColumnTables cols = { table.uSteps + 1, table.cosTheta, table.sinTheta, table.texU };
+    return cols;
+}
+
+/**********************************************************
+ * capRows(...) - Row j: sin(phi) scales x/y, cos(phi) is z
+ **********************************************************/
+static void capRows(const MeshParams& p, MeshVertex* out, bool stream)
+{
+    TessTableView table = tessTable(p.uSteps, p.vSteps);
+    ColumnTables  cols  = columnsOf(table);
+
+    // phi depends on the shape, so its sin/cos stay per call
+    // (scratch from the arena, handed back at the end)
+    const int rows = p.vSteps + 1;
+    ArenaMark mark = arenaMark();
+    float* phi    = arenaArray<float>(rows);
+    float* sinPhi = arenaArray<float>(rows);
+    float* cosPhi = arenaArray<float>(rows);
+    float dPhi = p.phiMax / p.vSteps;
+    for (int j = 0; j < rows; ++j)
+        phi[j] = j * dPhi;
+    tessSinCos(phi, sinPhi, cosPhi, rows);
+
+    for (int j = 0; j < rows; ++j) {
+        RowTerms t;
+        memset(&t, 0, sizeof(t));
+        // Unit sphere: the normal equals the position
+        t.c[0] = t.c[3] = sinPhi[j];
+        t.s[1] = t.s[4] = sinPhi[j];
+        t.k[2] = t.k[5] = cosPhi[j];
+        t.u[6] = 1.0f;
+        t.k[7] = table.rowT[j];
+        emitRow(t, cols, out + j * cols.columns, stream);
+    }
+    arenaRewind(mark);
+}
+
+/**********************************************************
+ * ringRows(...) - Outer and inner edge at z = cos(phiMax)
+ **********************************************************/
+static void ringRows(const MeshParams& p, MeshVertex* out, bool stream)
+{
+    ColumnTables cols = columnsOf(tessTable(p.uSteps, 1));
+
+    float outerRadius = sinf(p.phiMax);
+    float z           = cosf(p.phiMax);
+    float radius[2]   = { outerRadius, outerRadius * p.innerRadiusFactor };
+    float texScale[2] = { 0.5f, 0.5f * p.innerRadiusFactor };
+
+    for (int j = 0; j < 2; ++j) {
+        RowTerms t;
+        memset(&t, 0, sizeof(t));
+        t.c[0] = radius[j];
+        t.s[1] = radius[j];
+        t.k[2] = z;
+        t.k[5] = -1.0f;                     // Normal pointing down
+        t.c[6] = texScale[j];  t.k[6] = 0.5f;
+        t.s[7] = texScale[j];  t.k[7] = 0.5f;
+        emitRow(t, cols, out + j * cols.columns, stream);
+    }
+}
+
+/**********************************************************
+ * concaveRows(...) - Row j shrinks and rises towards the middle
+ *
+ * The normal (-cos, -sin, depth/innerR) has the same length
+ * in every column, so it is affine in cos/sin as well.
+ **********************************************************/
+static void concaveRows(const MeshParams& p, MeshVertex* out, bool stream)
+{
+    TessTableView table = tessTable(p.uSteps, p.vSteps);
+    ColumnTables  cols  = columnsOf(table);
+
+    float innerR  = sinf(p.phiMax) * p.innerRadiusFactor;
+    float zBase   = cosf(p.phiMax);
+    float nz      = p.concaveDepth / innerR;
+    float invLen  = 1.0f / sqrtf(1.0f + nz * nz);
+
+    for (int j = 0; j <= p.vSteps; ++j) {
+        float f = 1.0f - table.rowT[j];   // Radius fraction
+        RowTerms t;
+        memset(&t, 0, sizeof(t));
+        t.c[0] = innerR * f;
+        t.s[1] = innerR * f;
+        t.k[2] = zBase + p.concaveDepth * table.rowT[j];
+        t.c[3] = -invLen;
+        t.s[4] = -invLen;
+        t.k[5] = nz * invLen;
+        t.c[6] = 0.5f * f;  t.k[6] = 0.5f;
+        t.s[7] = 0.5f * f;  t.k[7] = 0.5f;
+        emitRow(t, cols, out + j * cols.columns, stream);
+    }
+}
+
+/**********************************************************
+ * tessVertexCount(...) - Grid size of one component
+ **********************************************************/
+int tessVertexCount(MeshComponent component, const MeshParams& p)
+{
+    if (component == MESH_RING)
+        return (p.uSteps + 1) * 2;
+    return (p.uSteps + 1) * (p.vSteps + 1);
+}
+
+/**********************************************************
+ * tessellateVertices(...) - One component, current backend
+ **********************************************************/
+void tessellateVertices(MeshComponent component, const MeshParams& p,
+                        MeshVertex* out)
+{
+    if (currentBackend == TESS_SCALAR) {
+        switch (component) {
+            case MESH_CAP:     capScalar(p, out);     break;
+            case MESH_RING:    ringScalar(p, out);    break;
+            case MESH_CONCAVE: concaveScalar(p, out); break;
+            default:           break;
+        }
+        return;
+    }
+
+    // Non-temporal stores need aligned destinations
+    bool stream = false;
+#ifdef TESS_X86
+    size_t alignment = currentBackend == TESS_AVX2 ? 32 : 16;
+    stream = currentBackend >= TESS_SSE2 &&
+             tessVertexCount(component, p) >= TESS_STREAM_MIN_VERTICES &&
+             ((uintptr_t)out & (alignment - 1)) == 0;
+#endif
+
+    switch (component) {
+        case MESH_CAP:     capRows(p, out, stream);     break;
+        case MESH_RING:    ringRows(p, out, stream);    break;
+        case MESH_CONCAVE: concaveRows(p, out, stream); break;
+        default:           break;
+    }
+
+#ifdef TESS_X86
+    // Make the streamed data visible before GL reads it
+    if (stream)
+        _mm_sfence();
+#endif
+}
+
+// --------------------------------------------------------
+// BACKEND SELECTION
+// --------------------------------------------------------
+
+/**********************************************************
+ * tessBestBackend() - Widest kernel this CPU can run
+ **********************************************************/
+TessBackend tessBestBackend()
+{
+#ifdef TESS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TESS_AVX2;
+    if (__builtin_cpu_supports("sse2")) return TESS_SSE2;
+#endif
+    return TESS_TABLE;
+}
+
+/**********************************************************
+ * tessCurrentBackend() - Kernel tessellateVertices() uses
+ **********************************************************/
+TessBackend tessCurrentBackend()
+{
+    return currentBackend;
+}
+
+/**********************************************************
+ * tessSetBackend(...) - Force a kernel (for comparisons)
+ **********************************************************/
+TessBackend tessSetBackend(TessBackend backend)
+{
+    TessBackend best = tessBestBackend();
+    currentBackend = backend > best ? best : backend;
+    return currentBackend;
+}
+
+/**********************************************************
+ * tessBackendName(...) - For logs and bench output
+ **********************************************************/
+const char* tessBackendName(TessBackend backend)
+{
+    switch (backend) {
+        case TESS_AVX2:  return "avx2";
+        case TESS_SSE2:  return "sse2";
+        case TESS_TABLE: return "table";
+        default:         return "scalar";
+    }
+}
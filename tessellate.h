@@ -0,0 +1,53 @@
+/**********************************************************
+ *  Orator - tessellate.h
+ *
+ *  Vertex generation for the speaker meshes, fast enough to
+ *  re-run while the shape is being edited. Every part is a
+ *  grid of rows (phi or radius) by columns (theta), and each
+ *  vertex attribute is an affine function of its column's
+ *  cos(theta), sin(theta) and texture U:
+ *
+ *      attribute = c*cos(theta) + s*sin(theta) + u*U + k
+ *
+ *  with c, s, u, k fixed per row. So the trigonometry is
+ *  done once per row and per column (with a batched SIMD
+ *  sincos), not once per vertex.
+ *
+ *  The SIMD kernels evaluate 8 (AVX2) or 4 (SSE2) columns at
+ *  a time, one register per attribute (structure of arrays),
+ *  then transpose in registers into the interleaved
+ *  MeshVertex layout of the VBO. The widest kernel the CPU
+ *  supports is picked at run time, like the FFT (fft.h).
+ **********************************************************/
+#ifndef ORATOR_TESSELLATE_H
+#define ORATOR_TESSELLATE_H
+
+#include "mesh.h"
+
+enum TessBackend {
+    TESS_SCALAR = 0,   // Original per-vertex sin/cos loops
+    TESS_TABLE,        // Row/column tables, scalar rows (portable)
+    TESS_SSE2,
+    TESS_AVX2
+};
+
+// Vertices of one component for these params
+int tessVertexCount(MeshComponent component, const MeshParams& p);
+
+// Writes tessVertexCount() vertices in the same order as the
+// tessellate*() functions of mesh.h. 'out' may be a mapped
+// GL buffer; it is only written, never read.
+void tessellateVertices(MeshComponent component, const MeshParams& p,
+                        MeshVertex* out);
+
+// Batched sine and cosine of n angles
+void tessSinCos(const float* angles, float* sines, float* cosines, int n);
+
+// Best backend this CPU supports, and the one in use
+TessBackend tessBestBackend();
+TessBackend tessCurrentBackend();
+// Forces a backend (clamped to what the CPU supports)
+TessBackend tessSetBackend(TessBackend backend);
+const char* tessBackendName(TessBackend backend);
+
+#endif // ORATOR_TESSELLATE_H
@@ -0,0 +1,105 @@
+/**********************************************************
+ *  Orator - tesstable.cpp
+ *
+ *  Lookup of the compile-time angle tables and the run-time
+ *  fallback for other levels (see tesstable.h).
+ **********************************************************/
+#include "tesstable.h"
+
+#include <map>
+#include <vector>
+
+// Every (uSteps, vSteps) the LOD chain in lod.cpp draws: the
+// cap, the ring (one row) and the concavity of each level.
+// Keep in sync with lodLevels[]; a level missing here still
+// works, it just builds its table at run time.
+static constexpr TessTableView builtInTables[] = {
+    TessTable<100, 50>::view(), TessTable<100, 1>::view(), TessTable<100, 20>::view(),
+    TessTable< 64, 32>::view(), TessTable< 64, 1>::view(), TessTable< 64, 12>::view(),
+    TessTable< 32, 16>::view(), TessTable< 32, 1>::view(), TessTable< 32,  6>::view(),
+    TessTable< 16,  8>::view(), TessTable< 16, 1>::view(), TessTable< 16,  3>::view(),
+    TessTable<  8,  4>::view(), TessTable<  8, 1>::view(), TessTable<  8,  2>::view(),
+    TessTable<  6,  3>::view(), TessTable<  6, 1>::view(),
+};
+static const int builtInCount = sizeof(builtInTables) / sizeof(builtInTables[0]);
+
+// Evaluated by the compiler, or this would not compile
+static_assert(TessColumnTable<100>::cosTheta[25] == 0.0f &&
+              TessColumnTable<100>::sinTheta[100] == 0.0f,
+              "angle tables must be compile-time constants");
+
+// Run-time tables by step count. Map nodes never move, so
+// the views handed out stay valid.
+struct RuntimeColumns {
+    std::vector<float> cosTheta, sinTheta, texU;
+};
+static std::map<int, RuntimeColumns>     runtimeColumns;
+static std::map<int, std::vector<float> > runtimeRows;
+
+/**********************************************************
+ * columnsFor(...) - Cached columns of a non-shipped level
+ *
+ * Same functions as the compile-time tables, just evaluated
+ * now, so both give identical values.
+ **********************************************************/
+static const RuntimeColumns& columnsFor(int uSteps)
+{
+    std::map<int, RuntimeColumns>::iterator found = runtimeColumns.find(uSteps);
+    if (found != runtimeColumns.end())
+        return found->second;
+
+    RuntimeColumns& cols = runtimeColumns[uSteps];
+    cols.cosTheta.resize(uSteps + 1);
+    cols.sinTheta.resize(uSteps + 1);
+    cols.texU.resize(uSteps + 1);
+    for (int i = 0; i <= uSteps; ++i) {
+        cols.cosTheta[i] = tessTableCos(i, uSteps);
+        cols.sinTheta[i] = tessTableSin(i, uSteps);
+        cols.texU[i]     = (float)i / uSteps;
+    }
+    return cols;
+}
+
+/**********************************************************
+ * rowsFor(...) - Cached row fractions j / vSteps
+ **********************************************************/
+static const std::vector<float>& rowsFor(int vSteps)
+{
+    std::map<int, std::vector<float> >::iterator found = runtimeRows.find(vSteps);
+    if (found != runtimeRows.end())
+        return found->second;
+
+    std::vector<float>& rows = runtimeRows[vSteps];
+    rows.resize(vSteps + 1);
+    for (int j = 0; j <= vSteps; ++j)
+        rows[j] = (float)j / vSteps;
+    return rows;
+}
+
+/**********************************************************
+ * tessTableIsBuiltIn(...) - Is this level compiled in?
+ **********************************************************/
+bool tessTableIsBuiltIn(int uSteps, int vSteps)
+{
+    for (int i = 0; i < builtInCount; ++i)
+        if (builtInTables[i].uSteps == uSteps && builtInTables[i].vSteps == vSteps)
+            return true;
+    return false;
+}
+
+/**********************************************************
+ * tessTable(...) - Angle table of one level
+ **********************************************************/
+TessTableView tessTable(int uSteps, int vSteps)
+{
+    for (int i = 0; i < builtInCount; ++i)
+        if (builtInTables[i].uSteps == uSteps && builtInTables[i].vSteps == vSteps)
+            return builtInTables[i];
+
+    const RuntimeColumns&     cols = columnsFor(uSteps);
+    const std::vector<float>& rows = rowsFor(vSteps);
+    TessTableView v = { uSteps, vSteps,
+                        cols.cosTheta.data(), cols.sinTheta.data(), cols.texU.data(),
+                        rows.data() };
+    return v;
+}
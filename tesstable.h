@@ -0,0 +1,142 @@
+/**********************************************************
+ *  Orator - tesstable.h
+ *
+ *  Angle tables for the tessellation levels we ship. Every
+ *  part walks theta = 2*pi*i/uSteps around the axis and
+ *  j/vSteps along phi or the radius, and those only depend
+ *  on the step counts, not on the shape. So for the levels
+ *  of the LOD chain (lod.cpp) the compiler builds them:
+ *  TessTable<USteps, VSteps> holds constexpr arrays, and the
+ *  draw and tessellation code looks them up instead of
+ *  calling sin/cos. Any other level gets a table built at
+ *  run time on first use and cached.
+ *
+ *  The sines and cosines come from a Taylor series in
+ *  double precision on the first quadrant; the quadrant is
+ *  taken from the integer index, so the axis points
+ *  (0, 90, 180, 270 degrees) are exact and column uSteps
+ *  repeats column 0 bit for bit.
+ **********************************************************/
+#ifndef ORATOR_TESSTABLE_H
+#define ORATOR_TESSTABLE_H
+
+// Highest power of the Taylor series; for angles up to pi/2
+// the next term is below 1e-25
+#define TESS_TABLE_TAYLOR_POWER 27
+
+#define TESS_TABLE_HALF_PI 1.57079632679489661923
+
+// One level: uSteps + 1 columns and vSteps + 1 rows. The
+// pointers stay valid for the whole program.
+struct TessTableView {
+    int uSteps, vSteps;
+    const float* cosTheta;   // cos(2*pi*i/uSteps)
+    const float* sinTheta;   // sin(2*pi*i/uSteps)
+    const float* texU;       // i / uSteps
+    const float* rowT;       // j / vSteps
+};
+
+// Table for a level: compile-time for the shipped levels,
+// otherwise built once and cached (main thread only)
+TessTableView tessTable(int uSteps, int vSteps);
+
+// True if (uSteps, vSteps) is one of the compile-time levels
+bool tessTableIsBuiltIn(int uSteps, int vSteps);
+
+// --------------------------------------------------------
+// COMPILE-TIME MATH (C++11 constexpr: one return each)
+// --------------------------------------------------------
+
+// term + the rest of the series; each term is the previous
+// one times -x^2 / ((power+1)(power+2))
+constexpr double tessTaylor(double x2, double term, int power)
+{
+    return power > TESS_TABLE_TAYLOR_POWER ? 0.0
+         : term + tessTaylor(x2, -term * x2 / ((power + 1) * (power + 2)), power + 2);
+}
+
+// Angle of column i inside its quadrant, 0..pi/2
+constexpr double tessQuarterAngle(int i, int steps)
+{
+    return TESS_TABLE_HALF_PI * (double)((4 * i) % steps) / steps;
+}
+
+constexpr int tessQuadrant(int i, int steps)
+{
+    return ((4 * i) / steps) & 3;
+}
+
+constexpr double tessQuarterSin(double x) { return tessTaylor(x * x, x, 1); }
+constexpr double tessQuarterCos(double x) { return tessTaylor(x * x, 1.0, 0); }
+
+// sin/cos of 2*pi*i/steps from the quadrant symmetries
+constexpr float tessTableSin(int i, int steps)
+{
+    return (float)(tessQuadrant(i, steps) == 0 ?  tessQuarterSin(tessQuarterAngle(i, steps)) :
+                   tessQuadrant(i, steps) == 1 ?  tessQuarterCos(tessQuarterAngle(i, steps)) :
+                   tessQuadrant(i, steps) == 2 ? -tessQuarterSin(tessQuarterAngle(i, steps)) :
+                                                 -tessQuarterCos(tessQuarterAngle(i, steps)));
+}
+
+constexpr float tessTableCos(int i, int steps)
+{
+    return (float)(tessQuadrant(i, steps) == 0 ?  tessQuarterCos(tessQuarterAngle(i, steps)) :
+                   tessQuadrant(i, steps) == 1 ? -tessQuarterSin(tessQuarterAngle(i, steps)) :
+                   tessQuadrant(i, steps) == 2 ? -tessQuarterCos(tessQuarterAngle(i, steps)) :
+                                                  tessQuarterSin(tessQuarterAngle(i, steps)));
+}
+
+// --------------------------------------------------------
+// COMPILE-TIME TABLES
+// --------------------------------------------------------
+
+// 0, 1, ..., N-1 as a template parameter pack
+template<int... I> struct TessIndices {};
+template<int N, int... I> struct TessMakeIndices : TessMakeIndices<N - 1, N - 1, I...> {};
+template<int... I> struct TessMakeIndices<0, I...> { typedef TessIndices<I...> type; };
+
+// The uSteps + 1 columns of one level
+template<int USteps, typename = typename TessMakeIndices<USteps + 1>::type>
+struct TessColumnTable;
+
+template<int USteps, int... I>
+struct TessColumnTable<USteps, TessIndices<I...> > {
+    static constexpr float cosTheta[USteps + 1] = { tessTableCos(I, USteps)... };
+    static constexpr float sinTheta[USteps + 1] = { tessTableSin(I, USteps)... };
+    static constexpr float texU[USteps + 1]     = { (float)I / USteps... };
+};
+
+template<int USteps, int... I>
+constexpr float TessColumnTable<USteps, TessIndices<I...> >::cosTheta[USteps + 1];
+template<int USteps, int... I>
+constexpr float TessColumnTable<USteps, TessIndices<I...> >::sinTheta[USteps + 1];
+template<int USteps, int... I>
+constexpr float TessColumnTable<USteps, TessIndices<I...> >::texU[USteps + 1];
+
+// The vSteps + 1 row fractions of one level
+template<int VSteps, typename = typename TessMakeIndices<VSteps + 1>::type>
+struct TessRowTable;
+
+template<int VSteps, int... J>
+struct TessRowTable<VSteps, TessIndices<J...> > {
+    static constexpr float rowT[VSteps + 1] = { (float)J / VSteps... };
+};
+
+template<int VSteps, int... J>
+constexpr float TessRowTable<VSteps, TessIndices<J...> >::rowT[VSteps + 1];
+
+// A whole level. Tables of the same uSteps (cap, ring and
+// concavity of one LOD level) share their column arrays.
+template<int USteps, int VSteps>
+struct TessTable {
+    static constexpr TessTableView view()
+    {
+        return TessTableView{ USteps, VSteps,
+                              TessColumnTable<USteps>::cosTheta,
+                              TessColumnTable<USteps>::sinTheta,
+                              TessColumnTable<USteps>::texU,
+                              TessRowTable<VSteps>::rowT };
+    }
+};
+
+#endif // ORATOR_TESSTABLE_H
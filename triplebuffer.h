@@ -0,0 +1,68 @@
+/**********************************************************
+ *  Orator - triplebuffer.h
+ *
+ *  Wait-free hand-off of the latest value from one writer
+ *  thread to one reader thread. With only two slots the
+ *  writer would have to wait for the reader to let go of
+ *  the front slot; a third slot means each side always has
+ *  one to itself, and they only ever swap an index with one
+ *  atomic exchange. The reader sees the most recent
+ *  complete value and older ones are simply overwritten.
+ **********************************************************/
+#ifndef ORATOR_TRIPLEBUFFER_H
+#define ORATOR_TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Bit in 'middle' meaning "holds a value the reader has not seen"
+#define TRIPLE_FRESH 4
+
+template <typename T>
+struct TripleBuffer {
+    T slots[3];
+    int back;                  // Writer's slot (writer thread only)
+    int front;                 // Reader's slot (reader thread only)
+    std::atomic<int> middle;   // Slot index | TRIPLE_FRESH
+
+    TripleBuffer() : back(0), front(1), middle(2) {}
+};
+
+/**********************************************************
+ * tripleWriteSlot(...) - Writer: slot to fill in
+ **********************************************************/
+template <typename T>
+T& tripleWriteSlot(TripleBuffer<T>& tb)
+{
+    return tb.slots[tb.back];
+}
+
+/**********************************************************
+ * triplePublish(...) - Writer: hand the filled slot over
+ **********************************************************/
+template <typename T>
+void triplePublish(TripleBuffer<T>& tb)
+{
+    int old = tb.middle.exchange(tb.back | TRIPLE_FRESH, std::memory_order_acq_rel);
+    tb.back = old & 3;
+}
+
+/**********************************************************
+ * tripleRead(...) - Reader: latest value
+ *
+ * Returns true if it is newer than the previous call's.
+ * Either way 'value' stays valid until the next call.
+ **********************************************************/
+template <typename T>
+bool tripleRead(TripleBuffer<T>& tb, const T** value)
+{
+    bool fresh = false;
+    if (tb.middle.load(std::memory_order_relaxed) & TRIPLE_FRESH) {
+        int old = tb.middle.exchange(tb.front, std::memory_order_acq_rel);
+        tb.front = old & 3;
+        fresh = true;
+    }
+    *value = &tb.slots[tb.front];
+    return fresh;
+}
+
+#endif // ORATOR_TRIPLEBUFFER_H
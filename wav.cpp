@@ -0,0 +1,276 @@
+/**********************************************************
+ *  Orator - wav.cpp
+ *
+ *  Memory-mapped WAV source (see wav.h).
+ **********************************************************/
+#include "wav.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+
+// WAVE format tags
+#define WAV_FORMAT_PCM        0x0001
+#define WAV_FORMAT_FLOAT      0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+/**********************************************************
+ * readLE16/readLE32(...) - Little-endian integers
+ **********************************************************/
+static unsigned readLE16(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned long readLE32(const unsigned char* p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/**********************************************************
+ * adviseData(...) - madvise() on a byte range of the data
+ *
+ * madvise wants a page-aligned start, so the range is
+ * widened down to its page.
+ **********************************************************/
+static void adviseData(const WavSource& wav, size_t from, size_t to, int advice)
+{
+    if (to <= from) return;
+    static const uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)(wav.data + from) & ~(pageSize - 1);
+    uintptr_t end   = (uintptr_t)(wav.data + to);
+    madvise((void*)begin, end - begin, advice);
+}
+
+/**********************************************************
+ * wavOpen(...) - Maps the file, finds "fmt " and "data"
+ **********************************************************/
+bool wavOpen(WavSource& wav, const char* path)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    memset(&wav, 0, sizeof(wav));
+    wav.fd = open(path, O_RDONLY);
+    struct stat info;
+    if (wav.fd < 0 || fstat(wav.fd, &info) != 0) {
+        fprintf(stderr, "Cannot open WAV file '%s'\n", path);
+        wavClose(wav);
+        return false;
+    }
+    wav.mapSize = (size_t)info.st_size;
+    if (wav.mapSize < 12) {
+        fprintf(stderr, "'%s' is not a RIFF/WAVE file\n", path);
+        wavClose(wav);
+        return false;
+    }
+
+    // Nothing is read here: pages come in on first touch
+    void* map = mmap(NULL, wav.mapSize, PROT_READ, MAP_PRIVATE, wav.fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Cannot map WAV file '%s'\n", path);
+        wav.map = NULL;
+        wavClose(wav);
+        return false;
+    }
+    wav.map = (const unsigned char*)map;
+    madvise(map, wav.mapSize, MADV_SEQUENTIAL);
+
+    if (memcmp(wav.map, "RIFF", 4) != 0 || memcmp(wav.map + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "'%s' is not a RIFF/WAVE file\n", path);
+        wavClose(wav);
+        return false;
+    }
+
+    // Walk the chunk list in place
+    bool haveFormat = false, haveData = false;
+    unsigned formatTag = 0;
+    size_t dataBytes = 0;
+    size_t offset = 12;
+    while (!(haveFormat && haveData) && offset + 8 <= wav.mapSize) {
+        const unsigned char* chunk = wav.map + offset;
+        size_t size = readLE32(chunk + 4);
+        size_t body = offset + 8;
+        size_t available = wav.mapSize - body;
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && available >= 16) {
+            const unsigned char* fmt = wav.map + body;
+            formatTag         = readLE16(fmt);
+            wav.channels      = (int)readLE16(fmt + 2);
+            wav.sampleRate    = (int)readLE32(fmt + 4);
+            wav.blockAlign    = (int)readLE16(fmt + 12);
+            wav.bitsPerSample = (int)readLE16(fmt + 14);
+            // Extensible: the real tag is the start of the SubFormat GUID
+            if (formatTag == WAV_FORMAT_EXTENSIBLE && size >= 26 && available >= 26)
+                formatTag = readLE16(fmt + 24);
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            wav.data = wav.map + body;
+            // Recorders that were cut off (or stream-writers that put
+            // 0xFFFFFFFF here) leave a size past the end of the file
+            dataBytes = size < available ? size : available;
+            haveData = true;
+        }
+        offset = body + size + (size & 1);   // Chunks are word-aligned
+    }
+
+    if (!haveFormat || !haveData) {
+        fprintf(stderr, "'%s' has no fmt/data chunk\n", path);
+        wavClose(wav);
+        return false;
+    }
+
+    wav.isFloat = (formatTag == WAV_FORMAT_FLOAT);
+    bool supported =
+        (formatTag == WAV_FORMAT_PCM &&
+         (wav.bitsPerSample == 8 || wav.bitsPerSample == 16 ||
+          wav.bitsPerSample == 24 || wav.bitsPerSample == 32)) ||
+        (wav.isFloat && wav.bitsPerSample == 32);
+    if (!supported || wav.channels < 1 || wav.sampleRate <= 0 ||
+        wav.blockAlign != wav.channels * (wav.bitsPerSample / 8)) {
+        fprintf(stderr, "'%s': unsupported WAV format (tag %u, %d bits, %d channels)\n",
+                path, formatTag, wav.bitsPerSample, wav.channels);
+        wavClose(wav);
+        return false;
+    }
+
+    wav.bytesPerSample = wav.bitsPerSample / 8;
+    wav.dataSamples = dataBytes / wav.blockAlign * wav.channels;   // Whole frames only
+    wavRewind(wav);
+
+    wav.openMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return true;
+}
+
+/**********************************************************
+ * wavClose(...) - Unmaps and closes the file
+ **********************************************************/
+void wavClose(WavSource& wav)
+{
+    if (wav.map) munmap((void*)wav.map, wav.mapSize);
+    if (wav.fd >= 0) close(wav.fd);
+    wav.map = NULL;
+    wav.data = NULL;
+    wav.fd = -1;
+}
+
+/**********************************************************
+ * wavRewind(...) - Back to the first sample
+ **********************************************************/
+bool wavRewind(WavSource& wav)
+{
+    size_t dataBytes = wav.dataSamples * wav.bytesPerSample;
+    // The tail we were playing is not needed until the next lap
+    adviseData(wav, wav.releasedTo, dataBytes, MADV_DONTNEED);
+
+    wav.position = 0;
+    wav.releasedTo = 0;
+    wav.prefetchedTo = dataBytes < WAV_PREFETCH_BYTES ? dataBytes : WAV_PREFETCH_BYTES;
+    adviseData(wav, 0, wav.prefetchedTo, MADV_WILLNEED);
+    return true;
+}
+
+/**********************************************************
+ * wavSeekFrame(...) - Jump, keeping the advice consistent
+ **********************************************************/
+bool wavSeekFrame(WavSource& wav, size_t frame)
+{
+    size_t frames = wavFrameCount(wav);
+    if (frames == 0 || !wavRewind(wav))
+        return false;
+    size_t dataBytes = wav.dataSamples * wav.bytesPerSample;
+    wav.position = (frame % frames) * wav.channels;
+
+    // Read ahead from the new position instead of the start
+    size_t startByte = wav.position * wav.bytesPerSample;
+    adviseData(wav, 0, wav.prefetchedTo, MADV_DONTNEED);
+    wav.releasedTo   = startByte;
+    wav.prefetchedTo = dataBytes - startByte < WAV_PREFETCH_BYTES
+                     ? dataBytes : startByte + WAV_PREFETCH_BYTES;
+    adviseData(wav, startByte, wav.prefetchedTo, MADV_WILLNEED);
+    return true;
+}
+
+/**********************************************************
+ * wavNextSamples(...) - Slice of the mapping + read-ahead
+ **********************************************************/
+size_t wavNextSamples(WavSource& wav, size_t maxSamples, const unsigned char** pcm)
+{
+    size_t left = wav.dataSamples - wav.position;
+    size_t count = maxSamples < left ? maxSamples : left;
+    *pcm = wav.data + wav.position * wav.bytesPerSample;
+    if (count == 0) return 0;
+
+    size_t dataBytes = wav.dataSamples * wav.bytesPerSample;
+    size_t startByte = wav.position * wav.bytesPerSample;
+    size_t endByte   = startByte + count * wav.bytesPerSample;
+
+    // Keep at least half a window of read-ahead in flight, so the
+    // decoder never waits for the disk
+    if (wav.prefetchedTo < dataBytes && endByte + WAV_PREFETCH_BYTES / 2 > wav.prefetchedTo) {
+        size_t to = endByte + WAV_PREFETCH_BYTES;
+        if (to > dataBytes) to = dataBytes;
+        adviseData(wav, wav.prefetchedTo, to, MADV_WILLNEED);
+        wav.prefetchedTo = to;
+    }
+    // Drop what was played more than a window ago. The mapping is
+    // read-only and file-backed, so the pages just fall back to
+    // the page cache (and are re-read if we ever loop).
+    if (startByte > wav.releasedTo + 2 * WAV_PREFETCH_BYTES) {
+        size_t to = startByte - WAV_PREFETCH_BYTES;
+        adviseData(wav, wav.releasedTo, to, MADV_DONTNEED);
+        wav.releasedTo = to;
+    }
+
+    wav.position += count;
+    return count;
+}
+
+/**********************************************************
+ * wavConvert(...) - Raw samples -> floats in [-1, 1]
+ **********************************************************/
+void wavConvert(const WavSource& wav, const unsigned char* p, size_t count, float* out)
+{
+    if (wav.isFloat) {
+        memcpy(out, p, count * sizeof(float));   // Little-endian host assumed
+    } else if (wav.bitsPerSample == 8) {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = ((int)p[i] - 128) * (1.0f / 128.0f);
+    } else if (wav.bitsPerSample == 16) {
+        for (size_t i = 0; i < count; ++i, p += 2)
+            out[i] = (short)readLE16(p) * (1.0f / 32768.0f);
+    } else if (wav.bitsPerSample == 24) {
+        for (size_t i = 0; i < count; ++i, p += 3) {
+            int v = (p[0] << 8) | (p[1] << 16) | (p[2] << 24);   // Sign lands in bit 31
+            out[i] = (v >> 8) * (1.0f / 8388608.0f);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i, p += 4)
+            out[i] = (int)readLE32(p) * (1.0f / 2147483648.0f);
+    }
+}
+
+/**********************************************************
+ * wavRead(...) - Slice + convert whole frames
+ **********************************************************/
+size_t wavRead(WavSource& wav, float* out, size_t maxFrames)
+{
+    const unsigned char* pcm;
+    size_t count = wavNextSamples(wav, maxFrames * wav.channels, &pcm);
+    wavConvert(wav, pcm, count, out);
+    return count / wav.channels;
+}
+
+/**********************************************************
+ * wavFrameCount(...) - Length of the data chunk in frames
+ **********************************************************/
+size_t wavFrameCount(const WavSource& wav)
+{
+    return wav.channels > 0 ? wav.dataSamples / wav.channels : 0;
+}
@@ -0,0 +1,74 @@
+/**********************************************************
+ *  Orator - wav.h
+ *
+ *  Memory-mapped WAV source for the audio decoder thread.
+ *  The file is mapped read-only and its RIFF chunks are
+ *  parsed in place, so opening costs the same for a
+ *  3-second clip and a 3-hour recording. PCM is handed out
+ *  as slices of the mapping (no read() copies). While
+ *  playing, the source asks the kernel to read ahead
+ *  (MADV_WILLNEED) and drops pages already played
+ *  (MADV_DONTNEED), so resident memory stays at a few MB.
+ *
+ *  Formats: 8/16/24/32-bit integer PCM or 32-bit float
+ *  (plain or WAVE_FORMAT_EXTENSIBLE), converted to
+ *  interleaved floats in [-1, 1].
+ **********************************************************/
+#ifndef ORATOR_WAV_H
+#define ORATOR_WAV_H
+
+#include <stddef.h>
+
+// Bytes read ahead of (and kept behind) the play position
+#define WAV_PREFETCH_BYTES (4u << 20)
+
+// An open, mapped WAV file
+struct WavSource {
+    int    fd;
+    const unsigned char* map;    // Whole file, read-only
+    size_t mapSize;
+
+    int    channels;
+    int    sampleRate;
+    int    bitsPerSample;
+    int    bytesPerSample;
+    bool   isFloat;        // IEEE float instead of integer PCM
+    int    blockAlign;     // Bytes per frame (all channels)
+
+    const unsigned char* data;   // First sample, inside map
+    size_t dataSamples;          // Samples (all channels) in "data"
+    size_t position;             // Next sample to hand out
+
+    size_t prefetchedTo;   // Byte offset (in data) already advised
+    size_t releasedTo;     // Byte offset (in data) already dropped
+    double openMs;         // Time spent in wavOpen()
+};
+
+// Maps the file and parses the header; prints a reason and
+// returns false on failure
+bool wavOpen(WavSource& wav, const char* path);
+void wavClose(WavSource& wav);
+
+// Zero-copy read: *pcm points at up to maxSamples raw samples
+// in the mapping, and the position moves past them. Returns
+// the number of samples (not frames); 0 at the end of the data.
+size_t wavNextSamples(WavSource& wav, size_t maxSamples, const unsigned char** pcm);
+
+// Converts count raw samples (from wavNextSamples) to floats
+void wavConvert(const WavSource& wav, const unsigned char* pcm, size_t count, float* out);
+
+// Convenience: slice + convert up to maxFrames whole frames.
+// Returns the number of frames; 0 at the end of the data.
+size_t wavRead(WavSource& wav, float* out, size_t maxFrames);
+
+// Back to the first sample (for looping)
+bool wavRewind(WavSource& wav);
+
+// Continue from 'frame' (modulo the length), e.g. so many
+// sources playing one file do not start in phase
+bool wavSeekFrame(WavSource& wav, size_t frame);
+
+// Frames in the data chunk
+size_t wavFrameCount(const WavSource& wav);
+
+#endif // ORATOR_WAV_H